@@ -3,8 +3,8 @@
    Program:    
    File:       KabCho.c
    
-   Version:    V1.2
-   Date:       30.05.96
+   Version:    V1.3
+   Date:       16.10.26
    Function:   Convert Kabat antibody numbering to Chothia numbering
    
    Copyright:  (c) UCL / Dr. Andrew C. R. Martin 1996
@@ -51,6 +51,7 @@
    V1.0  07.05.96 Original
    V1.1  08.05.96 Corrected 10-residue L1s
    V1.2  30.05.96 Changed variable name in ChoKab()
+   V1.3  16.10.26 Added KabChoTable()
 
 *************************************************************************/
 /* Includes
@@ -264,3 +265,37 @@ char *ChoKab(char *cdr, int length, char *chospec)
    */
    return(chospec);
 }
+
+
+/************************************************************************/
+/*>char **KabChoTable(char *cdr, int *maxLength, int *rowSize)
+   -----------------------------------------------------------
+   Input:   char   *cdr       The CDR-ID (L1 or H1)
+   Output:  int    *maxLength The longest CDR length in the table
+            int    *rowSize   Number of entries in each row (including
+                              the terminating NULL)
+   Returns: char   **         The conversion table (row 0 then a row for
+                              each length), NULL if the CDR has none
+
+   Gives access to the conversion tables used by KabCho() and ChoKab()
+   so that they may be compiled into direct lookups.
+
+   16.10.26 Original   By: ACRM
+*/
+char **KabChoTable(char *cdr, int *maxLength, int *rowSize)
+{
+   if(!strncmp(cdr,"L1",2))
+   {
+      *maxLength = MAXLEN_L1;
+      *rowSize   = sizeof(sL1Table[0]) / sizeof(sL1Table[0][0]);
+      return(&(sL1Table[0][0]));
+   }
+   else if(!strncmp(cdr,"H1",2))
+   {
+      *maxLength = MAXLEN_H1;
+      *rowSize   = sizeof(sH1Table[0]) / sizeof(sH1Table[0][0]);
+      return(&(sH1Table[0][0]));
+   }
+
+   return(NULL);
+}
@@ -0,0 +1,1401 @@
+/*************************************************************************
+
+   Program:    Chothia
+   File:       arrow.c
+
+   Version:    V2.20
+   Date:       16.10.26
+   Function:   Write canonical class assignments as an Apache Arrow IPC
+               file
+
+   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2026
+   Author:     Prof. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Part of libchothia. Writes the CANONRESULTS of many records as an
+   Arrow IPC file (format version V5) which may be memory mapped and
+   read without copying by Arrow based tools. The file has the columns:
+
+   id               utf8     Record ID (null if none)
+   and for each CDR (L1, L2, L3, H1, H2, H3):
+   xx_class         dictionary<int32, utf8>  Class assigned (null if
+                                             none matches or the loop
+                                             was not found)
+   xx_length        int32    Loop length (null if the loop was not
+                             found or the CDR was not processed)
+   xx_similar       dictionary<int32, utf8>  Nearest class if none
+                                             matches
+   xx_mismatches    int32    Key residues mismatching the nearest class
+                             (0 if a class matches)
+
+   The dictionaries are the class names for each CDR in the canonical
+   definitions, so the indices are the same in every record batch and
+   for every file written with the same definitions. Records are
+   written in batches of ARROWBATCH rows, so memory use does not
+   depend on the number of records.
+
+   Arrow metadata are FlatBuffers. These are built with the minimal
+   FlatBuffer builder here which, like the standard one, builds the
+   buffer from the end backwards so that objects are created before
+   the objects which refer to them.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.15 16.10.26 Original
+   V2.20 16.10.26 Added the CDR-H3 columns
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chothia.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define ARROWBATCH    16384      /* Rows per record batch               */
+#define ARROWMAGIC    "ARROW1"   /* File start and end                  */
+#define NCDRCOL       4          /* Columns per CDR                     */
+#define NINTCOL       (NCDR * NCDRCOL)
+#define NARROWCOL     (1 + NINTCOL)
+                                 /* Columns: ID then those of each CDR  */
+#define COL_CLASS     0          /* Offsets of the CDR columns          */
+#define COL_LENGTH    1
+#define COL_SIMILAR   2
+#define COL_MISMATCH  3
+#define MAXFBFIELDS   8          /* Max fields in a FlatBuffer table    */
+#define MAXARROWBUF   (3 + 2 * NINTCOL)
+                                 /* Max buffers in a record batch       */
+
+#define ARROW_V5         4       /* Arrow MetadataVersion               */
+#define ARROW_SCHEMA     1       /* Arrow MessageHeader types           */
+#define ARROW_DICTBATCH  2
+#define ARROW_RECBATCH   3
+#define ARROW_INT        2       /* Arrow Type types                    */
+#define ARROW_UTF8       5
+
+/* Round up to a multiple of 8 bytes as required for Arrow buffers      */
+#define ARROWALIGN(x) (((x) + 7) & ~((size_t)7))
+
+/* Set or clear bit n of a validity bitmap                              */
+#define SETVALID(b, n, v) ((v) ? ((b)[(n)>>3] |=  (1 << ((n)&7)))    \
+                               : ((b)[(n)>>3] &= ~(1 << ((n)&7))))
+
+/* A FlatBuffer under construction. Data are added at the start of the
+   used part of the buffer, which is at the end of the allocation, so
+   positions are measured from the end                                  */
+typedef struct
+{
+   unsigned char *data;             /* Allocated buffer                 */
+   size_t        cap,               /* Size of allocation               */
+                 size,              /* Bytes used (at end of data)      */
+                 objStart,          /* Position of current table start  */
+                 fieldPos[MAXFBFIELDS];
+                                    /* Positions of its fields (0 if
+                                       absent)                          */
+   int           nFields,           /* Fields in current table          */
+                 minAlign;          /* Largest alignment used           */
+   BOOL          error;             /* Out of memory?                   */
+}  FLATBUF;
+
+/* The body of an Arrow message, with the node and buffer descriptions
+   which go in its RecordBatch header                                   */
+typedef struct
+{
+   unsigned char *data;             /* Buffers, each 8 byte aligned     */
+   size_t        size,
+                 cap;
+   unsigned long nodes[2 * NARROWCOL],
+                                    /* Length and null count of columns */
+                 buffers[2 * MAXARROWBUF];
+                                    /* Offset and length of buffers     */
+   int           nNodes,
+                 nBuffers;
+   BOOL          error;
+}  ARROWBODY;
+
+/* Position of a message in the file, for the footer (array)            */
+typedef struct
+{
+   unsigned long offset,            /* Offset of message in file        */
+                 bodyLength;        /* Length of message body           */
+   int           metaLength;        /* Length of message metadata       */
+}  ARROWBLOCK;
+
+/* State of an Arrow file being written                                 */
+struct _arrowwriter
+{
+   FILE          *out;
+   char          **dict[NCDR];      /* Class names of each CDR (point
+                                       into the canonical definitions)  */
+   int           nDict[NCDR];
+   unsigned long position;          /* Bytes written to file            */
+   ARROWBLOCK    dictBlocks[2 * NCDR],
+                 *batchBlocks;      /* Dictionaries and record batches
+                                       written                          */
+   int           nDictBlocks,
+                 nBatchBlocks,
+                 maxBatchBlocks;
+   int           nRows,             /* Rows in current batch            */
+                 *values[NINTCOL],  /* Values of int/dictionary columns */
+                 nullCount[NARROWCOL],
+                 *idOffsets;        /* Offsets of IDs in idData         */
+   unsigned char *valid[NARROWCOL]; /* Validity bitmaps of columns      */
+   char          *idData;           /* IDs of current batch             */
+   size_t        idSize,
+                 idCap;
+   BOOL          error;             /* Write failed or out of memory    */
+};
+
+/************************************************************************/
+/* Prototypes
+*/
+BOOL   FBInit(FLATBUF *fb);
+void   FBReserve(FLATBUF *fb, size_t n);
+void   FBPrep(FLATBUF *fb, int align, size_t extra);
+void   FBPush(FLATBUF *fb, unsigned long value, int nbytes);
+void   FBPushOffset(FLATBUF *fb, size_t offset);
+size_t FBString(FLATBUF *fb, char *string);
+size_t FBOffsetVector(FLATBUF *fb, size_t *offsets, int n);
+size_t FBPairVector(FLATBUF *fb, unsigned long *values, int n);
+size_t FBBlockVector(FLATBUF *fb, ARROWBLOCK *blocks, int n);
+void   FBStartTable(FLATBUF *fb, int nFields);
+void   FBAddScalar(FLATBUF *fb, int field, unsigned long value,
+                   int nbytes);
+void   FBAddOffset(FLATBUF *fb, int field, size_t offset);
+size_t FBEndTable(FLATBUF *fb);
+void   FBFinish(FLATBUF *fb, size_t root);
+size_t ArrowAddSchema(FLATBUF *fb);
+size_t ArrowAddField(FLATBUF *fb, char *name, int type, long dictId);
+size_t ArrowAddIntType(FLATBUF *fb);
+size_t ArrowAddRecordBatch(FLATBUF *fb, int length, ARROWBODY *body);
+size_t ArrowAddMessage(FLATBUF *fb, int headerType, size_t header,
+                       ARROWBODY *body);
+void   ArrowBodyAddNode(ARROWBODY *body, int length, int nullCount);
+void   ArrowBodyAddBuffer(ARROWBODY *body, void *data, size_t length);
+void   ArrowWriteBytes(ARROWWRITER *writer, void *data, size_t length);
+void   ArrowWriteMessage(ARROWWRITER *writer, FLATBUF *fb,
+                         ARROWBODY *body, ARROWBLOCK *block);
+void   ArrowWriteDictionaries(ARROWWRITER *writer);
+void   ArrowFlushBatch(ARROWWRITER *writer);
+void   ArrowWriteFooter(ARROWWRITER *writer);
+int    ArrowDictIndex(ARROWWRITER *writer, int cdr, char *name);
+void   FreeArrowWriter(ARROWWRITER *writer);
+
+
+/************************************************************************/
+/*>ARROWWRITER *OpenArrowWriter(FILE *out, CHOTHIADATA *data)
+   ----------------------------------------------------------
+   Input:   FILE         *out    Output file pointer
+            CHOTHIADATA  *data   Canonical definitions
+   Returns: ARROWWRITER  *       Arrow writer (NULL if no memory or the
+                                 file could not be written)
+
+   Starts writing an Arrow IPC file of canonical assignments. The
+   schema and the dictionaries of class names from the canonical
+   definitions are written immediately. The definitions must not be
+   freed until the writer has been closed.
+
+   16.10.26 Original    By: ACRM
+*/
+ARROWWRITER *OpenArrowWriter(FILE *out, CHOTHIADATA *data)
+{
+   ARROWWRITER *writer;
+   CANONTABLE  *table = &(data->table);
+   FLATBUF     fb;
+   char        *name;
+   int         i, j,
+               loop;
+
+   if((writer = (ARROWWRITER *)calloc(1, sizeof(ARROWWRITER)))==NULL)
+      return(NULL);
+   writer->out = out;
+
+   /* Space for a record batch                                          */
+   writer->idCap = ARROWBATCH * SMALLWORD;
+   if(((writer->idData = (char *)malloc(writer->idCap))==NULL) ||
+      ((writer->idOffsets = (int *)malloc((ARROWBATCH+1) * sizeof(int)))
+       ==NULL))
+      writer->error = TRUE;
+   for(i=0; i<NINTCOL; i++)
+   {
+      if((writer->values[i] = (int *)calloc(ARROWBATCH, sizeof(int)))
+         ==NULL)
+         writer->error = TRUE;
+   }
+   for(i=0; i<NARROWCOL; i++)
+   {
+      if((writer->valid[i] = (unsigned char *)calloc(ARROWBATCH/8, 1))
+         ==NULL)
+         writer->error = TRUE;
+   }
+
+   /* Dictionaries of the distinct class names for each CDR             */
+   for(loop=0; loop<NCDR; loop++)
+   {
+      if((writer->dict[loop] = (char **)malloc((table->nClass+1) *
+                                               sizeof(char *)))==NULL)
+      {
+         writer->error = TRUE;
+         continue;
+      }
+      for(i=0; i<table->nClass; i++)
+      {
+         if(table->classes[i].loop != loop)
+            continue;
+         name = table->strings + table->classes[i].name;
+         for(j=0; j<writer->nDict[loop]; j++)
+         {
+            if(!strcmp(writer->dict[loop][j], name))
+               break;
+         }
+         if(j == writer->nDict[loop])
+            writer->dict[loop][writer->nDict[loop]++] = name;
+      }
+   }
+
+   if(writer->error)
+   {
+      FreeArrowWriter(writer);
+      return(NULL);
+   }
+
+   /* File header, schema and dictionaries                              */
+   ArrowWriteBytes(writer, ARROWMAGIC "\0", 8);
+   if(FBInit(&fb))
+   {
+      FBFinish(&fb, ArrowAddMessage(&fb, ARROW_SCHEMA,
+                                    ArrowAddSchema(&fb), NULL));
+      ArrowWriteMessage(writer, &fb, NULL, NULL);
+      free(fb.data);
+   }
+   else
+   {
+      writer->error = TRUE;
+   }
+   ArrowWriteDictionaries(writer);
+
+   if(writer->error)
+   {
+      FreeArrowWriter(writer);
+      return(NULL);
+   }
+
+   return(writer);
+}
+
+
+/************************************************************************/
+/*>BOOL WriteArrowRecord(ARROWWRITER *writer, char *id,
+                         CANONRESULTS *results)
+   ----------------------------------------------------
+   Input:   ARROWWRITER  *writer   Arrow writer
+            char         *id       ID of the record (or NULL)
+            CANONRESULTS *results  Canonical classes assigned
+   Returns: BOOL                   Success?
+
+   Adds a row to an Arrow file. A record batch is written each time
+   ARROWBATCH rows have been added.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL WriteArrowRecord(ARROWWRITER *writer, char *id,
+                      CANONRESULTS *results)
+{
+   CANONRESULT *result;
+   int         row = writer->nRows,
+               loop,
+               col,
+               value[NCDRCOL],
+               i;
+   size_t      len;
+   BOOL        found;
+
+   if(writer->error)
+      return(FALSE);
+
+   /* ID                                                                */
+   writer->idOffsets[0] = 0;
+   len = ((id == NULL) ? 0 : strlen(id));
+   if(writer->idSize + len > writer->idCap)
+   {
+      char *newData;
+
+      if((newData = (char *)realloc(writer->idData,
+                                    2 * (writer->idSize + len)))==NULL)
+      {
+         writer->error = TRUE;
+         return(FALSE);
+      }
+      writer->idData = newData;
+      writer->idCap  = 2 * (writer->idSize + len);
+   }
+   if(len)
+      memcpy(writer->idData + writer->idSize, id, len);
+   writer->idSize += len;
+   writer->idOffsets[row+1] = writer->idSize;
+   SETVALID(writer->valid[0], row, len);
+   if(!len)
+      writer->nullCount[0]++;
+
+   /* Columns of each CDR. A value of -1 is null                        */
+   for(loop=0; loop<NCDR; loop++)
+   {
+      result = &(results->cdr[loop]);
+      for(i=0; i<NCDRCOL; i++)
+         value[i] = (-1);
+
+      found = ((loop >= results->firstCDR) &&
+               (loop < results->lastCDR) &&
+               (result->status != CANON_MISSING));
+      if(found)
+      {
+         value[COL_LENGTH] = result->length;
+         if(result->status == CANON_MATCH)
+         {
+            value[COL_CLASS]    = ArrowDictIndex(writer, loop,
+                                                 result->className);
+            value[COL_MISMATCH] = 0;
+         }
+         else
+         {
+            value[COL_SIMILAR]  = ArrowDictIndex(writer, loop,
+                                                 result->similar);
+            value[COL_MISMATCH] = result->nMismatch;
+         }
+      }
+
+      for(i=0; i<NCDRCOL; i++)
+      {
+         col = loop * NCDRCOL + i;
+         writer->values[col][row] = ((value[i] < 0) ? 0 : value[i]);
+         SETVALID(writer->valid[col+1], row, (value[i] >= 0));
+         if(value[i] < 0)
+            writer->nullCount[col+1]++;
+      }
+   }
+
+   if(++writer->nRows == ARROWBATCH)
+      ArrowFlushBatch(writer);
+
+   return(!writer->error);
+}
+
+
+/************************************************************************/
+/*>BOOL CloseArrowWriter(ARROWWRITER *writer)
+   ------------------------------------------
+   Input:   ARROWWRITER  *writer   Arrow writer
+   Returns: BOOL                   Was the whole file written?
+
+   Writes any remaining rows and the file footer and frees the writer.
+   The output file is not closed.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL CloseArrowWriter(ARROWWRITER *writer)
+{
+   BOOL ok;
+
+   ArrowFlushBatch(writer);
+   ArrowWriteFooter(writer);
+
+   ok = !writer->error;
+   FreeArrowWriter(writer);
+
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>void FreeArrowWriter(ARROWWRITER *writer)
+   -----------------------------------------
+   Input:   ARROWWRITER  *writer   Arrow writer
+
+   Frees an Arrow writer without completing the file
+
+   16.10.26 Original    By: ACRM
+*/
+void FreeArrowWriter(ARROWWRITER *writer)
+{
+   int i;
+
+   for(i=0; i<NCDR; i++)
+   {
+      if(writer->dict[i] != NULL)
+         free(writer->dict[i]);
+   }
+   for(i=0; i<NINTCOL; i++)
+   {
+      if(writer->values[i] != NULL)
+         free(writer->values[i]);
+   }
+   for(i=0; i<NARROWCOL; i++)
+   {
+      if(writer->valid[i] != NULL)
+         free(writer->valid[i]);
+   }
+   if(writer->idData != NULL)
+      free(writer->idData);
+   if(writer->idOffsets != NULL)
+      free(writer->idOffsets);
+   if(writer->batchBlocks != NULL)
+      free(writer->batchBlocks);
+   free(writer);
+}
+
+
+/************************************************************************/
+/*>int ArrowDictIndex(ARROWWRITER *writer, int cdr, char *name)
+   ------------------------------------------------------------
+   Input:   ARROWWRITER  *writer   Arrow writer
+            int          cdr       CDR number
+            char         *name     Class name
+   Returns: int                    Index in dictionary (-1 if not found)
+
+   Finds the dictionary index of a class name.
+
+   16.10.26 Original    By: ACRM
+*/
+int ArrowDictIndex(ARROWWRITER *writer, int cdr, char *name)
+{
+   int i;
+
+   if(name == NULL)
+      return(-1);
+
+   /* Normally the same string as in the dictionary                     */
+   for(i=0; i<writer->nDict[cdr]; i++)
+   {
+      if(writer->dict[cdr][i] == name)
+         return(i);
+   }
+   for(i=0; i<writer->nDict[cdr]; i++)
+   {
+      if(!strcmp(writer->dict[cdr][i], name))
+         return(i);
+   }
+
+   return(-1);
+}
+
+
+/************************************************************************/
+/*>void ArrowFlushBatch(ARROWWRITER *writer)
+   -----------------------------------------
+   I/O:     ARROWWRITER  *writer   Arrow writer
+
+   Writes the rows added since the last record batch as a new record
+   batch.
+
+   16.10.26 Original    By: ACRM
+*/
+void ArrowFlushBatch(ARROWWRITER *writer)
+{
+   ARROWBODY  body;
+   ARROWBLOCK *blocks;
+   FLATBUF    fb;
+   int        nRows = writer->nRows,
+              nBitmap = (writer->nRows + 7) / 8,
+              i;
+
+   if((nRows == 0) || writer->error)
+      return;
+
+   if(writer->nBatchBlocks == writer->maxBatchBlocks)
+   {
+      writer->maxBatchBlocks = 2 * writer->maxBatchBlocks + 16;
+      if((blocks = (ARROWBLOCK *)realloc(writer->batchBlocks,
+                                         writer->maxBatchBlocks *
+                                         sizeof(ARROWBLOCK)))==NULL)
+      {
+         writer->error = TRUE;
+         return;
+      }
+      writer->batchBlocks = blocks;
+   }
+
+   /* Body with the validity, offsets and data of the ID column and the
+      validity and values of the others. Bitmaps are left out when
+      there are no nulls
+   */
+   memset(&body, 0, sizeof(ARROWBODY));
+   ArrowBodyAddNode(&body, nRows, writer->nullCount[0]);
+   ArrowBodyAddBuffer(&body, writer->valid[0],
+                      writer->nullCount[0] ? nBitmap : 0);
+   ArrowBodyAddBuffer(&body, writer->idOffsets, (nRows+1) * sizeof(int));
+   ArrowBodyAddBuffer(&body, writer->idData, writer->idSize);
+   for(i=0; i<NINTCOL; i++)
+   {
+      ArrowBodyAddNode(&body, nRows, writer->nullCount[i+1]);
+      ArrowBodyAddBuffer(&body, writer->valid[i+1],
+                         writer->nullCount[i+1] ? nBitmap : 0);
+      ArrowBodyAddBuffer(&body, writer->values[i], nRows * sizeof(int));
+   }
+
+   if(body.error || !FBInit(&fb))
+   {
+      writer->error = TRUE;
+   }
+   else
+   {
+      FBFinish(&fb, ArrowAddMessage(&fb, ARROW_RECBATCH,
+                                    ArrowAddRecordBatch(&fb, nRows,
+                                                        &body),
+                                    &body));
+      ArrowWriteMessage(writer, &fb, &body,
+                        &(writer->batchBlocks[writer->nBatchBlocks++]));
+      free(fb.data);
+   }
+   if(body.data != NULL)
+      free(body.data);
+
+   /* Start the next batch                                              */
+   writer->nRows  = 0;
+   writer->idSize = 0;
+   for(i=0; i<NARROWCOL; i++)
+      writer->nullCount[i] = 0;
+}
+
+
+/************************************************************************/
+/*>void ArrowWriteDictionaries(ARROWWRITER *writer)
+   ------------------------------------------------
+   I/O:     ARROWWRITER  *writer   Arrow writer
+
+   Writes the dictionary of class names for the class and nearest class
+   columns of each CDR.
+
+   16.10.26 Original    By: ACRM
+*/
+void ArrowWriteDictionaries(ARROWWRITER *writer)
+{
+   ARROWBODY body;
+   FLATBUF   fb;
+   int       loop,
+             copy,
+             i,
+             *offsets;
+   size_t    size,
+             batch;
+   char      *names;
+
+   for(loop=0; loop<NCDR && !writer->error; loop++)
+   {
+      /* Concatenate the names                                          */
+      for(i=0, size=0; i<writer->nDict[loop]; i++)
+         size += strlen(writer->dict[loop][i]);
+      offsets = (int *)malloc((writer->nDict[loop]+1) * sizeof(int));
+      names   = (char *)malloc(size + 1);
+      if((offsets == NULL) || (names == NULL))
+      {
+         writer->error = TRUE;
+      }
+      else
+      {
+         offsets[0] = 0;
+         for(i=0; i<writer->nDict[loop]; i++)
+         {
+            strcpy(names + offsets[i], writer->dict[loop][i]);
+            offsets[i+1] = offsets[i] + strlen(writer->dict[loop][i]);
+         }
+
+         /* The class and nearest class columns each have a copy        */
+         for(copy=0; copy<2 && !writer->error; copy++)
+         {
+            memset(&body, 0, sizeof(ARROWBODY));
+            ArrowBodyAddNode(&body, writer->nDict[loop], 0);
+            ArrowBodyAddBuffer(&body, NULL, 0);
+            ArrowBodyAddBuffer(&body, offsets,
+                               (writer->nDict[loop]+1) * sizeof(int));
+            ArrowBodyAddBuffer(&body, names, size);
+
+            if(body.error || !FBInit(&fb))
+            {
+               writer->error = TRUE;
+            }
+            else
+            {
+               batch = ArrowAddRecordBatch(&fb, writer->nDict[loop],
+                                           &body);
+               FBStartTable(&fb, 2);
+               FBAddScalar(&fb, 0, 2*loop + copy, 8);    /* id          */
+               FBAddOffset(&fb, 1, batch);               /* data        */
+               FBFinish(&fb, ArrowAddMessage(&fb, ARROW_DICTBATCH,
+                                             FBEndTable(&fb), &body));
+               ArrowWriteMessage(writer, &fb, &body,
+                                 &(writer->dictBlocks[
+                                      writer->nDictBlocks++]));
+               free(fb.data);
+            }
+            if(body.data != NULL)
+               free(body.data);
+         }
+      }
+
+      if(offsets != NULL)
+         free(offsets);
+      if(names != NULL)
+         free(names);
+   }
+}
+
+
+/************************************************************************/
+/*>void ArrowWriteFooter(ARROWWRITER *writer)
+   ------------------------------------------
+   I/O:     ARROWWRITER  *writer   Arrow writer
+
+   Writes the end of stream marker and the footer which ends the file.
+   The footer gives the schema again and the positions of the
+   dictionaries and record batches.
+
+   16.10.26 Original    By: ACRM
+*/
+void ArrowWriteFooter(ARROWWRITER *writer)
+{
+   FLATBUF       fb;
+   size_t        schema,
+                 dicts,
+                 batches;
+   unsigned char eos[8]  = {0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0},
+                 size[4];
+   int           i;
+
+   if(writer->error)
+      return;
+
+   ArrowWriteBytes(writer, eos, 8);
+
+   if(!FBInit(&fb))
+   {
+      writer->error = TRUE;
+      return;
+   }
+
+   schema  = ArrowAddSchema(&fb);
+   dicts   = FBBlockVector(&fb, writer->dictBlocks, writer->nDictBlocks);
+   batches = FBBlockVector(&fb, writer->batchBlocks,
+                           writer->nBatchBlocks);
+   FBStartTable(&fb, 4);
+   FBAddScalar(&fb, 0, ARROW_V5, 2);                     /* version     */
+   FBAddOffset(&fb, 1, schema);                          /* schema      */
+   FBAddOffset(&fb, 2, dicts);                           /* dictionaries*/
+   FBAddOffset(&fb, 3, batches);                         /* recordBatch.*/
+   FBFinish(&fb, FBEndTable(&fb));
+
+   if(fb.error)
+   {
+      writer->error = TRUE;
+   }
+   else
+   {
+      ArrowWriteBytes(writer, fb.data + fb.cap - fb.size, fb.size);
+      for(i=0; i<4; i++)
+         size[i] = (fb.size >> (8*i)) & 0xff;
+      ArrowWriteBytes(writer, size, 4);
+      ArrowWriteBytes(writer, ARROWMAGIC, 6);
+   }
+   free(fb.data);
+}
+
+
+/************************************************************************/
+/*>void ArrowWriteMessage(ARROWWRITER *writer, FLATBUF *fb,
+                          ARROWBODY *body, ARROWBLOCK *block)
+   --------------------------------------------------------------
+   I/O:     ARROWWRITER  *writer   Arrow writer
+   Input:   FLATBUF      *fb       Finished Message FlatBuffer
+            ARROWBODY    *body     Message body (or NULL)
+   Output:  ARROWBLOCK   *block    Position of message (or NULL)
+
+   Writes an encapsulated Arrow message: a continuation marker and the
+   length of the metadata, the Message FlatBuffer and the body.
+
+   16.10.26 Original    By: ACRM
+*/
+void ArrowWriteMessage(ARROWWRITER *writer, FLATBUF *fb,
+                       ARROWBODY *body, ARROWBLOCK *block)
+{
+   unsigned char prefix[8] = {0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0};
+   int           i;
+
+   if(fb->error)
+   {
+      writer->error = TRUE;
+      return;
+   }
+
+   /* FBFinish() leaves the size a multiple of 8                        */
+   for(i=0; i<4; i++)
+      prefix[4+i] = (fb->size >> (8*i)) & 0xff;
+
+   if(block != NULL)
+   {
+      block->offset     = writer->position;
+      block->metaLength = 8 + fb->size;
+      block->bodyLength = ((body == NULL) ? 0 : body->size);
+   }
+
+   ArrowWriteBytes(writer, prefix, 8);
+   ArrowWriteBytes(writer, fb->data + fb->cap - fb->size, fb->size);
+   if(body != NULL)
+      ArrowWriteBytes(writer, body->data, body->size);
+}
+
+
+/************************************************************************/
+/*>void ArrowWriteBytes(ARROWWRITER *writer, void *data, size_t length)
+   --------------------------------------------------------------------
+   I/O:     ARROWWRITER  *writer   Arrow writer
+   Input:   void         *data     Data to write
+            size_t       length    Bytes to write
+
+   Writes to the Arrow file, keeping track of the position.
+
+   16.10.26 Original    By: ACRM
+*/
+void ArrowWriteBytes(ARROWWRITER *writer, void *data, size_t length)
+{
+   if(length && (fwrite(data, 1, length, writer->out) != length))
+      writer->error = TRUE;
+   writer->position += length;
+}
+
+
+/************************************************************************/
+/*>size_t ArrowAddSchema(FLATBUF *fb)
+   ----------------------------------
+   I/O:     FLATBUF  *fb      FlatBuffer
+   Returns: size_t            Position of Schema table
+
+   Adds the Schema of the file.
+
+   16.10.26 Original    By: ACRM
+*/
+size_t ArrowAddSchema(FLATBUF *fb)
+{
+   static char *colName[NCDRCOL] = {"class", "length", "similar",
+                                    "mismatches"};
+   static char *cdrName[NCDR]    = {"L1", "L2", "L3", "H1", "H2", "H3"};
+   size_t      fields[NARROWCOL];
+   char        name[SMALLWORD];
+   int         loop,
+               i;
+
+   fields[0] = ArrowAddField(fb, "id", ARROW_UTF8, -1);
+   for(loop=0; loop<NCDR; loop++)
+   {
+      for(i=0; i<NCDRCOL; i++)
+      {
+         sprintf(name, "%s_%s", cdrName[loop], colName[i]);
+         if(i == COL_CLASS)
+            fields[1 + loop*NCDRCOL + i] =
+               ArrowAddField(fb, name, ARROW_UTF8, 2*loop);
+         else if(i == COL_SIMILAR)
+            fields[1 + loop*NCDRCOL + i] =
+               ArrowAddField(fb, name, ARROW_UTF8, 2*loop + 1);
+         else
+            fields[1 + loop*NCDRCOL + i] =
+               ArrowAddField(fb, name, ARROW_INT, -1);
+      }
+   }
+
+   fields[0] = FBOffsetVector(fb, fields, NARROWCOL);
+   FBStartTable(fb, 2);
+   FBAddOffset(fb, 1, fields[0]);                        /* fields      */
+   return(FBEndTable(fb));
+}
+
+
+/************************************************************************/
+/*>size_t ArrowAddField(FLATBUF *fb, char *name, int type, long dictId)
+   --------------------------------------------------------------------
+   I/O:     FLATBUF  *fb      FlatBuffer
+   Input:   char     *name    Field name
+            int      type     ARROW_UTF8 or ARROW_INT (32 bit signed)
+            long     dictId   Dictionary ID (-1 if not dictionary
+                              encoded)
+   Returns: size_t            Position of Field table
+
+   Adds a nullable Field to a Schema. Dictionary encoded fields have
+   32 bit signed indices.
+
+   16.10.26 Original    By: ACRM
+*/
+size_t ArrowAddField(FLATBUF *fb, char *name, int type, long dictId)
+{
+   size_t nameOff,
+          typeOff,
+          dictOff = 0,
+          children;
+
+   nameOff = FBString(fb, name);
+   if(type == ARROW_INT)
+   {
+      typeOff = ArrowAddIntType(fb);
+   }
+   else
+   {
+      FBStartTable(fb, 0);
+      typeOff = FBEndTable(fb);
+   }
+   children = FBOffsetVector(fb, NULL, 0);
+
+   if(dictId >= 0)
+   {
+      size_t indexType = ArrowAddIntType(fb);
+      FBStartTable(fb, 2);
+      FBAddScalar(fb, 0, dictId, 8);                     /* id          */
+      FBAddOffset(fb, 1, indexType);                     /* indexType   */
+      dictOff = FBEndTable(fb);
+   }
+
+   FBStartTable(fb, 6);
+   FBAddOffset(fb, 0, nameOff);                          /* name        */
+   FBAddOffset(fb, 3, typeOff);                          /* type        */
+   if(dictOff)
+      FBAddOffset(fb, 4, dictOff);                       /* dictionary  */
+   FBAddOffset(fb, 5, children);                         /* children    */
+   FBAddScalar(fb, 1, TRUE, 1);                          /* nullable    */
+   FBAddScalar(fb, 2, type, 1);                          /* type_type   */
+   return(FBEndTable(fb));
+}
+
+
+/************************************************************************/
+/*>size_t ArrowAddIntType(FLATBUF *fb)
+   -----------------------------------
+   I/O:     FLATBUF  *fb      FlatBuffer
+   Returns: size_t            Position of Int table
+
+   Adds an Int type table for 32 bit signed integers.
+
+   16.10.26 Original    By: ACRM
+*/
+size_t ArrowAddIntType(FLATBUF *fb)
+{
+   FBStartTable(fb, 2);
+   FBAddScalar(fb, 0, 32, 4);                            /* bitWidth    */
+   FBAddScalar(fb, 1, TRUE, 1);                          /* is_signed   */
+   return(FBEndTable(fb));
+}
+
+
+/************************************************************************/
+/*>size_t ArrowAddRecordBatch(FLATBUF *fb, int length, ARROWBODY *body)
+   --------------------------------------------------------------------
+   I/O:     FLATBUF    *fb      FlatBuffer
+   Input:   int        length   Number of rows
+            ARROWBODY  *body    Body with node and buffer descriptions
+   Returns: size_t              Position of RecordBatch table
+
+   Adds a RecordBatch table describing a message body.
+
+   16.10.26 Original    By: ACRM
+*/
+size_t ArrowAddRecordBatch(FLATBUF *fb, int length, ARROWBODY *body)
+{
+   size_t nodes,
+          buffers;
+
+   nodes   = FBPairVector(fb, body->nodes, body->nNodes);
+   buffers = FBPairVector(fb, body->buffers, body->nBuffers);
+   FBStartTable(fb, 3);
+   FBAddScalar(fb, 0, length, 8);                        /* length      */
+   FBAddOffset(fb, 1, nodes);                            /* nodes       */
+   FBAddOffset(fb, 2, buffers);                          /* buffers     */
+   return(FBEndTable(fb));
+}
+
+
+/************************************************************************/
+/*>size_t ArrowAddMessage(FLATBUF *fb, int headerType, size_t header,
+                          ARROWBODY *body)
+   ------------------------------------------------------------------
+   I/O:     FLATBUF    *fb          FlatBuffer
+   Input:   int        headerType   ARROW_SCHEMA, _DICTBATCH or
+                                    _RECBATCH
+            size_t     header       Position of header table
+            ARROWBODY  *body        Message body (or NULL)
+   Returns: size_t                  Position of Message table
+
+   Adds the Message table which is the root of a message's metadata.
+
+   16.10.26 Original    By: ACRM
+*/
+size_t ArrowAddMessage(FLATBUF *fb, int headerType, size_t header,
+                       ARROWBODY *body)
+{
+   FBStartTable(fb, 4);
+   FBAddScalar(fb, 3, (body == NULL) ? 0 : body->size, 8);
+                                                         /* bodyLength  */
+   FBAddOffset(fb, 2, header);                           /* header      */
+   FBAddScalar(fb, 0, ARROW_V5, 2);                      /* version     */
+   FBAddScalar(fb, 1, headerType, 1);                    /* header_type */
+   return(FBEndTable(fb));
+}
+
+
+/************************************************************************/
+/*>void ArrowBodyAddNode(ARROWBODY *body, int length, int nullCount)
+   -----------------------------------------------------------------
+   I/O:     ARROWBODY  *body       Message body
+   Input:   int        length      Number of values in column
+            int        nullCount   Number of nulls
+
+   Adds the FieldNode for a column.
+
+   16.10.26 Original    By: ACRM
+*/
+void ArrowBodyAddNode(ARROWBODY *body, int length, int nullCount)
+{
+   body->nodes[2*body->nNodes]     = length;
+   body->nodes[2*body->nNodes + 1] = nullCount;
+   body->nNodes++;
+}
+
+
+/************************************************************************/
+/*>void ArrowBodyAddBuffer(ARROWBODY *body, void *data, size_t length)
+   -------------------------------------------------------------------
+   I/O:     ARROWBODY  *body       Message body
+   Input:   void       *data       Buffer contents
+            size_t     length      Buffer length
+
+   Appends a buffer to a message body, padded to a multiple of 8 bytes.
+
+   16.10.26 Original    By: ACRM
+*/
+void ArrowBodyAddBuffer(ARROWBODY *body, void *data, size_t length)
+{
+   size_t        need = body->size + ARROWALIGN(length);
+   unsigned char *newData;
+
+   if(need > body->cap)
+   {
+      if((newData = (unsigned char *)realloc(body->data, 2 * need))
+         ==NULL)
+      {
+         body->error = TRUE;
+         return;
+      }
+      body->data = newData;
+      body->cap  = 2 * need;
+   }
+
+   body->buffers[2*body->nBuffers]     = body->size;
+   body->buffers[2*body->nBuffers + 1] = length;
+   body->nBuffers++;
+
+   if(length)
+      memcpy(body->data + body->size, data, length);
+   memset(body->data + body->size + length, 0,
+          ARROWALIGN(length) - length);
+   body->size = need;
+}
+
+
+/************************************************************************/
+/*>BOOL FBInit(FLATBUF *fb)
+   ------------------------
+   Output:  FLATBUF  *fb      FlatBuffer
+   Returns: BOOL              Success?
+
+   Initialises an empty FlatBuffer.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL FBInit(FLATBUF *fb)
+{
+   fb->cap      = 1024;
+   fb->size     = 0;
+   fb->nFields  = 0;
+   fb->minAlign = 8;
+   fb->error    = FALSE;
+
+   return((fb->data = (unsigned char *)malloc(fb->cap)) != NULL);
+}
+
+
+/************************************************************************/
+/*>void FBReserve(FLATBUF *fb, size_t n)
+   -------------------------------------
+   I/O:     FLATBUF  *fb      FlatBuffer
+   Input:   size_t   n        Bytes to add
+
+   Adds n bytes to the start of the used part of a FlatBuffer, growing
+   the allocation (and moving the contents to its end) if required.
+
+   16.10.26 Original    By: ACRM
+*/
+void FBReserve(FLATBUF *fb, size_t n)
+{
+   unsigned char *newData;
+   size_t        newCap;
+
+   if(fb->error)
+      return;
+
+   if(fb->size + n > fb->cap)
+   {
+      newCap = 2 * (fb->size + n);
+      if((newData = (unsigned char *)malloc(newCap))==NULL)
+      {
+         fb->error = TRUE;
+         return;
+      }
+      memcpy(newData + newCap - fb->size, fb->data + fb->cap - fb->size,
+             fb->size);
+      free(fb->data);
+      fb->data = newData;
+      fb->cap  = newCap;
+   }
+
+   fb->size += n;
+}
+
+
+/************************************************************************/
+/*>void FBPrep(FLATBUF *fb, int align, size_t extra)
+   -------------------------------------------------
+   I/O:     FLATBUF  *fb      FlatBuffer
+   Input:   int      align    Alignment required
+            size_t   extra    Bytes to be added before aligning
+
+   Pads so that the next object, once extra bytes have been added, is
+   aligned. Since the finished buffer is a multiple of the largest
+   alignment, positions from the end have the same alignment as
+   positions from the start.
+
+   16.10.26 Original    By: ACRM
+*/
+void FBPrep(FLATBUF *fb, int align, size_t extra)
+{
+   size_t pad = (~(fb->size + extra) + 1) & (align - 1);
+
+   if(align > fb->minAlign)
+      fb->minAlign = align;
+
+   FBReserve(fb, pad);
+   if(!fb->error)
+      memset(fb->data + fb->cap - fb->size, 0, pad);
+}
+
+
+/************************************************************************/
+/*>void FBPush(FLATBUF *fb, unsigned long value, int nbytes)
+   ---------------------------------------------------------
+   I/O:     FLATBUF        *fb      FlatBuffer
+   Input:   unsigned long  value    Value
+            int            nbytes   Size of value (1, 2, 4 or 8)
+
+   Adds an aligned little-endian scalar.
+
+   16.10.26 Original    By: ACRM
+*/
+void FBPush(FLATBUF *fb, unsigned long value, int nbytes)
+{
+   unsigned char *p;
+   int           i;
+
+   FBPrep(fb, nbytes, 0);
+   FBReserve(fb, nbytes);
+   if(fb->error)
+      return;
+
+   p = fb->data + fb->cap - fb->size;
+   for(i=0; i<nbytes; i++)
+   {
+      p[i]    = value & 0xff;
+      value >>= 8;
+   }
+}
+
+
+/************************************************************************/
+/*>void FBPushOffset(FLATBUF *fb, size_t offset)
+   ---------------------------------------------
+   I/O:     FLATBUF  *fb      FlatBuffer
+   Input:   size_t   offset   Position of object referred to
+
+   Adds an offset to an object already in the buffer. FlatBuffer offsets
+   are from the offset itself.
+
+   16.10.26 Original    By: ACRM
+*/
+void FBPushOffset(FLATBUF *fb, size_t offset)
+{
+   FBPrep(fb, 4, 0);
+   FBPush(fb, fb->size + 4 - offset, 4);
+}
+
+
+/************************************************************************/
+/*>size_t FBString(FLATBUF *fb, char *string)
+   ------------------------------------------
+   I/O:     FLATBUF  *fb      FlatBuffer
+   Input:   char     *string  String
+   Returns: size_t            Position of string
+
+   Adds a string (length, bytes and terminating nul).
+
+   16.10.26 Original    By: ACRM
+*/
+size_t FBString(FLATBUF *fb, char *string)
+{
+   size_t len = strlen(string);
+
+   FBPrep(fb, 4, len+1);
+   FBReserve(fb, len+1);
+   if(!fb->error)
+      memcpy(fb->data + fb->cap - fb->size, string, len+1);
+   FBPush(fb, len, 4);
+
+   return(fb->size);
+}
+
+
+/************************************************************************/
+/*>size_t FBOffsetVector(FLATBUF *fb, size_t *offsets, int n)
+   ----------------------------------------------------------
+   I/O:     FLATBUF  *fb       FlatBuffer
+   Input:   size_t   *offsets  Positions of objects
+            int      n         Number of objects
+   Returns: size_t             Position of vector
+
+   Adds a vector of offsets to objects (tables or strings).
+
+   16.10.26 Original    By: ACRM
+*/
+size_t FBOffsetVector(FLATBUF *fb, size_t *offsets, int n)
+{
+   int i;
+
+   FBPrep(fb, 4, 4*n);
+   for(i=n-1; i>=0; i--)
+      FBPushOffset(fb, offsets[i]);
+   FBPush(fb, n, 4);
+
+   return(fb->size);
+}
+
+
+/************************************************************************/
+/*>size_t FBPairVector(FLATBUF *fb, unsigned long *values, int n)
+   --------------------------------------------------------------
+   I/O:     FLATBUF        *fb      FlatBuffer
+   Input:   unsigned long  *values  Pairs of values
+            int            n        Number of pairs
+   Returns: size_t                  Position of vector
+
+   Adds a vector of structs of two 64 bit integers (Arrow FieldNode
+   or Buffer).
+
+   16.10.26 Original    By: ACRM
+*/
+size_t FBPairVector(FLATBUF *fb, unsigned long *values, int n)
+{
+   int i;
+
+   FBPrep(fb, 4, 16*n);
+   FBPrep(fb, 8, 16*n);
+   for(i=n-1; i>=0; i--)
+   {
+      FBPush(fb, values[2*i+1], 8);
+      FBPush(fb, values[2*i],   8);
+   }
+   FBPush(fb, n, 4);
+
+   return(fb->size);
+}
+
+
+/************************************************************************/
+/*>size_t FBBlockVector(FLATBUF *fb, ARROWBLOCK *blocks, int n)
+   ------------------------------------------------------------
+   I/O:     FLATBUF     *fb      FlatBuffer
+   Input:   ARROWBLOCK  *blocks  Blocks
+            int         n        Number of blocks
+   Returns: size_t               Position of vector
+
+   Adds a vector of Arrow Block structs (64 bit offset, 32 bit metadata
+   length with 4 bytes of padding, 64 bit body length).
+
+   16.10.26 Original    By: ACRM
+*/
+size_t FBBlockVector(FLATBUF *fb, ARROWBLOCK *blocks, int n)
+{
+   int i;
+
+   FBPrep(fb, 4, 24*n);
+   FBPrep(fb, 8, 24*n);
+   for(i=n-1; i>=0; i--)
+   {
+      FBPush(fb, blocks[i].bodyLength, 8);
+      FBPush(fb, 0, 4);
+      FBPush(fb, blocks[i].metaLength, 4);
+      FBPush(fb, blocks[i].offset, 8);
+   }
+   FBPush(fb, n, 4);
+
+   return(fb->size);
+}
+
+
+/************************************************************************/
+/*>void FBStartTable(FLATBUF *fb, int nFields)
+   -------------------------------------------
+   I/O:     FLATBUF  *fb       FlatBuffer
+   Input:   int      nFields   Number of fields in table type
+
+   Starts a table. Fields are then added with FBAddScalar() and
+   FBAddOffset() in any order. Objects referred to by the table must
+   have been added already.
+
+   16.10.26 Original    By: ACRM
+*/
+void FBStartTable(FLATBUF *fb, int nFields)
+{
+   int i;
+
+   fb->nFields  = nFields;
+   fb->objStart = fb->size;
+   for(i=0; i<nFields; i++)
+      fb->fieldPos[i] = 0;
+}
+
+
+/************************************************************************/
+/*>void FBAddScalar(FLATBUF *fb, int field, unsigned long value,
+                    int nbytes)
+   -------------------------------------------------------------
+   I/O:     FLATBUF        *fb      FlatBuffer
+   Input:   int            field    Field number
+            unsigned long  value    Value
+            int            nbytes   Size of value
+
+   Adds a scalar field to the current table.
+
+   16.10.26 Original    By: ACRM
+*/
+void FBAddScalar(FLATBUF *fb, int field, unsigned long value, int nbytes)
+{
+   FBPush(fb, value, nbytes);
+   fb->fieldPos[field] = fb->size;
+}
+
+
+/************************************************************************/
+/*>void FBAddOffset(FLATBUF *fb, int field, size_t offset)
+   -------------------------------------------------------
+   I/O:     FLATBUF  *fb      FlatBuffer
+   Input:   int      field    Field number
+            size_t   offset   Position of object referred to
+
+   Adds a field referring to a table, vector or string to the current
+   table.
+
+   16.10.26 Original    By: ACRM
+*/
+void FBAddOffset(FLATBUF *fb, int field, size_t offset)
+{
+   FBPushOffset(fb, offset);
+   fb->fieldPos[field] = fb->size;
+}
+
+
+/************************************************************************/
+/*>size_t FBEndTable(FLATBUF *fb)
+   ------------------------------
+   I/O:     FLATBUF  *fb      FlatBuffer
+   Returns: size_t            Position of table
+
+   Ends the current table. Its vtable (the size of the vtable and the
+   table and the offset of each field in the table) is placed
+   immediately before the table which starts with the offset back to
+   the vtable.
+
+   16.10.26 Original    By: ACRM
+*/
+size_t FBEndTable(FLATBUF *fb)
+{
+   size_t table,
+          vtable;
+   long   soffset;
+   int    i;
+
+   FBPush(fb, 0, 4);
+   table = fb->size;
+
+   for(i=fb->nFields-1; i>=0; i--)
+      FBPush(fb, (fb->fieldPos[i] ? table - fb->fieldPos[i] : 0), 2);
+   FBPush(fb, table - fb->objStart, 2);
+   FBPush(fb, 4 + 2*fb->nFields, 2);
+   vtable = fb->size;
+
+   /* Fill in the offset from the table to its vtable                   */
+   if(!fb->error)
+   {
+      soffset = vtable - table;
+      for(i=0; i<4; i++)
+      {
+         fb->data[fb->cap - table + i] = soffset & 0xff;
+         soffset >>= 8;
+      }
+   }
+
+   return(table);
+}
+
+
+/************************************************************************/
+/*>void FBFinish(FLATBUF *fb, size_t root)
+   ---------------------------------------
+   I/O:     FLATBUF  *fb      FlatBuffer
+   Input:   size_t   root     Position of root table
+
+   Adds the offset to the root table, padding so that the whole buffer
+   is a multiple of the largest alignment (8 bytes).
+
+   16.10.26 Original    By: ACRM
+*/
+void FBFinish(FLATBUF *fb, size_t root)
+{
+   FBPrep(fb, fb->minAlign, 4);
+   FBPushOffset(fb, root);
+}
@@ -0,0 +1,1392 @@
+/*************************************************************************
+
+   Program:    chobench
+   File:       chobench.c
+
+   Version:    V2.28
+   Date:       16.10.26
+   Function:   Benchmark libchothia on a synthetic repertoire
+
+   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2026
+   Author:     Prof. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Generates a synthetic repertoire of numbered antibody sequences and
+   times the stages of canonical assignment on it separately:
+
+   parse          ReadInputRecord() for each record
+   readdata       ReadChothiaData() of the datafile
+   loaddata       LoadChothiaData() of the datafile (mapping its
+                  compiled version if current, otherwise reading, 
+                  compiling and building the matching kernel)
+   index          IndexSequence() for each record
+   findres        FindRes() of every key residue label of the datafile
+                  for each record
+   classify       ClassifySequence() for each record
+   classify_block ClassifyBlock() for each block of BLOCKSEQS records
+   classify_tree  ClassifySequence() for each record with the decision
+                  tree engine (ENGINE_TREE)
+
+   Each record is built from the light and heavy chain frameworks of
+   4fab with random CDRs whose lengths are drawn from a distribution
+   for each CDR. The sequence is numbered with NumberSequence() in the
+   scheme of the datafile, then for each CDR one of the classes of the
+   loop length found is chosen at random and its key residues are set
+   to residue types it allows. A small fraction of key residues is
+   instead set to any type, so that some loops match no class.
+
+   The results are written as a single JSON object giving, for each
+   stage, the number of operations and items (records, or residue
+   lookups for findres), the total time, the throughput in items per
+   second and the mean, median, 90th and 99th percentile and maximum
+   latency of an operation in microseconds. Minimum throughputs may be
+   given for any stage; the exit status is then 1 if any is not met.
+
+**************************************************************************
+
+   Usage:
+   ======
+   chobench [-c datafile] [-n nrecords] [-s seed] [-m mutation]
+            [-r nreads] [-l CDR=len:weight,...] [-T stage=persec]
+            [-w repertoire]
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.24 16.10.26 Original
+   V2.25 16.10.26 Sets the method of the CANONCONTEXT
+   V2.26 16.10.26 Arrays for generated sequences are sized from 
+                  MAXRAWSEQ as MAXSEQ was removed. The repertoire is 
+                  read into a growing sequence array
+   V2.27 16.10.26 Added the classify_tree stage. Sets the engine of the
+                  CANONCONTEXT
+   V2.28 16.10.26 Reports the stage when reading the datafile or
+                  building the trees fails
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L  /* For clock_gettime()                 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "bioplib/macros.h"
+#include "bioplib/general.h"
+
+#include "../chothia.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define DEF_RECORDS  10000       /* Default records generated           */
+#define DEF_SEED     1           /* Default random number seed          */
+#define DEF_MUTATION 0.02        /* Default fraction of key residues set
+                                    to any residue type                 */
+#define DEF_READS    20          /* Default reads of the datafile       */
+#define MAXLENGTHS   32          /* Max lengths in a CDR distribution   */
+#define MAXRAWSEQ    400         /* Max length of a generated sequence  */
+#define MAXNUMSEQ    (MAXRAWSEQ + NCDR) /* Max length once numbered     */
+
+#define STAGE_PARSE    0         /* Stages timed                        */
+#define STAGE_READDATA 1
+#define STAGE_LOADDATA 2
+#define STAGE_INDEX    3
+#define STAGE_FINDRES  4
+#define STAGE_CLASSIFY 5
+#define STAGE_BLOCK    6
+#define STAGE_TREE     7
+#define NSTAGE         8
+
+/* Residue types used for the CDRs. Cys and Trp are left out so that the
+   conserved framework residues used by NumberSequence() are not mimicked
+*/
+#define CDRTYPES     "ADEFGHIKLMNPQRSTVY"
+
+/* The distribution of the length of a CDR as numbered by
+   NumberSequence() (array)                                             */
+typedef struct
+{
+   char   *name;                    /* CDR name                         */
+   int    minLength,                /* Lengths which can be numbered    */
+          maxLength,
+          nLength,                  /* Lengths in the distribution      */
+          length[MAXLENGTHS];       /* Each length                      */
+   double weight[MAXLENGTHS];       /*    and its relative frequency    */
+}  LENGTHDIST;
+
+/* Timings of a stage (array)                                          */
+typedef struct
+{
+   char   *name;                    /* Stage name                       */
+   double *latency,                 /* Time of each operation           */
+          seconds,                  /* Total time                       */
+          target;                   /* Minimum items per second (0 if
+                                       none)                            */
+   long   nOps,                     /* Operations timed                 */
+          maxOps,                   /* Size of latency array            */
+          nItems;                   /* Items processed                  */
+}  STAGE;
+
+/************************************************************************/
+/* Globals
+*/
+/* Frameworks of the 4fab light and heavy chains between the CDRs
+   (Kabat L1-L23, L35-L49, L57-L88, L98-L107 and H1-H25, H36-H49,
+   H66-H94, H103-H113)                                                  */
+static char *sLightFR[4] =
+{  "DVVMTQTPLSLPVSLGDQASISC",
+   "WYLQKPGQSPKVLIY",
+   "GVPDRFSGSGSGTDFTLKISRVEAEDLGVYFC",
+   "FGGGTKLEIK"
+}  ;
+static char *sHeavyFR[4] =
+{  "EVKLDETGGGLVQPGRPMKLSCVAS",
+   "WVRQSPEKGLEWVA",
+   "RFTISRDDSKSSVYLQMNNLRVEDMGIYYCTG",
+   "WGQGTSVTVSS"
+}  ;
+
+/* Default CDR length distributions, loosely following those of human
+   repertoires. The ranges are those numbered by NumberSequence()      */
+static LENGTHDIST sLengthDist[NCDR] =
+{  {  "L1", 10, 17, 8,
+      { 10, 11, 12, 13, 14, 15, 16, 17 },
+      {  4, 40,  8,  4,  4,  6, 24, 10 }  },
+   {  "L2",  7,  7, 1,
+      {  7 },
+      {  1 }  },
+   {  "L3",  7, 11, 5,
+      {  7,  8,  9, 10, 11 },
+      {  4,  8, 70, 12,  6 }  },
+   {  "H1", 10, 12, 3,
+      { 10, 11, 12 },
+      { 80, 12,  8 }  },
+   {  "H2", 16, 19, 4,
+      { 16, 17, 18, 19 },
+      { 25, 50, 10, 15 }  },
+   {  "H3",  2, 30, 18,
+      {  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19,
+        20, 21 },
+      {  1,  2,  3,  5,  7,  9, 10, 11, 11, 10,  9,  7,  5,  4,  3,  2,
+         1,  1 }  }
+}  ;
+
+static unsigned long sRandom = DEF_SEED;
+
+/************************************************************************/
+/* Prototypes
+*/
+int  main(int argc, char **argv);
+BOOL ParseCmdLine(int argc, char **argv, char *datafile, long *nrecords,
+                  unsigned long *seed, double *mutation, int *nreads,
+                  char *repfile, STAGE *stages);
+BOOL ParseLengthDist(char *spec);
+BOOL ParseTarget(char *spec, STAGE *stages);
+BOOL GenerateRepertoire(FILE *out, CHOTHIADATA *data, long nrecords,
+                        double mutation, SEQUENCE *Sequence,
+                        RESINDEX *index);
+int  BuildRecord(char *seq);
+void SeedKeyResidues(CHOTHIADATA *data, CANONRESULTS *results,
+                     double mutation, SEQUENCE *Sequence, int NRes,
+                     RESINDEX *index);
+BOOL ClassAllows(CANONTABLE *table, CANONCLASS *canon,
+                 SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                 BOOL *seeded);
+BOOL ReadRepertoire(FILE *in, STAGE *stage, SEQUENCE ***sequences,
+                    int **lengths, long *nrecords);
+BOOL TimeDataFile(char *datafile, int nreads, STAGE *readStage,
+                  STAGE *loadStage);
+BOOL TimeClassification(CANONCONTEXT *ctx, SEQUENCE **sequences,
+                        int *lengths, long nrecords, STAGE *stages,
+                        long *nAssigned, long *nLoops);
+BOOL TimeBlocks(CANONCONTEXT *ctx, SEQUENCE **sequences, int *lengths,
+                long nrecords, STAGE *stage);
+BOOL TimeTree(CANONCONTEXT *ctx, SEQUENCE **sequences, int *lengths,
+              long nrecords, STAGE *stage);
+BOOL AddTiming(STAGE *stage, double seconds, long items);
+void PrintResults(FILE *out, char *datafile, long nrecords,
+                  unsigned long seed, long nAssigned, long nLoops,
+                  STAGE *stages);
+double Percentile(double *sorted, long n, double percent);
+int  CompareDoubles(const void *a, const void *b);
+double Now(void);
+double Uniform(void);
+int  RandomLength(LENGTHDIST *dist);
+void Usage(void);
+
+/************************************************************************/
+/*>int main(int argc, char **argv)
+   -------------------------------
+   Main program for the benchmark. Returns 1 on error or if a target
+   throughput is not met.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Sets the method
+   16.10.26 Times the decision tree engine
+   16.10.26 Initialises the RESINDEX with InitResIndex()
+*/
+int main(int argc, char **argv)
+{
+   static char *names[NSTAGE] =
+   {  "parse", "readdata", "loaddata", "index", "findres", "classify",
+      "classify_block", "classify_tree"
+   }  ;
+   char          datafile[MAXBUFF],
+                 repfile[MAXBUFF];
+   SEQUENCE      Sequence[MAXNUMSEQ],
+                 **sequences = NULL;
+   RESINDEX      *index;
+   CHOTHIADATA   data;
+   CANONCONTEXT  ctx;
+   STAGE         stages[NSTAGE];
+   FILE          *fp;
+   unsigned long seed;
+   double        mutation;
+   long          nrecords,
+                 nAssigned = 0,
+                 nLoops    = 0;
+   int           *lengths  = NULL,
+                 nreads,
+                 i;
+   BOOL          met       = TRUE;
+
+   for(i=0; i<NSTAGE; i++)
+   {
+      stages[i].name    = names[i];
+      stages[i].latency = NULL;
+      stages[i].seconds = stages[i].target = 0.0;
+      stages[i].nOps    = stages[i].maxOps = stages[i].nItems = 0;
+   }
+
+   if(!ParseCmdLine(argc, argv, datafile, &nrecords, &seed, &mutation,
+                    &nreads, repfile, stages))
+   {
+      Usage();
+      return(0);
+   }
+   /* xorshift must not be seeded with zero                           */
+   sRandom = (seed & 0xFFFFFFFFUL) ? (seed & 0xFFFFFFFFUL) : DEF_SEED;
+
+   if((index = (RESINDEX *)malloc(sizeof(RESINDEX)))==NULL)
+   {
+      fprintf(stderr,"Error (chobench): No memory for sequence \
+index\n");
+      return(1);
+   }
+   InitResIndex(index);
+   if(!LoadChothiaData(datafile, &data))
+   {
+      fprintf(stderr,"Error (chobench): Unable to read Chothia datafile \
+%s\n", datafile);
+      return(1);
+   }
+
+   /* Generate the repertoire to the file given, or a temporary file    */
+   if((fp = (repfile[0] ? fopen(repfile, "w+") : tmpfile())) == NULL)
+   {
+      fprintf(stderr,"Error (chobench): Unable to open repertoire \
+file\n");
+      return(1);
+   }
+   if(!GenerateRepertoire(fp, &data, nrecords, mutation, Sequence,
+                          index))
+      return(1);
+   free(index);
+   rewind(fp);
+
+   /* Time each stage                                                   */
+   if(!ReadRepertoire(fp, &(stages[STAGE_PARSE]), &sequences, &lengths,
+                      &nrecords))
+      return(1);
+   fclose(fp);
+
+   if(!TimeDataFile(datafile, nreads, &(stages[STAGE_READDATA]),
+                    &(stages[STAGE_LOADDATA])))
+      return(1);
+
+   ctx.data            = &data;
+   ctx.chothiaNumbered = data.canonChothNum;
+   ctx.verbose         = FALSE;
+   ctx.chain           = ' ';
+   ctx.format          = FORMAT_TEXT;
+   ctx.cache           = NULL;
+   ctx.trans           = NULL;
+   ctx.topK            = 0;
+   ctx.stats           = NULL;
+   ctx.method          = NULL;
+   ctx.engine          = ENGINE_SCAN;
+
+   if(!TimeClassification(&ctx, sequences, lengths, nrecords, stages,
+                          &nAssigned, &nLoops) ||
+      !TimeBlocks(&ctx, sequences, lengths, nrecords,
+                  &(stages[STAGE_BLOCK])) ||
+      !TimeTree(&ctx, sequences, lengths, nrecords,
+                &(stages[STAGE_TREE])))
+      return(1);
+
+   PrintResults(stdout, datafile, nrecords, seed, nAssigned, nLoops,
+                stages);
+
+   for(i=0; i<NSTAGE; i++)
+   {
+      if((stages[i].target > 0.0) &&
+         ((stages[i].seconds <= 0.0) ||
+          (stages[i].nItems / stages[i].seconds < stages[i].target)))
+         met = FALSE;
+   }
+
+   return(met ? 0 : 1);
+}
+
+
+/************************************************************************/
+/*>BOOL GenerateRepertoire(FILE *out, CHOTHIADATA *data, long nrecords,
+                           double mutation, SEQUENCE *Sequence,
+                           RESINDEX *index)
+   --------------------------------------------------------------------
+   Input:   FILE        *out       Output file
+            CHOTHIADATA *data      Canonical definitions
+            long        nrecords   Number of records to generate
+            double      mutation   Fraction of key residues set to any
+                                   residue type
+            SEQUENCE    *Sequence  Sequence array (work space)
+            RESINDEX    *index     Sequence index (work space)
+   Returns: BOOL                   Success?
+
+   Writes a synthetic repertoire of records in the batch input format
+   of chothia, numbered in the scheme of the datafile.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Sets the method
+            Sets the engine
+*/
+BOOL GenerateRepertoire(FILE *out, CHOTHIADATA *data, long nrecords,
+                        double mutation, SEQUENCE *Sequence,
+                        RESINDEX *index)
+{
+   CANONCONTEXT ctx;
+   CANONRESULTS results;
+   char         seq[MAXRAWSEQ];
+   long         record;
+   int          length,
+                NRes,
+                i;
+
+   ctx.data            = data;
+   ctx.chothiaNumbered = data->canonChothNum;
+   ctx.verbose         = FALSE;
+   ctx.chain           = ' ';
+   ctx.format          = FORMAT_TEXT;
+   ctx.cache           = NULL;
+   ctx.trans           = NULL;
+   ctx.topK            = 0;
+   ctx.stats           = NULL;
+   ctx.method          = NULL;
+   ctx.engine          = ENGINE_SCAN;
+
+   for(record=0; record<nrecords; record++)
+   {
+      length = BuildRecord(seq);
+      if((NRes = NumberSequence(seq, length, ' ', data->canonChothNum,
+                                Sequence)) == 0)
+      {
+         fprintf(stderr,"Error (chobench): Unable to number generated \
+sequence %s\n", seq);
+         return(FALSE);
+      }
+
+      /* Find the loop lengths, then give each loop the key residues of
+         one of the classes of that length
+      */
+      IndexSequence(Sequence, NRes, index);
+      ClassifySequence(&ctx, Sequence, NRes, index, &results);
+      SeedKeyResidues(data, &results, mutation, Sequence, NRes, index);
+
+      fprintf(out, ">syn%ld\n", record+1);
+      for(i=0; i<NRes; i++)
+         fprintf(out, "%s %c\n", Sequence[i].resnum, Sequence[i].seq);
+   }
+
+   if(fflush(out) || ferror(out))
+   {
+      fprintf(stderr,"Error (chobench): Unable to write repertoire\n");
+      return(FALSE);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int BuildRecord(char *seq)
+   --------------------------
+   Output:  char   *seq       Light chain followed by heavy chain
+                              variable domain
+   Returns: int               Length of sequence
+
+   Builds a sequence from the template frameworks with random CDRs of
+   lengths drawn from the distributions
+
+   16.10.26 Original    By: ACRM
+*/
+int BuildRecord(char *seq)
+{
+   int  cdr,
+        length,
+        i,
+        len = 0;
+   char **fr;
+
+   for(cdr=0; cdr<NCDR; cdr++)
+   {
+      /* Framework before the CDR                                       */
+      fr = (cdr < 3) ? sLightFR : sHeavyFR;
+      strcpy(seq+len, fr[cdr % 3]);
+      len += strlen(fr[cdr % 3]);
+
+      length = RandomLength(&(sLengthDist[cdr]));
+      for(i=0; i<length; i++)
+         seq[len++] = CDRTYPES[(int)(Uniform() * strlen(CDRTYPES))];
+
+      /* Framework after the last CDR of the chain                      */
+      if((cdr % 3) == 2)
+      {
+         strcpy(seq+len, fr[3]);
+         len += strlen(fr[3]);
+      }
+   }
+   seq[len] = '\0';
+
+   return(len);
+}
+
+
+/************************************************************************/
+/*>void SeedKeyResidues(CHOTHIADATA *data, CANONRESULTS *results,
+                        double mutation, SEQUENCE *Sequence, int NRes,
+                        RESINDEX *index)
+   ---------------------------------------------------------------------
+   Input:   CHOTHIADATA  *data     Canonical definitions
+            CANONRESULTS *results  Classes assigned (for the loop
+                                   lengths)
+            double       mutation  Fraction of key residues set to any
+                                   residue type
+   I/O:     SEQUENCE     *Sequence Numbered sequence
+   Input:   int          NRes      Length of sequence
+            RESINDEX     *index    Index of the sequence
+
+   For each loop found, chooses one of the classes of its length at
+   random and sets the residues at its key positions to types allowed
+   by the class. The sequence must be numbered in the scheme of the
+   datafile.
+
+   Some key positions are shared between loops (e.g. L90 for L1 and
+   L3), so the class is chosen from those allowing the residues
+   already set for earlier loops if there are any, and those residues
+   are kept.
+
+   16.10.26 Original    By: ACRM
+*/
+void SeedKeyResidues(CHOTHIADATA *data, CANONRESULTS *results,
+                     double mutation, SEQUENCE *Sequence, int NRes,
+                     RESINDEX *index)
+{
+   CANONTABLE *table = &(data->table);
+   CANONCLASS *canon;
+   char       *types;
+   BOOL       seeded[MAXNUMSEQ];
+   int        loop,
+              length,
+              nMatch,
+              nConsistent,
+              chosen,
+              key,
+              res,
+              i;
+
+   for(i=0; i<NRes; i++)
+      seeded[i] = FALSE;
+
+   for(loop=results->firstCDR; loop<results->lastCDR; loop++)
+   {
+      if(results->cdr[loop].status == CANON_MISSING)
+         continue;
+      length = results->cdr[loop].length;
+
+      /* Count the classes of this length, and those of them allowing
+         the residues already set, and choose one
+      */
+      nMatch = nConsistent = 0;
+      for(i=0; i<table->nClass; i++)
+      {
+         canon = &(table->classes[i]);
+         if((canon->loop == loop) && (length >= canon->length) &&
+            (length <= canon->maxLength))
+         {
+            nMatch++;
+            nConsistent += ClassAllows(table, canon, Sequence, NRes,
+                                       index, seeded);
+         }
+      }
+      if(nMatch == 0)
+         continue;
+      chosen = (int)(Uniform() * (nConsistent ? nConsistent : nMatch));
+
+      for(i=0; i<table->nClass; i++)
+      {
+         canon = &(table->classes[i]);
+         if((canon->loop != loop) || (length < canon->length) ||
+            (length > canon->maxLength) ||
+            (nConsistent && !ClassAllows(table, canon, Sequence, NRes,
+                                         index, seeded)))
+            continue;
+         if(chosen-- > 0)
+            continue;
+
+         for(key=canon->firstKey; key<canon->firstKey+canon->nKey;
+             key++)
+         {
+            if(((res = FindRes(Sequence, NRes, index,
+                               table->strings + table->keyLabel[key]))
+                < 0) || seeded[res])
+               continue;
+            types = table->strings + table->keyTypes[key];
+            if((Uniform() < mutation) || !isalpha(types[0]))
+               types = CDRTYPES;
+            Sequence[res].seq = types[(int)(Uniform() * strlen(types))];
+            if(!isalpha(Sequence[res].seq))
+               Sequence[res].seq = 'X';
+            seeded[res] = TRUE;
+         }
+         break;
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>BOOL ClassAllows(CANONTABLE *table, CANONCLASS *canon,
+                    SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                    BOOL *seeded)
+   ------------------------------------------------------------------
+   Input:   CANONTABLE *table     Compiled canonical definitions
+            CANONCLASS *canon     A class
+            SEQUENCE   *Sequence  Numbered sequence
+            int        NRes       Length of sequence
+            RESINDEX   *index     Index of the sequence
+            BOOL       *seeded    Residues already set for each
+                                  position
+   Returns: BOOL                  Does the class allow all the residues
+                                  already set at its key positions?
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL ClassAllows(CANONTABLE *table, CANONCLASS *canon,
+                 SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                 BOOL *seeded)
+{
+   int key,
+       res;
+
+   for(key=canon->firstKey; key<canon->firstKey+canon->nKey; key++)
+   {
+      if(((res = FindRes(Sequence, NRes, index,
+                         table->strings + table->keyLabel[key])) >= 0) &&
+         seeded[res] &&
+         !strchr(table->strings + table->keyTypes[key], Sequence[res].seq))
+         return(FALSE);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadRepertoire(FILE *in, STAGE *stage, SEQUENCE ***sequences,
+                       int **lengths, long *nrecords)
+   --------------------------------------------------------------------
+   Input:   FILE     *in          Repertoire file
+   I/O:     STAGE    *stage       Timings of parsing each record
+   Output:  SEQUENCE ***sequences Sequence of each record
+            int      **lengths    Length of each sequence
+            long     *nrecords    Number of records read
+   Returns: BOOL                  Success?
+
+   Reads the repertoire back with ReadInputRecord(), timing each
+   record, and keeps the sequences for the later stages
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Reads into a sequence array grown by ReadInputRecord()
+*/
+BOOL ReadRepertoire(FILE *in, STAGE *stage, SEQUENCE ***sequences,
+                    int **lengths, long *nrecords)
+{
+   SEQUENCE *Sequence = NULL;
+   char     id[MAXBUFF],
+            nextID[MAXBUFF];
+   long     maxRecords = 0;
+   int      NRes,
+            maxRes = 0;
+   double   start;
+   BOOL     ok = TRUE;
+
+   *nrecords = 0;
+   nextID[0] = '\0';
+   while(ok)
+   {
+      start = Now();
+      NRes  = ReadInputRecord(in, &Sequence, &maxRes, id, nextID);
+      if(NRes < 0)
+         break;
+      if(!AddTiming(stage, Now() - start, 1))
+      {
+         ok = FALSE;
+         break;
+      }
+      if(NRes == 0)
+      {
+         fprintf(stderr,"Error (chobench): Error in generated record \
+%s\n", id);
+         ok = FALSE;
+         break;
+      }
+
+      if(*nrecords == maxRecords)
+      {
+         maxRecords = (maxRecords == 0) ? 1024 : (2 * maxRecords);
+         if(((*sequences = (SEQUENCE **)realloc(*sequences, maxRecords *
+                                                sizeof(SEQUENCE *)))
+             ==NULL) ||
+            ((*lengths = (int *)realloc(*lengths, maxRecords *
+                                        sizeof(int)))==NULL))
+         {
+            fprintf(stderr,"Error (chobench): No memory for \
+repertoire\n");
+            ok = FALSE;
+            break;
+         }
+      }
+      if(((*sequences)[*nrecords] = (SEQUENCE *)malloc(NRes *
+                                                       sizeof(SEQUENCE)))
+         ==NULL)
+      {
+         fprintf(stderr,"Error (chobench): No memory for repertoire\n");
+         ok = FALSE;
+         break;
+      }
+      memcpy((*sequences)[*nrecords], Sequence, NRes * sizeof(SEQUENCE));
+      (*lengths)[(*nrecords)++] = NRes;
+   }
+
+   if(Sequence != NULL)
+      free(Sequence);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL TimeDataFile(char *datafile, int nreads, STAGE *readStage,
+                     STAGE *loadStage)
+   ---------------------------------------------------------------
+   Input:   char    *datafile    Chothia datafile
+            int     nreads       Times to read it
+   I/O:     STAGE   *readStage   Timings of ReadChothiaData()
+            STAGE   *loadStage   Timings of LoadChothiaData()
+   Returns: BOOL                 Success?
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Prints an error naming the stage which fails
+*/
+BOOL TimeDataFile(char *datafile, int nreads, STAGE *readStage,
+                  STAGE *loadStage)
+{
+   CHOTHIADATA data;
+   double      start;
+   BOOL        ok;
+   int         i;
+
+   for(i=0; i<nreads; i++)
+   {
+      start = Now();
+      if(!(ok = ReadChothiaData(datafile, &data)))
+         fprintf(stderr,"Error (chobench): %s failed to read datafile \
+%s on pass %d\n", readStage->name, datafile, i+1);
+      if(!AddTiming(readStage, Now() - start, 1))
+         ok = FALSE;
+      FreeChothiaData(&data);
+      if(!ok)
+         return(FALSE);
+
+      start = Now();
+      if(!(ok = LoadChothiaData(datafile, &data)))
+         fprintf(stderr,"Error (chobench): %s failed to load datafile \
+%s on pass %d\n", loadStage->name, datafile, i+1);
+      if(!AddTiming(loadStage, Now() - start, 1))
+         ok = FALSE;
+      FreeChothiaData(&data);
+      if(!ok)
+         return(FALSE);
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL TimeClassification(CANONCONTEXT *ctx, SEQUENCE **sequences,
+                           int *lengths, long nrecords, STAGE *stages,
+                           long *nAssigned, long *nLoops)
+   --------------------------------------------------------------------
+   Input:   CANONCONTEXT *ctx        Canonical definitions and options
+            SEQUENCE     **sequences Sequence of each record
+            int          *lengths    Length of each sequence
+            long         nrecords    Number of records
+   I/O:     STAGE        *stages     Timings of each stage
+   Output:  long         *nAssigned  Loops assigned a class
+            long         *nLoops     Loops found
+   Returns: BOOL                     Success?
+
+   Times indexing each record, looking up every key residue label of
+   the datafile in it, and classifying it
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Initialises the RESINDEX with InitResIndex()
+*/
+BOOL TimeClassification(CANONCONTEXT *ctx, SEQUENCE **sequences,
+                        int *lengths, long nrecords, STAGE *stages,
+                        long *nAssigned, long *nLoops)
+{
+   CANONTABLE   *table = &(ctx->data->table);
+   CANONRESULTS results;
+   RESINDEX     *index;
+   double       start;
+   long         record;
+   int          key,
+                loop,
+                found = 0;
+
+   if((index = (RESINDEX *)malloc(sizeof(RESINDEX)))==NULL)
+   {
+      fprintf(stderr,"Error (chobench): No memory for sequence \
+index\n");
+      return(FALSE);
+   }
+   InitResIndex(index);
+
+   for(record=0; record<nrecords; record++)
+   {
+      start = Now();
+      IndexSequence(sequences[record], lengths[record], index);
+      if(!AddTiming(&(stages[STAGE_INDEX]), Now() - start, 1))
+         return(FALSE);
+
+      start = Now();
+      for(key=0; key<table->nKey; key++)
+         found += (FindRes(sequences[record], lengths[record], index,
+                           table->strings + table->keyLabel[key]) >= 0);
+      if(!AddTiming(&(stages[STAGE_FINDRES]), Now() - start,
+                    table->nKey))
+         return(FALSE);
+
+      start = Now();
+      ClassifySequence(ctx, sequences[record], lengths[record], index,
+                       &results);
+      if(!AddTiming(&(stages[STAGE_CLASSIFY]), Now() - start, 1))
+         return(FALSE);
+
+      for(loop=results.firstCDR; loop<results.lastCDR; loop++)
+      {
+         if(results.cdr[loop].status != CANON_MISSING)
+            (*nLoops)++;
+         if(results.cdr[loop].status == CANON_MATCH)
+            (*nAssigned)++;
+      }
+   }
+
+   /* Stops the lookups being optimized away                            */
+   if(found < 0)
+      fprintf(stderr, "%d\n", found);
+
+   free(index);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL TimeBlocks(CANONCONTEXT *ctx, SEQUENCE **sequences, int *lengths,
+                   long nrecords, STAGE *stage)
+   ----------------------------------------------------------------------
+   Input:   CANONCONTEXT *ctx        Canonical definitions and options
+            SEQUENCE     **sequences Sequence of each record
+            int          *lengths    Length of each sequence
+            long         nrecords    Number of records
+   I/O:     STAGE        *stage      Timings of ClassifyBlock()
+   Returns: BOOL                     Success?
+
+   Times classifying the records in blocks with ClassifyBlock(). The
+   records are indexed first, which is not timed.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Initialises the RESINDEX with InitResIndex()
+*/
+BOOL TimeBlocks(CANONCONTEXT *ctx, SEQUENCE **sequences, int *lengths,
+                long nrecords, STAGE *stage)
+{
+   RESINDEX     *index;
+   CANONRESULTS *results;
+   double       start;
+   long         first;
+   int          n,
+                i;
+
+   if(((index = (RESINDEX *)malloc(BLOCKSEQS * sizeof(RESINDEX)))
+       ==NULL) ||
+      ((results = (CANONRESULTS *)malloc(BLOCKSEQS *
+                                         sizeof(CANONRESULTS)))==NULL))
+   {
+      fprintf(stderr,"Error (chobench): No memory for blocks\n");
+      return(FALSE);
+   }
+   for(i=0; i<BLOCKSEQS; i++)
+      InitResIndex(&(index[i]));
+
+   for(first=0; first<nrecords; first+=BLOCKSEQS)
+   {
+      n = ((nrecords - first) < BLOCKSEQS) ? (int)(nrecords - first) :
+          BLOCKSEQS;
+      for(i=0; i<n; i++)
+         IndexSequence(sequences[first+i], lengths[first+i],
+                       &(index[i]));
+
+      start = Now();
+      ClassifyBlock(ctx, sequences+first, lengths+first, index, n,
+                    results);
+      if(!AddTiming(stage, Now() - start, n))
+         return(FALSE);
+   }
+
+   free(index);
+   free(results);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL TimeTree(CANONCONTEXT *ctx, SEQUENCE **sequences, int *lengths,
+                 long nrecords, STAGE *stage)
+   --------------------------------------------------------------------
+   Input:   CANONCONTEXT *ctx        Canonical definitions and options
+            SEQUENCE     **sequences Sequence of each record
+            int          *lengths    Length of each sequence
+            long         nrecords    Number of records
+   I/O:     STAGE        *stage      Timings of ClassifySequence()
+   Returns: BOOL                     Success?
+
+   Times classifying each record with the decision tree engine. The
+   trees are built and the records indexed first, which is not timed.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Frees the index and prints an error if the trees cannot be
+            built
+   16.10.26 Initialises the RESINDEX with InitResIndex()
+*/
+BOOL TimeTree(CANONCONTEXT *ctx, SEQUENCE **sequences, int *lengths,
+              long nrecords, STAGE *stage)
+{
+   CANONCONTEXT treeCtx;
+   CANONRESULTS results;
+   RESINDEX     *index;
+   double       start;
+   long         record;
+
+   if((index = (RESINDEX *)malloc(sizeof(RESINDEX)))==NULL)
+   {
+      fprintf(stderr,"Error (chobench): No memory for sequence \
+index\n");
+      return(FALSE);
+   }
+   InitResIndex(index);
+
+   if(!BuildChothiaTree(ctx->data))
+   {
+      fprintf(stderr,"Error (chobench): %s failed to build the \
+decision trees\n", stage->name);
+      free(index);
+      return(FALSE);
+   }
+
+   treeCtx        = *ctx;
+   treeCtx.engine = ENGINE_TREE;
+   for(record=0; record<nrecords; record++)
+   {
+      IndexSequence(sequences[record], lengths[record], index);
+
+      start = Now();
+      ClassifySequence(&treeCtx, sequences[record], lengths[record],
+                       index, &results);
+      if(!AddTiming(stage, Now() - start, 1))
+         return(FALSE);
+   }
+
+   free(index);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL AddTiming(STAGE *stage, double seconds, long items)
+   --------------------------------------------------------
+   I/O:     STAGE   *stage      Timings of a stage
+   Input:   double  seconds     Time of an operation
+            long    items       Items processed by the operation
+   Returns: BOOL                Success?
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL AddTiming(STAGE *stage, double seconds, long items)
+{
+   if(stage->nOps == stage->maxOps)
+   {
+      stage->maxOps = (stage->maxOps == 0) ? 1024 : (2 * stage->maxOps);
+      if((stage->latency = (double *)realloc(stage->latency,
+                                             stage->maxOps *
+                                             sizeof(double)))==NULL)
+      {
+         fprintf(stderr,"Error (chobench): No memory for timings\n");
+         return(FALSE);
+      }
+   }
+
+   stage->latency[stage->nOps++] = seconds;
+   stage->seconds += seconds;
+   stage->nItems  += items;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void PrintResults(FILE *out, char *datafile, long nrecords,
+                     unsigned long seed, long nAssigned, long nLoops,
+                     STAGE *stages)
+   -----------------------------------------------------------------
+   Input:   FILE          *out       Output file
+            char          *datafile  Chothia datafile
+            long          nrecords   Number of records
+            unsigned long seed       Random number seed
+            long          nAssigned  Loops assigned a class
+            long          nLoops     Loops found
+            STAGE         *stages    Timings of each stage
+
+   Writes the results as a JSON object. For example:
+
+   {"benchmark":"chothia","version":"2.27","datafile":"chothia.dat",
+    "records":10000,"seed":1,"blockSize":64,"loops":60000,
+    "assigned":55212,"stages":[
+     {"stage":"parse","operations":10000,"items":10000,
+      "seconds":0.2314,"perSecond":43215.2,"latencyUs":{"mean":23.14,
+      "p50":22.10,"p90":25.31,"p99":40.12,"max":120.55}},...]}
+
+   A stage with a target also has "target" (items per second) and
+   "met" (true or false).
+
+   16.10.26 Original    By: ACRM
+*/
+void PrintResults(FILE *out, char *datafile, long nrecords,
+                  unsigned long seed, long nAssigned, long nLoops,
+                  STAGE *stages)
+{
+   STAGE  *stage;
+   double rate;
+   int    i;
+
+   fprintf(out, "{\"benchmark\":\"chothia\",\"version\":\"2.27\",\
+\"datafile\":\"");
+   for(i=0; datafile[i]; i++)
+   {
+      if((datafile[i] == '"') || (datafile[i] == '\\'))
+         fputc('\\', out);
+      fputc(datafile[i], out);
+   }
+   fprintf(out, "\",\"records\":%ld,\"seed\":%lu,\"blockSize\":%d,\
+\"loops\":%ld,\"assigned\":%ld,\"stages\":[",
+           nrecords, seed, BLOCKSEQS, nLoops, nAssigned);
+
+   for(i=0; i<NSTAGE; i++)
+   {
+      stage = &(stages[i]);
+      if(stage->nOps > 0)
+         qsort(stage->latency, stage->nOps, sizeof(double),
+               CompareDoubles);
+      rate = (stage->seconds > 0.0) ? (stage->nItems / stage->seconds) :
+             0.0;
+
+      fprintf(out, "%s\n {\"stage\":\"%s\",\"operations\":%ld,\
+\"items\":%ld,\"seconds\":%.6f,\"perSecond\":%.1f,\"latencyUs\":\
+{\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}",
+              (i ? "," : ""), stage->name, stage->nOps, stage->nItems,
+              stage->seconds, rate,
+              (stage->nOps ? (1.0e6 * stage->seconds / stage->nOps) :
+               0.0),
+              1.0e6 * Percentile(stage->latency, stage->nOps, 50.0),
+              1.0e6 * Percentile(stage->latency, stage->nOps, 90.0),
+              1.0e6 * Percentile(stage->latency, stage->nOps, 99.0),
+              1.0e6 * Percentile(stage->latency, stage->nOps, 100.0));
+      if(stage->target > 0.0)
+         fprintf(out, ",\"target\":%.1f,\"met\":%s", stage->target,
+                 ((rate >= stage->target) ? "true" : "false"));
+      fprintf(out, "}");
+   }
+   fprintf(out, "]}\n");
+}
+
+
+/************************************************************************/
+/*>double Percentile(double *sorted, long n, double percent)
+   ---------------------------------------------------------
+   Input:   double *sorted   Sorted values
+            long   n         Number of values
+            double percent   Percentile required
+   Returns: double           The smallest value which is at least the
+                             given percentage of values (0 if none)
+
+   16.10.26 Original    By: ACRM
+*/
+double Percentile(double *sorted, long n, double percent)
+{
+   long rank;
+
+   if(n == 0)
+      return(0.0);
+
+   rank = (long)((percent * n + 99.999) / 100.0);
+   if(rank < 1)
+      rank = 1;
+   if(rank > n)
+      rank = n;
+   return(sorted[rank-1]);
+}
+
+
+/************************************************************************/
+/*>int CompareDoubles(const void *a, const void *b)
+   ------------------------------------------------
+   Comparison function for qsort()
+
+   16.10.26 Original    By: ACRM
+*/
+int CompareDoubles(const void *a, const void *b)
+{
+   double x = *(const double *)a,
+          y = *(const double *)b;
+
+   return((x < y) ? -1 : ((x > y) ? 1 : 0));
+}
+
+
+/************************************************************************/
+/*>double Now(void)
+   ----------------
+   Returns: double      Monotonic time in seconds
+
+   16.10.26 Original    By: ACRM
+*/
+double Now(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return((double)ts.tv_sec + ((double)ts.tv_nsec * 1.0e-9));
+}
+
+
+/************************************************************************/
+/*>double Uniform(void)
+   --------------------
+   Returns: double      Random number in [0,1)
+
+   A 32-bit xorshift generator, so that a repertoire is the same for a
+   given seed on any machine
+
+   16.10.26 Original    By: ACRM
+*/
+double Uniform(void)
+{
+   sRandom ^= (sRandom << 13) & 0xFFFFFFFFUL;
+   sRandom ^= sRandom >> 17;
+   sRandom ^= (sRandom << 5) & 0xFFFFFFFFUL;
+   return((double)(sRandom >> 8) / 16777216.0);
+}
+
+
+/************************************************************************/
+/*>int RandomLength(LENGTHDIST *dist)
+   ----------------------------------
+   Input:   LENGTHDIST *dist     Length distribution of a CDR
+   Returns: int                  A length drawn from the distribution
+
+   16.10.26 Original    By: ACRM
+*/
+int RandomLength(LENGTHDIST *dist)
+{
+   double total = 0.0,
+          r;
+   int    i;
+
+   for(i=0; i<dist->nLength; i++)
+      total += dist->weight[i];
+
+   r = Uniform() * total;
+   for(i=0; i<dist->nLength-1; i++)
+   {
+      if((r -= dist->weight[i]) < 0.0)
+         break;
+   }
+   return(dist->length[i]);
+}
+
+
+/************************************************************************/
+/*>BOOL ParseLengthDist(char *spec)
+   --------------------------------
+   Input:   char   *spec     CDR=len:weight,len:weight,...
+   Returns: BOOL             Valid?
+
+   Replaces the length distribution of a CDR. A length without a
+   weight has weight 1.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL ParseLengthDist(char *spec)
+{
+   LENGTHDIST *dist = NULL;
+   char       *entry;
+   int        cdr,
+              n = 0;
+
+   for(cdr=0; cdr<NCDR; cdr++)
+   {
+      if(!strncmp(spec, sLengthDist[cdr].name, 2) && (spec[2] == '='))
+         dist = &(sLengthDist[cdr]);
+   }
+   if(dist == NULL)
+      return(FALSE);
+
+   for(entry=strtok(spec+3, ","); entry!=NULL; entry=strtok(NULL, ","))
+   {
+      if(n == MAXLENGTHS)
+         return(FALSE);
+      dist->weight[n] = 1.0;
+      if((sscanf(entry, "%d:%lf", &(dist->length[n]),
+                 &(dist->weight[n])) < 1) ||
+         (dist->length[n] < dist->minLength) ||
+         (dist->length[n] > dist->maxLength) ||
+         (dist->weight[n] < 0.0))
+      {
+         fprintf(stderr,"Error (chobench): %s lengths must be %d-%d\n",
+                 dist->name, dist->minLength, dist->maxLength);
+         return(FALSE);
+      }
+      n++;
+   }
+   dist->nLength = n;
+
+   return(n > 0);
+}
+
+
+/************************************************************************/
+/*>BOOL ParseTarget(char *spec, STAGE *stages)
+   -------------------------------------------
+   Input:   char   *spec     stage=persec
+   I/O:     STAGE  *stages   Stages, with the target set
+   Returns: BOOL             Valid?
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL ParseTarget(char *spec, STAGE *stages)
+{
+   char *value;
+   int  i;
+
+   if((value = strchr(spec, '=')) == NULL)
+      return(FALSE);
+   *(value++) = '\0';
+
+   for(i=0; i<NSTAGE; i++)
+   {
+      if(!strcmp(spec, stages[i].name))
+         return((sscanf(value, "%lf", &(stages[i].target)) == 1) &&
+                (stages[i].target > 0.0));
+   }
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>BOOL ParseCmdLine(int argc, char **argv, char *datafile,
+                     long *nrecords, unsigned long *seed,
+                     double *mutation, int *nreads, char *repfile,
+                     STAGE *stages)
+   ---------------------------------------------------------------------
+   Input:   int           argc        Argument count
+            char          **argv      Argument array
+   Output:  char          *datafile   Chothia datafile
+            long          *nrecords   Records to generate
+            unsigned long *seed       Random number seed
+            double        *mutation   Fraction of key residues set to
+                                      any residue type
+            int           *nreads     Times to read the datafile
+            char          *repfile    File to keep the repertoire (or
+                                      blank string)
+   I/O:     STAGE         *stages     Stages with any targets set
+   Returns: BOOL                      Success?
+
+   Parse the command line
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL ParseCmdLine(int argc, char **argv, char *datafile, long *nrecords,
+                  unsigned long *seed, double *mutation, int *nreads,
+                  char *repfile, STAGE *stages)
+{
+   argc--;
+   argv++;
+
+   strncpy(datafile, "chothia.dat", MAXBUFF);
+   repfile[0] = '\0';
+   *nrecords  = DEF_RECORDS;
+   *seed      = DEF_SEED;
+   *mutation  = DEF_MUTATION;
+   *nreads    = DEF_READS;
+
+   while(argc)
+   {
+      if((argv[0][0] != '-') || (argc < 2))
+         return(FALSE);
+
+      switch(argv[0][1])
+      {
+      case 'c':
+         strncpy(datafile, argv[1], MAXBUFF);
+         break;
+      case 'w':
+         strncpy(repfile, argv[1], MAXBUFF);
+         break;
+      case 'n':
+         if(!sscanf(argv[1], "%ld", nrecords) || (*nrecords < 1))
+            return(FALSE);
+         break;
+      case 's':
+         if(!sscanf(argv[1], "%lu", seed))
+            return(FALSE);
+         break;
+      case 'm':
+         if(!sscanf(argv[1], "%lf", mutation) || (*mutation < 0.0) ||
+            (*mutation > 1.0))
+            return(FALSE);
+         break;
+      case 'r':
+         if(!sscanf(argv[1], "%d", nreads) || (*nreads < 1))
+            return(FALSE);
+         break;
+      case 'l':
+         if(!ParseLengthDist(argv[1]))
+            return(FALSE);
+         break;
+      case 'T':
+         if(!ParseTarget(argv[1], stages))
+            return(FALSE);
+         break;
+      default:
+         return(FALSE);
+      }
+      argc -= 2;
+      argv += 2;
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void Usage(void)
+   ----------------
+   Prints a usage message
+
+   16.10.26 Original    By: ACRM
+*/
+void Usage(void)
+{
+   fprintf(stderr,"\nchobench V2.27 (c) 1995-2026, Prof. Andrew C.R. \
+Martin, UCL\n\n");
+
+   fprintf(stderr,"Usage: chobench [-c datafile] [-n nrecords] [-s seed] \
+[-m mutation]\n");
+   fprintf(stderr,"                [-r nreads] [-l CDR=len:weight,...] \
+[-T stage=persec]\n");
+   fprintf(stderr,"                [-w repertoire]\n");
+   fprintf(stderr,"                -c Chothia datafile (Default: \
+chothia.dat)\n");
+   fprintf(stderr,"                -n Number of records to generate \
+(Default: %d)\n", DEF_RECORDS);
+   fprintf(stderr,"                -s Random number seed (Default: \
+%d)\n", DEF_SEED);
+   fprintf(stderr,"                -m Fraction of key residues set to \
+any residue type\n");
+   fprintf(stderr,"                   (Default: %.2f)\n", DEF_MUTATION);
+   fprintf(stderr,"                -r Times to read the datafile \
+(Default: %d)\n", DEF_READS);
+   fprintf(stderr,"                -l Length distribution of a CDR \
+(L1, L3, H1, H2 or H3).\n");
+   fprintf(stderr,"                   May be repeated\n");
+   fprintf(stderr,"                -T Minimum items per second for a \
+stage. May be repeated\n");
+   fprintf(stderr,"                -w Keep the repertoire in the \
+specified file\n\n");
+
+   fprintf(stderr,"Generates a synthetic repertoire of antibody \
+sequences numbered in the\n");
+   fprintf(stderr,"scheme of the datafile, with the key residues of \
+canonical classes chosen\n");
+   fprintf(stderr,"at random, and times the stages of assigning \
+canonical classes to it.\n");
+   fprintf(stderr,"The stages are parse, readdata, loaddata, index, \
+findres, classify,\n");
+   fprintf(stderr,"classify_block and classify_tree. The results are \
+written to stdout as a\n");
+   fprintf(stderr,"JSON object giving the throughput and latency \
+percentiles of each stage.\n");
+   fprintf(stderr,"The exit status is 1 if a throughput given with -T \
+is not met.\n\n");
+   fprintf(stderr,"CDR lengths are as numbered by chothia -r (e.g. \
+H3 is H95-H102). For\n");
+   fprintf(stderr,"example, -l H3=10:1,12:2,14:1 gives H3 loops of 10, \
+12 and 14 residues\n");
+   fprintf(stderr,"with 12 twice as likely as the others.\n\n");
+}
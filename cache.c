@@ -0,0 +1,458 @@
+/*************************************************************************
+
+   Program:    Chothia
+   File:       cache.c
+
+   Version:    V2.28
+   Date:       16.10.26
+   Function:   Memo cache of loop classifications
+
+   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2026
+   Author:     Prof. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Part of libchothia. The class assigned to a loop depends only on the
+   loop, its length and the residues at the key positions of the
+   candidate classes for that loop and length (and, when the numbering
+   of the sequence must be translated to that of the datafile, on the
+   CDR lengths). In a large repertoire, very many sequences have the
+   same residues at all of these positions, so ClassifyLoop() keeps the
+   results in a CANONCACHE keyed on these and only tests the classes for
+   new combinations.
+
+   For each bucket of candidates (loop and length) the MATCHKERNEL of
+   the canonical definitions holds the distinct key positions of all its
+   classes. The residues found at these positions form the fingerprint
+   of the loop. Entries are found through a hash table and, once the
+   cache is full, are replaced using the CLOCK algorithm, which
+   approximates least recently used replacement without reordering the
+   entries on each hit.
+
+   A cache is for a single set of canonical definitions and must not be
+   shared between threads; like a RESINDEX, each thread has its own.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.16 16.10.26 Original
+   V2.22 16.10.26 The key positions of each bucket are taken from the
+                  MATCHKERNEL of the canonical definitions
+   V2.28 16.10.26 Added StoreCanonCacheKey() for loops looked up in a
+                  block before they are classified
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chothia.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define FNV_OFFSET   2166136261U /* FNV-1a hash parameters              */
+#define FNV_PRIME    16777619U
+
+/* A cached classification (array). Entries with the same hash value
+   modulo the size of the hash table are chained through next          */
+typedef struct
+{
+   unsigned int hash;               /* Hash of bucket, context and
+                                       fingerprint                      */
+   int          bucket,             /* Bucket of candidates             */
+                context,            /* Numbering translation context    */
+                status,             /* CANON_MATCH or _NOMATCH          */
+                classNum,           /* Class assigned or nearest class
+                                       (-1 if none)                     */
+                next;               /* Next entry in chain (-1 if none) */
+   BOOL         referenced;         /* Used since the CLOCK hand passed?*/
+}  CACHEENTRY;
+
+struct _canoncache
+{
+   MATCHKERNEL   *kernel;           /* Key positions of each bucket     */
+   int           maxKeys,           /* Most keys in one bucket          */
+                 *heads;            /* Hash table of entry chains       */
+   unsigned int  hashMask;          /* Size of hash table - 1           */
+   CACHEENTRY    *entries;
+   char          *fingerprints,     /* Fingerprint of each entry        */
+                 *fingerprint;      /* Fingerprint being looked up      */
+   int           nEntries,          /* Size of cache                    */
+                 nUsed,             /* Entries filled                   */
+                 hand,              /* CLOCK hand                       */
+                 lastBucket,        /* Bucket and context of last lookup*/
+                 lastContext;
+   unsigned int  lastHash;          /* Hash of last lookup              */
+   unsigned long hits,
+                 misses,
+                 evictions;
+};
+
+/************************************************************************/
+/* Prototypes
+*/
+unsigned int HashFingerprint(CANONCACHE *cache, int bucket, int context);
+int  FindCacheEntry(CANONCACHE *cache, int bucket, int context);
+
+
+/************************************************************************/
+/*>CANONCACHE *NewCanonCache(CHOTHIADATA *data, int nEntries)
+   ----------------------------------------------------------
+   Input:   CHOTHIADATA  *data      Canonical definitions
+            int          nEntries   Maximum number of loops cached
+   Returns: CANONCACHE   *          The cache (NULL if no memory)
+
+   Creates an empty classification cache for a set of canonical
+   definitions. It is used by ClassifySequence() when placed in the
+   CANONCONTEXT.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Key positions are taken from the MATCHKERNEL
+*/
+CANONCACHE *NewCanonCache(CHOTHIADATA *data, int nEntries)
+{
+   CANONCACHE   *cache;
+   unsigned int nHeads;
+   int          i;
+
+   if(nEntries < 1)
+      return(NULL);
+   if((cache = (CANONCACHE *)calloc(1, sizeof(CANONCACHE)))==NULL)
+      return(NULL);
+
+   cache->kernel   = data->kernel;
+   cache->maxKeys  = MatchKernelMaxKeys(data->kernel);
+   cache->nEntries = nEntries;
+
+   /* Hash table of at least twice the number of entries               */
+   for(nHeads=1; nHeads < 2 * (unsigned int)nEntries; nHeads <<= 1);
+   cache->hashMask = nHeads - 1;
+
+   if(((cache->heads   = (int *)malloc(nHeads * sizeof(int)))==NULL) ||
+      ((cache->entries = (CACHEENTRY *)malloc(nEntries *
+                                              sizeof(CACHEENTRY)))
+       ==NULL) ||
+      ((cache->fingerprints = (char *)malloc((size_t)nEntries *
+                                             (cache->maxKeys + 1)))
+       ==NULL) ||
+      ((cache->fingerprint = (char *)malloc(cache->maxKeys + 1))==NULL))
+   {
+      FreeCanonCache(cache);
+      return(NULL);
+   }
+
+   for(i=0; i<(int)nHeads; i++)
+      cache->heads[i] = (-1);
+
+   return(cache);
+}
+
+
+/************************************************************************/
+/*>void FreeCanonCache(CANONCACHE *cache)
+   --------------------------------------
+   Input:   CANONCACHE  *cache    Classification cache (may be NULL)
+
+   Frees a classification cache
+
+   16.10.26 Original    By: ACRM
+*/
+void FreeCanonCache(CANONCACHE *cache)
+{
+   if(cache == NULL)
+      return;
+
+   if(cache->heads != NULL)        free(cache->heads);
+   if(cache->entries != NULL)      free(cache->entries);
+   if(cache->fingerprints != NULL) free(cache->fingerprints);
+   if(cache->fingerprint != NULL)  free(cache->fingerprint);
+   free(cache);
+}
+
+
+/************************************************************************/
+/*>void CanonCacheStats(CANONCACHE *cache, unsigned long *hits,
+                        unsigned long *misses, unsigned long *evictions)
+   ----------------------------------------------------------------------
+   Input:   CANONCACHE    *cache      Classification cache
+   Output:  unsigned long *hits       Loops found in the cache
+            unsigned long *misses     Loops which had to be classified
+            unsigned long *evictions  Entries replaced
+
+   Returns the counters of a classification cache
+
+   16.10.26 Original    By: ACRM
+*/
+void CanonCacheStats(CANONCACHE *cache, unsigned long *hits,
+                     unsigned long *misses, unsigned long *evictions)
+{
+   *hits      = cache->hits;
+   *misses    = cache->misses;
+   *evictions = cache->evictions;
+}
+
+
+/************************************************************************/
+/*>int *CanonCacheKeys(CANONCACHE *cache, int bucket, int *nKeys,
+                       char **fingerprint)
+   --------------------------------------------------------------
+   Input:   CANONCACHE  *cache        Classification cache
+            int         bucket        Bucket of candidates
+   Output:  int         *nKeys        Number of keys in fingerprint
+            char        **fingerprint Buffer for the fingerprint
+   Returns: int         *             Key residues (offsets into the
+                                      table)
+
+   Gives the key residues which make up the fingerprint of a loop in
+   the given bucket. The caller places the residue type found at each
+   ('\0' if not found) in the fingerprint buffer before calling
+   LookupCanonCache().
+
+   16.10.26 Original    By: ACRM
+*/
+int *CanonCacheKeys(CANONCACHE *cache, int bucket, int *nKeys,
+                    char **fingerprint)
+{
+   *fingerprint = cache->fingerprint;
+   return(MatchKernelKeys(cache->kernel, bucket, nKeys));
+}
+
+
+/************************************************************************/
+/*>BOOL LookupCanonCache(CANONCACHE *cache, int bucket, int context,
+                         int *status, int *classNum)
+   -----------------------------------------------------------------
+   Input:   CANONCACHE  *cache    Classification cache
+            int         bucket    Bucket of candidates
+            int         context   Numbering translation context (0 if
+                                  the numbering is not translated)
+   Output:  int         *status   CANON_MATCH or _NOMATCH
+            int         *classNum Class assigned or nearest class (-1 if
+                                  none)
+   Returns: BOOL                  Was the loop in the cache?
+
+   Looks up the fingerprint placed in the buffer from CanonCacheKeys().
+   If it is not found, the result may be added with StoreCanonCache()
+   once the loop has been classified.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 The search moved out to FindCacheEntry()
+*/
+BOOL LookupCanonCache(CANONCACHE *cache, int bucket, int context,
+                      int *status, int *classNum)
+{
+   CACHEENTRY *entry;
+   int        e;
+
+   if((e = FindCacheEntry(cache, bucket, context)) >= 0)
+   {
+      entry = &(cache->entries[e]);
+      entry->referenced = TRUE;
+      *status = entry->status;
+      *classNum = entry->classNum;
+      cache->hits++;
+      return(TRUE);
+   }
+
+   cache->misses++;
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>void StoreCanonCache(CANONCACHE *cache, int status, int classNum)
+   --------------------------------------------------------------
+   Input:   CANONCACHE  *cache    Classification cache
+            int         status    CANON_MATCH or _NOMATCH
+            int         classNum  Class assigned or nearest class (-1 if
+                                  none)
+
+   Adds the result for the fingerprint of the last (unsuccessful) call
+   to LookupCanonCache(). Once the cache is full, the CLOCK hand is
+   advanced, clearing the referenced flag of each entry it passes,
+   until it reaches an entry which has not been used since it was last
+   passed. This entry is replaced.
+
+   16.10.26 Original    By: ACRM
+*/
+void StoreCanonCache(CANONCACHE *cache, int status, int classNum)
+{
+   CACHEENTRY *entry;
+   int        e,
+              nKeys,
+              *link;
+
+   if(cache->nUsed < cache->nEntries)
+   {
+      e = cache->nUsed++;
+   }
+   else
+   {
+      while(cache->entries[cache->hand].referenced)
+      {
+         cache->entries[cache->hand].referenced = FALSE;
+         cache->hand = (cache->hand + 1) % cache->nEntries;
+      }
+      e = cache->hand;
+      cache->hand = (cache->hand + 1) % cache->nEntries;
+
+      /* Unlink the old entry from its chain                           */
+      for(link = &(cache->heads[cache->entries[e].hash &
+                                cache->hashMask]);
+          *link != e;
+          link = &(cache->entries[*link].next));
+      *link = cache->entries[e].next;
+      cache->evictions++;
+   }
+
+   entry = &(cache->entries[e]);
+   entry->hash       = cache->lastHash;
+   entry->bucket     = cache->lastBucket;
+   entry->context    = cache->lastContext;
+   entry->status     = status;
+   entry->classNum   = classNum;
+   entry->referenced = FALSE;
+   MatchKernelKeys(cache->kernel, cache->lastBucket, &nKeys);
+   memcpy(cache->fingerprints + (size_t)e * (cache->maxKeys + 1),
+          cache->fingerprint, nKeys);
+
+   entry->next = cache->heads[entry->hash & cache->hashMask];
+   cache->heads[entry->hash & cache->hashMask] = e;
+}
+
+
+/************************************************************************/
+/*>void StoreCanonCacheKey(CANONCACHE *cache, int bucket, int context,
+                           char *fingerprint, int status, int classNum)
+   --------------------------------------------------------------------
+   Input:   CANONCACHE  *cache       Classification cache
+            int         bucket       Bucket of candidates
+            int         context      Numbering translation context (0
+                                     if the numbering is not translated)
+            char        *fingerprint Residue type at each key position
+                                     of CanonCacheKeys() ('\0' if not
+                                     found)
+            int         status       CANON_MATCH or _NOMATCH
+            int         classNum     Class assigned or nearest class (-1
+                                     if none)
+
+   Adds the result for a fingerprint given explicitly rather than that
+   of the last call to LookupCanonCache(), so that a block of loops may
+   be looked up before those not found are classified together. Nothing
+   is added if the fingerprint is already present, as happens when two
+   loops of a block have the same residues.
+
+   16.10.26 Original    By: ACRM
+*/
+void StoreCanonCacheKey(CANONCACHE *cache, int bucket, int context,
+                        char *fingerprint, int status, int classNum)
+{
+   int nKeys;
+
+   MatchKernelKeys(cache->kernel, bucket, &nKeys);
+   memcpy(cache->fingerprint, fingerprint, nKeys);
+   if(FindCacheEntry(cache, bucket, context) < 0)
+      StoreCanonCache(cache, status, classNum);
+}
+
+
+/************************************************************************/
+/*>int FindCacheEntry(CANONCACHE *cache, int bucket, int context)
+   --------------------------------------------------------------
+   Input:   CANONCACHE  *cache    Classification cache
+            int         bucket    Bucket of candidates
+            int         context   Numbering translation context
+   Returns: int                   Entry with the fingerprint in the
+                                  buffer (-1 if none)
+
+   Searches for the fingerprint in the buffer, remembering its hash, 
+   bucket and context for StoreCanonCache()
+
+   16.10.26 Original    By: ACRM
+*/
+int FindCacheEntry(CANONCACHE *cache, int bucket, int context)
+{
+   CACHEENTRY *entry;
+   int        e,
+              nKeys;
+
+   MatchKernelKeys(cache->kernel, bucket, &nKeys);
+   cache->lastHash    = HashFingerprint(cache, bucket, context);
+   cache->lastBucket  = bucket;
+   cache->lastContext = context;
+
+   for(e=cache->heads[cache->lastHash & cache->hashMask]; e>=0;
+       e=entry->next)
+   {
+      entry = &(cache->entries[e]);
+      if((entry->hash == cache->lastHash) &&
+         (entry->bucket == bucket) &&
+         (entry->context == context) &&
+         !memcmp(cache->fingerprints + (size_t)e * (cache->maxKeys + 1),
+                 cache->fingerprint, nKeys))
+         return(e);
+   }
+
+   return(-1);
+}
+
+
+/************************************************************************/
+/*>unsigned int HashFingerprint(CANONCACHE *cache, int bucket,
+                                int context)
+   ---------------------------------------------------------------
+   Input:   CANONCACHE  *cache    Classification cache
+            int         bucket    Bucket of candidates
+            int         context   Numbering translation context
+   Returns: unsigned int          FNV-1a hash of bucket, context and
+                                  the fingerprint being looked up
+
+   16.10.26 Original    By: ACRM
+*/
+unsigned int HashFingerprint(CANONCACHE *cache, int bucket, int context)
+{
+   unsigned int hash = FNV_OFFSET;
+   int          i,
+                nKeys;
+
+   MatchKernelKeys(cache->kernel, bucket, &nKeys);
+   hash = (hash ^ (unsigned int)bucket) * FNV_PRIME;
+   hash = (hash ^ (unsigned int)context) * FNV_PRIME;
+   for(i=0; i<nKeys; i++)
+      hash = (hash ^ (unsigned char)cache->fingerprint[i]) * FNV_PRIME;
+
+   return(hash);
+}
+
@@ -3,12 +3,12 @@
    Program:    Chothia
    File:       chothia.c
    
-   Version:    V2.3
-   Date:       12.10.21
+   Version:    V2.27
+   Date:       16.10.26
    Function:   Assign canonical classes and display reasons for 
                mismatches.
    
-   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2021
+   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2026
    Author:     Prof. Andrew C. R. Martin
    Address:    Biomolecular Structure & Modelling Unit,
                Department of Biochemistry & Molecular Biology,
@@ -37,7 +37,8 @@
    Description:
    ============
 
-   Must be linked with KabCho.c from KabatMan
+   Command line program for assigning canonicals. The work is done by
+   libchothia (libchothia.c, numtrans.c, KabCho.c etc.) - see chothia.h.
 
 
 **************************************************************************
@@ -75,124 +76,262 @@
                   Changed to new blXXX() Bioplib functions
    V2.3  12.10.21 MAXBUFF bumped to 240 and MAXSEQ to 3000 (inherited 
                   from abYsis version)
+   V2.4  16.10.26 Added -b batch mode. The input may contain many 
+                  records, each started by a >ID line and/or terminated 
+                  by //. The canonical definitions are read once and 
+                  each record is reported in turn, tagged with its ID
+                  Residues with illegal names really are ignored now
+   V2.5  16.10.26 Removed globals. The canonical definitions are held in
+                  a CHOTHIADATA structure and the options in a 
+                  CANONCONTEXT so the assignment code is reentrant.
+                  Added -j to process batch records with a pool of 
+                  threads
+   V2.6  16.10.26 Each sequence is indexed by chain, residue number and
+                  insert code once it has been read so FindRes() is a
+                  simple lookup rather than repeated scans of the 
+                  sequence
+   V2.7  16.10.26 The canonical definitions are compiled into a 
+                  CANONTABLE once read. Classes are held in an array
+                  grouped by loop and length, with their key residues
+                  as encoded residue IDs and bit masks of allowed
+                  residues
+   V2.8  16.10.26 Compiled classes are bucketed by loop and length with
+                  priority chains resolved, so only classes of the right
+                  loop and length are tested. Classes in a priority 
+                  chain must now be for the same loop
+   V2.9  16.10.26 Added -C to write the compiled definitions to a binary
+                  file alongside the data file. If this is present and
+                  up to date, it is mapped into memory at startup rather
+                  than reading the data file
+   V2.10 16.10.26 Added -S server mode. One or more datafiles (-c may 
+                  now be repeated) are loaded once and requests are 
+                  handled concurrently over a Unix domain socket. 
+                  Datafiles may be reloaded without disturbing requests
+                  in progress. -C writes the compiled file via a 
+                  temporary file so a running server is not disturbed
+   V2.11 16.10.26 Canonical assignment split out into libchothia, which
+                  returns the classes assigned in a CANONRESULTS 
+                  structure rather than printing them. This program is
+                  now the command line interface to the library
+   V2.12 16.10.26 Added -r to read raw sequences in FASTA or PIR format
+                  which are numbered internally, so KabatSeq need not 
+                  be run first
+   V2.13 16.10.26 Raw sequences are read by a streaming SEQREADER in 
+                  constant memory, and may be gzipped
+   V2.14 16.10.26 Added -f to give output as JSON Lines or TSV with one
+                  line per record. Output is written through a large 
+                  buffer
+   V2.15 16.10.26 Added -f arrow to write an Apache Arrow IPC file with
+                  dictionary encoded classes, written in record batches
+   V2.16 16.10.26 Batch mode keeps a cache of loop classifications keyed
+                  on the residues at the key positions. Added -m to set
+                  its size
+   V2.17 16.10.26 Added -d to classify each distinct sequence in a batch
+                  only once, and -u to output each distinct sequence 
+                  once with a count of the records having it
+   V2.18 16.10.26 Added -t to read a translation from the numbering 
+                  scheme of the sequence data to that of the datafile.
+                  Numbering is translated for all CDRs through a 
+                  table-driven NUMTRANS
+   V2.19 16.10.26 The translation of each key residue for each CDR 
+                  length is worked out when the translation is loaded
+   V2.20 16.10.26 CDR-H3 is classified when the datafile defines H3
+                  classes. Classes may cover a range of loop lengths
+   V2.21 16.10.26 Added -k to rank the classes of each CDR by a score
+                  weighted by the key residues
+   V2.23 16.10.26 Added -g to classify batch records in blocks, testing
+                  each class against a block of records at once
+   V2.24 16.10.26 Added -s to report counts of the work done and where
+                  the time went
+   V2.25 16.10.26 Added -M to classify each record against each of the
+                  methods (sets of definitions) listed in a file such
+                  as canonical_method.txt. If -c is repeated, each 
+                  datafile is used in turn. Records are read and 
+                  indexed once and the output for each method is 
+                  labelled with its name
+   V2.26 16.10.26 Sequence arrays are grown as needed and reused for
+                  each record rather than limited to MAXSEQ residues
+   V2.27 16.10.26 Added -e to choose the matching engine: counting the
+                  mismatches against each class (scan) or following a
+                  decision tree over the key positions (tree)
 
 *************************************************************************/
 /* Includes
 */
+#define _POSIX_C_SOURCE 200809L  /* For open_memstream(), fmemopen() etc*/
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <errno.h>
 
 #include "bioplib/macros.h"
 #include "bioplib/general.h"
-#include "bioplib/seq.h"
+
+#include "chothia.h"
 
 /************************************************************************/
 /* Defines and macros
 */
-#define ENV_KABATDIR "KABATDIR"  /* Environment variable for Kabat      */
-                                 /* directory                           */
-#define MAXCHOTHRES  80          /* Max number of key residues per class*/
-#define MAXBUFF      240         /* General buffer size                 */
-#define MAXSEQ       3000        /* Max length of light + heavy chains  */
-#define MAXEXPSEQ    300         /* Expected max light + heavy          */
-#define NCDR         5           /* Number of CDRs to process           */
-#define MAXWORD      40          /* Max length of an extracted word     */
-#define SMALLWORD    16          /* Length of small extracted word      */
-
-/* Terminates a string at the first alphabetic character                */
-#define TERMALPHA(x) do {  int _termalpha_j;                  \
-                        for(_termalpha_j=0;                   \
-                            (x)[_termalpha_j];                \
-                            _termalpha_j++)                   \
-                        {  if(isalpha((x)[_termalpha_j]))     \
-                           {  (x)[_termalpha_j] = '\0';       \
-                              break;                          \
-                     }  }  }  while(0)
-      
-/* Linked list to store information on canonical class definitions      */
-typedef struct _chothia
+#define MAXTHREADS   1024        /* Max number of batch worker threads  */
+#define SLOTSPERTHREAD 16        /* Records queued per worker thread    */
+
+#define MAXDATAFILES 16          /* Max Chothia datafiles (-c)          */
+#define MAXREQUEST   (1 << 26)   /* Max size of a server request        */
+#define SERVERQUEUE  64          /* Max pending server connections      */
+#define OUTPUTBUFF   (1 << 20)   /* Size of output file buffer          */
+#define CACHESIZE    65536       /* Default loops cached per thread     */
+#define STATS_NONE   (-1)        /* Format of statistics (-s) if none   */
+
+#define DEDUP_NONE   0           /* Handling of duplicate sequences:    */
+#define DEDUP_EXPAND 1           /*    none, classify once but output   */
+#define DEDUP_UNIQUE 2           /*    each record, or output each      */
+                                 /*    distinct sequence with a count   */
+
+#define SLOT_EMPTY   0           /* Status of a batch record slot       */
+#define SLOT_READY   1
+#define SLOT_DONE    2
+
+/* A record queued in the threaded batch engine (array)                 */
+typedef struct
 {
-   struct _chothia *next,                           /* Linked list      */
-                   *priority_over,                  /* Priority over which
-                                                       other classes when
-                                                       key residues 
-                                                       clash            */
-                   *subordinate_to;                 /* Suborinate to which
-                                                       other classes when
-                                                       key residues
-                                                       clash            */
-   int             length;                          /* Loop length      */
-   char            LoopID[SMALLWORD],               /* CDR (L1, L2, etc */
-                   class[SMALLWORD],                /* Class name       */
-                   source[MAXBUFF],                 /* Info on class
-                                                       maybe including PDB
-                                                       code in []       */
-                   resnum[MAXCHOTHRES][SMALLWORD],  /* Key positions    */
-                   restype[MAXCHOTHRES][MAXWORD],   /* Allowed residues */
-                   subordinate[SMALLWORD],          /* Class name to
-                                                       which this class is
-                                                       subordinate
-                                                       (0 or 1)         */
-                   priority[SMALLWORD];             /* Class name over
-                                                       which this class
-                                                       takes priority
-                                                       (0 or 1)         */
-   int             npriority,                       /* Number over which
-                                                       this class takes
-                                                       priority (0 or 1)*/
-                   nsubordinate;                    /* Number of classes
-                                                       to which this is
-                                                       subordinate 
-                                                       (0 or 1)         */
-   
-}  CHOTHIA;
-
-/* Input sequence data (array) - residue number label and amino acid    */
+   SEQUENCE *sequence;              /* Sequence array                   */
+   char     id[MAXBUFF],            /* Record ID                        */
+            *output;                /* Output text for the record       */
+   size_t   outputLen;              /* Length of output text            */
+   CANONRESULTS *results;           /* Results (if kept rather than
+                                       output text)                     */
+   int      NRes,                   /* Length of sequence               */
+            maxRes,                 /* Allocated size of sequence array */
+            status,                 /* SLOT_EMPTY, _READY or _DONE      */
+            dupEntry;               /* Entry in table of distinct
+                                       sequences (-1 if none)           */
+   BOOL     duplicate;              /* Sequence seen before so not to be
+                                       classified                       */
+}  BATCHSLOT;
+
+/* State shared between the threads of the batch engine. Records are 
+   read into the ring of slots in input order, claimed by the workers
+   and written out again in input order. Only the reading and writing
+   thread uses the table of distinct sequences                          */
 typedef struct
 {
-   char            resnum[SMALLWORD],
-                   seq;
-}  SEQUENCE;
-
-/* Definitions of CDR loop boundaries (array)                           */
+   CANONCONTEXT    *ctx;            /* Context of each method. Shared,
+                                       read-only except that the workers
+                                       add their counts to the 
+                                       CANONSTATS under the lock        */
+   BATCHSLOT       *slots;          /* Ring of records                  */
+   DUPTABLE        *dups;           /* Distinct sequences (NULL if not
+                                       collapsing duplicates)           */
+   int             nmethods,        /* Number of methods                */
+                   nslots,          /* Size of ring                     */
+                   nread,           /* Records queued so far            */
+                   nclaimed,        /* Records claimed by workers       */
+                   dedup;           /* DEDUP_NONE, _EXPAND or _UNIQUE   */
+   BOOL            finished,        /* All records have been queued     */
+                   keepResults;     /* Keep results rather than output
+                                       text (Arrow output or collapsing
+                                       duplicates)                      */
+   int             cacheSize,       /* Loops cached by each worker      */
+                   blockSize;       /* Records claimed by a worker at
+                                       once (1, or BLOCKSEQS with -g)   */
+   pthread_mutex_t lock;
+   pthread_cond_t  workReady,       /* A record has been queued         */
+                   workDone;        /* A record has been processed      */
+}  BATCHPOOL;
+
+/* A set of canonical definitions loaded by the server. Each request 
+   using it holds a reference, as does the server while it is current,
+   so a set replaced by a reload is freed when its last request ends   */
 typedef struct
 {
-   char name[SMALLWORD],
-        start[SMALLWORD],
-        stop[SMALLWORD];
-}  LOOP;
+   CHOTHIADATA     data;            /* Canonical definitions            */
+   int             nref;            /* Number of references             */
+   unsigned long   serial;          /* Distinguishes each set loaded    */
+}  SERVEDDATA;
 
-
-/************************************************************************/
-/* Globals
-*/
-CHOTHIA   *gChothia = NULL;         /* Linked list of Chothia data      */
-BOOL      gCanonChothNum = FALSE,   /* Data file uses Chothia numbering?*/
-          gChothiaNumbered = FALSE; /* Sequence data uses Chothia 
-                                       numbering?                       */
+/* State shared between the threads of the server                       */
+typedef struct
+{
+   char            filename[MAXDATAFILES][MAXBUFF];
+                                    /* Chothia datafiles served         */
+   SERVEDDATA      *served[MAXDATAFILES];
+                                    /* Current definitions for each     */
+   int             nfiles;          /* Number of datafiles              */
+   unsigned long   nloaded;         /* Sets of definitions loaded       */
+   pthread_mutex_t lock,            /* Protects served[] and nref       */
+                   reloadLock;      /* Allows one reload at a time      */
+}  SERVER;
+
+/* A client connection handled by a server thread                       */
+typedef struct
+{
+   SERVER          *server;
+   int             fd;
+}  CONNECTION;
 
 /************************************************************************/
 /* Prototypes
 */
 int  main(int argc, char **argv);
-BOOL ReadChothiaData(char *filename);
-int  ReadInputData(FILE *in, SEQUENCE *Sequence);
-void ReportCanonicals(FILE *out, SEQUENCE *Sequence, int NRes, 
-                      BOOL verbose, char chain);
-int  FindRes(SEQUENCE *Sequence, int NRes, char *res);
-void ReportACanonical(FILE *out, char *LoopName, int LoopLen, 
-                      SEQUENCE *Sequence, int NRes, BOOL verbose,
-                      char *cdr, int cdrlen);
+BOOL ProcessBatch(FILE *in, FILE *out, CANONCONTEXT *ctx, int nmethods,
+                  SEQUENCE **Sequence, int *maxRes, BOOL raw, 
+                  ARROWWRITER *arrow, int cacheSize, int dedup);
+BOOL ProcessBatchThreaded(FILE *in, FILE *out, CANONCONTEXT *ctx,
+                          int nmethods, SEQUENCE **Sequence, 
+                          int *maxRes, int nthreads, BOOL raw, 
+                          ARROWWRITER *arrow, int cacheSize, int dedup,
+                          BOOL block);
+BOOL ReportRecord(FILE *out, ARROWWRITER *arrow, CANONCONTEXT *ctx, 
+                  int nmethods, char *id, SEQUENCE *Sequence, int NRes, 
+                  RESINDEX *index);
+BOOL WriteRecord(FILE *out, ARROWWRITER *arrow, CANONCONTEXT *ctx, 
+                 char *id, CANONRESULTS *results);
+BOOL WriteUniqueRecords(FILE *out, CANONCONTEXT *ctx, DUPTABLE *dups);
+BOOL WriteBatchSlot(BATCHPOOL *pool, BATCHSLOT *slot, FILE *out, 
+                    ARROWWRITER *arrow);
+int  ReadFirstRecord(FILE *in, SEQUENCE **Sequence, int *maxRes, 
+                     char *id, CANONCONTEXT *ctx, BOOL raw);
+int  ReadNextRecord(FILE *in, SEQREADER *reader, SEQUENCE **Sequence, 
+                    int *maxRes, char *id, char *next, 
+                    CANONCONTEXT *ctx);
+void *BatchWorker(void *arg);
+void ClassifyBatchSlot(BATCHPOOL *pool, CANONCONTEXT *ctx, 
+                       BATCHSLOT *slot, RESINDEX *index);
+void ClassifyBatchBlock(BATCHPOOL *pool, CANONCONTEXT *ctx, 
+                        BATCHSLOT **block, int nblock, RESINDEX *index,
+                        CANONRESULTS *results);
+BOOL StoreBatchRecord(BATCHSLOT *slot, SEQUENCE *Sequence, int NRes, 
+                      char *id);
+BOOL RunServer(char *socketPath, char ChothiaFiles[][MAXBUFF], 
+               int nfiles);
+void *ServeConnection(void *arg);
+char *HandleRequest(SERVER *server, char *request, SEQUENCE **Sequence,
+                    int *maxRes, RESINDEX *index, CANONCACHE **cache,
+                    unsigned long *cacheSerial, size_t *replyLen);
+SERVEDDATA *LoadServedData(SERVER *server, char *filename);
+SERVEDDATA *AcquireServedData(SERVER *server, char *filename);
+void ReleaseServedData(SERVER *server, SERVEDDATA *served);
+BOOL ReloadServer(SERVER *server);
+BOOL ReadFrame(int fd, char **buffer, size_t *length);
+BOOL WriteFrame(int fd, char *buffer, size_t length);
+BOOL ReadBytes(int fd, void *buffer, size_t length);
+BOOL WriteBytes(int fd, void *buffer, size_t length);
 void Usage(void);
+BOOL ParseFormat(char *name, int *format);
+BOOL ParseEngine(char *name, int *engine);
 BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile, 
-                  char *ChothiaFile, BOOL *verbose, char *chain);
-char *KabCho(char *cdr, int length, char *kabspec);
-char *ChoKab(char *cdr, int length, char *kabspec);
-int TestThisCanonical(CHOTHIA *p, char *LoopName, int LoopLen,
-                      SEQUENCE *Sequence, int NRes, 
-                      char *cdr1, int cdr1len);
+                  char ChothiaFiles[][MAXBUFF], int *nfiles, 
+                  char *methodFile, CANONCONTEXT *ctx, BOOL *batch,
+                  int *nthreads, int *cacheSize, int *dedup,
+                  char *transFile, BOOL *compile, BOOL *raw,
+                  char *socketPath, BOOL *block, int *statsFormat);
 
 /************************************************************************/
 /*>int main(int argc, char **argv)
@@ -201,44 +340,282 @@ int TestThisCanonical(CHOTHIA *p, char *LoopName, int LoopLen,
 
    16.05.95 Original    By: ACRM
    19.12.08 Changed strcpy() to strncpy()
+   16.10.26 Added batch mode
+            Uses CHOTHIADATA and CANONCONTEXT rather than globals. 
+            Added threaded batch mode
+            Indexes the sequence
+            Compiles the canonical definitions
+            Added compile mode
+            Added server mode. Multiple datafiles
+            Added raw sequence input
+            Added output formats. Output is fully buffered
+            Added Arrow output
+            Added classification cache size
+            Added collapsing of duplicate sequences
+            Added numbering translation file
+            Compiles the translation of the key residues
+            Added block classification
+            Classifies against each of several methods
+            The sequence array is allocated and grown as needed
+            Builds the decision trees for the tree engine
+   16.10.26 Initialises the RESINDEX with InitResIndex()
+   16.10.26 Loads each datafile to write its compiled version
 */
 int main(int argc, char **argv)
 {
-   char     InFile[MAXBUFF],
-            OutFile[MAXBUFF],
-            ChothiaFile[MAXBUFF];
-   FILE     *in  = stdin,
-            *out = stdout;
-   SEQUENCE Sequence[MAXSEQ];
-   int      NRes;
-   BOOL     verbose;
-   char     chain = ' ';
-
-   strncpy(ChothiaFile,"chothia.dat", MAXBUFF);
-
-   if(ParseCmdLine(argc, argv, InFile, OutFile, ChothiaFile, &verbose,
-                   &chain))
+   char         CompFile[MAXBUFF+MAXWORD],
+                InFile[MAXBUFF],
+                OutFile[MAXBUFF],
+                ChothiaFiles[MAXDATAFILES][MAXBUFF],
+                MethodFile[MAXBUFF],
+                SocketPath[MAXBUFF],
+                TransFile[MAXBUFF],
+                id[MAXBUFF];
+   FILE         *in  = stdin,
+                *out = stdout;
+   SEQUENCE     *Sequence = NULL;
+   RESINDEX     Index;
+   int          NRes,
+                maxRes = 0,
+                nthreads,
+                cacheSize,
+                dedup,
+                nfiles,
+                nmethods,
+                statsFormat,
+                i;
+   BOOL         batch,
+                compile,
+                raw,
+                block,
+                reverse,
+                ok = TRUE;
+   CHOTHIADATA  ChothiaData[MAXDATAFILES];
+   CANONMETHOD  Methods[MAXDATAFILES];
+   CANONCONTEXT ctx,
+                MethodCtx[MAXDATAFILES];
+   CANONSTATS   stats;
+   ARROWWRITER  *arrow = NULL;
+   NUMTRANS     *trans = NULL;
+   double       start = 0.0,
+                split = 0.0;
+
+   if(ParseCmdLine(argc, argv, InFile, OutFile, ChothiaFiles, &nfiles,
+                   MethodFile, &ctx, &batch, &nthreads, &cacheSize, 
+                   &dedup, TransFile, &compile, &raw, SocketPath, 
+                   &block, &statsFormat))
    {
-      if(blOpenStdFiles(InFile, OutFile, &in, &out))
+      /* Each method is a set of definitions classified in turn. These
+         are those listed in the method file, or each datafile given.
+         The results are labelled unless there is only one datafile
+      */
+      if(MethodFile[0])
+      {
+         if(nfiles || SocketPath[0])
+         {
+            fprintf(stderr,"Error (chothia): -M is not available with \
+-c or -S\n");
+            return(1);
+         }
+         if((nfiles = ReadCanonMethods(MethodFile, Methods, 
+                                       MAXDATAFILES)) == 0)
+            return(1);
+         for(i=0; i<nfiles; i++)
+            strncpy(ChothiaFiles[i], Methods[i].datafile, MAXBUFF);
+      }
+      if(nfiles == 0)
+         strncpy(ChothiaFiles[nfiles++], "chothia.dat", MAXBUFF);
+      nmethods = nfiles;
+      for(i=0; i<nmethods; i++)
+      {
+         MethodCtx[i]        = ctx;
+         MethodCtx[i].data   = &(ChothiaData[i]);
+         MethodCtx[i].method = (MethodFile[0] ? Methods[i].display : 
+                                ((nmethods > 1) ? ChothiaFiles[i] : NULL));
+      }
+      
+      if((dedup == DEDUP_UNIQUE) && (ctx.format == FORMAT_ARROW))
+      {
+         fprintf(stderr,"Error (chothia): -u is not available with Arrow \
+output\n");
+         return(1);
+      }
+      
+      if((nmethods > 1) && !compile && !SocketPath[0] &&
+         ((dedup != DEDUP_NONE) || (ctx.format == FORMAT_ARROW)))
+      {
+         fprintf(stderr,"Error (chothia): -d, -u and -f arrow are only \
+available with one method\n");
+         return(1);
+      }
+      
+      if((ctx.topK > 0) && 
+         ((ctx.format == FORMAT_TSV) || (ctx.format == FORMAT_ARROW)))
+      {
+         fprintf(stderr,"Error (chothia): -k is only available with \
+text or JSON output\n");
+         return(1);
+      }
+      
+      if(TransFile[0] && raw)
+      {
+         fprintf(stderr,"Error (chothia): -t is not available with -r\n");
+         return(1);
+      }
+      
+      if((statsFormat != STATS_NONE) && SocketPath[0])
+      {
+         fprintf(stderr,"Error (chothia): -s is not available with -S\n");
+         return(1);
+      }
+      if(statsFormat != STATS_NONE)
+      {
+         InitCanonStats(&stats);
+         for(i=0; i<nmethods; i++)
+            MethodCtx[i].stats = &stats;
+         start = StatsClock();
+      }
+      
+      if(compile)
       {
-         if(ReadChothiaData(ChothiaFile))
+         for(i=0; i<nfiles; i++)
          {
-            if((NRes = ReadInputData(in, Sequence)) != 0)
+            if(!LoadChothiaData(ChothiaFiles[i], &(ChothiaData[i])) ||
+               !CompiledDataPath(ChothiaFiles[i], CompFile) ||
+               !WriteCompiledData(&(ChothiaData[i]), CompFile))
             {
-               ReportCanonicals(out, Sequence, NRes, verbose, chain);
+               fprintf(stderr,"Error (chothia): Unable to write \
+compiled Chothia datafile %s\n", ChothiaFiles[i]);
+               return(1);
             }
-            else
+            FreeChothiaData(&(ChothiaData[i]));
+         }
+      }
+      else if(SocketPath[0])
+      {
+         /* Only returns if the server could not be started             */
+         RunServer(SocketPath, ChothiaFiles, nfiles);
+         return(1);
+      }
+      else if(blOpenStdFiles(InFile, OutFile, &in, &out))
+      {
+         for(i=0; i<nmethods; i++)
+         {
+            if(!LoadChothiaData(ChothiaFiles[i], &(ChothiaData[i])))
+            {
+               fprintf(stderr,"Error (chothia): Unable to read Chothia \
+datafile %s\n", ChothiaFiles[i]);
+               return(1);
+            }
+            if((ctx.engine == ENGINE_TREE) && 
+               !BuildChothiaTree(&(ChothiaData[i])))
+               return(1);
+         }
+         if(statsFormat != STATS_NONE)
+            stats.loadTime = StatsClock() - start;
+
+         /* Raw sequences are numbered once, in the scheme of the first
+            datafile. The numbering is translated for the others
+         */
+         if(raw)
+         {
+            for(i=0; i<nmethods; i++)
+               MethodCtx[i].chothiaNumbered = ChothiaData[0].canonChothNum;
+         }
+
+         /* Translation from the numbering of the sequence data         */
+         if(TransFile[0] && ((trans = ReadNumTrans(TransFile)) == NULL))
+            return(1);
+         for(i=0; (trans != NULL) && (i<nmethods); i++)
+         {
+            if(!NumTransDirection(trans, 
+                                  (ChothiaData[i].canonChothNum ? 
+                                   "Chothia" : "Kabat"), &reverse))
             {
-               fprintf(stderr,"Error (chothia): Error in input data\n");
+               fprintf(stderr,"Error (chothia): %s does not translate \
+to the numbering of the datafile\n", TransFile);
+               return(1);
+            }
+            if((MethodCtx[i].trans = 
+                CompileKeyTrans(&(ChothiaData[i]), trans)) == NULL)
                return(1);
+         }
+
+         setvbuf(out, NULL, _IOFBF, OUTPUTBUFF);
+         if(ctx.format == FORMAT_TSV)
+         {
+            PrintCanonHeaderTSV(out, (dedup == DEDUP_UNIQUE),
+                                (MethodCtx[0].method != NULL));
+         }
+         else if((ctx.format == FORMAT_ARROW) &&
+                 ((arrow = OpenArrowWriter(out, &(ChothiaData[0])))
+                  ==NULL))
+         {
+            fprintf(stderr,"Error (chothia): Unable to write Arrow \
+output\n");
+            return(1);
+         }
+         
+         if(batch)
+         {
+            /* The Arrow file must still be completed if some records
+               were in error. Blocks of records are classified by the
+               threaded engine even with one thread
+            */
+            if((nthreads > 1) || block)
+               ok = ProcessBatchThreaded(in, out, MethodCtx, nmethods,
+                                         &Sequence, &maxRes, nthreads, 
+                                         raw, arrow, cacheSize, dedup,
+                                         block);
+            else
+               ok = ProcessBatch(in, out, MethodCtx, nmethods, 
+                                 &Sequence, &maxRes, raw, arrow, 
+                                 cacheSize, dedup);
+         }
+         else if((NRes = ReadFirstRecord(in, &Sequence, &maxRes, id, 
+                                         MethodCtx, raw)) > 0)
+         {
+            if(statsFormat != STATS_NONE)
+               split = StatsClock();
+            InitResIndex(&Index);
+            IndexSequence(Sequence, NRes, &Index);
+            ReportRecord(out, arrow, MethodCtx, nmethods,
+                         (ctx.format == FORMAT_TEXT) ? NULL : id, 
+                         Sequence, NRes, &Index);
+            if(statsFormat != STATS_NONE)
+            {
+               stats.records      = 1;
+               stats.classifyTime = StatsClock() - split;
             }
          }
          else
          {
-            fprintf(stderr,"Error (chothia): Unable to read Chothia \
-datafile\n");
+            fprintf(stderr,"Error (chothia): Error in input data\n");
+            return(1);
+         }
+         if(Sequence != NULL)
+            free(Sequence);
+
+         /* The batch workers merge their counts; otherwise they are all
+            counted in this thread
+         */
+         if(statsFormat != STATS_NONE)
+         {
+            if(stats.threads == 0)
+               stats.threads = 1;
+            stats.totalTime = StatsClock() - start;
+            PrintCanonStats(stderr, &stats, 
+                            (statsFormat == FORMAT_JSON));
+         }
+
+         if((arrow != NULL) && !CloseArrowWriter(arrow))
+         {
+            fprintf(stderr,"Error (chothia): Unable to write Arrow \
+output\n");
             return(1);
          }
+         if(!ok)
+            return(1);
       }
       else
       {
@@ -256,483 +633,1781 @@ datafile\n");
 
 
 /************************************************************************/
-/*>BOOL ReadChothiaData(char *filename)
-   ------------------------------------
-   Input:   char *filename      The Chothia data filename
-   Returns: BOOL                Success?
-   Globals: CHOTHIA *gChothia   Linked list of Chothia data
-            BOOL gCanonChothNum Chothia (rather than Kabat) numbering 
-                                used in file
-
-   Reads a Chothia canonical definition file. This file has the format:
-   LOOP loopid class length
-  [SOURCE ............................ ]
-   resid types
-   resid types
-   ...
-
-   16.05.95 Original based on ReadChothiaData() from KabatMan
-   30.11.95 Remove leading spaces from strings read from file
-   07.05.96 Handles the CHOTHIANUMBERING keyword
-   19.12.08 Uses MAXWORD and updated for new GetWord()
-            Fixed explicit 160 in fgets to MAXBUFF
-            Changed strcpy() to strncpy()
-   14.02.11 Added PRIORITY and SUBORDINATE keywords
-   14.12.16 Changed to blGetWord()
+/*>BOOL ProcessBatch(FILE *in, FILE *out, CANONCONTEXT *ctx, 
+                     int nmethods, SEQUENCE **Sequence, int *maxRes,
+                     BOOL raw, ARROWWRITER *arrow, int cacheSize, 
+                     int dedup)
+   ------------------------------------------------------------------
+   Input:   FILE         *in       Input data file pointer
+            FILE         *out      Output file pointer
+            CANONCONTEXT *ctx      Canonical definitions and options
+                                   for each method (array)
+            int          nmethods  Number of methods
+   I/O:     SEQUENCE     **Sequence Sequence array (work space,
+                                   grown as needed)
+            int          *maxRes   Allocated size of sequence array
+   Input:   BOOL         raw       Input is raw sequences to be numbered
+            ARROWWRITER  *arrow    Arrow writer for the output (NULL
+                                   for other formats)
+            int          cacheSize Loops to cache (0 for no cache)
+            int          dedup     DEDUP_NONE, _EXPAND or _UNIQUE
+   Returns: BOOL                   Were all records processed OK?
+
+   Reads each record from a batch file in turn and reports the 
+   canonicals for it. In text format, the output for each record is 
+   started with a >id line and terminated with a // line. Records 
+   without an ID are labelled with their record number.
+
+   Loops with the same residues at the key positions as one already
+   seen are classified from a cache.
+
+   When collapsing duplicates, each distinct sequence is only 
+   classified once and later records with the same sequence are given
+   its results. With DEDUP_UNIQUE, nothing is output until the end, when
+   each distinct sequence is reported once under the ID of its first
+   record with a count of the records having it.
+
+   Each record is read and indexed once and then classified against
+   each method in turn, each with its own cache. Duplicates may only be
+   collapsed with a single method. A cache already placed in a context
+   by the caller is used instead, and is kept.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Added raw. Raw sequences are read through a SEQREADER
+            Uses ReportCanonicalRecord() for the output format
+            Added arrow
+            Added cacheSize
+            Added dedup
+            Adds to the CANONSTATS of the context if there is one
+            Added nmethods
+            The sequence array is grown as needed
+            Uses a cache supplied in the context
+   16.10.26 Initialises the RESINDEX with InitResIndex()
 */
-BOOL ReadChothiaData(char *filename)
+BOOL ProcessBatch(FILE *in, FILE *out, CANONCONTEXT *ctx, int nmethods,
+                  SEQUENCE **Sequence, int *maxRes, BOOL raw, 
+                  ARROWWRITER *arrow, int cacheSize, int dedup)
 {
-   FILE    *fp;
-   char    buffer[MAXBUFF],
-           word[MAXWORD],
-           *chp,
-           *buffp;
-   CHOTHIA *p = NULL;
-   int     count = 0;
-   BOOL    NoEnv;
-/*           GotSubPri = FALSE; */
-   
-   /* Open the data file                                                */
-   if((fp=blOpenFile(filename,ENV_KABATDIR,"r",&NoEnv))==NULL)
+   CANONCONTEXT local[MAXDATAFILES];
+   CANONRESULTS results;
+   char      id[MAXBUFF],
+             nextID[MAXBUFF];
+   double    start    = 0.0,
+             readTime = 0.0;
+   int       NRes,
+             entry,
+             m,
+             nrecord = 0;
+   BOOL      ok      = TRUE,
+             found;
+   RESINDEX  *index;
+   SEQREADER *reader = NULL;
+   DUPTABLE  *dups   = NULL;
+
+   if((index = (RESINDEX *)malloc(sizeof(RESINDEX)))==NULL)
+   {
+      fprintf(stderr,"Error (chothia): No memory for sequence index\n");
+      return(FALSE);
+   }
+   InitResIndex(index);
+   if(raw && ((reader = OpenSequenceReader(in)) == NULL))
+   {
+      fprintf(stderr,"Error (chothia): No memory for sequence reader\n");
+      free(index);
+      return(FALSE);
+   }
+   if((dedup != DEDUP_NONE) && ((dups = NewDupTable()) == NULL))
    {
+      fprintf(stderr,"Error (chothia): No memory for duplicate \
+sequences\n");
+      CloseSequenceReader(reader);
+      free(index);
       return(FALSE);
    }
 
-   gCanonChothNum = FALSE;
+   /* The caches are used through our own copies of the contexts        */
+   for(m=0; m<nmethods; m++)
+   {
+      local[m] = ctx[m];
+      if((ctx[m].cache == NULL) && (cacheSize > 0) && 
+         ((local[m].cache = NewCanonCache(ctx[m].data, cacheSize)) 
+          == NULL))
+      {
+         fprintf(stderr,"Warning (chothia): No memory for \
+classification cache\n");
+      }
+   }
 
-   while(fgets(buffer,MAXBUFF,fp))
+   nextID[0] = '\0';
+   if(ctx->stats != NULL)
+   {
+      start    = StatsClock();
+      readTime = ctx->stats->readTime;
+   }
+   
+   while((NRes = ReadNextRecord(in, reader, Sequence, maxRes, id, nextID, 
+                                ctx)) >= 0)
    {
-      TERMINATE(buffer);
-      buffp = buffer;
-      while(isspace(*buffp))
-         buffp++;
+      nrecord++;
+      if(id[0] == '\0')
+         sprintf(id, "%d", nrecord);
       
-      if(strlen(buffp) && buffp[0] != '!' && buffp[0] != '#')
+      if(NRes == 0)
       {
-         /* Handle the SOURCE keyword                                   */
-         if(!blUpstrncmp(buffp,"SOURCE",6))
-         {
-            if(p!=NULL)
-            {
-               /* Strip out the SOURCE keyword                          */
-               chp = blGetWord(buffp,word,MAXWORD);
-               /* Store the text                                        */
-               strncpy(p->source, chp, MAXWORD);
-            }
-         }
-         else if(!blUpstrncmp(buffp,"PRIORITY",8))
-         {
-/*            GotSubPri = TRUE; */
-            /* Strip out the PRIORITY keyword                           */
-            chp = blGetWord(buffp,word,MAXWORD);
-            /* And grab the class name over which this takes priority   */
-            chp = blGetWord(chp,p->priority,SMALLWORD);
-            p->npriority = 1;
-         }
-         else if(!blUpstrncmp(buffp,"SUBORDINATE",11))
-         {
-/*            GotSubPri = TRUE; */
-            /* Strip out the SUBORDINATE keyword                        */
-            chp = blGetWord(buffp,word,MAXWORD);
-            /* And grab the class name to which this is subordinate     */
-            chp = blGetWord(chp,p->subordinate,SMALLWORD);
-            p->nsubordinate = 1;
-         }
-         else if(!blUpstrncmp(buffp,"CHOTHIANUM",10))
-         {
-            gCanonChothNum = TRUE;
-         }
-         else if(!blUpstrncmp(buffp,"LOOP",4))    /* Start of entry     */
-         {
-            /* Terminate the previous list of resnums                   */
-            if(p!=NULL)
-               strncpy(p->resnum[count],"-1",SMALLWORD);
-            
-            /* Allocate space in linked list                            */
-            if(gChothia == NULL)
-            {
-               INIT(gChothia,CHOTHIA);
-               p = gChothia;
-            }
-            else
-            {
-               ALLOCNEXT(p,CHOTHIA);
-            }
-            if(p==NULL) return(FALSE);
-            
-            /* 14.02.11 Initialize the PRIORITY and SUBORDINATE fields  */
-            p->priority_over = p->subordinate_to = NULL;
-            p->npriority     = p->nsubordinate   = 0;
-
-            /* Strip out the word LOOP                                  */
-            chp = blGetWord(buffp,word,MAXWORD);
-            /* Get the loop id                                          */
-            chp = blGetWord(chp,p->LoopID,SMALLWORD);
-            /* Get the class name                                       */
-            chp = blGetWord(chp,p->class,SMALLWORD);
-            /* Get the loop length                                      */
-            chp = blGetWord(chp,word,MAXWORD);
-            sscanf(word,"%d",&(p->length));
-            
-            /* Set the resnum counter to zero                           */
-            count = 0;
-         }
-         else
+         fprintf(stderr,"Error (chothia): Error in input data for \
+record %s\n", id);
+         ok = FALSE;
+         continue;
+      }
+      
+      if(dups == NULL)
+      {
+         IndexSequence(*Sequence, NRes, index);
+         if(!ReportRecord(out, arrow, local, nmethods, id, *Sequence, 
+                          NRes, index))
+            ok = FALSE;
+         continue;
+      }
+
+      if((entry = FindDuplicate(dups, *Sequence, NRes, id, &found)) < 0)
+      {
+         fprintf(stderr,"Error (chothia): No memory for duplicate \
+sequences\n");
+         ok = FALSE;
+      }
+      if(found && (ctx->stats != NULL))
+         ctx->stats->duplicates++;
+      
+      if(!found || !GetDuplicateResults(dups, entry, &results))
+      {
+         IndexSequence(*Sequence, NRes, index);
+         ClassifySequence(local, *Sequence, NRes, index, &results);
+         if((entry >= 0) && !SetDuplicateResults(dups, entry, &results))
          {
-            /* Not the start of an entry, so must be a resid/type pair  */
-            if(p!=NULL)
-            {
-               chp = blGetWord(buffp,p->resnum[count],SMALLWORD);
-               chp = blGetWord(chp,p->restype[count],MAXWORD);
-               if(++count > MAXCHOTHRES)
-               {
-                  fprintf(stderr,"Error: (chothia) Too many key \
-residues when reading Chothia file.\n");
-                  return(FALSE);
-               }
-            }
+            fprintf(stderr,"Error (chothia): No memory for results of \
+record %s\n", id);
+            ok = FALSE;
          }
       }
+
+      if((dedup == DEDUP_EXPAND) &&
+         !WriteRecord(out, arrow, local, id, &results))
+         ok = FALSE;
+   }
+
+   if((dedup == DEDUP_UNIQUE) && !WriteUniqueRecords(out, local, dups))
+      ok = FALSE;
+
+   /* Everything but reading counts as classifying                      */
+   if(ctx->stats != NULL)
+   {
+      ctx->stats->classifyTime += StatsClock() - start - 
+                                  (ctx->stats->readTime - readTime);
+      for(m=0; m<nmethods; m++)
+         AddCacheStats(ctx->stats, local[m].cache);
+   }
+
+   FreeDupTable(dups);
+   for(m=0; m<nmethods; m++)
+   {
+      if(ctx[m].cache == NULL)
+         FreeCanonCache(local[m].cache);
+   }
+   CloseSequenceReader(reader);
+   free(index);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL ProcessBatchThreaded(FILE *in, FILE *out, CANONCONTEXT *ctx,
+                             int nmethods, SEQUENCE **Sequence, 
+                             int *maxRes, int nthreads, BOOL raw, 
+                             ARROWWRITER *arrow, int cacheSize, 
+                             int dedup, BOOL block)
+   ---------------------------------------------------------------------
+   Input:   FILE         *in       Input data file pointer
+            FILE         *out      Output file pointer
+            CANONCONTEXT *ctx      Canonical definitions and options
+                                   for each method (array)
+            int          nmethods  Number of methods
+   I/O:     SEQUENCE     **Sequence Sequence array (work space,
+                                   grown as needed)
+            int          *maxRes   Allocated size of sequence array
+   Input:   int          nthreads  Number of worker threads
+            BOOL         raw       Input is raw sequences to be numbered
+            ARROWWRITER  *arrow    Arrow writer for the output (NULL
+                                   for other formats)
+            int          cacheSize Loops to cache in each thread (0 for
+                                   no cache)
+            int          dedup     DEDUP_NONE, _EXPAND or _UNIQUE
+            BOOL         block     Classify records in blocks of 
+                                   BLOCKSEQS
+   Returns: BOOL                   Were all records processed OK?
+
+   As ProcessBatch(), but the canonicals are assigned by a pool of
+   worker threads which share the (read-only) canonical definitions.
+   Each thread has its own classification cache.
+
+   This thread reads records into a ring of slots and writes out the
+   results in input order. The ring is a fixed size, so if the record 
+   at the head of the ring has not yet been processed, we wait for it 
+   before reading any more. Raw sequences are numbered as they are 
+   read.
+
+   When collapsing duplicates, each record is looked up in the table of
+   distinct sequences as it is read. A record with a sequence seen 
+   before is not given to the workers but is still queued so that it
+   is output in order (unless only distinct sequences are output). By 
+   then the record which first had the sequence has been written and 
+   its results stored in the table.
+
+   With block, each worker claims BLOCKSEQS records at a time (or
+   those left at the end) and classifies them with ClassifyBlock(). 
+   The ring holds two blocks for each worker.
+
+   If the context has a CANONSTATS, each worker counts into its own 
+   and adds it to that of the context when it exits.
+
+   A worker classifies each record against each method in turn and
+   has a cache for each.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Added raw. Raw sequences are read through a SEQREADER
+            Added arrow
+            Added cacheSize
+            Added dedup
+            Added block
+            Adds to the CANONSTATS of the context if there is one
+            Added nmethods
+            The sequence array is grown as needed
+*/
+BOOL ProcessBatchThreaded(FILE *in, FILE *out, CANONCONTEXT *ctx,
+                          int nmethods, SEQUENCE **Sequence, 
+                          int *maxRes, int nthreads, BOOL raw, 
+                          ARROWWRITER *arrow, int cacheSize, int dedup,
+                          BOOL block)
+{
+   BATCHPOOL pool;
+   BATCHSLOT *slot;
+   SEQREADER *reader = NULL;
+   pthread_t *threads;
+   char      id[MAXBUFF],
+             nextID[MAXBUFF];
+   int       NRes,
+             i,
+             entry    = (-1),
+             nstarted = 0,
+             nrecord  = 0,
+             nwritten = 0;
+   BOOL      ok       = TRUE,
+             fatal    = FALSE,
+             found    = FALSE;
+
+   pool.ctx         = ctx;
+   pool.nmethods    = nmethods;
+   pool.dups        = NULL;
+   pool.blockSize   = (block ? BLOCKSEQS : 1);
+   pool.nslots      = nthreads * (block ? (2 * BLOCKSEQS) : 
+                                  SLOTSPERTHREAD);
+   pool.nread       = 0;
+   pool.nclaimed    = 0;
+   pool.dedup       = dedup;
+   pool.finished    = FALSE;
+   pool.keepResults = ((arrow != NULL) || (dedup != DEDUP_NONE));
+   pool.cacheSize   = cacheSize;
+
+   if((pool.slots = (BATCHSLOT *)calloc(pool.nslots, 
+                                        sizeof(BATCHSLOT)))==NULL)
+   {
+      fprintf(stderr,"Error (chothia): No memory for batch records\n");
+      return(FALSE);
+   }
+   if((threads = (pthread_t *)malloc(nthreads * sizeof(pthread_t)))
+      ==NULL)
+   {
+      fprintf(stderr,"Error (chothia): No memory for batch threads\n");
+      free(pool.slots);
+      return(FALSE);
+   }
+   if(raw && ((reader = OpenSequenceReader(in)) == NULL))
+   {
+      fprintf(stderr,"Error (chothia): No memory for sequence reader\n");
+      free(pool.slots);
+      free(threads);
+      return(FALSE);
+   }
+   if((dedup != DEDUP_NONE) && ((pool.dups = NewDupTable()) == NULL))
+   {
+      fprintf(stderr,"Error (chothia): No memory for duplicate \
+sequences\n");
+      free(pool.slots);
+      free(threads);
+      CloseSequenceReader(reader);
+      return(FALSE);
    }
    
-   /* Terminate the previous list of resnums                            */
-   if(p!=NULL)
-      strncpy(p->resnum[count],"-1",SMALLWORD);
-
-   /* 14.02.11 If we have any PRIORITY/SUBORDINATEs then set the 
-      information for the pointers rather than simple text labels
-   */
-   for(p=gChothia; p!=NULL; NEXT(p))
+   pthread_mutex_init(&pool.lock, NULL);
+   pthread_cond_init(&pool.workReady, NULL);
+   pthread_cond_init(&pool.workDone, NULL);
+
+   for(i=0; i<nthreads; i++)
+   {
+      if(pthread_create(&threads[i], NULL, BatchWorker, &pool))
+         break;
+      nstarted++;
+   }
+
+   if(nstarted == 0)
+   {
+      fprintf(stderr,"Error (chothia): Unable to start batch threads\n");
+      fatal = TRUE;
+   }
+   else
    {
-      /* See if this takes priority over anything else                  */
-      if(p->npriority)
+      nextID[0] = '\0';
+      
+      while(!fatal && 
+            (NRes = ReadNextRecord(in, reader, Sequence, maxRes, id, 
+                                   nextID, ctx)) >= 0)
       {
-         int     nmatch = 0;
-         CHOTHIA *q = NULL;
-         for(q=gChothia; q!=NULL; NEXT(q))
+         nrecord++;
+         if(id[0] == '\0')
+            sprintf(id, "%d", nrecord);
+         
+         if(NRes == 0)
          {
-            if(!strcmp(p->priority, q->class))
-            {
-               p->priority_over = q;
-               nmatch++;
-            }
+            fprintf(stderr,"Error (chothia): Error in input data for \
+record %s\n", id);
+            ok = FALSE;
+            continue;
          }
-         if(nmatch > 1)
+
+         if((pool.dups != NULL) &&
+            ((entry = FindDuplicate(pool.dups, *Sequence, NRes, id, 
+                                    &found)) < 0))
          {
-            fprintf(stderr,"Chothia: Error 1, Loop %s takes priority \
-over %s, but %s matches %d classes\n", 
-                    p->class, p->priority, p->priority, nmatch);
-            return(FALSE);
+            fprintf(stderr,"Error (chothia): No memory for duplicate \
+sequences\n");
+            ok = FALSE;
          }
-         if(nmatch < 1)
+         if(found && (ctx->stats != NULL))
+            ctx->stats->duplicates++;
+
+         /* Only the count is needed                                    */
+         if(found && (dedup == DEDUP_UNIQUE))
+            continue;
+         
+         /* If the ring is full, wait for the oldest record and write it
+            out to free its slot
+         */
+         if(pool.nread - nwritten == pool.nslots)
          {
-            fprintf(stderr,"Chothia: Error 2, Loop %s takes priority \
-over %s, but %s not found as a valid canonical name\n", 
-                    p->class, p->priority, p->priority);
-            return(FALSE);
+            slot = &(pool.slots[nwritten % pool.nslots]);
+            pthread_mutex_lock(&pool.lock);
+            while(slot->status != SLOT_DONE)
+               pthread_cond_wait(&pool.workDone, &pool.lock);
+            pthread_mutex_unlock(&pool.lock);
+
+            if(!WriteBatchSlot(&pool, slot, out, arrow))
+               ok = FALSE;
+            nwritten++;
          }
-         if(p->length != p->priority_over->length)
+         
+         /* Nothing else touches an empty slot so it can be filled 
+            without the lock
+         */
+         slot = &(pool.slots[pool.nread % pool.nslots]);
+         if(!StoreBatchRecord(slot, *Sequence, NRes, id))
          {
-            fprintf(stderr,"Chothia: Error 5, Loop %s takes priority \
-over %s, but lengths do not match\n", 
-                    p->class, p->priority);
-            return(FALSE);
+            fatal = TRUE;
+            break;
          }
+         slot->dupEntry  = entry;
+         slot->duplicate = found;
          
-         
+         pthread_mutex_lock(&pool.lock);
+         slot->status = SLOT_READY;
+         pool.nread++;
+         pthread_cond_signal(&pool.workReady);
+         pthread_mutex_unlock(&pool.lock);
       }
+   }
+   
+   /* Tell the workers there is nothing more to come                    */
+   pthread_mutex_lock(&pool.lock);
+   pool.finished = TRUE;
+   pthread_cond_broadcast(&pool.workReady);
+   pthread_mutex_unlock(&pool.lock);
+   
+   /* Write out the remaining records in order                          */
+   while(nstarted && (nwritten < pool.nread))
+   {
+      slot = &(pool.slots[nwritten % pool.nslots]);
+      pthread_mutex_lock(&pool.lock);
+      while(slot->status != SLOT_DONE)
+         pthread_cond_wait(&pool.workDone, &pool.lock);
+      pthread_mutex_unlock(&pool.lock);
       
-      /* See if this is subordinate to anything else                    */
-      if(p->nsubordinate)
+      if(!WriteBatchSlot(&pool, slot, out, arrow))
+         ok = FALSE;
+      nwritten++;
+   }
+
+   for(i=0; i<nstarted; i++)
+      pthread_join(threads[i], NULL);
+
+   if((dedup == DEDUP_UNIQUE) && nstarted && !fatal &&
+      !WriteUniqueRecords(out, ctx, pool.dups))
+      ok = FALSE;
+
+   for(i=0; i<pool.nslots; i++)
+   {
+      if(pool.slots[i].sequence != NULL)
+         free(pool.slots[i].sequence);
+   }
+   free(pool.slots);
+   free(threads);
+   CloseSequenceReader(reader);
+   FreeDupTable(pool.dups);
+   
+   pthread_mutex_destroy(&pool.lock);
+   pthread_cond_destroy(&pool.workReady);
+   pthread_cond_destroy(&pool.workDone);
+
+   return(ok && !fatal);
+}
+
+
+/************************************************************************/
+/*>int ReadFirstRecord(FILE *in, SEQUENCE **Sequence, int *maxRes,
+                       char *id, CANONCONTEXT *ctx, BOOL raw)
+   ---------------------------------------------------------------
+   Input:   FILE         *in       Input data file pointer
+            CANONCONTEXT *ctx      Canonical definitions and options
+            BOOL         raw       Input is raw sequences to be numbered
+   I/O:     SEQUENCE     **Sequence Sequence array (grown as needed)
+            int          *maxRes   Allocated size of sequence array
+   Output:  char         *id       ID of the record (blank if none)
+   Returns: int                    Number of residues (0 if error)
+
+   Reads the sequence for a single run. Only the first record of the
+   file is used.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Raw sequences read through a SEQREADER
+            Returns the ID
+   16.10.26 The sequence array is grown as needed
+   16.10.26 Numbered sequences also stop at the end of the first record
+*/
+int ReadFirstRecord(FILE *in, SEQUENCE **Sequence, int *maxRes, 
+                    char *id, CANONCONTEXT *ctx, BOOL raw)
+{
+   SEQREADER *reader;
+   int       NRes;
+
+   id[0] = '\0';
+   if(!raw)
+      return(ReadInputData(in, Sequence, maxRes));
+
+   if((reader = OpenSequenceReader(in)) == NULL)
+   {
+      fprintf(stderr,"Error (chothia): No memory for sequence reader\n");
+      return(0);
+   }
+   NRes = ReadSequenceRecord(reader, Sequence, maxRes, id, ctx->chain,
+                             ctx->chothiaNumbered);
+   CloseSequenceReader(reader);
+   
+   return((NRes < 0) ? 0 : NRes);
+}
+
+
+/************************************************************************/
+/*>int ReadNextRecord(FILE *in, SEQREADER *reader, SEQUENCE **Sequence,
+                      int *maxRes, char *id, char *next, 
+                      CANONCONTEXT *ctx)
+   ---------------------------------------------------------------------
+   Input:   FILE         *in       Input data file pointer
+            SEQREADER    *reader   Reader for raw sequences (NULL if the
+                                   input is numbered)
+            CANONCONTEXT *ctx      Canonical definitions and options
+   I/O:     SEQUENCE     **Sequence Sequence array (grown as needed)
+            int          *maxRes   Allocated size of sequence array
+   Output:  char         *id       ID of the record
+   I/O:     char         *next     ID of the next record (numbered 
+                                   input only)
+   Returns: int                    Number of residues
+                                   0 if error
+                                   -1 if no more records
+
+   Reads the next record of a batch file with ReadInputRecord() or,
+   for raw sequences, ReadSequenceRecord().
+
+   If there is a CANONSTATS, the records are counted and timed. Only
+   the reading thread calls this, and the batch workers only add their
+   counts once all the records have been read, so this updates the
+   CANONSTATS of the shared context directly.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Raw sequences read through a SEQREADER
+   16.10.26 Counts the records if there is a CANONSTATS
+   16.10.26 The sequence array is grown as needed
+*/
+int ReadNextRecord(FILE *in, SEQREADER *reader, SEQUENCE **Sequence, 
+                   int *maxRes, char *id, char *next, CANONCONTEXT *ctx)
+{
+   double start = 0.0;
+   int    NRes;
+
+   if(ctx->stats != NULL)
+      start = StatsClock();
+
+   if(reader != NULL)
+      NRes = ReadSequenceRecord(reader, Sequence, maxRes, id, 
+                                ctx->chain, ctx->chothiaNumbered);
+   else
+      NRes = ReadInputRecord(in, Sequence, maxRes, id, next);
+
+   if(ctx->stats != NULL)
+   {
+      ctx->stats->readTime += StatsClock() - start;
+      if(NRes >= 0)
+         ctx->stats->records++;
+      if(NRes == 0)
+         ctx->stats->errors++;
+   }
+   
+   return(NRes);
+}
+
+
+/************************************************************************/
+/*>BOOL StoreBatchRecord(BATCHSLOT *slot, SEQUENCE *Sequence, int NRes, 
+                         char *id)
+   ---------------------------------------------------------------------
+   Input:   SEQUENCE  *Sequence   Sequence array
+            int       NRes        Length of sequence
+            char      *id         Record ID
+   Output:  BATCHSLOT *slot       Slot in the batch ring
+   Returns: BOOL                  Success?
+
+   Copies a record into a slot of the batch ring. The slot's sequence
+   array is only grown if this sequence is longer than any held there 
+   before.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL StoreBatchRecord(BATCHSLOT *slot, SEQUENCE *Sequence, int NRes, 
+                      char *id)
+{
+   if(NRes > slot->maxRes)
+   {
+      if(slot->sequence != NULL)
+         free(slot->sequence);
+      if((slot->sequence = (SEQUENCE *)malloc(NRes * sizeof(SEQUENCE)))
+         ==NULL)
       {
-         int     nmatch = 0;
-         CHOTHIA *q = NULL;
-         for(q=gChothia; q!=NULL; NEXT(q))
-         {
-            if(!strcmp(p->subordinate, q->class))
-            {
-               p->subordinate_to = q;
-               nmatch++;
-            }
-         }
-         if(nmatch > 1)
-         {
-            fprintf(stderr,"Chothia: Error 3, Loop %s is subordinate \
-to %s, but %s matches %d classes\n", 
-                    p->class, p->subordinate, p->subordinate, nmatch);
-            return(FALSE);
-         }
-         if(nmatch < 1)
-         {
-            fprintf(stderr,"Chothia: Error 4, Loop %s is subordinate \
-to %s, but %s not found as a valid canonical name\n", 
-                    p->class, p->subordinate, p->subordinate);
-            return(FALSE);
-         }
-         if(p->length != p->subordinate_to->length)
-         {
-            fprintf(stderr,"Chothia: Error 6, Loop %s is subordinate \
-to %s, but lengths do not match\n", 
-                    p->class, p->priority);
-            return(FALSE);
-         }
+         fprintf(stderr,"Error (chothia): No memory for batch \
+record\n");
+         slot->maxRes = 0;
+         return(FALSE);
       }
+      slot->maxRes = NRes;
    }
    
-   return(TRUE);
+   memcpy(slot->sequence, Sequence, NRes * sizeof(SEQUENCE));
+   slot->NRes = NRes;
+   strncpy(slot->id, id, MAXBUFF);
+   slot->output    = NULL;
+   slot->outputLen = 0;
+   slot->results   = NULL;
+   slot->dupEntry  = (-1);
+   slot->duplicate = FALSE;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL WriteBatchSlot(BATCHPOOL *pool, BATCHSLOT *slot, FILE *out,
+                       ARROWWRITER *arrow)
+   -------------------------------------------------------------------
+   Input:   BATCHPOOL   *pool     The batch engine
+   I/O:     BATCHSLOT   *slot     Processed slot of the batch ring
+   Input:   FILE        *out      Output file pointer
+            ARROWWRITER *arrow    Arrow writer (NULL if not Arrow 
+                                  output)
+   Returns: BOOL                  Success?
+
+   Writes out the output of a processed record and empties its slot.
+   When collapsing duplicates, the results of a record with a new 
+   sequence are stored in the table of distinct sequences, and a 
+   record with a sequence seen before is given the results stored.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Added pool. Handles duplicate sequences
+*/
+BOOL WriteBatchSlot(BATCHPOOL *pool, BATCHSLOT *slot, FILE *out, 
+                    ARROWWRITER *arrow)
+{
+   CANONRESULTS results;
+   BOOL         ok = TRUE;
+
+   if(slot->duplicate)
+   {
+      if(GetDuplicateResults(pool->dups, slot->dupEntry, &results))
+      {
+         ok = WriteRecord(out, arrow, pool->ctx, slot->id, &results);
+      }
+      else
+      {
+         fprintf(stderr,"Error (chothia): No results for duplicate \
+record %s\n", slot->id);
+         ok = FALSE;
+      }
+   }
+   else if(pool->keepResults)
+   {
+      /* The worker reported the error if there are no results          */
+      if(slot->results == NULL)
+      {
+         ok = FALSE;
+      }
+      else
+      {
+         if((slot->dupEntry >= 0) &&
+            !SetDuplicateResults(pool->dups, slot->dupEntry, 
+                                 slot->results))
+         {
+            fprintf(stderr,"Error (chothia): No memory for results of \
+record %s\n", slot->id);
+            ok = FALSE;
+         }
+         if((pool->dedup != DEDUP_UNIQUE) &&
+            !WriteRecord(out, arrow, pool->ctx, slot->id, slot->results))
+            ok = FALSE;
+         free(slot->results);
+         slot->results = NULL;
+      }
+   }
+   else
+   {
+      fwrite(slot->output, 1, slot->outputLen, out);
+      free(slot->output);
+      slot->output = NULL;
+   }
+   slot->status = SLOT_EMPTY;
+
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL ReportRecord(FILE *out, ARROWWRITER *arrow, CANONCONTEXT *ctx, 
+                     int nmethods, char *id, SEQUENCE *Sequence, 
+                     int NRes, RESINDEX *index)
+   ---------------------------------------------------------------------
+   Input:   FILE         *out      Output file pointer
+            ARROWWRITER  *arrow    Arrow writer (NULL if not Arrow 
+                                   output)
+            CANONCONTEXT *ctx      Canonical definitions and options
+                                   for each method (array)
+            int          nmethods  Number of methods
+            char         *id       Record ID (or NULL)
+            SEQUENCE     *Sequence Sequence array
+            int          NRes      Length of sequence
+            RESINDEX     *index    Index of sequence
+   Returns: BOOL                   Success?
+
+   Reports the canonicals for a record with ReportCanonicalRecord() or,
+   for Arrow output, adds them to the Arrow file. The record is 
+   classified and reported for each method in turn.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Uses WriteRecord()
+            Added nmethods
+*/
+BOOL ReportRecord(FILE *out, ARROWWRITER *arrow, CANONCONTEXT *ctx, 
+                  int nmethods, char *id, SEQUENCE *Sequence, int NRes, 
+                  RESINDEX *index)
+{
+   CANONRESULTS results;
+   int          m;
+   BOOL         ok = TRUE;
+
+   for(m=0; m<nmethods; m++)
+   {
+      ClassifySequence(&(ctx[m]), Sequence, NRes, index, &results);
+      if(!WriteRecord(out, arrow, &(ctx[m]), id, &results))
+         ok = FALSE;
+   }
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL WriteRecord(FILE *out, ARROWWRITER *arrow, CANONCONTEXT *ctx, 
+                    char *id, CANONRESULTS *results)
+   ------------------------------------------------------------------
+   Input:   FILE         *out      Output file pointer
+            ARROWWRITER  *arrow    Arrow writer (NULL if not Arrow 
+                                   output)
+            CANONCONTEXT *ctx      Canonical definitions and options
+            char         *id       Record ID (or NULL)
+            CANONRESULTS *results  Canonical classes assigned
+   Returns: BOOL                   Success?
+
+   Writes the canonicals assigned to a record with PrintCanonRecord()
+   or, for Arrow output, adds them to the Arrow file.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL WriteRecord(FILE *out, ARROWWRITER *arrow, CANONCONTEXT *ctx, 
+                 char *id, CANONRESULTS *results)
+{
+   if(arrow != NULL)
+      return(WriteArrowRecord(arrow, id, results));
+
+   PrintCanonRecord(out, ctx, id, 0, results);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL WriteUniqueRecords(FILE *out, CANONCONTEXT *ctx, DUPTABLE *dups)
+   ---------------------------------------------------------------------
+   Input:   FILE         *out      Output file pointer
+            CANONCONTEXT *ctx      Canonical definitions and options
+            DUPTABLE     *dups     Distinct sequences of a batch
+   Returns: BOOL                   Success?
+
+   Writes the canonicals of each distinct sequence in the order they
+   were first seen, labelled with the ID of the first record having
+   the sequence and the number of records having it.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL WriteUniqueRecords(FILE *out, CANONCONTEXT *ctx, DUPTABLE *dups)
+{
+   CANONRESULTS results;
+   char         *id;
+   int          entry,
+                count;
+   BOOL         ok = TRUE;
+
+   for(entry=0; entry<DupTableEntries(dups); entry++)
+   {
+      id = DupTableEntry(dups, entry, &count);
+
+      /* The error was reported when the results were not stored        */
+      if(GetDuplicateResults(dups, entry, &results))
+         PrintCanonRecord(out, ctx, id, count, &results);
+      else
+         ok = FALSE;
+   }
+
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>void *BatchWorker(void *arg)
+   ----------------------------
+   Input:   void  *arg      The BATCHPOOL shared by all threads
+   Returns: void  *         NULL
+
+   Worker thread for ProcessBatchThreaded(). Repeatedly claims the next
+   queued record, or block of records, classifies it with 
+   ClassifyBatchSlot() or ClassifyBatchBlock(), and marks the records 
+   as done. A worker claiming blocks waits until a full block has been
+   queued unless all the records have been read. Exits once all 
+   records have been queued and claimed.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Keeps the results for Arrow output
+            Has its own classification cache
+            Skips duplicate sequences
+            Claims blocks of records. Classification moved out to
+            ClassifyBatchSlot()
+            Counts into its own CANONSTATS if the pool's context has one
+            Has a context and cache for each method
+   16.10.26 Initialises the RESINDEX with InitResIndex()
+*/
+void *BatchWorker(void *arg)
+{
+   BATCHPOOL    *pool = (BATCHPOOL *)arg;
+   BATCHSLOT    *block[BLOCKSEQS];
+   RESINDEX     *index;
+   CANONRESULTS *results = NULL;
+   CANONCONTEXT ctx[MAXDATAFILES];
+   CANONSTATS   stats;
+   double       start    = 0.0;
+   int          nblock,
+                m,
+                i;
+
+   if(((index = (RESINDEX *)malloc(pool->blockSize * sizeof(RESINDEX)))
+       ==NULL) ||
+      ((pool->blockSize > 1) &&
+       ((results = (CANONRESULTS *)malloc(pool->nmethods * 
+                                          pool->blockSize * 
+                                          sizeof(CANONRESULTS)))==NULL)))
+   {
+      fprintf(stderr,"Error (chothia): No memory for sequence index\n");
+      if(index != NULL)
+         free(index);
+      index = NULL;
+   }
+   for(i=0; (index != NULL) && (i < pool->blockSize); i++)
+      InitResIndex(&(index[i]));
+
+   if(pool->ctx->stats != NULL)
+      InitCanonStats(&stats);
+   for(m=0; m<pool->nmethods; m++)
+   {
+      ctx[m]       = pool->ctx[m];
+      ctx[m].cache = NULL;
+      if((pool->cacheSize > 0) && 
+         ((ctx[m].cache = NewCanonCache(ctx[m].data, pool->cacheSize)) 
+          == NULL))
+      {
+         fprintf(stderr,"Warning (chothia): No memory for \
+classification cache\n");
+      }
+      if(ctx[m].stats != NULL)
+         ctx[m].stats = &stats;
+   }
+
+   pthread_mutex_lock(&pool->lock);
+   for(;;)
+   {
+      while((pool->nread - pool->nclaimed < pool->blockSize) && 
+            !pool->finished)
+         pthread_cond_wait(&pool->workReady, &pool->lock);
+
+      if(pool->nclaimed == pool->nread)
+         break;
+
+      for(nblock=0; 
+          (nblock < pool->blockSize) && (pool->nclaimed < pool->nread);
+          nblock++)
+      {
+         block[nblock] = &(pool->slots[pool->nclaimed % pool->nslots]);
+         pool->nclaimed++;
+      }
+      pthread_mutex_unlock(&pool->lock);
+
+      if(ctx[0].stats != NULL)
+         start = StatsClock();
+      if(pool->blockSize > 1)
+         ClassifyBatchBlock(pool, ctx, block, nblock, index, results);
+      else
+         ClassifyBatchSlot(pool, ctx, block[0], index);
+      if(ctx[0].stats != NULL)
+         stats.classifyTime += StatsClock() - start;
+
+      pthread_mutex_lock(&pool->lock);
+      for(i=0; i<nblock; i++)
+         block[i]->status = SLOT_DONE;
+      pthread_cond_broadcast(&pool->workDone);
+   }
+   if(ctx[0].stats != NULL)
+   {
+      for(m=0; m<pool->nmethods; m++)
+         AddCacheStats(&stats, ctx[m].cache);
+      MergeCanonStats(pool->ctx->stats, &stats);
+   }
+   pthread_mutex_unlock(&pool->lock);
+
+   if(index != NULL)
+      free(index);
+   if(results != NULL)
+      free(results);
+   for(m=0; m<pool->nmethods; m++)
+      FreeCanonCache(ctx[m].cache);
+
+   return(NULL);
+}
+
+
+/************************************************************************/
+/*>void ClassifyBatchSlot(BATCHPOOL *pool, CANONCONTEXT *ctx, 
+                          BATCHSLOT *slot, RESINDEX *index)
+   -----------------------------------------------------------
+   Input:   BATCHPOOL    *pool     The batch engine
+            CANONCONTEXT *ctx      The worker's canonical definitions
+                                   and options for each method (array)
+   I/O:     BATCHSLOT    *slot     Record claimed by the worker
+   Input:   RESINDEX     *index    Sequence index (work space; NULL if
+                                   none could be allocated)
+
+   Indexes the sequence of a record and assigns its canonicals writing
+   the output (or, for Arrow output or when collapsing duplicates, the
+   results) to memory. A record with a sequence seen before is left
+   alone. The output gives the canonicals for each method in turn;
+   results are only kept with a single method.
+
+   16.10.26 Split from BatchWorker()   By: ACRM
+   16.10.26 Classifies against each method
+*/
+void ClassifyBatchSlot(BATCHPOOL *pool, CANONCONTEXT *ctx, 
+                       BATCHSLOT *slot, RESINDEX *index)
+{
+   FILE *fp;
+   int  m;
+
+   if(slot->duplicate)
+   {
+      /* Given the results of its first record when written out         */
+      ;
+   }
+   else if((index != NULL) && pool->keepResults &&
+           ((slot->results = (CANONRESULTS *)
+             malloc(sizeof(CANONRESULTS))) != NULL))
+   {
+      IndexSequence(slot->sequence, slot->NRes, index);
+      ClassifySequence(ctx, slot->sequence, slot->NRes, index,
+                       slot->results);
+   }
+   else if((index != NULL) && !pool->keepResults &&
+           ((fp = open_memstream(&(slot->output), &(slot->outputLen)))
+            != NULL))
+   {
+      IndexSequence(slot->sequence, slot->NRes, index);
+      for(m=0; m<pool->nmethods; m++)
+         ReportCanonicalRecord(fp, &(ctx[m]), slot->id, slot->sequence,
+                               slot->NRes, index);
+      fclose(fp);
+   }
+   else
+   {
+      fprintf(stderr,"Error (chothia): No memory for output of \
+record %s\n", slot->id);
+   }
+}
+
+
+/************************************************************************/
+/*>void ClassifyBatchBlock(BATCHPOOL *pool, CANONCONTEXT *ctx, 
+                           BATCHSLOT **block, int nblock, 
+                           RESINDEX *index, CANONRESULTS *results)
+   ----------------------------------------------------------------
+   Input:   BATCHPOOL    *pool     The batch engine
+            CANONCONTEXT *ctx      The worker's canonical definitions
+                                   and options for each method (array)
+   I/O:     BATCHSLOT    **block   Records claimed by the worker
+   Input:   int          nblock    Number of records (up to BLOCKSEQS)
+            RESINDEX     *index    Sequence indexes (work space; NULL 
+                                   if none could be allocated)
+            CANONRESULTS *results  Results (work space for BLOCKSEQS
+                                   records for each method)
+
+   As ClassifyBatchSlot(), but the records other than those with a 
+   sequence seen before are classified together by ClassifyBlock(),
+   once for each method.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Classifies against each method
+*/
+void ClassifyBatchBlock(BATCHPOOL *pool, CANONCONTEXT *ctx, 
+                        BATCHSLOT **block, int nblock, RESINDEX *index,
+                        CANONRESULTS *results)
+{
+   SEQUENCE *sequences[BLOCKSEQS];
+   FILE     *fp;
+   int      NRes[BLOCKSEQS],
+            nseq = 0,
+            m,
+            i;
+
+   for(i=0; (index != NULL) && (i<nblock); i++)
+   {
+      if(!block[i]->duplicate)
+      {
+         IndexSequence(block[i]->sequence, block[i]->NRes, 
+                       &(index[nseq]));
+         sequences[nseq] = block[i]->sequence;
+         NRes[nseq++]    = block[i]->NRes;
+      }
+   }
+   for(m=0; (index != NULL) && (m<pool->nmethods); m++)
+      ClassifyBlock(&(ctx[m]), sequences, NRes, index, nseq, 
+                    &(results[m * BLOCKSEQS]));
+
+   for(i=0, nseq=0; i<nblock; i++)
+   {
+      if(block[i]->duplicate)
+         continue;
+
+      if((index != NULL) && pool->keepResults &&
+         ((block[i]->results = (CANONRESULTS *)
+           malloc(sizeof(CANONRESULTS))) != NULL))
+      {
+         *(block[i]->results) = results[nseq];
+      }
+      else if((index != NULL) && !pool->keepResults &&
+              ((fp = open_memstream(&(block[i]->output), 
+                                    &(block[i]->outputLen))) != NULL))
+      {
+         for(m=0; m<pool->nmethods; m++)
+            PrintCanonRecord(fp, &(ctx[m]), block[i]->id, 0, 
+                             &(results[(m * BLOCKSEQS) + nseq]));
+         fclose(fp);
+      }
+      else
+      {
+         fprintf(stderr,"Error (chothia): No memory for output of \
+record %s\n", block[i]->id);
+      }
+      nseq++;
+   }
+}
+
+
+/************************************************************************/
+/*>BOOL RunServer(char *socketPath, char ChothiaFiles[][MAXBUFF], 
+                  int nfiles)
+   -------------------------------------------------------------
+   Input:   char  *socketPath       Path of Unix domain socket
+            char  ChothiaFiles[][]  Chothia datafiles to serve
+            int   nfiles            Number of datafiles
+   Returns: BOOL                    FALSE if the server could not be
+                                    started (otherwise does not return)
+
+   Runs chothia as a server. The datafiles are loaded once and each 
+   connection to the socket is handled by its own thread. A connection
+   may make any number of requests. Each request and reply is a 4-byte
+   length (most significant byte first) followed by that many bytes of
+   text. The first line of a request is a command:
+
+   ASSIGN [-c datafile] [-v] [-n] [-L|-H] [-b] [-r] [-d|-u] [-f format]
+          [-k n] [-e engine]
+      followed by a sequence file (or a batch file with -b). The 
+      options are as on the command line. The first datafile is used 
+      if -c is not given.
+   RELOAD
+      rereads all the datafiles. Requests already running complete with
+      the old definitions.
+
+   The reply starts with a line containing OK or ERROR followed by an
+   explanation, and for ASSIGN, the output is then as on the command 
+   line. Batch records in error are omitted and noted on the OK line.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Added -r to ASSIGN
+            Added -f to ASSIGN
+            Added -d and -u to ASSIGN
+            Added -k to ASSIGN
+*/
+BOOL RunServer(char *socketPath, char ChothiaFiles[][MAXBUFF], 
+               int nfiles)
+{
+   SERVER             server;
+   CONNECTION         *conn;
+   struct sockaddr_un addr;
+   struct stat        info;
+   pthread_t          thread;
+   pthread_attr_t     attr;
+   int                sock,
+                      fd,
+                      i;
+
+   if(strlen(socketPath) >= sizeof(addr.sun_path))
+   {
+      fprintf(stderr,"Error (chothia): Socket path too long: %s\n",
+              socketPath);
+      return(FALSE);
+   }
+
+   server.nfiles  = nfiles;
+   server.nloaded = 0;
+   for(i=0; i<nfiles; i++)
+   {
+      strncpy(server.filename[i], ChothiaFiles[i], MAXBUFF);
+      if((server.served[i] = LoadServedData(&server, ChothiaFiles[i])) 
+         == NULL)
+      {
+         fprintf(stderr,"Error (chothia): Unable to read Chothia \
+datafile %s\n", ChothiaFiles[i]);
+         return(FALSE);
+      }
+   }
+   pthread_mutex_init(&server.lock, NULL);
+   pthread_mutex_init(&server.reloadLock, NULL);
+
+   /* Clients that disconnect early must not kill the server            */
+   signal(SIGPIPE, SIG_IGN);
+
+   /* Remove a socket left by a previous server, but nothing else       */
+   if(!stat(socketPath, &info) && S_ISSOCK(info.st_mode))
+      unlink(socketPath);
+   
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   strcpy(addr.sun_path, socketPath);
+   if(((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) ||
+      bind(sock, (struct sockaddr *)&addr, sizeof(addr)) ||
+      listen(sock, SERVERQUEUE))
+   {
+      fprintf(stderr,"Error (chothia): Unable to listen on socket %s \
+(%s)\n", socketPath, strerror(errno));
+      if(sock >= 0)
+         close(sock);
+      return(FALSE);
+   }
+
+   pthread_attr_init(&attr);
+   pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+   for(;;)
+   {
+      if((fd = accept(sock, NULL, NULL)) < 0)
+      {
+         if((errno == EINTR) || (errno == ECONNABORTED))
+            continue;
+         fprintf(stderr,"Error (chothia): Unable to accept connection \
+(%s)\n", strerror(errno));
+         break;
+      }
+
+      if((conn = (CONNECTION *)malloc(sizeof(CONNECTION))) == NULL)
+      {
+         fprintf(stderr,"Warning (chothia): No memory for connection\n");
+         close(fd);
+         continue;
+      }
+      conn->server = &server;
+      conn->fd     = fd;
+      
+      if(pthread_create(&thread, &attr, ServeConnection, conn))
+      {
+         fprintf(stderr,"Warning (chothia): Unable to create thread for \
+connection\n");
+         close(fd);
+         free(conn);
+      }
+   }
+
+   close(sock);
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>void *ServeConnection(void *arg)
+   --------------------------------
+   Input:   void  *arg      The CONNECTION (freed on exit)
+   Returns: void  *         NULL
+
+   Thread for a server connection. Handles requests until the client
+   disconnects or sends a bad request. The sequence array is grown as
+   needed and kept for all the requests of the connection, as is the
+   classification cache for batches.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 The sequence array is grown as needed
+            Keeps a classification cache for the connection
+   16.10.26 Initialises the RESINDEX with InitResIndex()
+*/
+void *ServeConnection(void *arg)
+{
+   CONNECTION    *conn = (CONNECTION *)arg;
+   SEQUENCE      *Sequence = NULL;
+   RESINDEX      *index;
+   CANONCACHE    *cache    = NULL;
+   char          *request,
+                 *reply;
+   size_t        length,
+                 replyLen;
+   unsigned long cacheSerial = 0;
+   int           maxRes = 0;
+   BOOL          ok = TRUE;
+
+   index = (RESINDEX *)malloc(sizeof(RESINDEX));
+
+   if(index == NULL)
+   {
+      fprintf(stderr,"Warning (chothia): No memory for connection\n");
+   }
+   else
+   {
+      InitResIndex(index);
+      while(ok && ReadFrame(conn->fd, &request, &length))
+      {
+         reply = HandleRequest(conn->server, request, &Sequence, 
+                               &maxRes, index, &cache, &cacheSerial,
+                               &replyLen);
+         free(request);
+
+         if(reply == NULL)
+         {
+            fprintf(stderr,"Warning (chothia): No memory for reply\n");
+            break;
+         }
+         ok = WriteFrame(conn->fd, reply, replyLen);
+         free(reply);
+      }
+   }
+
+   if(Sequence != NULL) free(Sequence);
+   if(index    != NULL) free(index);
+   FreeCanonCache(cache);
+   close(conn->fd);
+   free(conn);
+   
+   return(NULL);
+}
+
+
+/************************************************************************/
+/*>char *HandleRequest(SERVER *server, char *request, 
+                       SEQUENCE **Sequence, int *maxRes, 
+                       RESINDEX *index, CANONCACHE **cache,
+                       unsigned long *cacheSerial, size_t *replyLen)
+   ----------------------------------------------------------------------
+   Input:   SERVER     *server      The server
+            char       *request     Text of the request (modified)
+   I/O:     SEQUENCE   **Sequence   Work space for sequence (grown as
+                                    needed)
+            int        *maxRes      Allocated size of sequence array
+   Input:   RESINDEX   *index       Work space for sequence index
+   I/O:     CANONCACHE **cache      Classification cache for batches
+                                    (NULL until one is needed)
+            unsigned long *cacheSerial
+                                    Serial number of the definitions
+                                    the cache is for (0 for none)
+   Output:  size_t     *replyLen    Length of the reply
+   Returns: char       *            Reply (malloc'd) or NULL if no memory
+
+   Carries out a server request. See RunServer() for the commands.
+
+   Batches use the cache, so loops seen by earlier requests need not be
+   classified again. It is replaced when the definitions used are not 
+   those it was created for, i.e. after a reload or when another 
+   datafile is given.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Added raw sequence input
+            Added output formats
+            Added Arrow output
+            Added collapsing of duplicate sequences
+            The sequence array is grown as needed
+            Added -e
+            Batches use the cache of the connection rather than 
+            creating one for each request
+*/
+char *HandleRequest(SERVER *server, char *request, SEQUENCE **Sequence,
+                    int *maxRes, RESINDEX *index, CANONCACHE **cache,
+                    unsigned long *cacheSerial, size_t *replyLen)
+{
+   CANONCONTEXT ctx;
+   SERVEDDATA   *served;
+   ARROWWRITER  *arrow = NULL;
+   FILE         *in,
+                *out,
+                *fp;
+   char         *body,
+                *word,
+                *save,
+                *reply   = NULL,
+                *output  = NULL,
+                *datafile = NULL,
+                id[MAXBUFF];
+   size_t       outputLen;
+   int          NRes,
+                dedup    = DEDUP_NONE;
+   BOOL         batch    = FALSE,
+                raw      = FALSE,
+                ok       = TRUE,
+                complete = TRUE;
+
+   if((fp = open_memstream(&reply, replyLen)) == NULL)
+      return(NULL);
+
+   /* Split off the command line                                        */
+   if((body = strchr(request, '\n')) != NULL)
+      *(body++) = '\0';
+   else
+      body = request + strlen(request);
+   TERMINATECR(request);
+
+   if((word = strtok_r(request, " \t", &save)) == NULL)
+   {
+      fprintf(fp, "ERROR Empty request\n");
+   }
+   else if(!strcmp(word, "RELOAD"))
+   {
+      if(ReloadServer(server))
+         fprintf(fp, "OK\n");
+      else
+         fprintf(fp, "ERROR Unable to reload Chothia datafiles\n");
+   }
+   else if(!strcmp(word, "ASSIGN"))
+   {
+      ctx.verbose         = FALSE;
+      ctx.format          = FORMAT_TEXT;
+      ctx.chain           = ' ';
+      ctx.chothiaNumbered = FALSE;
+      ctx.cache           = NULL;
+      ctx.trans           = NULL;
+      ctx.topK            = 0;
+      ctx.stats           = NULL;
+      ctx.method          = NULL;
+      ctx.engine          = ENGINE_SCAN;
+
+      while(ok && ((word = strtok_r(NULL, " \t", &save)) != NULL))
+      {
+         if(!strcmp(word, "-v"))
+            ctx.verbose = TRUE;
+         else if(!strcmp(word, "-n"))
+            ctx.chothiaNumbered = TRUE;
+         else if(!strcmp(word, "-b"))
+            batch = TRUE;
+         else if(!strcmp(word, "-r"))
+            raw = TRUE;
+         else if(!strcmp(word, "-d"))
+         {
+            if(dedup == DEDUP_NONE)
+               dedup = DEDUP_EXPAND;
+            batch = TRUE;
+         }
+         else if(!strcmp(word, "-u"))
+         {
+            dedup = DEDUP_UNIQUE;
+            batch = TRUE;
+         }
+         else if(!strcmp(word, "-f") && 
+                 ((word = strtok_r(NULL, " \t", &save)) != NULL) &&
+                 ParseFormat(word, &(ctx.format)))
+            ;
+         else if(!strcmp(word, "-k") && 
+                 ((word = strtok_r(NULL, " \t", &save)) != NULL) &&
+                 sscanf(word, "%d", &(ctx.topK)) &&
+                 (ctx.topK >= 1) && (ctx.topK <= MAXRANK))
+            ;
+         else if(!strcmp(word, "-e") && 
+                 ((word = strtok_r(NULL, " \t", &save)) != NULL) &&
+                 ParseEngine(word, &(ctx.engine)))
+            ;
+         else if(!strcmp(word, "-L") && (ctx.chain == ' '))
+            ctx.chain = 'L';
+         else if(!strcmp(word, "-H") && (ctx.chain == ' '))
+            ctx.chain = 'H';
+         else if(!strcmp(word, "-c") && 
+                 ((datafile = strtok_r(NULL, " \t", &save)) != NULL))
+            ;
+         else
+            ok = FALSE;
+      }
+
+      /* Counts cannot be given in Arrow output                         */
+      if(ok && (dedup == DEDUP_UNIQUE) && (ctx.format == FORMAT_ARROW))
+      {
+         ok   = FALSE;
+         word = "-u";
+      }
+
+      /* Nor can rankings in Arrow or TSV                               */
+      if(ok && (ctx.topK > 0) && 
+         ((ctx.format == FORMAT_TSV) || (ctx.format == FORMAT_ARROW)))
+      {
+         ok   = FALSE;
+         word = "-k";
+      }
+
+      if(!ok)
+      {
+         fprintf(fp, "ERROR Bad option: %s\n", word);
+      }
+      else if((served = AcquireServedData(server, datafile)) == NULL)
+      {
+         fprintf(fp, "ERROR Chothia datafile not loaded: %s\n", 
+                 datafile);
+      }
+      else
+      {
+         ctx.data = &(served->data);
+         if(raw)
+            ctx.chothiaNumbered = ctx.data->canonChothNum;
+         
+         if((*body == '\0') ||
+            ((in = fmemopen(body, strlen(body), "r")) == NULL))
+         {
+            fprintf(fp, "ERROR Error in input data\n");
+         }
+         else
+         {
+            if((out = open_memstream(&output, &outputLen)) == NULL)
+            {
+               ok = FALSE;
+            }
+            else
+            {
+               if(ctx.format == FORMAT_TSV)
+                  PrintCanonHeaderTSV(out, (dedup == DEDUP_UNIQUE), 
+                                      FALSE);
+               
+               if((ctx.format == FORMAT_ARROW) &&
+                  ((arrow = OpenArrowWriter(out, ctx.data)) == NULL))
+               {
+                  ok = FALSE;
+               }
+               else if(batch)
+               {
+                  if(*cacheSerial != served->serial)
+                  {
+                     FreeCanonCache(*cache);
+                     *cacheSerial = 0;
+                     if((*cache = NewCanonCache(ctx.data, CACHESIZE))
+                        == NULL)
+                        fprintf(stderr,"Warning (chothia): No memory \
+for classification cache\n");
+                     else
+                        *cacheSerial = served->serial;
+                  }
+                  ctx.cache = *cache;
+
+                  /* Records in error are omitted from the output       */
+                  complete = ProcessBatch(in, out, &ctx, 1, Sequence, 
+                                          maxRes, raw, arrow, 0, dedup);
+               }
+               else if((NRes = ReadFirstRecord(in, Sequence, maxRes, id,
+                                               &ctx, raw)) > 0)
+               {
+                  IndexSequence(*Sequence, NRes, index);
+                  ok = ReportRecord(out, arrow, &ctx, 1,
+                                    (ctx.format == FORMAT_TEXT) ? 
+                                    NULL : id, 
+                                    *Sequence, NRes, index);
+               }
+               else
+               {
+                  ok = FALSE;
+               }
+               if((arrow != NULL) && !CloseArrowWriter(arrow))
+                  ok = FALSE;
+               fclose(out);
+            }
+            fclose(in);
+
+            if(ok)
+            {
+               fprintf(fp, complete ? "OK\n" : 
+                       "OK Some records were not processed\n");
+               fwrite(output, 1, outputLen, fp);
+            }
+            else
+            {
+               fprintf(fp, "ERROR Error in input data\n");
+            }
+            if(output != NULL)
+               free(output);
+         }
+
+         ReleaseServedData(server, served);
+      }
+   }
+   else
+   {
+      fprintf(fp, "ERROR Unknown command: %s\n", word);
+   }
+
+   if(fclose(fp))
+   {
+      free(reply);
+      return(NULL);
+   }
+   
+   return(reply);
+}
+
+
+/************************************************************************/
+/*>SERVEDDATA *LoadServedData(SERVER *server, char *filename)
+   ----------------------------------------------------------
+   Input:   SERVER     *server     The server
+            char       *filename   The Chothia data filename
+   Returns: SERVEDDATA *           The loaded definitions (NULL on error)
+
+   Loads a datafile for the server. The server holds the only reference.
+   The decision trees are built so that requests may use either engine.
+   Each set loaded is given a new serial number. Sets are only loaded
+   before the connections start or while holding the reload lock.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Builds the decision trees
+            Added server and the serial number
+*/
+SERVEDDATA *LoadServedData(SERVER *server, char *filename)
+{
+   SERVEDDATA *served;
+
+   if((served = (SERVEDDATA *)calloc(1, sizeof(SERVEDDATA))) == NULL)
+      return(NULL);
+
+   if(!LoadChothiaData(filename, &(served->data)) ||
+      !BuildChothiaTree(&(served->data)))
+   {
+      FreeChothiaData(&(served->data));
+      free(served);
+      return(NULL);
+   }
+   served->nref   = 1;
+   served->serial = ++(server->nloaded);
+
+   return(served);
+}
+
+
+/************************************************************************/
+/*>SERVEDDATA *AcquireServedData(SERVER *server, char *filename)
+   -------------------------------------------------------------
+   Input:   SERVER     *server     The server
+            char       *filename   The Chothia data filename (NULL for 
+                                   the first datafile)
+   Returns: SERVEDDATA *           Current definitions from that file 
+                                   (NULL if not being served)
+
+   Obtains a reference to the current definitions from a datafile. This 
+   must be released with ReleaseServedData().
+
+   16.10.26 Original    By: ACRM
+*/
+SERVEDDATA *AcquireServedData(SERVER *server, char *filename)
+{
+   SERVEDDATA *served = NULL;
+   int        i;
+
+   for(i=0; i<server->nfiles; i++)
+   {
+      if((filename == NULL) || !strcmp(filename, server->filename[i]))
+         break;
+   }
+
+   if(i < server->nfiles)
+   {
+      pthread_mutex_lock(&server->lock);
+      served = server->served[i];
+      served->nref++;
+      pthread_mutex_unlock(&server->lock);
+   }
+   
+   return(served);
+}
+
+
+/************************************************************************/
+/*>void ReleaseServedData(SERVER *server, SERVEDDATA *served)
+   ----------------------------------------------------------
+   Input:   SERVER     *server     The server
+            SERVEDDATA *served     Definitions to release
+
+   Releases a reference to a set of definitions, freeing it if it has
+   been replaced by a reload and this was the last reference.
+
+   16.10.26 Original    By: ACRM
+*/
+void ReleaseServedData(SERVER *server, SERVEDDATA *served)
+{
+   int nref;
+   
+   pthread_mutex_lock(&server->lock);
+   nref = --(served->nref);
+   pthread_mutex_unlock(&server->lock);
+
+   if(nref == 0)
+   {
+      FreeChothiaData(&(served->data));
+      free(served);
+   }
 }
 
 
 /************************************************************************/
-/*>int ReadInputData(FILE *in, SEQUENCE *Sequence)
-   -----------------------------------------------
-   Input:   FILE     *in          Input data file pointer
-   Output:  SEQUENCE *Sequence    Sequence array
-   Returns: int                   Length of sequence
+/*>BOOL ReloadServer(SERVER *server)
+   ---------------------------------
+   Input:   SERVER     *server     The server
+   Returns: BOOL                   Success?
 
-   16.05.95 Original    By: ACRM
-   19.12.08 Changed strcpy() to strncpy()
-            Changed word[16] to word[MAXWORD]
-            New GetWord()
-            Checks number of residues in file
-            Added check on residue names of '-'
-   14.12.16 Changed to blGetWord()
+   Rereads all the datafiles being served. If any cannot be read, the
+   current definitions are all kept. Otherwise the new definitions 
+   replace them for subsequent requests, while requests in progress 
+   complete with the definitions they started with.
+
+   16.10.26 Original    By: ACRM
 */
-int ReadInputData(FILE *in, SEQUENCE *Sequence)
+BOOL ReloadServer(SERVER *server)
 {
-   char buffer[MAXBUFF],
-        word[MAXWORD],
-        *chp;
-   int  count = 0;
-   
-   while(fgets(buffer, MAXBUFF, in))
+   SERVEDDATA *served[MAXDATAFILES];
+   int        i,
+              j;
+
+   pthread_mutex_lock(&server->reloadLock);
+
+   for(i=0; i<server->nfiles; i++)
    {
-      TERMINATE(buffer);  /* 13.02.14 Added this                        */
-      TERMINATECR(buffer);/* 14.12.16 Added this                        */
-      
-      if((buffer[0] == 'L' || buffer[0] == 'H') &&
-         isdigit(buffer[1]))
+      if((served[i] = LoadServedData(server, server->filename[i])) 
+         == NULL)
       {
-         chp = blGetWord(buffer, word, MAXWORD);
-         strncpy(Sequence[count].resnum, word, SMALLWORD);
-         
-         chp = blGetWord(chp, word, MAXWORD);
-         if(strlen(word) == 0)
-            return(0);
-         
-         if(word[0] != '-')
-         {
-            if(strlen(word) == 3)
-            {
-               Sequence[count].seq = blThrone(word);
-            }
-            else if(strlen(word) == 1)
-            {
-               Sequence[count].seq = word[0];
-            }
-            else
-            {
-               fprintf(stderr,"Warning (chothia): illegal residue name: \
-%s\n", word);
-               fprintf(stderr,"                   residue ignored.\n");
-            }
-            
-            
-            if(++count >= MAXSEQ)
-            {
-               fprintf(stderr,"Error (chothia): Too many residues in \
-sequence file\n");
-               return(0);
-            }
-         }
+         fprintf(stderr,"Warning (chothia): Unable to reload Chothia \
+datafile %s\n", server->filename[i]);
+         for(j=0; j<i; j++)
+            ReleaseServedData(server, served[j]);
+         pthread_mutex_unlock(&server->reloadLock);
+         return(FALSE);
       }
    }
 
-   if(count > MAXEXPSEQ)
+   /* Swap in the new definitions, leaving the old in served[]          */
+   pthread_mutex_lock(&server->lock);
+   for(i=0; i<server->nfiles; i++)
    {
-      fprintf(stderr,"Warning (chothia): %d residues in input file. \
-Expect <%d. Maybe two antibodies?\n", count, MAXEXPSEQ);
+      SERVEDDATA *old = server->served[i];
+      server->served[i] = served[i];
+      served[i] = old;
    }
-   
-   return(count);
+   pthread_mutex_unlock(&server->lock);
+
+   for(i=0; i<server->nfiles; i++)
+      ReleaseServedData(server, served[i]);
+
+   pthread_mutex_unlock(&server->reloadLock);
+   return(TRUE);
 }
 
-      
+
 /************************************************************************/
-/*>void ReportCanonicals(FILE *out, SEQUENCE *Sequence, int NRes, 
-                         BOOL verbose, char chain)
-   ---------------------------------------------------------------
-   Input:   FILE     *out          Output file pointer
-            SEQUENCE *Sequence     Sequence array
-            int      NRes          Length of sequence
-            BOOL     verbose       Flag to display reasons
-            char     chain         Chain to handle (both if eq '')
+/*>BOOL ReadFrame(int fd, char **buffer, size_t *length)
+   -----------------------------------------------------
+   Input:   int    fd        Connection
+   Output:  char   **buffer  Text read (malloc'd and terminated)
+            size_t *length   Length of text
+   Returns: BOOL             Success? (FALSE at end of connection, or
+                             if the request is too large)
 
-   Reports the canonical classes for all 6 loops. Calls ReportACanonical()
-   to do the work.
+   Reads a length-prefixed request from a server connection.
 
-   16.05.95 Original    By: ACRM
-   18.08.95 No longer fails if unable to find a residue; just reports the
-            fact. Now returns void.
-   08.05.96 Modified to determine length of CDR1 in each chain and pass
-            it to the ReportACanonical() routine
-   19.12.08 Changed strcpy() to strncpy()
-   09.08.15 Added chain handling
+   16.10.26 Original    By: ACRM
 */
-void ReportCanonicals(FILE *out, SEQUENCE *Sequence, int NRes, 
-                      BOOL verbose, char chain)
+BOOL ReadFrame(int fd, char **buffer, size_t *length)
 {
-   int         loop,
-               len,
-               cdr1len,
-               start,
-               stop,
-               firstLoop,
-               lastLoop;
-   char        cdr1[SMALLWORD];
-   static LOOP LoopDef[] = 
-   {  {  "L1", "L24", "L34"  },
-      {  "L2", "L50", "L56"  },
-      {  "L3", "L89", "L97"  },
-      {  "H1", "H26", "H35B" },
-      {  "H2", "H50", "H58"  },
-      {  "H3", "H95", "H102" }
-   }  ;
-   
-   /* Default to all CDRs                                               */
-   firstLoop = 0;
-   lastLoop  = NCDR;
-   
-   /* Update it we have specified to do only one chain                  */
-   if(chain == 'L')
+   unsigned char prefix[4];
+
+   if(!ReadBytes(fd, prefix, 4))
+      return(FALSE);
+   *length = ((size_t)prefix[0] << 24) | ((size_t)prefix[1] << 16) |
+             ((size_t)prefix[2] << 8)  |  (size_t)prefix[3];
+   if(*length > MAXREQUEST)
    {
-      firstLoop = 0;
-      lastLoop  = 3;
+      fprintf(stderr,"Warning (chothia): Request too large (%lu bytes)\n",
+              (unsigned long)*length);
+      return(FALSE);
    }
-   else if(chain == 'H')
+   
+   if((*buffer = (char *)malloc(*length + 1)) == NULL)
+      return(FALSE);
+   if(!ReadBytes(fd, *buffer, *length))
    {
-      firstLoop = 3;
-      lastLoop  = NCDR;
+      free(*buffer);
+      return(FALSE);
    }
+   (*buffer)[*length] = '\0';
+   
+   return(TRUE);
+}
 
-   for(loop=firstLoop; loop<lastLoop; loop++)
-   {
-      if((start = FindRes(Sequence, NRes, LoopDef[loop].start)) == (-1))
-      {
-         fprintf(stderr,"Warning (chothia): Unable to find residue %s \
-in input\n", LoopDef[loop].start);
-         fprintf(out,"CDR %s  Missing Residues\n",LoopDef[loop].name);
-         continue;
-      }
 
-      if((stop = FindRes(Sequence, NRes, LoopDef[loop].stop)) == (-1))
-      {
-         fprintf(stderr,"Warning (chothia): Unable to find residue %s \
-in input\n", LoopDef[loop].stop);
-         fprintf(out,"CDR %s  Missing Residues\n",LoopDef[loop].name);
-         continue;
-      }
-         
-      len   = 1 + stop - start;
+/************************************************************************/
+/*>BOOL WriteFrame(int fd, char *buffer, size_t length)
+   ----------------------------------------------------
+   Input:   int    fd        Connection
+            char   *buffer   Text to write
+            size_t length    Length of text
+   Returns: BOOL             Success?
 
-      if(loop==0 || loop==3) 
-      {
-         strncpy(cdr1, LoopDef[loop].name, SMALLWORD);
-         cdr1len = len;
-      }
-      
-      ReportACanonical(out, LoopDef[loop].name, len, Sequence, NRes,
-                       verbose, cdr1, cdr1len);
-   }
+   Writes a length-prefixed reply to a server connection.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL WriteFrame(int fd, char *buffer, size_t length)
+{
+   unsigned char prefix[4];
+
+   prefix[0] = (unsigned char)((length >> 24) & 0xFF);
+   prefix[1] = (unsigned char)((length >> 16) & 0xFF);
+   prefix[2] = (unsigned char)((length >> 8)  & 0xFF);
+   prefix[3] = (unsigned char)(length & 0xFF);
+
+   return(WriteBytes(fd, prefix, 4) && WriteBytes(fd, buffer, length));
 }
 
 
 /************************************************************************/
-/*>int FindRes(SEQUENCE *Sequence, int NRes, char *InRes)
-   ------------------------------------------------------
-   Input:   SEQUENCE   *Sequence      The sequence array
-            int        NRes           Length of sequence array
-            char       *InRes         The res number to find
-   Returns: int                       Offset into Sequence array
-                                      -1 if not found
-
-   Finds a residue label in the sequence array. If no exact match is found
-   it runs through again checking without any insert codes. This assumes
-   that residues which we search for can be substituted by an earlier 
-   residue in the sequence.
+/*>BOOL ReadBytes(int fd, void *buffer, size_t length)
+   ---------------------------------------------------
+   Input:   int    fd        File descriptor
+            size_t length    Number of bytes to read
+   Output:  void   *buffer   Bytes read
+   Returns: BOOL             Were all the bytes read?
 
-   16.05.95 Original    By: ACRM
-   17.05.95 Added no-insert checking
-   18.08.95 Fixed failure when 35B specified and had 35A in sequence
-            (Used to find 35 instead of 35A).
-   30.05.96 Checks for InRes being --- and returns -1
-   19.12.08 Changed strcpy() to strncpy()
-            Changed res[16] and buff[16] to use MAXWORD
+   Reads exactly the specified number of bytes, retrying after short 
+   reads and interrupts.
+
+   16.10.26 Original    By: ACRM
 */
-int FindRes(SEQUENCE *Sequence, int NRes, char *InRes)
+BOOL ReadBytes(int fd, void *buffer, size_t length)
 {
-   int  i,
-        InsPos = (-1);
-   char res[MAXWORD];
-
-   if(!strncmp(InRes,"---",3))
-      return(-1);
-
-   strncpy(res,InRes,MAXWORD);
-   
-   /* Check full residue names                                          */
-   for(i=0; i<NRes; i++)
-   {
-      if(!strcmp(Sequence[i].resnum, res))
-         return(i);
-   }
+   char    *buffp = (char *)buffer;
+   ssize_t n;
 
-   /* Exact match failed, see if there is an insert code. Counts from 1
-      not zero as 0 is the chain name
-   */
-   for(i=1; i<strlen(res); i++)
+   while(length)
    {
-      if(isalpha(res[i]))
+      if((n = read(fd, buffp, length)) <= 0)
       {
-         InsPos = i;
-         break;
+         if((n < 0) && (errno == EINTR))
+            continue;
+         return(FALSE);
       }
+      buffp  += n;
+      length -= n;
    }
+   
+   return(TRUE);
+}
 
-   /* If there wasn't an insert code, then we've definitely failed      */
-   if(InsPos < 0)
-      return(-1);
 
-   /* Step the insert code down                                         */
-   res[InsPos]--;
-   
-   while(res[InsPos] >= 'A')
-   {
-      for(i=0; i<NRes; i++)
-      {
-         if(!strcmp(Sequence[i].resnum, res))
-            return(i);
-      }
-   
-      /* Step the insert code down                                      */
-      res[InsPos]--;
-   }
+/************************************************************************/
+/*>BOOL WriteBytes(int fd, void *buffer, size_t length)
+   ----------------------------------------------------
+   Input:   int    fd        File descriptor
+            void   *buffer   Bytes to write
+            size_t length    Number of bytes to write
+   Returns: BOOL             Were all the bytes written?
 
-   /* Finally try without the insert code                               */
-   res[InsPos] = '\0';
-   for(i=0; i<NRes; i++)
-   {
-      char buff[MAXWORD];
+   Writes exactly the specified number of bytes, retrying after short
+   writes and interrupts.
 
-      strncpy(buff, Sequence[i].resnum, MAXWORD);
-      TERMALPHA(buff+1);
+   16.10.26 Original    By: ACRM
+*/
+BOOL WriteBytes(int fd, void *buffer, size_t length)
+{
+   char    *buffp = (char *)buffer;
+   ssize_t n;
 
-      if(!strcmp(buff, res))
-         return(i);
+   while(length)
+   {
+      if((n = write(fd, buffp, length)) < 0)
+      {
+         if(errno == EINTR)
+            continue;
+         return(FALSE);
+      }
+      buffp  += n;
+      length -= n;
    }
    
-   /* Tried everything!                                                 */
-   return(-1);
+   return(TRUE);
 }
 
 
@@ -753,22 +2428,102 @@ int FindRes(SEQUENCE *Sequence, int NRes, char *InRes)
    09.08.15 V2.1 Added -L and -H
    14.12.16 V2.2 
    12.10.21 V2.3
+   16.10.26 V2.4 Added -b
+   16.10.26 V2.5 Added -j
+   16.10.26 V2.6
+   16.10.26 V2.7
+   16.10.26 V2.8
+   16.10.26 V2.9 Added -C
+   16.10.26 V2.10 Added -S. -c may be repeated
+   16.10.26 V2.11
+   16.10.26 V2.12 Added -r
+   16.10.26 V2.13 -r input may be gzipped
+   16.10.26 V2.14 Added -f
+   16.10.26 V2.15 Added -f arrow
+   16.10.26 V2.16 Added -m
+   16.10.26 V2.17 Added -d and -u
+   16.10.26 V2.18 Added -t
+   16.10.26 V2.19
+   16.10.26 V2.20 Describes CDR-H3 classes
+   16.10.26 V2.21 Added -k
+   16.10.26 V2.22
+   16.10.26 V2.23 Added -g
+   16.10.26 V2.24 Added -s
+   16.10.26 V2.25 Added -M. Repeated -c classifies against each
+   16.10.26 V2.26
+   16.10.26 V2.27 Added -e
+   16.10.26 States that -g is not a speed option
+   16.10.26 States what is used from the compiled datafile
+   16.10.26 Mentions the framework and IMGT translations for -t
 */
 void Usage(void)
 {
-   fprintf(stderr,"\nChothia V2.3 (c) 1995-2021, Prof. Andrew C.R. \
+   fprintf(stderr,"\nChothia V2.27 (c) 1995-2026, Prof. Andrew C.R. \
 Martin, UCL\n\n");
 
-   fprintf(stderr,"Usage: chothia [-c filename] [-L|-H] [-v] [-n] \
-[input.seq [output.dat]]\n");
+   fprintf(stderr,"Usage: chothia [-c filename ...|-M methodfile] [-L|-H] \
+[-v] [-n] [-r] [-b]\n");
+   fprintf(stderr,"               [-j nthreads]");
+   fprintf(stderr," [-m nloops] [-g] [-d|-u] \
+[-f text|json|tsv|arrow]\n");
+   fprintf(stderr,"               [-t transfile] [-k nclasses] \
+[-e scan|tree] [-s text|json]\n");
+   fprintf(stderr,"               [input.seq [output.dat]]\n");
+   fprintf(stderr,"       chothia [-c filename ...|-M methodfile] -C\n");
+   fprintf(stderr,"       chothia [-c filename ...] -S socket\n");
    fprintf(stderr,"               -c Specify Chothia datafile (Default: \
 chothia.dat)\n");
+   fprintf(stderr,"                  If repeated, records are \
+classified against each in turn\n");
+   fprintf(stderr,"               -M Classify against each method \
+listed in the specified file\n");
    fprintf(stderr,"               -L Input only contains light chain\n");
    fprintf(stderr,"               -H Input only contains heavy chain\n");
    fprintf(stderr,"               -v Verbose; give explanations when \
 no canonical found\n");
    fprintf(stderr,"               -n The sequence file has Chothia \
 (rather than Kabat) numbering\n");
+   fprintf(stderr,"               -t The sequence file is numbered in \
+another scheme which is\n");
+   fprintf(stderr,"                  translated using the specified \
+file\n");
+   fprintf(stderr,"               -r The sequence file contains raw \
+sequences (FASTA or PIR)\n");
+   fprintf(stderr,"               -b Batch mode; the sequence file \
+contains many records\n");
+   fprintf(stderr,"               -j Use the specified number of threads \
+in batch mode\n");
+   fprintf(stderr,"                  (implies -b)\n");
+   fprintf(stderr,"               -m Size of the classification cache \
+in batch mode\n");
+   fprintf(stderr,"                  (loops per thread; Default: %d, \
+0 for none)\n", CACHESIZE);
+   fprintf(stderr,"               -g Classify batch records in blocks \
+of %d (implies -b)\n", BLOCKSEQS);
+   fprintf(stderr,"               -d Classify each distinct sequence \
+only once (implies -b)\n");
+   fprintf(stderr,"               -u Output each distinct sequence once \
+with a count of records\n");
+   fprintf(stderr,"                  (implies -b and -d)\n");
+   fprintf(stderr,"               -f Output format (Default: \
+text)\n");
+   fprintf(stderr,"               -k Also give the specified number of \
+highest scoring\n");
+   fprintf(stderr,"                  classes for each CDR (max %d; text \
+or JSON output)\n", MAXRANK);
+   fprintf(stderr,"               -e Matching engine: count the \
+mismatches against each class\n");
+   fprintf(stderr,"                  (scan) or follow a decision tree \
+over the key residues\n");
+   fprintf(stderr,"                  (tree). The results are the same \
+(Default: scan)\n");
+   fprintf(stderr,"               -s Report statistics on stderr at \
+the end in the specified\n");
+   fprintf(stderr,"                  format\n");
+   fprintf(stderr,"               -C Write the compiled Chothia datafile \
+(filename%s)\n", COMP_EXT);
+   fprintf(stderr,"               -S Run as a server on the specified \
+Unix domain socket\n");
    fprintf(stderr,"       I/O is through stdin/stdout if files are not \
 specified.\n\n");
 
@@ -780,33 +2535,276 @@ numbers and the\n");
 each position. Such\n");
    fprintf(stderr,"a file may be generated from a PIR file using the \
 program KabatSeq.\n");
+   fprintf(stderr,"Alternatively, with -r, the input is a FASTA or PIR \
+file which is\n");
+   fprintf(stderr,"numbered by the program using the numbering scheme \
+of the datafile.\n");
+   fprintf(stderr,"This may be gzipped and is read in constant memory \
+whatever its size.\n");
+   fprintf(stderr,"Without -b, only the first entry is used. In batch \
+mode each entry\n");
+   fprintf(stderr,"is a record and may contain a light chain, a heavy \
+chain or both.\n");
    fprintf(stderr,"The numbering in this file is normally Kabat \
 numbering; if the -n switch is\n");
    fprintf(stderr,"specified on the command line, the file must have \
 Chothia numbering.\n\n");
 
+   fprintf(stderr,"CDR-H3 is only classified if the datafile defines \
+H3 classes. These\n");
+   fprintf(stderr,"normally give the kinked or extended base of the \
+loop and a range of\n");
+   fprintf(stderr,"loop lengths (e.g. LOOP H3 K/M 9-14). The supplied \
+datafiles do not\n");
+   fprintf(stderr,"define them, so that they may still be read by \
+KabatMan; use\n");
+   fprintf(stderr,"chothia.dat.auto_h3, which adds a simplified set \
+of H3 classes to\n");
+   fprintf(stderr,"chothia.dat.auto.\n\n");
+
+   fprintf(stderr,"With -k, every class of the same loop and length is \
+scored as the\n");
+   fprintf(stderr,"fraction of its key residues which match, weighted \
+by any weight given\n");
+   fprintf(stderr,"after the allowed residue types in the datafile \
+(Default: 1).\n\n");
+
+   fprintf(stderr,"In batch mode (-b), each record in the input file is \
+started by a line\n");
+   fprintf(stderr,"of the form >id and/or terminated by a line containing \
+//. The output\n");
+   fprintf(stderr,"for each record is similarly started with >id and \
+terminated by //\n");
+   fprintf(stderr,"With -j, records are shared between threads, but the \
+output remains in\n");
+   fprintf(stderr,"input order. With -g, each thread takes a block of \
+records and the\n");
+   fprintf(stderr,"records in which a CDR has the same length are \
+tested against each\n");
+   fprintf(stderr,"class of that length together. The classes assigned \
+are the same and\n");
+   fprintf(stderr,"loops seen before are still taken from the cache, \
+but this is slower\n");
+   fprintf(stderr,"than classifying each record alone, so -g is not a \
+speed option.\n\n");
+
+   fprintf(stderr,"With -f json, each record is output as a single line \
+JSON object giving\n");
+   fprintf(stderr,"the class, loop length, nearest class and mismatches \
+for each CDR.\n");
+   fprintf(stderr,"With -f tsv, each record is a single line of tab \
+separated values with\n");
+   fprintf(stderr,"the same information, after a line of column \
+headings.\n");
+   fprintf(stderr,"With -f arrow, the output is an Apache Arrow IPC \
+file with the class\n");
+   fprintf(stderr,"(dictionary encoded), loop length, nearest class and \
+number of\n");
+   fprintf(stderr,"mismatches for each CDR, written in batches of \
+records.\n\n");
+
+   fprintf(stderr,"With -s, the work done is counted and reported at \
+the end: the time\n");
+   fprintf(stderr,"taken to load the datafile, read the records and \
+classify them (summed\n");
+   fprintf(stderr,"over the threads), the key residues looked up and \
+how many were found\n");
+   fprintf(stderr,"by falling back to an earlier insert code, the use \
+of the cache and,\n");
+   fprintf(stderr,"for each CDR, the classes tested per loop, the loops \
+tested together\n");
+   fprintf(stderr,"with the match kernel, those matched before the last \
+candidate and the\n");
+   fprintf(stderr,"priority chains walked. -s is not available with \
+-S.\n\n");
+
+   fprintf(stderr,"With -M, records are classified against each \
+set of definitions (method)\n");
+   fprintf(stderr,"listed in a file such as canonical_method.txt. \
+Each line of this gives\n");
+   fprintf(stderr,"the method name, the name under which its results \
+are given and its\n");
+   fprintf(stderr,"position in the output, separated by | (e.g. \
+abm|AbM|2). The datafile\n");
+   fprintf(stderr,"for a method is chothia.dat.name in the directory \
+of the method file,\n");
+   fprintf(stderr,"which is found as for a datafile. Similarly, if -c \
+is repeated, records\n");
+   fprintf(stderr,"are classified against each datafile, named by its \
+filename. Each\n");
+   fprintf(stderr,"record is read and indexed once. Its output for each \
+method is given\n");
+   fprintf(stderr,"in turn, with a Method line after the >id line in \
+text output, or a\n");
+   fprintf(stderr,"method field in JSON or TSV. Raw sequences are \
+numbered in the scheme\n");
+   fprintf(stderr,"of the first datafile. -d, -u and -f arrow are not \
+available with more\n");
+   fprintf(stderr,"than one method. The counts given by -s are summed \
+over the methods.\n");
+   fprintf(stderr,"With -C, all the datafiles are compiled.\n\n");
+
+   fprintf(stderr,"With -d, a record with exactly the same numbered \
+sequence as an earlier\n");
+   fprintf(stderr,"record is given its results rather than being \
+classified again. With\n");
+   fprintf(stderr,"-u, each distinct sequence is output once, in the \
+order first seen,\n");
+   fprintf(stderr,"under the ID of its first record and with the number \
+of records having\n");
+   fprintf(stderr,"it (a Count line in text output or a count field \
+in JSON or TSV).\n");
+   fprintf(stderr,"-u is not available with -f arrow. Memory use grows \
+with the number of\n");
+   fprintf(stderr,"distinct sequences.\n\n");
+
+   fprintf(stderr,"Key residues are translated between Kabat and Chothia \
+numbering as\n");
+   fprintf(stderr,"needed using the length of the CDR in whose region \
+they lie. With -t,\n");
+   fprintf(stderr,"the numbering of the sequence file is instead \
+translated using a file\n");
+   fprintf(stderr,"giving the labels in the two schemes for each CDR \
+length and for the\n");
+   fprintf(stderr,"framework of each chain (see numbering.kabat_chothia \
+for the format;\n");
+   fprintf(stderr,"numbering.imgt_chothia translates IMGT numbering). \
+The file is found as\n");
+   fprintf(stderr,"for the datafile and -t is not available with \
+-r.\n\n");
+
    fprintf(stderr,"The program will look for the datafile first in the \
 current directory\n");
    fprintf(stderr,"and then in the directory specified by the %s \
 environment variable.\n", ENV_KABATDIR);
    fprintf(stderr,"This data file is also used by the KabatMan database \
 software.\n\n");
+
+   fprintf(stderr,"With -C, the datafile is compiled to a binary file \
+with the extension\n");
+   fprintf(stderr,"%s in the same directory. When this exists and was \
+compiled from\n", COMP_EXT);
+   fprintf(stderr,"the current version of the datafile, it is mapped \
+into memory in\n");
+   fprintf(stderr,"preference to the datafile. The compiled definitions, \
+the matching\n");
+   fprintf(stderr,"masks and the Kabat/Chothia translation of the key \
+residues are then\n");
+   fprintf(stderr,"used from the file rather than built at startup.\n\n");
+
+   fprintf(stderr,"With -S, the datafiles are loaded once and requests \
+are accepted on the\n");
+   fprintf(stderr,"socket. Each request and reply is a 4-byte length \
+(most significant byte\n");
+   fprintf(stderr,"first) followed by that number of bytes of text. A \
+request starts with\n");
+   fprintf(stderr,"a command line, which is one of:\n");
+   fprintf(stderr,"   ASSIGN [-c filename] [-L|-H] [-v] [-n] [-r] \
+[-b] [-d|-u] [-f format]\n");
+   fprintf(stderr,"          [-k nclasses] [-e scan|tree]\n");
+   fprintf(stderr,"      followed by the sequence file. The options are \
+as above, and\n");
+   fprintf(stderr,"      the first datafile is used if -c is not \
+given.\n");
+   fprintf(stderr,"   RELOAD\n");
+   fprintf(stderr,"      rereads the datafiles. Requests in progress are \
+not affected.\n");
+   fprintf(stderr,"The reply starts with a line containing OK or ERROR \
+and a message,\n");
+   fprintf(stderr,"followed by the output for ASSIGN.\n\n");
+}
+
+
+/************************************************************************/
+/*>BOOL ParseFormat(char *name, int *format)
+   -----------------------------------------
+   Input:   char   *name      Name of output format
+   Output:  int    *format    FORMAT_TEXT, _JSON, _TSV or _ARROW
+   Returns: BOOL              Is it a valid format?
+
+   Converts the argument of -f to an output format
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Added arrow
+*/
+BOOL ParseFormat(char *name, int *format)
+{
+   if(!blUpstrncmp(name, "TEXT", 4) && (strlen(name) == 4))
+      *format = FORMAT_TEXT;
+   else if(!blUpstrncmp(name, "JSON", 4) && (strlen(name) == 4))
+      *format = FORMAT_JSON;
+   else if(!blUpstrncmp(name, "TSV", 3) && (strlen(name) == 3))
+      *format = FORMAT_TSV;
+   else if(!blUpstrncmp(name, "ARROW", 5) && (strlen(name) == 5))
+      *format = FORMAT_ARROW;
+   else
+      return(FALSE);
+   
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL ParseEngine(char *name, int *engine)
+   -----------------------------------------
+   Input:   char   *name      Name of matching engine
+   Output:  int    *engine    ENGINE_SCAN or ENGINE_TREE
+   Returns: BOOL              Is it a valid engine?
+
+   Converts the argument of -e to a matching engine
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL ParseEngine(char *name, int *engine)
+{
+   if(!blUpstrncmp(name, "SCAN", 4) && (strlen(name) == 4))
+      *engine = ENGINE_SCAN;
+   else if(!blUpstrncmp(name, "TREE", 4) && (strlen(name) == 4))
+      *engine = ENGINE_TREE;
+   else
+      return(FALSE);
+   
+   return(TRUE);
 }
 
 
 /************************************************************************/
 /*>BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile, 
-                  char *ChothiaFile, BOOL *verbose, char *chain)
+                  char ChothiaFiles[][MAXBUFF], int *nfiles, 
+                  char *methodFile, CANONCONTEXT *ctx, BOOL *batch,
+                  int *nthreads, int *cacheSize, int *dedup,
+                  char *transFile, BOOL *compile, BOOL *raw,
+                  char *socketPath, BOOL *block, int *statsFormat)
    ---------------------------------------------------------------------
-   Input:   int  argc             Argument count
-            char **argv           Argument array
-   Output:  char *infile          Input file (or blank string)
-            char *outfile         Output file (or blank string)
-            char *ChothiaFile     Chothia data file
-            BOOL *verbose         Flag to show details of mismatches
-            char *chain           Chain to  handle (default both)
-   Returns: BOOL                  Success?
-   Globals: BOOL gChothiaNumbered The sequence data is Chothia numbered
+   Input:   int          argc        Argument count
+            char         **argv      Argument array
+   Output:  char         *infile     Input file (or blank string)
+            char         *outfile    Output file (or blank string)
+            char         ChothiaFiles[][] Chothia data files
+            int          *nfiles     Number of Chothia data files (0 if
+                                     none specified)
+            char         *methodFile File listing the methods (or blank
+                                     string)
+            CANONCONTEXT *ctx        Options: whether to show details of
+                                     mismatches, chain to handle 
+                                     (default both), whether the 
+                                     sequence data is Chothia numbered,
+                                     the output format and the matching
+                                     engine
+            BOOL         *batch      Input contains multiple records
+            int          *nthreads   Number of batch threads
+            int          *cacheSize  Loops cached by each batch thread
+            int          *dedup      DEDUP_NONE, _EXPAND or _UNIQUE
+            char         *transFile  Numbering translation file (or
+                                     blank string)
+            BOOL         *compile    Just write the compiled data file
+            BOOL         *raw        Input is raw sequences
+            char         *socketPath Socket for server mode (or blank
+                                     string)
+            BOOL         *block      Classify batch records in blocks
+            int          *statsFormat Format of statistics (FORMAT_TEXT
+                                     or _JSON; STATS_NONE if none)
+   Returns: BOOL                     Success?
 
    Parse the command line
    
@@ -814,18 +2812,53 @@ software.\n\n");
    08.05.96 Added -n
    19.12.08 Changed strcpy() to strncpy()
    09.08.15 Added -l and -h for chain specification
+   16.10.26 Added -b
+            Options returned in a CANONCONTEXT. Added -j
+            Added -C
+            Added -S. -c may be repeated
+            Added -r
+            Added -f
+            Added -m
+            Added -d and -u
+            Added -t
+            Added -k
+            Added -g
+            Added -s
+            Added -M
+            Added -e
 */
 BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile, 
-                  char *ChothiaFile, BOOL *verbose, char *chain)
+                  char ChothiaFiles[][MAXBUFF], int *nfiles, 
+                  char *methodFile, CANONCONTEXT *ctx, BOOL *batch,
+                  int *nthreads, int *cacheSize, int *dedup,
+                  char *transFile, BOOL *compile, BOOL *raw,
+                  char *socketPath, BOOL *block, int *statsFormat)
 {
    argc--;
    argv++;
 
-   infile[0] = outfile[0] = '\0';
-   *verbose = FALSE;
-   *chain   = ' ';
-
-   gChothiaNumbered = FALSE;
+   infile[0] = outfile[0] = socketPath[0] = transFile[0] = '\0';
+   methodFile[0]        = '\0';
+   *nfiles              = 0;
+   ctx->data            = NULL;
+   ctx->verbose         = FALSE;
+   ctx->format          = FORMAT_TEXT;
+   ctx->chain           = ' ';
+   ctx->chothiaNumbered = FALSE;
+   ctx->cache           = NULL;
+   ctx->trans           = NULL;
+   ctx->topK            = 0;
+   ctx->stats           = NULL;
+   ctx->method          = NULL;
+   ctx->engine          = ENGINE_SCAN;
+   *batch               = FALSE;
+   *nthreads            = 1;
+   *cacheSize           = CACHESIZE;
+   *dedup               = DEDUP_NONE;
+   *compile             = FALSE;
+   *raw                 = FALSE;
+   *block               = FALSE;
+   *statsFormat         = STATS_NONE;
    
    while(argc)
    {
@@ -836,23 +2869,110 @@ BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile,
          case 'c':
             argc--;
             argv++;
-            strncpy(ChothiaFile, argv[0], MAXBUFF);
+            if(!argc || (*nfiles >= MAXDATAFILES))
+               return(FALSE);
+            strncpy(ChothiaFiles[(*nfiles)++], argv[0], MAXBUFF);
+            break;
+         case 'M':
+            argc--;
+            argv++;
+            if(!argc)
+               return(FALSE);
+            strncpy(methodFile, argv[0], MAXBUFF);
+            break;
+         case 't':
+            argc--;
+            argv++;
+            if(!argc)
+               return(FALSE);
+            strncpy(transFile, argv[0], MAXBUFF);
+            break;
+         case 'S':
+            argc--;
+            argv++;
+            if(!argc)
+               return(FALSE);
+            strncpy(socketPath, argv[0], MAXBUFF);
             break;
          case 'v':
-            *verbose = TRUE;
+            ctx->verbose = TRUE;
             break;
          case 'n':
-            gChothiaNumbered = TRUE;
+            ctx->chothiaNumbered = TRUE;
+            break;
+         case 'b':
+            *batch = TRUE;
+            break;
+         case 'r':
+            *raw = TRUE;
+            break;
+         case 'd':
+            if(*dedup == DEDUP_NONE)
+               *dedup = DEDUP_EXPAND;
+            *batch = TRUE;
+            break;
+         case 'u':
+            *dedup = DEDUP_UNIQUE;
+            *batch = TRUE;
+            break;
+         case 'f':
+            argc--;
+            argv++;
+            if(!argc || !ParseFormat(argv[0], &(ctx->format)))
+               return(FALSE);
+            break;
+         case 's':
+            argc--;
+            argv++;
+            if(!argc || !ParseFormat(argv[0], statsFormat) ||
+               ((*statsFormat != FORMAT_TEXT) && 
+                (*statsFormat != FORMAT_JSON)))
+               return(FALSE);
+            break;
+         case 'C':
+            *compile = TRUE;
+            break;
+         case 'j':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%d", nthreads) || 
+               (*nthreads < 1) || (*nthreads > MAXTHREADS))
+               return(FALSE);
+            *batch = TRUE;
+            break;
+         case 'g':
+            *block = TRUE;
+            *batch = TRUE;
+            break;
+         case 'm':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%d", cacheSize) || 
+               (*cacheSize < 0))
+               return(FALSE);
+            break;
+         case 'e':
+            argc--;
+            argv++;
+            if(!argc || !ParseEngine(argv[0], &(ctx->engine)))
+               return(FALSE);
+            break;
+         case 'k':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%d", &(ctx->topK)) || 
+               (ctx->topK < 1) || (ctx->topK > MAXRANK))
+               return(FALSE);
             break;
          case 'L':
-            if(*chain != ' ')
+            if(ctx->chain != ' ')
                return(FALSE);
-            *chain = 'L';
+            ctx->chain = 'L';
             break;
          case 'H':
-            if(*chain != ' ')
+            if(ctx->chain != ' ')
                return(FALSE);
-            *chain = 'H';
+            ctx->chain = 'H';
             break;
          default:
             return(FALSE);
@@ -882,235 +3002,3 @@ BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile,
    
    return(TRUE);
 }
-
-/************************************************************************/
-/*>int TestThisCanonical(CHOTHIA *p, char *LoopName, int LoopLen,
-                         SEQUENCE *Sequence, char *cdr1, int cdr1len)
-   ------------------------------------------------------------------
-   16.02.11 Extracted from ReportACanonical()
-*/
-int TestThisCanonical(CHOTHIA *p, char *LoopName, int LoopLen,
-                      SEQUENCE *Sequence, int NRes, 
-                      char *cdr1, int cdr1len)
-{
-   int  NMismatch = 10000, /* Return this if loop length/name wrong     */
-        res,
-        i;
-   
-   /* If the Loop name and length match                                 */
-   if(!strcmp(p->LoopID, LoopName) && (p->length == LoopLen))
-   {
-      NMismatch = 0;  /* Assume we are OK                               */
-         
-      /* Check each residue specified by this canonical definition      */
-      for(i=0; strcmp(p->resnum[i], "-1"); i++)
-      {
-         if(gCanonChothNum == gChothiaNumbered)
-         {
-            /* Both the datafile and the sequence data use the same
-               numbering scheme (Kabat or Chothia)
-            */
-            res = FindRes(Sequence, NRes, p->resnum[i]);
-         }
-         else if(gCanonChothNum)
-         {
-            /* Datafile uses Chothia numbering while the sequence data
-               uses Kabat numbering
-            */
-            res = FindRes(Sequence, NRes, 
-                          ChoKab(cdr1, cdr1len, p->resnum[i]));
-         }
-         else
-         {
-            /* Datafile uses Kabat numbering while the sequence data
-               uses Chothia numbering
-            */
-            res = FindRes(Sequence, NRes, 
-                          KabCho(cdr1, cdr1len, p->resnum[i]));
-         }
-
-         /* This is a disallowed residue type, so increment the mismatch 
-            counter
-            30.05.96 Added check on -1
-         */
-         if((res==(-1)) || (!strchr(p->restype[i], Sequence[res].seq)))
-         {
-            NMismatch++;
-         }
-      }
-   }
-
-   return(NMismatch);
-}
-
-/************************************************************************/
-/*>void ReportACanonical(FILE *out, char *LoopName, int LoopLen, 
-                         SEQUENCE *Sequence, int NRes, BOOL verbose,
-                         char *cdr1, int cdr1len)
-   -----------------------------------------------------------------
-   Input:   FILE     *out          Output file pointer
-            char     *LoopName     Name of a loop (e.g. L1)
-            int      LoopLen       Length of the loop
-            SEQUENCE *Sequence     Sequence array
-            int      NRes          Length of sequence
-            BOOL     verbose       Flag to display reasons
-            char     *cdr1         Name of CDR1 (L1 or H1)
-            char     *cdr1len      Length of CDR1
-   Returns: BOOL                   Success?
-
-   Reports the canonical class for an individual loop
-
-   16.05.95 Original    By: ACRM
-   17.05.95 Only prints source data if verbose
-   08.05.96 Converts between Chothia and Kabat numbering if required
-   09.05.96 Fixed bug in reporting mismatches with numbering conversion
-   30.05.96 Mismatches report numbering scheme in data file
-            Added check for -1 return from FindRes(); reports deleted
-            residues
-   16.02.11 Moved actual canonical finding code out into 
-            TestThisCanonical()
-   17.02.11 Re-written to deal with priority chains
-*/
-void ReportACanonical(FILE *out, char *LoopName, int LoopLen, 
-                      SEQUENCE *Sequence, int NRes, BOOL verbose,
-                      char *cdr1, int cdr1len)
-{
-   CHOTHIA *p,
-           *theMatch,
-           *best = NULL;
-   int     i,
-           res,
-           NMismatch,
-           MinMismatch = 10000;
-   
-   /* Run through the linked list of Canonical definitions              */
-   for(p=gChothia; p!=NULL; NEXT(p))
-   {
-      /* If this is subordinate to something else                       */
-      if(p->nsubordinate)
-      {
-         /* If it hasn't also got things it has priority over (i.e. it's
-            not in the middle of a priority chain
-         */
-         if(p->npriority == 0)
-         {
-            CHOTHIA *q = p;
-         
-            /* Walk to the highest priority class                       */
-            while(q->subordinate_to != NULL)
-            {
-               NEXT(q);
-            }
-            /* q now points to the highest priority class, walk back to 
-               the lowest priority class, testing for a perfect match
-            */
-            do {
-               NMismatch = TestThisCanonical(q, LoopName, LoopLen, 
-                                             Sequence, NRes, 
-                                             cdr1, cdr1len);
-               if(NMismatch == 0)
-               {
-                  break;
-               }
-               q=q->priority_over;
-            }  while(q != NULL);
-            
-            /* If we found a match then use that, otherwise, use p      
-               In other words we only accept mismatches against the 
-               lowest priority class.
-             */
-            theMatch = (q==NULL)?p:q;
-         }
-      }
-      else
-      {
-         theMatch = p;
-         NMismatch = TestThisCanonical(p, LoopName, LoopLen, Sequence, 
-                                       NRes, cdr1, cdr1len);
-      }
-
-      if(NMismatch == 0)  /* We've found the canonical                  */
-      {
-         break;
-      }
-      else
-      {
-         if(NMismatch < MinMismatch)
-         {
-            MinMismatch = NMismatch;
-            best = theMatch;
-         }
-      }
-   }
-
-   if(NMismatch == 0)
-   {
-      fprintf(out,"CDR %s  Class %-3s", LoopName, theMatch->class);
-      if(verbose && strlen(theMatch->source))
-         fprintf(out," %s", theMatch->source);
-      fprintf(out,"\n");
-   }
-   else
-   {
-      fprintf(out,"CDR %s  Class ?  \n", LoopName); 
-   
-      if(verbose)
-      {
-         if(best==NULL)
-         {
-            fprintf(out, "! No canonical of the same loop length\n");
-         }
-         else
-         {
-            fprintf(out, "! Similar to class %s, but:\n", best->class);
-
-            /* Display each mismatch for this canonical definition      */
-            for(i=0; strcmp(best->resnum[i], "-1"); i++)
-            {
-               if(gCanonChothNum == gChothiaNumbered)
-               {
-                  /* Both the datafile and the sequence data use the same
-                     numbering scheme (Kabat or Chothia)
-                  */
-                  res = FindRes(Sequence, NRes, best->resnum[i]);
-               }
-               else if(gCanonChothNum)
-               {
-                  /* Datafile uses Chothia numbering while the sequence 
-                     data uses Kabat numbering
-                  */
-                  res = FindRes(Sequence, NRes, 
-                                ChoKab(cdr1, cdr1len, best->resnum[i]));
-               }
-               else
-               {
-                  /* Datafile uses Kabat numbering while the sequence data
-                     uses Chothia numbering
-                  */
-                  res = FindRes(Sequence, NRes, 
-                                KabCho(cdr1, cdr1len, best->resnum[i]));
-               }
-
-               /* 30.05.96 Added check on -1                            */
-               if(res==(-1))
-               {
-                  fprintf(out, "!    %s (%s Numbering) is deleted.\n", 
-                          best->resnum[i],
-                          (gCanonChothNum?"Chothia":"Kabat"));
-               }
-               else if(!strchr(best->restype[i], Sequence[res].seq))
-               {
-                  fprintf(out, "!    %s (%s Numbering) = %c \
-(allows: %s)\n", 
-                          best->resnum[i],
-                          (gCanonChothNum?"Chothia":"Kabat"),
-                          Sequence[res].seq,
-                          best->restype[i]);
-               }
-            }
-         }
-      }
-   }   
-}
-
-
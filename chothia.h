@@ -0,0 +1,565 @@
+/*************************************************************************
+
+   Program:    Chothia
+   File:       chothia.h
+
+   Version:    V2.30
+   Date:       16.10.26
+   Function:   Library interface for assigning canonical classes
+
+   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2026
+   Author:     Prof. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Types and functions of libchothia. A program using the library
+   loads a set of canonical definitions with LoadChothiaData(), reads
+   a sequence with ReadInputData() (or fills in a SEQUENCE array
+   itself, or numbers raw sequences read through a SEQREADER with 
+   ReadSequenceRecord()), indexes it with IndexSequence() (into a
+   RESINDEX emptied once with InitResIndex()) and calls
+   ClassifySequence() to obtain a CANONRESULTS structure. The readers
+   grow the SEQUENCE array as needed, so one array may be reused for
+   all the records of a file. The definitions are freed with 
+   FreeChothiaData(). The results of many records may be written as an
+   Arrow IPC file with an ARROWWRITER.
+   When many sequences are classified, a CANONCACHE created with
+   NewCanonCache() may be placed in the CANONCONTEXT so that loops with
+   the same residues at all key positions are only classified once.
+   Records with exactly the same sequence as one already seen may be
+   given its results from a DUPTABLE rather than being classified.
+   Setting the engine of the CANONCONTEXT to ENGINE_TREE finds the
+   class matched by following a decision tree over the key positions,
+   built with BuildChothiaTree(), rather than by counting the 
+   mismatches against each class; the results are the same.
+
+   Once loaded, the definitions are not modified, so one set may be
+   used by any number of threads, each with its own SEQUENCE, RESINDEX,
+   CANONCACHE and CANONRESULTS. The strings in a CANONRESULTS point into the
+   definitions and remain valid until these are freed.
+
+   The library uses Bioplib, so programs must also be linked with that.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.11 16.10.26 Original - split from chothia.c
+   V2.12 16.10.26 Added ReadSequenceRecord() and NumberSequence()
+   V2.13 16.10.26 Added SEQREADER. ReadSequenceRecord() reads from this
+                  rather than a FILE
+   V2.14 16.10.26 Added output formats (CANONCONTEXT format) with
+                  JSON Lines and TSV output
+   V2.15 16.10.26 Added ARROWWRITER for Arrow IPC file output
+   V2.16 16.10.26 Added CANONCACHE to memoize loop classifications
+   V2.17 16.10.26 Added DUPTABLE to collapse duplicate sequences.
+                  Added PrintCanonRecord(). The JSON and TSV output
+                  may include a count of records
+   V2.18 16.10.26 Added NUMTRANS to translate between numbering
+                  schemes. CHOTHIADATA has the built-in Kabat/Chothia
+                  translation and CANONCONTEXT the translation given
+                  for the sequence data
+   V2.19 16.10.26 Added KEYTRANS. The translations of the key residues
+                  are worked out when the translation is loaded
+   V2.20 16.10.26 NCDR now includes CDR-H3. A CANONCLASS may cover a
+                  range of loop lengths. Added CHOTHIADATA nCDR
+   V2.21 16.10.26 Key residues have weights. Added CANONCONTEXT topK
+                  and the ranked classes of a CANONRESULT
+   V2.22 16.10.26 Added the MATCHKERNEL of a CHOTHIADATA
+   V2.23 16.10.26 Added ClassifyBlock() to classify a block of sequences
+                  together
+   V2.24 16.10.26 Added CANONSTATS and CANONCONTEXT stats
+   V2.25 16.10.26 Added CANONMETHOD and ReadCanonMethods(). Added 
+                  CANONCONTEXT and CANONRESULTS method. 
+                  PrintCanonHeaderTSV() takes a method flag
+   V2.26 16.10.26 Added CHOTHIADATA blocks. Removed MAXSEQ and 
+                  MAXCHOTHRES; the mismatches reported are limited by
+                  MAXMISMATCH. Added GrowSequence(). ReadInputData(), 
+                  ReadInputRecord() and ReadSequenceRecord() grow the
+                  sequence array
+   V2.27 16.10.26 Added CLASSTREE, CHOTHIADATA tree, BuildChothiaTree(),
+                  CANONCONTEXT engine and CANONSTATS treeLoops and 
+                  treeSteps
+   V2.28 16.10.26 RESINDEX holds only exact matches and the first 
+                  residue of each number, and lists the entries set so
+                  that only these are reset. Added InitResIndex()
+   V2.29 16.10.26 Added StoreCanonCacheKey()
+   V2.30 16.10.26 The MATCHKERNEL and the Kabat/Chothia KEYTRANS are
+                  stored in a compiled data file, so CHOTHIADATA 
+                  kabcho was removed. Added CHOTHIADATA srcMtime,
+                  srcMtimeNsec and srcSize, CompiledDataPath(),
+                  NumTransDigits(), MatchKernelArrays() and 
+                  MapMatchKernel(). WriteCompiledData() writes a
+                  loaded CHOTHIADATA
+
+*************************************************************************/
+#ifndef _CHOTHIA_H
+#define _CHOTHIA_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "bioplib/SysDefs.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define ENV_KABATDIR "KABATDIR"  /* Environment variable for Kabat      */
+                                 /* directory                           */
+#define MAXBUFF      240         /* General buffer size                 */
+#define MAXMISMATCH  80          /* Max mismatches reported for a CDR   */
+#define NCDR         6           /* Number of CDRs (H3 only processed if
+                                    the data file defines H3 classes)   */
+#define MAXLOOPLEN   64          /* Longest loop matched by a class with
+                                    an open range of lengths            */
+#define MAXRANK      10          /* Max classes ranked for each CDR     */
+#define MAXMATCHKEYS 256         /* Max key positions and classes in a  */
+#define MAXMATCHLANES 64         /*    bucket tested by CountMismatches()*/
+#define MATCH_MISSING (1U << 31) /* Residue type bit of a key residue
+                                    not found in the sequence           */
+#define MATCHPLANES  9           /* Bit planes of the mismatch counts of
+                                    a block (up to MAXMATCHKEYS)        */
+#define BLOCKSEQS    (8 * (int)sizeof(unsigned long))
+                                 /* Sequences classified together by
+                                    ClassifyBlock(), one bit each of an
+                                    unsigned long                       */
+#define TREELEAF(lane) (-2 - (lane))
+                                 /* Leaf of a CLASSTREE for the class
+                                    (lane) matched, or -1 for none      */
+#define TREELANE(node) (-2 - (node))
+                                 /* Class at a leaf (-1 if none)        */
+#define MAXWORD      40          /* Max length of an extracted word     */
+#define SMALLWORD    16          /* Length of small extracted word      */
+
+#define MAXRESNUM    128         /* Max residue number held in RESINDEX */
+#define NINSERT      26          /* Number of insert codes (A-Z)        */
+#define NRESID       (2*(MAXRESNUM+1)*(NINSERT+1))
+                                 /* Number of encoded residue IDs       */
+
+#define NLOOPDEF     6           /* Number of CDR definitions           */
+#define COMP_EXT     ".bin"      /* Extension for compiled data file    */
+#define NKERNELARRAY 6           /* Arrays of a MATCHKERNEL             */
+
+#define CANON_MISSING 0          /* Status of a CANONRESULT: loop ends  */
+#define CANON_MATCH   1          /*    not found, class assigned, or no */
+#define CANON_NOMATCH 2          /*    class matches                    */
+
+#define FORMAT_TEXT  0           /* Output formats: text, JSON Lines,   */
+#define FORMAT_JSON  1           /*    tab-separated values or Arrow    */
+#define FORMAT_TSV   2           /*    IPC file                         */
+#define FORMAT_ARROW 3
+
+#define ENGINE_SCAN  0           /* Matching engines: count mismatches  */
+#define ENGINE_TREE  1           /*    or follow a decision tree        */
+
+/* Input sequence data (array) - residue number label and amino acid    */
+typedef struct
+{
+   char            resnum[SMALLWORD],
+                   seq;
+}  SEQUENCE;
+
+/* Index of a sequence array by encoded residue ID. The insert code
+   fallbacks of FindRes() are resolved on lookup. The entries set are
+   listed so that only these are reset for the next sequence           */
+typedef struct
+{
+   int offset[NRESID],              /* Offset into SEQUENCE array of an
+                                       exact match or -1                */
+       first[2*(MAXRESNUM+1)],      /* Offset of first residue with each
+                                       number (any insert code) or -1   */
+       setID[NRESID],               /* Entries of offset[] set          */
+       setNum[2*(MAXRESNUM+1)],     /* Entries of first[] set           */
+       nSetID,
+       nSetNum;
+}  RESINDEX;
+
+/* A compiled canonical class definition (array)                        */
+typedef struct
+{
+   int      loop,                   /* CDR number (-1 if not a known
+                                       CDR)                             */
+            length,                 /* Loop length (shortest if a range)*/
+            maxLength,              /* Longest loop length              */
+            firstKey,               /* Offset of first key residue      */
+            nKey,                   /* Number of key residues           */
+            name,                   /* Class name (string pool offset)  */
+            source,                 /* Source info (string pool offset) */
+            priorityOver,           /* Class over which this takes
+                                       priority (-1 if none)            */
+            subordinateTo;          /* Class to which this is
+                                       subordinate (-1 if none)         */
+}  CANONCLASS;
+
+/* A candidate to be tested for a loop: either a single class or a
+   priority chain (array)                                               */
+typedef struct
+{
+   int      firstLink,              /* Offset of first class in links[] */
+            nLink,                  /* Number of classes (highest
+                                       priority first)                  */
+            reportAs;               /* Class reported if none match     */
+}  CANDIDATE;
+
+/* The candidates for a given loop and length (array)                   */
+typedef struct
+{
+   int      first,                  /* Offset of first CANDIDATE        */
+            n;                      /* Number of candidates             */
+}  BUCKET;
+
+/* Canonical definitions compiled from the CHOTHIA linked list. The
+   key residues of all classes are held in parallel arrays and strings
+   in a single pool. The candidates for each loop and length are found
+   from buckets[(loop * (maxLength+1)) + length]                        */
+typedef struct
+{
+   CANONCLASS   *classes;           /* Classes grouped by loop & length */
+   CANDIDATE    *candidates;        /* Candidates grouped by loop and
+                                       length                           */
+   BUCKET       *buckets;           /* Candidates for each loop and
+                                       length                           */
+   int          *keyResid,          /* Encoded residue ID of each key
+                                       residue (-1 if not encodable)    */
+                *keyLabel,          /* Residue label (pool offset)      */
+                *keyTypes;          /* Allowed types (pool offset)      */
+   unsigned int *keyAllowed;        /* Bit mask of allowed types        */
+   float        *keyWeight;         /* Weight in scores                 */
+   char         *strings;           /* String pool                      */
+   int          *links;             /* Classes in each candidate        */
+   int          nClass,             /* Number of classes                */
+                nCandidate,         /* Number of candidates             */
+                nLink,              /* Number of entries in links[]     */
+                maxLength,          /* Longest loop length              */
+                nKey,               /* Total number of key residues     */
+                nStrings;           /* Size of string pool              */
+}  CANONTABLE;
+
+/* Translation of residue labels between numbering schemes (private to
+   the library)                                                         */
+typedef struct _numtrans NUMTRANS;
+
+/* Key residues of a set of canonical definitions translated by a 
+   NUMTRANS for each CDR length (private to the library)               */
+typedef struct _keytrans KEYTRANS;
+
+/* Allowed residue types of all the classes of each bucket, tested 
+   together (private to the library)                                    */
+typedef struct _matchkernel MATCHKERNEL;
+
+/* Decision trees over the key positions of each bucket (private to the
+   library)                                                             */
+typedef struct _classtree CLASSTREE;
+
+/* A set of canonical definitions read from a data file. This is not
+   modified once read, so may be shared between threads                 */
+typedef struct
+{
+   struct _chothia *chothia;        /* Linked list of class definitions
+                                       (freed once compiled)            */
+   struct _defblock *blocks;        /* Storage of the linked list       */
+   CANONTABLE      table;           /* Compiled class definitions       */
+   BOOL            canonChothNum;   /* Data file uses Chothia numbering?*/
+   void            *map;            /* Mapped compiled data file from
+                                       which the table is taken (NULL
+                                       if not mapped)                   */
+   size_t          mapSize;         /* Size of mapped file              */
+   long            srcMtime,        /* Modification time (seconds and   */
+                   srcMtimeNsec,    /*    nanoseconds) and size of the  */
+                   srcSize;         /*    data file (0 if not known)    */
+   int             nCDR;            /* CDRs processed (NCDR if H3 classes
+                                       are defined, otherwise NCDR-1)   */
+   KEYTRANS        *kabchoKeys;     /* Kabat/Chothia translation of the
+                                       key residues                     */
+   MATCHKERNEL     *kernel;         /* Masks for testing all the classes
+                                       of a bucket together             */
+   CLASSTREE       *tree;           /* Decision trees of the buckets
+                                       (NULL if not built)              */
+}  CHOTHIADATA;
+
+/* Memo cache of loop classifications (private to the library)        */
+typedef struct _canoncache CANONCACHE;
+
+/* Counts of the work done in assigning canonicals. Each thread keeps
+   its own and they are merged with MergeCanonStats() at the end       */
+typedef struct
+{
+   double        loadTime,          /* Seconds loading the datafile     */
+                 readTime,          /* Seconds reading records          */
+                 classifyTime,      /* Seconds classifying records and
+                                       formatting the output (summed
+                                       over threads)                    */
+                 totalTime;         /* Elapsed seconds                  */
+   unsigned long records,           /* Records read                     */
+                 errors,            /* Records in error                 */
+                 duplicates,        /* Records with a sequence seen
+                                       before                           */
+                 lookups,           /* Key residues looked up           */
+                 fallbacks,         /*    found by insert code fallback */
+                 scans,             /*    found by scanning the sequence*/
+                 cacheHits,         /* Loops found in the cache         */
+                 cacheMisses,       /* Loops looked up but not found    */
+                 cacheEvictions,    /* Cache entries replaced           */
+                 missing[NCDR],     /* Loops whose ends were not found  */
+                 loops[NCDR],       /* Loops classified                 */
+                 matched[NCDR],     /*    and assigned a class          */
+                 classesTested[NCDR], /* Classes whose mismatches were
+                                       counted                          */
+                 kernelLoops[NCDR], /* Loops tested with the MATCHKERNEL*/
+                 earlyExits[NCDR],  /* Loops matched before the last
+                                       candidate                        */
+                 chainWalks[NCDR],  /* Priority chains walked           */
+                 chainLinks[NCDR],  /* Classes tested in them           */
+                 treeLoops[NCDR],   /* Loops matched with the CLASSTREE */
+                 treeSteps[NCDR];   /* Key positions tested for them    */
+   int           threads;           /* Threads whose counts are merged  */
+}  CANONSTATS;
+
+/* Everything needed to assign canonicals for a sequence                */
+typedef struct
+{
+   CHOTHIADATA *data;               /* Canonical definitions            */
+   BOOL        chothiaNumbered,     /* Sequence data uses Chothia
+                                       numbering?                       */
+               verbose;             /* Display reasons for mismatches   */
+   char        chain;               /* Chain to handle (both if ' ')    */
+   int         format;              /* FORMAT_TEXT, _JSON, _TSV or
+                                       _ARROW                           */
+   CANONCACHE  *cache;              /* Classification cache (NULL if 
+                                       none). Not shared between 
+                                       threads                          */
+   KEYTRANS    *trans;              /* Translation of key residues to the
+                                       numbering of the sequence data
+                                       (NULL to use chothiaNumbered)    */
+   int         topK;                /* Classes ranked by score for each
+                                       CDR (0 for none)                 */
+   CANONSTATS  *stats;              /* Counts of work done (NULL if not
+                                       counting). Not shared between 
+                                       threads                          */
+   char        *method;             /* Name of the set of definitions,
+                                       given with the results (NULL if
+                                       only one set is used)            */
+   int         engine;              /* ENGINE_SCAN or ENGINE_TREE       */
+}  CANONCONTEXT;
+
+/* A set of canonical definitions listed in a method file (array)       */
+typedef struct
+{
+   char        name[MAXBUFF],       /* Method name                      */
+               display[MAXBUFF],    /* Name given with the results      */
+               datafile[MAXBUFF];   /* Chothia datafile                 */
+   int         order;               /* Position in display order        */
+}  CANONMETHOD;
+
+/* A key residue which does not match the nearest class (array)         */
+typedef struct
+{
+   char        *label,              /* Residue (numbering of datafile)  */
+               *allowed;            /* Residue types allowed            */
+   char        found;               /* Residue type in sequence ('\0' if
+                                       deleted)                         */
+}  CANONMISMATCH;
+
+/* A class ranked by its score against a CDR (array)                   */
+typedef struct
+{
+   char        *className;          /* Class name                       */
+   double      score;               /* Weighted fraction of key residues
+                                       matching (0-1)                   */
+}  CANONRANK;
+
+/* The canonical class assigned to a CDR                                */
+typedef struct
+{
+   char          *loop,             /* CDR name (L1, L2, etc)           */
+                 *missing,          /* Loop end not found in sequence
+                                       (CANON_MISSING)                  */
+                 *className,        /* Class assigned (CANON_MATCH)     */
+                 *source,           /* Source info of class assigned    */
+                 *similar;          /* Nearest class (CANON_NOMATCH;
+                                       NULL if none of this length)     */
+   int           status,            /* CANON_MISSING, _MATCH or _NOMATCH*/
+                 length,            /* Loop length                      */
+                 nRanked,           /* Classes ranked (-1 if not 
+                                       scoring)                         */
+                 nMismatch;         /* Mismatches to nearest class (the
+                                       first MAXMISMATCH are reported)  */
+   CANONRANK     rank[MAXRANK];     /* Highest scoring classes          */
+   CANONMISMATCH mismatch[MAXMISMATCH];
+}  CANONRESULT;
+
+/* Streaming reader for raw sequence files (private to the library)    */
+typedef struct _seqreader SEQREADER;
+
+/* Arrow IPC file writer (private to the library)                       */
+typedef struct _arrowwriter ARROWWRITER;
+
+/* Table of distinct sequences in a batch (private to the library)      */
+typedef struct _duptable DUPTABLE;
+
+/* The canonical classes assigned to a sequence                         */
+typedef struct
+{
+   CANONRESULT cdr[NCDR];           /* Results for each CDR             */
+   int         firstCDR,            /* CDRs processed (depends on the   */
+               lastCDR;             /*    chain, last is exclusive)     */
+   BOOL        chothiaNumbering;    /* Mismatch labels use Chothia
+                                       (rather than Kabat) numbering?   */
+   char        *method;             /* Set of definitions used (from
+                                       the CANONCONTEXT; NULL if none
+                                       given)                           */
+}  CANONRESULTS;
+
+/************************************************************************/
+/* Prototypes
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+BOOL LoadChothiaData(char *filename, CHOTHIADATA *data);
+BOOL BuildChothiaTree(CHOTHIADATA *data);
+void FreeChothiaData(CHOTHIADATA *data);
+BOOL ReadChothiaData(char *filename, CHOTHIADATA *data);
+BOOL CompileChothiaData(CHOTHIADATA *data);
+BOOL CompiledDataPath(char *filename, char *compfile);
+BOOL WriteCompiledData(CHOTHIADATA *data, char *compfile);
+int  ReadCanonMethods(char *filename, CANONMETHOD *methods,
+                      int maxMethods);
+BOOL GrowSequence(SEQUENCE **Sequence, int *maxRes, int NRes);
+int  ReadInputData(FILE *in, SEQUENCE **Sequence, int *maxRes);
+int  ReadInputRecord(FILE *in, SEQUENCE **Sequence, int *maxRes,
+                     char *id, char *nextID);
+SEQREADER *OpenSequenceReader(FILE *fp);
+void CloseSequenceReader(SEQREADER *reader);
+int  ReadSequenceRecord(SEQREADER *reader, SEQUENCE **Sequence, 
+                        int *maxRes, char *id, char chain, 
+                        BOOL chothia);
+int  NumberSequence(char *seq, int length, char chain, BOOL chothia,
+                    SEQUENCE *Sequence);
+void InitResIndex(RESINDEX *index);
+void IndexSequence(SEQUENCE *Sequence, int NRes, RESINDEX *index);
+int  FindRes(SEQUENCE *Sequence, int NRes, RESINDEX *index, char *res);
+void ClassifySequence(CANONCONTEXT *ctx, SEQUENCE *Sequence, int NRes,
+                      RESINDEX *index, CANONRESULTS *results);
+void ClassifyBlock(CANONCONTEXT *ctx, SEQUENCE **Sequences, int *NRes,
+                   RESINDEX *index, int nSeq, CANONRESULTS *results);
+void PrintCanonResults(FILE *out, CANONRESULTS *results, BOOL verbose);
+void ReportCanonicals(FILE *out, CANONCONTEXT *ctx, SEQUENCE *Sequence,
+                      int NRes, RESINDEX *index);
+void ReportCanonicalRecord(FILE *out, CANONCONTEXT *ctx, char *id,
+                           SEQUENCE *Sequence, int NRes, RESINDEX *index);
+void PrintCanonRecord(FILE *out, CANONCONTEXT *ctx, char *id, int count,
+                      CANONRESULTS *results);
+void PrintCanonResultsJSON(FILE *out, char *id, int count,
+                           CANONRESULTS *results);
+void PrintCanonHeaderTSV(FILE *out, BOOL count, BOOL method);
+void PrintCanonResultsTSV(FILE *out, char *id, int count,
+                          CANONRESULTS *results);
+ARROWWRITER *OpenArrowWriter(FILE *out, CHOTHIADATA *data);
+BOOL WriteArrowRecord(ARROWWRITER *writer, char *id,
+                      CANONRESULTS *results);
+BOOL CloseArrowWriter(ARROWWRITER *writer);
+CANONCACHE *NewCanonCache(CHOTHIADATA *data, int nEntries);
+void FreeCanonCache(CANONCACHE *cache);
+void CanonCacheStats(CANONCACHE *cache, unsigned long *hits,
+                     unsigned long *misses, unsigned long *evictions);
+int  *CanonCacheKeys(CANONCACHE *cache, int bucket, int *nKeys,
+                     char **fingerprint);
+BOOL LookupCanonCache(CANONCACHE *cache, int bucket, int context,
+                      int *status, int *classNum);
+void StoreCanonCache(CANONCACHE *cache, int status, int classNum);
+void StoreCanonCacheKey(CANONCACHE *cache, int bucket, int context,
+                        char *fingerprint, int status, int classNum);
+DUPTABLE *NewDupTable(void);
+void FreeDupTable(DUPTABLE *dups);
+int  FindDuplicate(DUPTABLE *dups, SEQUENCE *Sequence, int NRes, char *id,
+                   BOOL *found);
+BOOL SetDuplicateResults(DUPTABLE *dups, int entry,
+                         CANONRESULTS *results);
+BOOL GetDuplicateResults(DUPTABLE *dups, int entry,
+                         CANONRESULTS *results);
+int  DupTableEntries(DUPTABLE *dups);
+char *DupTableEntry(DUPTABLE *dups, int entry, int *count);
+NUMTRANS *BuiltinNumTrans(void);
+NUMTRANS *ReadNumTrans(char *filename);
+void FreeNumTrans(NUMTRANS *trans);
+BOOL NumTransDirection(NUMTRANS *trans, char *scheme, BOOL *reverse);
+char *NumTransScheme(NUMTRANS *trans, BOOL to);
+char *TranslateResLabel(NUMTRANS *trans, BOOL reverse, int *loopLen,
+                        char *label);
+int  NumTransContext(NUMTRANS *trans, int *loopLen);
+int  NumTransContexts(NUMTRANS *trans);
+int  *NumTransDigits(NUMTRANS *trans, int loop, int *maxLength);
+int  NumTransRegion(NUMTRANS *trans, BOOL reverse, char *label,
+                    int *maxLength);
+KEYTRANS *CompileKeyTrans(CHOTHIADATA *data, NUMTRANS *trans);
+void FreeKeyTrans(KEYTRANS *keyTrans);
+char *KabCho(char *cdr, int length, char *kabspec);
+char *ChoKab(char *cdr, int length, char *kabspec);
+char **KabChoTable(char *cdr, int *maxLength, int *rowSize);
+void InitCanonStats(CANONSTATS *stats);
+void MergeCanonStats(CANONSTATS *total, CANONSTATS *stats);
+void AddCacheStats(CANONSTATS *stats, CANONCACHE *cache);
+double StatsClock(void);
+void PrintCanonStats(FILE *out, CANONSTATS *stats, BOOL json);
+MATCHKERNEL *BuildMatchKernel(CANONTABLE *table);
+void FreeMatchKernel(MATCHKERNEL *kernel);
+void MatchKernelArrays(MATCHKERNEL *kernel, int nBucket, void **arrays,
+                       size_t *sizes);
+MATCHKERNEL *MapMatchKernel(void **arrays, int maxKeys);
+int  *MatchKernelKeys(MATCHKERNEL *kernel, int bucket, int *nKeys);
+int  MatchKernelMaxKeys(MATCHKERNEL *kernel);
+BOOL MatchKernelUsable(MATCHKERNEL *kernel, int bucket);
+void CountMismatches(MATCHKERNEL *kernel, int bucket,
+                     unsigned int *observed, int *counts);
+void CountBlockMismatches(MATCHKERNEL *kernel, int bucket,
+                          unsigned int *observed, int nSeq,
+                          unsigned long *planes);
+unsigned long BlockMatches(unsigned long *planes, int lane, int nSeq);
+int  BlockMismatches(unsigned long *planes, int lane, int seq);
+unsigned int *MatchKernelMasks(MATCHKERNEL *kernel, int bucket,
+                               int *nLane);
+CLASSTREE *BuildClassTree(CANONTABLE *table, MATCHKERNEL *kernel);
+void FreeClassTree(CLASSTREE *tree);
+BOOL ClassTreeUsable(CLASSTREE *tree, int bucket);
+int  ClassTreeRoot(CLASSTREE *tree, int bucket);
+int  ClassTreeKey(CLASSTREE *tree, int node);
+int  ClassTreeNext(CLASSTREE *tree, int node, char res);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,524 @@
+/*************************************************************************
+
+   Program:    Chothia
+   File:       dedup.c
+
+   Version:    V2.25
+   Date:       16.10.26
+   Function:   Collapse exact duplicate sequences in a batch
+
+   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2026
+   Author:     Prof. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Part of libchothia. A repertoire often contains the same V region
+   many times over. A DUPTABLE holds each distinct numbered sequence
+   seen in a batch, with the number of records having it, the ID of the
+   first of these and, once it has been classified, its CANONRESULTS.
+   The canonicals for a record whose sequence is already in the table
+   are then simply copied from there.
+
+   Sequences are compared exactly, residue labels and all, so they are
+   held in full. The results are held packed, with only the mismatches
+   actually found. Both are kept in large blocks of memory rather than
+   being allocated one by one. The memory used therefore grows with the
+   number of distinct sequences, but not with the number of records.
+
+   A table is not shared between threads.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.17 16.10.26 Original
+   V2.25 16.10.26 The method of the results is kept
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "chothia.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define FNV_OFFSET   2166136261U /* FNV-1a hash parameters              */
+#define FNV_PRIME    16777619U
+#define DUPBLOCKSIZE (1 << 20)   /* Size of storage blocks              */
+#define DUPENTRIES   1024        /* Initial number of entries           */
+
+/* Size of the part of a CANONRESULT before its mismatches              */
+#define RESULTHEAD   offsetof(CANONRESULT, mismatch)
+
+/* A block of storage for sequences, IDs and results (linked list)      */
+typedef struct _dupblock
+{
+   struct _dupblock *next;
+   unsigned char    *data;
+   size_t           used,
+                    size;
+}  DUPBLOCK;
+
+/* A distinct sequence (array). Entries with the same hash value modulo
+   the size of the hash table are chained through next                  */
+typedef struct
+{
+   unsigned int  hash;              /* Hash of packed sequence          */
+   unsigned char *key,              /* Packed sequence                  */
+                 *results;          /* Packed results (NULL until set)  */
+   size_t        keyLen;            /* Length of packed sequence        */
+   char          *id;               /* ID of first record               */
+   int           count,             /* Records with this sequence       */
+                 next;              /* Next entry in chain (-1 if none) */
+}  DUPENTRY;
+
+struct _duptable
+{
+   DUPENTRY      *entries;
+   int           *heads,            /* Hash table of entry chains       */
+                 nEntries,          /* Entries filled                   */
+                 maxEntries;        /* Entries allocated                */
+   unsigned int  hashMask;          /* Size of hash table - 1           */
+   DUPBLOCK      *blocks;           /* Storage (most recent first)      */
+   unsigned char *key;              /* Sequence being looked up         */
+   size_t        keyLen,
+                 keyMax;
+};
+
+/************************************************************************/
+/* Prototypes
+*/
+BOOL PackSequence(DUPTABLE *dups, SEQUENCE *Sequence, int NRes);
+void *DupAlloc(DUPTABLE *dups, size_t size);
+BOOL GrowDupTable(DUPTABLE *dups);
+
+
+/************************************************************************/
+/*>DUPTABLE *NewDupTable(void)
+   ---------------------------
+   Returns: DUPTABLE *       The table (NULL if no memory)
+
+   Creates an empty table of distinct sequences
+
+   16.10.26 Original    By: ACRM
+*/
+DUPTABLE *NewDupTable(void)
+{
+   DUPTABLE *dups;
+   int      i;
+
+   if((dups = (DUPTABLE *)calloc(1, sizeof(DUPTABLE)))==NULL)
+      return(NULL);
+
+   dups->maxEntries = DUPENTRIES;
+   dups->hashMask   = 2 * DUPENTRIES - 1;
+
+   if(((dups->entries = (DUPENTRY *)malloc(DUPENTRIES *
+                                           sizeof(DUPENTRY)))==NULL) ||
+      ((dups->heads = (int *)malloc(2 * DUPENTRIES * sizeof(int)))
+       ==NULL))
+   {
+      FreeDupTable(dups);
+      return(NULL);
+   }
+
+   for(i=0; i<2*DUPENTRIES; i++)
+      dups->heads[i] = (-1);
+
+   return(dups);
+}
+
+
+/************************************************************************/
+/*>void FreeDupTable(DUPTABLE *dups)
+   ---------------------------------
+   Input:   DUPTABLE  *dups     Table of distinct sequences (may be NULL)
+
+   Frees a table of distinct sequences and everything stored in it
+
+   16.10.26 Original    By: ACRM
+*/
+void FreeDupTable(DUPTABLE *dups)
+{
+   DUPBLOCK *block,
+            *next;
+
+   if(dups == NULL)
+      return;
+
+   for(block=dups->blocks; block!=NULL; block=next)
+   {
+      next = block->next;
+      free(block->data);
+      free(block);
+   }
+
+   if(dups->entries != NULL) free(dups->entries);
+   if(dups->heads != NULL)   free(dups->heads);
+   if(dups->key != NULL)     free(dups->key);
+   free(dups);
+}
+
+
+/************************************************************************/
+/*>int FindDuplicate(DUPTABLE *dups, SEQUENCE *Sequence, int NRes,
+                     char *id, BOOL *found)
+   ---------------------------------------------------------------
+   Input:   DUPTABLE  *dups      Table of distinct sequences
+            SEQUENCE  *Sequence  Sequence array
+            int       NRes       Length of sequence
+            char      *id        ID of the record
+   Output:  BOOL      *found     Was the sequence already in the table?
+   Returns: int                  Entry for the sequence (-1 if no
+                                 memory)
+
+   Looks up a sequence, counting another record for it. If it is not
+   already in the table it is added, with this record as the first,
+   and its results must be given with SetDuplicateResults() once it
+   has been classified.
+
+   16.10.26 Original    By: ACRM
+*/
+int FindDuplicate(DUPTABLE *dups, SEQUENCE *Sequence, int NRes, char *id,
+                  BOOL *found)
+{
+   DUPENTRY     *entry;
+   unsigned int hash = FNV_OFFSET;
+   size_t       i;
+   int          e;
+
+   *found = FALSE;
+   if(!PackSequence(dups, Sequence, NRes))
+      return(-1);
+
+   for(i=0; i<dups->keyLen; i++)
+      hash = (hash ^ dups->key[i]) * FNV_PRIME;
+
+   for(e=dups->heads[hash & dups->hashMask]; e!=(-1); e=entry->next)
+   {
+      entry = &(dups->entries[e]);
+      if((entry->hash == hash) && (entry->keyLen == dups->keyLen) &&
+         !memcmp(entry->key, dups->key, dups->keyLen))
+      {
+         entry->count++;
+         *found = TRUE;
+         return(e);
+      }
+   }
+
+   /* A new sequence                                                    */
+   if((dups->nEntries == dups->maxEntries) && !GrowDupTable(dups))
+      return(-1);
+
+   e     = dups->nEntries;
+   entry = &(dups->entries[e]);
+   if(((entry->key = (unsigned char *)DupAlloc(dups, dups->keyLen))
+       ==NULL) ||
+      ((entry->id = (char *)DupAlloc(dups, strlen(id) + 1))==NULL))
+      return(-1);
+
+   memcpy(entry->key, dups->key, dups->keyLen);
+   strcpy(entry->id, id);
+   entry->keyLen  = dups->keyLen;
+   entry->hash    = hash;
+   entry->results = NULL;
+   entry->count   = 1;
+   entry->next    = dups->heads[hash & dups->hashMask];
+   dups->heads[hash & dups->hashMask] = e;
+   dups->nEntries++;
+
+   return(e);
+}
+
+
+/************************************************************************/
+/*>BOOL SetDuplicateResults(DUPTABLE *dups, int entry,
+                            CANONRESULTS *results)
+   -------------------------------------------------------
+   Input:   DUPTABLE     *dups     Table of distinct sequences
+            int          entry     Entry from FindDuplicate()
+            CANONRESULTS *results  Canonical classes assigned to it
+   Returns: BOOL                   Success?
+
+   Stores the canonical classes assigned to a sequence in the table.
+   Only the mismatches found are kept.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Keeps the method
+*/
+BOOL SetDuplicateResults(DUPTABLE *dups, int entry,
+                         CANONRESULTS *results)
+{
+   CANONRESULT   head;
+   unsigned char *packed;
+   size_t        size;
+   int           loop;
+
+   size = 2 * sizeof(int) + sizeof(BOOL) + sizeof(char *);
+   for(loop=results->firstCDR; loop<results->lastCDR; loop++)
+   {
+      size += RESULTHEAD;
+      if(results->cdr[loop].status == CANON_NOMATCH)
+         size += results->cdr[loop].nMismatch * sizeof(CANONMISMATCH);
+   }
+
+   if((packed = (unsigned char *)DupAlloc(dups, size))==NULL)
+      return(FALSE);
+   dups->entries[entry].results = packed;
+
+   memcpy(packed, &(results->firstCDR), sizeof(int));
+   memcpy(packed + sizeof(int), &(results->lastCDR), sizeof(int));
+   memcpy(packed + 2 * sizeof(int), &(results->chothiaNumbering),
+          sizeof(BOOL));
+   memcpy(packed + 2 * sizeof(int) + sizeof(BOOL), &(results->method),
+          sizeof(char *));
+   packed += 2 * sizeof(int) + sizeof(BOOL) + sizeof(char *);
+
+   for(loop=results->firstCDR; loop<results->lastCDR; loop++)
+   {
+      memcpy(&head, &(results->cdr[loop]), RESULTHEAD);
+      if(head.status != CANON_NOMATCH)
+         head.nMismatch = 0;
+      memcpy(packed, &head, RESULTHEAD);
+      packed += RESULTHEAD;
+
+      memcpy(packed, results->cdr[loop].mismatch,
+             head.nMismatch * sizeof(CANONMISMATCH));
+      packed += head.nMismatch * sizeof(CANONMISMATCH);
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL GetDuplicateResults(DUPTABLE *dups, int entry,
+                            CANONRESULTS *results)
+   -------------------------------------------------------
+   Input:   DUPTABLE     *dups     Table of distinct sequences
+            int          entry     Entry from FindDuplicate()
+   Output:  CANONRESULTS *results  Canonical classes assigned to it
+   Returns: BOOL                   Have the results been stored?
+
+   Gives the canonical classes stored with SetDuplicateResults()
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Keeps the method
+*/
+BOOL GetDuplicateResults(DUPTABLE *dups, int entry,
+                         CANONRESULTS *results)
+{
+   unsigned char *packed = dups->entries[entry].results;
+   int           loop;
+
+   if(packed == NULL)
+      return(FALSE);
+
+   memcpy(&(results->firstCDR), packed, sizeof(int));
+   memcpy(&(results->lastCDR), packed + sizeof(int), sizeof(int));
+   memcpy(&(results->chothiaNumbering), packed + 2 * sizeof(int),
+          sizeof(BOOL));
+   memcpy(&(results->method), packed + 2 * sizeof(int) + sizeof(BOOL),
+          sizeof(char *));
+   packed += 2 * sizeof(int) + sizeof(BOOL) + sizeof(char *);
+
+   for(loop=results->firstCDR; loop<results->lastCDR; loop++)
+   {
+      memcpy(&(results->cdr[loop]), packed, RESULTHEAD);
+      packed += RESULTHEAD;
+
+      memcpy(results->cdr[loop].mismatch, packed,
+             results->cdr[loop].nMismatch * sizeof(CANONMISMATCH));
+      packed += results->cdr[loop].nMismatch * sizeof(CANONMISMATCH);
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int DupTableEntries(DUPTABLE *dups)
+   -----------------------------------
+   Input:   DUPTABLE  *dups     Table of distinct sequences
+   Returns: int                 Number of distinct sequences
+
+   16.10.26 Original    By: ACRM
+*/
+int DupTableEntries(DUPTABLE *dups)
+{
+   return(dups->nEntries);
+}
+
+
+/************************************************************************/
+/*>char *DupTableEntry(DUPTABLE *dups, int entry, int *count)
+   ----------------------------------------------------------
+   Input:   DUPTABLE  *dups     Table of distinct sequences
+            int       entry     Entry number (0 is the first sequence
+                                seen)
+   Output:  int       *count    Number of records with the sequence
+   Returns: char      *         ID of the first of these records
+
+   16.10.26 Original    By: ACRM
+*/
+char *DupTableEntry(DUPTABLE *dups, int entry, int *count)
+{
+   *count = dups->entries[entry].count;
+   return(dups->entries[entry].id);
+}
+
+
+/************************************************************************/
+/*>BOOL PackSequence(DUPTABLE *dups, SEQUENCE *Sequence, int NRes)
+   ---------------------------------------------------------------
+   Input:   DUPTABLE  *dups      Table of distinct sequences
+            SEQUENCE  *Sequence  Sequence array
+            int       NRes       Length of sequence
+   Returns: BOOL                 Success?
+
+   Packs a sequence into the table's lookup key as the residue label,
+   a '\0' and the residue type for each residue in turn.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL PackSequence(DUPTABLE *dups, SEQUENCE *Sequence, int NRes)
+{
+   unsigned char *key;
+   size_t        len;
+   int           i;
+
+   if((size_t)NRes * (SMALLWORD + 1) > dups->keyMax)
+   {
+      if(dups->key != NULL)
+         free(dups->key);
+      dups->keyMax = (size_t)NRes * (SMALLWORD + 1);
+      if((dups->key = (unsigned char *)malloc(dups->keyMax))==NULL)
+      {
+         dups->keyMax = 0;
+         return(FALSE);
+      }
+   }
+
+   key = dups->key;
+   for(i=0; i<NRes; i++)
+   {
+      for(len=0; (len<SMALLWORD-1) && Sequence[i].resnum[len]; len++)
+         *(key++) = Sequence[i].resnum[len];
+      *(key++) = '\0';
+      *(key++) = Sequence[i].seq;
+   }
+   dups->keyLen = key - dups->key;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void *DupAlloc(DUPTABLE *dups, size_t size)
+   -------------------------------------------
+   Input:   DUPTABLE  *dups      Table of distinct sequences
+            size_t    size       Bytes required
+   Returns: void      *          Storage (NULL if no memory)
+
+   Allocates storage from the table's blocks. Storage is only freed
+   with the table and is not aligned, so is accessed with memcpy().
+
+   16.10.26 Original    By: ACRM
+*/
+void *DupAlloc(DUPTABLE *dups, size_t size)
+{
+   DUPBLOCK *block = dups->blocks;
+
+   if((block == NULL) || (block->size - block->used < size))
+   {
+      if((block = (DUPBLOCK *)malloc(sizeof(DUPBLOCK)))==NULL)
+         return(NULL);
+      block->size = (size > DUPBLOCKSIZE) ? size : DUPBLOCKSIZE;
+      block->used = 0;
+      if((block->data = (unsigned char *)malloc(block->size))==NULL)
+      {
+         free(block);
+         return(NULL);
+      }
+      block->next  = dups->blocks;
+      dups->blocks = block;
+   }
+
+   block->used += size;
+   return(block->data + block->used - size);
+}
+
+
+/************************************************************************/
+/*>BOOL GrowDupTable(DUPTABLE *dups)
+   ---------------------------------
+   Input:   DUPTABLE  *dups      Table of distinct sequences
+   Returns: BOOL                 Success?
+
+   Doubles the number of entries and the size of the hash table
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL GrowDupTable(DUPTABLE *dups)
+{
+   DUPENTRY     *entries;
+   int          *heads,
+                e;
+   unsigned int nHeads = 2 * (dups->hashMask + 1);
+
+   if((entries = (DUPENTRY *)realloc(dups->entries,
+                                     2 * dups->maxEntries *
+                                     sizeof(DUPENTRY)))==NULL)
+      return(FALSE);
+   dups->entries = entries;
+
+   if((heads = (int *)malloc(nHeads * sizeof(int)))==NULL)
+      return(FALSE);
+   free(dups->heads);
+   dups->heads      = heads;
+   dups->hashMask   = nHeads - 1;
+   dups->maxEntries *= 2;
+
+   for(e=0; e<(int)nHeads; e++)
+      heads[e] = (-1);
+   for(e=0; e<dups->nEntries; e++)
+   {
+      entries[e].next = heads[entries[e].hash & dups->hashMask];
+      heads[entries[e].hash & dups->hashMask] = e;
+   }
+
+   return(TRUE);
+}
@@ -0,0 +1,4456 @@
+/*************************************************************************
+
+   Program:    Chothia
+   File:       libchothia.c
+   
+   Version:    V2.31
+   Date:       16.10.26
+   Function:   Library routines to assign canonical classes and find
+               reasons for mismatches.
+   
+   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2026
+   Author:     Prof. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+               
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! 
+
+   The code may not be sold commercially or included as part of a 
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   The canonical assignment code of the chothia program, built as 
+   libchothia. See chothia.h for the interface.
+
+   Must be linked with KabCho.c from KabatMan (for the built-in 
+   translation between Kabat and Chothia numbering in numtrans.c)
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.11 16.10.26 Original - split from chothia.c V2.10. Canonicals are
+                  assigned into a CANONRESULTS structure rather than 
+                  being printed
+   V2.14 16.10.26 Added JSON Lines and TSV output of CANONRESULTS and
+                  ReportCanonicalRecord()
+   V2.16 16.10.26 ClassifyLoop() uses the CANONCACHE of the CANONCONTEXT
+   V2.17 16.10.26 Added PrintCanonRecord(). JSON and TSV output may 
+                  give a count of records
+   V2.18 16.10.26 Key residues are translated to the numbering of the
+                  sequence through a NUMTRANS for all CDRs, rather 
+                  than with KabCho() and ChoKab() for CDR1
+   V2.19 16.10.26 Key residues and loop ends are translated for each 
+                  CDR length in a KEYTRANS when the translation is
+                  loaded rather than for each sequence
+   V2.20 16.10.26 CDR-H3 is classified if the data file defines H3
+                  classes. A class may cover a range of loop lengths
+   V2.21 16.10.26 Key residues may be given weights. Classes may be 
+                  ranked by a weighted score against each CDR
+   V2.22 16.10.26 ClassifyLoop() counts the mismatches against all the
+                  classes of a bucket at once with a MATCHKERNEL
+   V2.23 16.10.26 Added ClassifyBlock() to classify a block of sequences
+                  a class at a time
+   V2.24 16.10.26 Counts key residue lookups, classes tested and how
+                  loops were resolved in the CANONSTATS of the
+                  CANONCONTEXT
+   V2.25 16.10.26 Added ReadCanonMethods(). Results are labelled with
+                  the method of the CANONCONTEXT, which is given in 
+                  the output
+   V2.26 16.10.26 Definitions read from a data file are stored in 
+                  blocks with a list of key residues for each class
+                  rather than a fixed size node, so there is no limit
+                  on the number of key residues. Sequence arrays are
+                  grown as needed by GrowSequence()
+   V2.27 16.10.26 Added BuildChothiaTree(). Loops are assigned by 
+                  following the CLASSTREE if the CANONCONTEXT engine
+                  is ENGINE_TREE
+   V2.28 16.10.26 Added InitResIndex(). IndexSequence() only resets the
+                  entries set for the previous sequence and the insert
+                  code fallbacks are resolved by IndexedRes()
+   V2.29 16.10.26 ClassifyLoopBlock() takes loops seen before from the
+                  CANONCACHE and adds those it classifies
+   V2.30 16.10.26 A KEYTRANS holds copies of its labels and context 
+                  digits rather than referring to the NUMTRANS. The
+                  compiled data file also holds the MATCHKERNEL and the
+                  Kabat/Chothia KEYTRANS, which are mapped rather than
+                  built. WriteCompiledData() writes a loaded CHOTHIADATA
+   V2.31 16.10.26 Key residues in the framework of a chain may be
+                  translated
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L  /* For mmap(), st_mtim etc.            */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "bioplib/macros.h"
+#include "bioplib/general.h"
+#include "bioplib/seq.h"
+
+#include "chothia.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXEXPSEQ    300         /* Expected max light + heavy          */
+#define DEFBLOCKSIZE (1 << 16)   /* Size of definition storage blocks   */
+
+#define RESID_OK     0           /* Return codes from ParseResID()      */
+#define RESID_STEM   1
+#define RESID_BAD    2
+
+#define RESBIT_OTHER (1U << 26)  /* Allowed residue bit used for any
+                                    non-standard residue type           */
+
+#define METHODPREFIX "chothia.dat." /* Datafile of a method is this
+                                    followed by the method name         */
+#define COMP_MAGIC   "CHOTHCMP"  /* Identifies a compiled data file     */
+#define COMP_VERSION 4           /* Version of compiled data file format*/
+#define COMP_BYTEORDER 0x01020304 /* Detects files from other machines  */
+#define NTABLESECTION 10         /* Arrays of the CANONTABLE,           */
+#define NTRANSSECTION 6          /*    of a KEYTRANS                    */
+#define NCOMPSECTION (NTABLESECTION + NKERNELARRAY + NTRANSSECTION)
+                                 /*    and in all in a compiled file    */
+
+#define KEY_SCAN     (-1)        /* Translated residue: label not       */
+#define KEY_DELETED  (-2)        /*    encodable or position unoccupied */
+
+/* Terminates a string at the first alphabetic character                */
+#define TERMALPHA(x) do {  int _termalpha_j;                  \
+                        for(_termalpha_j=0;                   \
+                            (x)[_termalpha_j];                \
+                            _termalpha_j++)                   \
+                        {  if(isalpha((x)[_termalpha_j]))     \
+                           {  (x)[_termalpha_j] = '\0';       \
+                              break;                          \
+                     }  }  }  while(0)
+
+/* Encodes a chain (0=L, 1=H), residue number and insert code (0=none,
+   1=A, etc.) as a single integer residue ID                            */
+#define ENCODERESID(chain, num, ins) \
+   ((((chain)*(MAXRESNUM+1))+(num))*(NINSERT+1)+(ins))
+
+/* Rounds a size up so that the next section of a compiled data file is
+   aligned for any of the arrays stored                                 */
+#define COMPALIGN(x) (((x) + 7) & ~((size_t)7))
+
+/* Bit representing an amino acid in an allowed residue mask            */
+#define RESBIT(c) ((((c) >= 'A') && ((c) <= 'Z')) ?                     \
+                   (1U << ((c) - 'A')) : RESBIT_OTHER)
+
+/* A label from the string pool of a KEYTRANS                           */
+#define KEYTRANSLABEL(kt, offset) \
+   (((offset) < 0) ? NULL : ((kt)->strings + (offset)))
+
+/* A block of storage for the definitions read from a data file (linked
+   list)                                                                */
+typedef struct _defblock
+{
+   struct _defblock *next;
+   char             *data;
+   size_t           used,
+                    size;
+}  DEFBLOCK;
+
+/* Linked list of the key residues of a class definition                */
+typedef struct _chothiakey
+{
+   struct _chothiakey *next;
+   char               *resnum,      /* Key position                     */
+                      *restype;     /* Allowed residues                 */
+   float              weight;       /* Key residue weight               */
+}  CHOTHIAKEY;
+
+/* Linked list to store information on canonical class definitions. The
+   nodes, key residues and strings are allocated from the DEFBLOCKs of
+   the CHOTHIADATA                                                      */
+typedef struct _chothia
+{
+   struct _chothia *next,                           /* Linked list      */
+                   *priority_over,                  /* Priority over which
+                                                       other classes when
+                                                       key residues 
+                                                       clash            */
+                   *subordinate_to;                 /* Suborinate to which
+                                                       other classes when
+                                                       key residues
+                                                       clash            */
+   CHOTHIAKEY      *keys;                           /* Key residues     */
+   int             length,                          /* Loop length      */
+                   maxLength,                       /* Longest length if
+                                                       a range          */
+                   nKey;                            /* Number of key
+                                                       residues         */
+   char            *LoopID,                         /* CDR (L1, L2, etc */
+                   *class,                          /* Class name       */
+                   *source,                         /* Info on class
+                                                       maybe including PDB
+                                                       code in []       */
+                   *subordinate,                    /* Class name to
+                                                       which this class is
+                                                       subordinate
+                                                       (NULL if none)   */
+                   *priority;                       /* Class name over
+                                                       which this class
+                                                       takes priority
+                                                       (NULL if none)   */
+   int             npriority,                       /* Number over which
+                                                       this class takes
+                                                       priority (0 or 1)*/
+                   nsubordinate;                    /* Number of classes
+                                                       to which this is
+                                                       subordinate 
+                                                       (0 or 1)         */
+   
+}  CHOTHIA;
+
+/* Definitions of CDR loop boundaries (array)                           */
+typedef struct
+{
+   char name[SMALLWORD],
+        start[SMALLWORD],
+        stop[SMALLWORD];
+}  LOOP;
+
+/* Sizes and fixed-size fields of a KEYTRANS. These are stored in the
+   header of a compiled data file                                       */
+typedef struct
+{
+   int      nKey,                   /* Entries of region[] and first[]  */
+            nEntries,               /*    of resid[] and label[]        */
+            nDigits,                /*    of digit[]                    */
+            nStrings,               /* Size of string pool              */
+            nContexts,              /* Translation contexts (-1 if too
+                                       many to number)                  */
+            regionMax[NLOOPDEF],    /* Longest length with its own
+                                       translation of each CDR (-1 if
+                                       not translated)                  */
+            endResid[NLOOPDEF][2],  /* Residue IDs of the loop ends     */
+            endLabel[NLOOPDEF][2];  /*    and their labels              */
+}  KEYTRANSINFO;
+
+/* Header of a compiled data file. This is followed by the arrays of the
+   CANONTABLE, the MATCHKERNEL and the Kabat/Chothia KEYTRANS, each
+   aligned with COMPALIGN(). The checksum covers everything after the
+   header                                                               */
+typedef struct
+{
+   char         magic[8];           /* COMP_MAGIC                       */
+   int          version,            /* COMP_VERSION                     */
+                byteOrder,          /* COMP_BYTEORDER                   */
+                maxResNum,          /* MAXRESNUM when written           */
+                nInsert,            /* NINSERT when written             */
+                nLoopDef,           /* NLOOPDEF when written            */
+                canonChothNum,      /* Data file uses Chothia numbering?*/
+                nClass,             /* Sizes of the CANONTABLE arrays   */
+                nKey,
+                nStrings,
+                nCandidate,
+                nLink,
+                maxLength,
+                kernelMaxKeys;      /* MatchKernelMaxKeys()             */
+   long         kernelSize[NKERNELARRAY];
+                                    /* Sizes of the MATCHKERNEL arrays  */
+   KEYTRANSINFO kabcho;             /* The Kabat/Chothia KEYTRANS       */
+   unsigned int checksum;           /* Checksum of the arrays           */
+   long         srcMtime,           /* Modification time of data file   */
+                srcMtimeNsec,       /* (seconds and nanoseconds)        */
+                srcSize;            /* Size of data file                */
+}  COMPHEADER;
+
+/* Key residues translated to the numbering of the sequences. For a
+   key residue k in the region of a CDR of length l, the translation is
+   entry first[k] + l, or first[k] + regionMax + 1 if l is longer or 
+   not found. A key residue translated the same for all lengths has the
+   single entry first[k] and no region. Labels are offsets into the 
+   string pool of the KEYTRANS (-1 if the position is not occupied), so
+   it does not refer to the NUMTRANS and may be stored in a compiled 
+   data file                                                            */
+struct _keytrans
+{
+   KEYTRANSINFO info;
+   int      *region,                /* CDR whose length determines the
+                                       translation of each key residue
+                                       (-1 if none)                     */
+            *first,                 /* First entry for each key residue
+                                       (-1 if not translated)           */
+            *resid,                 /* Residue ID of each entry (or
+                                       KEY_SCAN or KEY_DELETED)         */
+            *label,                 /* Label of each entry              */
+            *digit;                 /* Context digit of each length 
+                                       0..regionMax then others of each
+                                       translated CDR in turn           */
+   char     *strings;               /* String pool                      */
+   int      maxStrings;             /* Space in string pool             */
+   BOOL     mapped;                 /* Arrays in a compiled data file?  */
+};
+
+/* Translation of the key residues of the data file to the numbering of
+   a sequence                                                           */
+typedef struct
+{
+   KEYTRANS *trans;                 /* Translation (NULL if numbered the
+                                       same)                            */
+   int      loopLen[NLOOPDEF],      /* Length of each CDR (0 if not
+                                       found)                           */
+            context;                /* Context for the classification
+                                       cache (-1 if not cachable)       */
+}  SEQTRANS;
+
+/************************************************************************/
+/* Globals
+*/
+/* Definitions of the CDRs. The order of these defines the loop numbers
+   used in CANONCLASS                                                   */
+static LOOP sLoopDef[NLOOPDEF] = 
+{  {  "L1", "L24", "L34"  },
+   {  "L2", "L50", "L56"  },
+   {  "L3", "L89", "L97"  },
+   {  "H1", "H26", "H35B" },
+   {  "H2", "H50", "H58"  },
+   {  "H3", "H95", "H102" }
+}  ;
+
+/************************************************************************/
+/* Prototypes
+*/
+BOOL FindDataFile(char *filename, char *path, struct stat *info);
+void *DefAlloc(CHOTHIADATA *data, size_t size);
+char *DefString(CHOTHIADATA *data, char *string);
+void FreeDefBlocks(CHOTHIADATA *data);
+BOOL MapCompiledData(char *compfile, struct stat *srcInfo, 
+                     CHOTHIADATA *data);
+KEYTRANS *MapKeyTrans(KEYTRANSINFO *info, unsigned char *map,
+                      size_t *offset);
+size_t CompiledLayout(COMPHEADER *header, size_t *offset, size_t *size);
+unsigned int Checksum(unsigned char *buffer, size_t length);
+BOOL BuildCandidateBuckets(CANONTABLE *table);
+int  LoopIndex(char *LoopID);
+BOOL ParseLoopLength(char *word, int *length, int *maxLength);
+int  ParseResidueLine(char *buffer, SEQUENCE *Sequence, int count);
+int  ParseResID(char *resnum, int *chain, int *num, int *ins);
+int  EncodeResID(char *resnum);
+int  FindResByScan(SEQUENCE *Sequence, int NRes, char *res);
+void FindCDRs(CANONCONTEXT *ctx, SEQUENCE *Sequence, int NRes,
+              RESINDEX *index, SEQTRANS *seqTrans, int *start,
+              int *stop, CANONRESULTS *results);
+void ClassifyLoopBlock(CANONCONTEXT *ctx, int loop, int b,
+                       unsigned long group, SEQUENCE **Sequences,
+                       int *NRes, RESINDEX *index, SEQTRANS *seqTrans,
+                       CANONRESULTS *results);
+void ClassifyLoop(CANONCONTEXT *ctx, int loop, int LoopLen, 
+                  SEQUENCE *Sequence, int NRes, RESINDEX *index, 
+                  SEQTRANS *seqTrans, CANONRESULT *result);
+void InitLoopResult(CANONCONTEXT *ctx, int loop, int LoopLen,
+                    CANONRESULT *result);
+void SetLoopResult(CANONCONTEXT *ctx, CANONCLASS *p, BOOL match,
+                   SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                   SEQTRANS *seqTrans, CANONRESULT *result);
+void SetSeqTrans(CANONCONTEXT *ctx, SEQTRANS *seqTrans);
+void ScoreLoop(CANONCONTEXT *ctx, int loop, BUCKET *bucket,
+               SEQUENCE *Sequence, int NRes, RESINDEX *index,
+               SEQTRANS *seqTrans, CANONRESULT *result);
+int  ScoreThisCanonical(CANONCONTEXT *ctx, CANONCLASS *p, 
+                        SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                        SEQTRANS *seqTrans, double *score);
+void RankClass(CANONRESULT *result, int topK, char *className, 
+               double score);
+int  TestThisCanonical(CANONCONTEXT *ctx, CANONCLASS *p, int loop, 
+                       int LoopLen, SEQUENCE *Sequence, int NRes, 
+                       RESINDEX *index, SEQTRANS *seqTrans);
+void PrintJSONString(FILE *out, char *string);
+void CountResults(CANONCONTEXT *ctx, CANONRESULTS *results);
+int  FindKeyRes(CANONCONTEXT *ctx, int key, SEQUENCE *Sequence, int NRes,
+                RESINDEX *index, SEQTRANS *seqTrans);
+int  FindLoopEnd(SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                 SEQTRANS *seqTrans, int loop, int end);
+int  FindTransRes(SEQUENCE *Sequence, int NRes, RESINDEX *index, 
+                  int resid, char *label);
+int  IndexedRes(RESINDEX *index, int resid);
+BOOL SetTransEntry(KEYTRANS *keyTrans, char *label, int *resid,
+                   int *transLabel);
+int  KeyTransContext(KEYTRANS *keyTrans, int *loopLen);
+
+/************************************************************************/
+/*>BOOL ReadChothiaData(char *filename, CHOTHIADATA *data)
+   -------------------------------------------------------
+   Input:   char        *filename  The Chothia data filename
+   Output:  CHOTHIADATA *data      The linked list of Chothia data and
+                                   whether Chothia (rather than Kabat)
+                                   numbering is used in the file
+   Returns: BOOL                   Success?
+
+   Reads a Chothia canonical definition file. This file has the format:
+   LOOP loopid class length
+  [SOURCE ............................ ]
+   resid types [weight]
+   resid types [weight]
+   ...
+
+   The length may be a range (see ParseLoopLength()). The weight of a 
+   key residue in scores defaults to 1
+
+   16.05.95 Original based on ReadChothiaData() from KabatMan
+   30.11.95 Remove leading spaces from strings read from file
+   07.05.96 Handles the CHOTHIANUMBERING keyword
+   19.12.08 Uses MAXWORD and updated for new GetWord()
+            Fixed explicit 160 in fgets to MAXBUFF
+            Changed strcpy() to strncpy()
+   14.02.11 Added PRIORITY and SUBORDINATE keywords
+   14.12.16 Changed to blGetWord()
+   16.10.26 Data returned in a CHOTHIADATA structure rather than globals
+            Checks PRIORITY and SUBORDINATE classes are for the same 
+            loop
+            Initialises the CHOTHIADATA before opening the file
+            The loop length may be a range. The SOURCE is optional
+            Key residues may be given a weight
+            The definitions are stored in DEFBLOCKs rather than one 
+            fixed size node per class, so any number of key residues
+            may be given
+            Closes the file
+*/
+BOOL ReadChothiaData(char *filename, CHOTHIADATA *data)
+{
+   FILE       *fp;
+   char       buffer[MAXBUFF],
+              word[MAXWORD],
+              resnum[SMALLWORD],
+              source[MAXWORD+1],
+              *chp,
+              *buffp;
+   CHOTHIA    *p = NULL;
+   CHOTHIAKEY *key,
+              **lastKey = NULL;
+   BOOL       NoEnv,
+              ok = TRUE;
+/*           GotSubPri = FALSE; */
+   
+   data->chothia       = NULL;
+   data->blocks        = NULL;
+   data->canonChothNum = FALSE;
+   data->map           = NULL;
+   data->mapSize       = 0;
+   data->srcMtime      = 0;
+   data->srcMtimeNsec  = 0;
+   data->srcSize       = 0;
+   data->kabchoKeys    = NULL;
+   data->kernel        = NULL;
+   data->tree          = NULL;
+   data->nCDR          = NCDR - 1;
+   memset(&(data->table), 0, sizeof(CANONTABLE));
+
+   /* Open the data file                                                */
+   if((fp=blOpenFile(filename,ENV_KABATDIR,"r",&NoEnv))==NULL)
+   {
+      return(FALSE);
+   }
+
+   while(ok && fgets(buffer,MAXBUFF,fp))
+   {
+      TERMINATE(buffer);
+      buffp = buffer;
+      while(isspace(*buffp))
+         buffp++;
+      
+      if(strlen(buffp) && buffp[0] != '!' && buffp[0] != '#')
+      {
+         /* Handle the SOURCE keyword                                   */
+         if(!blUpstrncmp(buffp,"SOURCE",6))
+         {
+            if(p!=NULL)
+            {
+               /* Strip out the SOURCE keyword                          */
+               chp = blGetWord(buffp,word,MAXWORD);
+               /* Store the text                                        */
+               strncpy(source, chp, MAXWORD);
+               source[MAXWORD] = '\0';
+               if((p->source = DefString(data, source))==NULL)
+                  ok = FALSE;
+            }
+         }
+         else if(!blUpstrncmp(buffp,"PRIORITY",8))
+         {
+/*            GotSubPri = TRUE; */
+            if(p!=NULL)
+            {
+               /* Strip out the PRIORITY keyword                        */
+               chp = blGetWord(buffp,word,MAXWORD);
+               /* And grab the class name over which this takes 
+                  priority
+               */
+               chp = blGetWord(chp,resnum,SMALLWORD);
+               if((p->priority = DefString(data, resnum))==NULL)
+                  ok = FALSE;
+               p->npriority = 1;
+            }
+         }
+         else if(!blUpstrncmp(buffp,"SUBORDINATE",11))
+         {
+/*            GotSubPri = TRUE; */
+            if(p!=NULL)
+            {
+               /* Strip out the SUBORDINATE keyword                     */
+               chp = blGetWord(buffp,word,MAXWORD);
+               /* And grab the class name to which this is subordinate  */
+               chp = blGetWord(chp,resnum,SMALLWORD);
+               if((p->subordinate = DefString(data, resnum))==NULL)
+                  ok = FALSE;
+               p->nsubordinate = 1;
+            }
+         }
+         else if(!blUpstrncmp(buffp,"CHOTHIANUM",10))
+         {
+            data->canonChothNum = TRUE;
+         }
+         else if(!blUpstrncmp(buffp,"LOOP",4))    /* Start of entry     */
+         {
+            /* Allocate space in linked list                            */
+            if(p == NULL)
+               p = data->chothia = (CHOTHIA *)DefAlloc(data, 
+                                                       sizeof(CHOTHIA));
+            else
+               p = p->next = (CHOTHIA *)DefAlloc(data, sizeof(CHOTHIA));
+            if(p==NULL)
+            {
+               ok = FALSE;
+               break;
+            }
+            
+            /* 14.02.11 Initialize the PRIORITY and SUBORDINATE fields  */
+            p->next          = NULL;
+            p->priority_over = p->subordinate_to = NULL;
+            p->priority      = p->subordinate    = NULL;
+            p->npriority     = p->nsubordinate   = 0;
+            p->source        = "";
+            p->keys          = NULL;
+            p->nKey          = 0;
+            lastKey          = &(p->keys);
+
+            /* Strip out the word LOOP                                  */
+            chp = blGetWord(buffp,word,MAXWORD);
+            /* Get the loop id                                          */
+            chp = blGetWord(chp,resnum,SMALLWORD);
+            p->LoopID = DefString(data, resnum);
+            /* Get the class name                                       */
+            chp = blGetWord(chp,resnum,SMALLWORD);
+            p->class = DefString(data, resnum);
+            if((p->LoopID == NULL) || (p->class == NULL))
+            {
+               ok = FALSE;
+               break;
+            }
+            
+            /* Get the loop length                                      */
+            chp = blGetWord(chp,word,MAXWORD);
+            if(!ParseLoopLength(word, &(p->length), &(p->maxLength)))
+            {
+               fprintf(stderr,"Error (chothia): Invalid length (%s) \
+for class %s\n", word, p->class);
+               ok = FALSE;
+            }
+         }
+         else
+         {
+            /* Not the start of an entry, so must be a resid/type pair  */
+            if(p!=NULL)
+            {
+               if((key = (CHOTHIAKEY *)DefAlloc(data, 
+                                                sizeof(CHOTHIAKEY)))
+                  ==NULL)
+               {
+                  ok = FALSE;
+                  break;
+               }
+               key->next = NULL;
+               
+               chp = blGetWord(buffp,resnum,SMALLWORD);
+               key->resnum = DefString(data, resnum);
+               chp = blGetWord(chp,word,MAXWORD);
+               key->restype = DefString(data, word);
+               if((key->resnum == NULL) || (key->restype == NULL))
+               {
+                  ok = FALSE;
+                  break;
+               }
+               
+               /* The weight is optional                                */
+               key->weight = 1.0;
+               chp = blGetWord(chp,word,MAXWORD);
+               if(word[0] && 
+                  ((sscanf(word,"%f",&(key->weight)) != 1) ||
+                   (key->weight < 0.0)))
+               {
+                  fprintf(stderr,"Error (chothia): Invalid weight (%s) \
+for %s in class %s\n", word, key->resnum, p->class);
+                  ok = FALSE;
+               }
+
+               /* Add to the end of the class's key residues            */
+               *lastKey = key;
+               lastKey  = &(key->next);
+               p->nKey++;
+            }
+         }
+      }
+   }
+   fclose(fp);
+
+   if(!ok)
+      return(FALSE);
+   
+   /* 14.02.11 If we have any PRIORITY/SUBORDINATEs then set the 
+      information for the pointers rather than simple text labels
+   */
+   for(p=data->chothia; p!=NULL; NEXT(p))
+   {
+      /* See if this takes priority over anything else                  */
+      if(p->npriority)
+      {
+         int     nmatch = 0;
+         CHOTHIA *q = NULL;
+         for(q=data->chothia; q!=NULL; NEXT(q))
+         {
+            if(!strcmp(p->priority, q->class))
+            {
+               p->priority_over = q;
+               nmatch++;
+            }
+         }
+         if(nmatch > 1)
+         {
+            fprintf(stderr,"Chothia: Error 1, Loop %s takes priority \
+over %s, but %s matches %d classes\n", 
+                    p->class, p->priority, p->priority, nmatch);
+            return(FALSE);
+         }
+         if(nmatch < 1)
+         {
+            fprintf(stderr,"Chothia: Error 2, Loop %s takes priority \
+over %s, but %s not found as a valid canonical name\n", 
+                    p->class, p->priority, p->priority);
+            return(FALSE);
+         }
+         if((p->length    != p->priority_over->length) ||
+            (p->maxLength != p->priority_over->maxLength))
+         {
+            fprintf(stderr,"Chothia: Error 5, Loop %s takes priority \
+over %s, but lengths do not match\n", 
+                    p->class, p->priority);
+            return(FALSE);
+         }
+         if(strcmp(p->LoopID, p->priority_over->LoopID))
+         {
+            fprintf(stderr,"Chothia: Error 9, Loop %s takes priority \
+over %s, but loops do not match\n", 
+                    p->class, p->priority);
+            return(FALSE);
+         }
+         
+         
+      }
+      
+      /* See if this is subordinate to anything else                    */
+      if(p->nsubordinate)
+      {
+         int     nmatch = 0;
+         CHOTHIA *q = NULL;
+         for(q=data->chothia; q!=NULL; NEXT(q))
+         {
+            if(!strcmp(p->subordinate, q->class))
+            {
+               p->subordinate_to = q;
+               nmatch++;
+            }
+         }
+         if(nmatch > 1)
+         {
+            fprintf(stderr,"Chothia: Error 3, Loop %s is subordinate \
+to %s, but %s matches %d classes\n", 
+                    p->class, p->subordinate, p->subordinate, nmatch);
+            return(FALSE);
+         }
+         if(nmatch < 1)
+         {
+            fprintf(stderr,"Chothia: Error 4, Loop %s is subordinate \
+to %s, but %s not found as a valid canonical name\n", 
+                    p->class, p->subordinate, p->subordinate);
+            return(FALSE);
+         }
+         if((p->length    != p->subordinate_to->length) ||
+            (p->maxLength != p->subordinate_to->maxLength))
+         {
+            fprintf(stderr,"Chothia: Error 6, Loop %s is subordinate \
+to %s, but lengths do not match\n", 
+                    p->class, p->priority);
+            return(FALSE);
+         }
+         if(strcmp(p->LoopID, p->subordinate_to->LoopID))
+         {
+            fprintf(stderr,"Chothia: Error 10, Loop %s is subordinate \
+to %s, but loops do not match\n", 
+                    p->class, p->subordinate);
+            return(FALSE);
+         }
+      }
+   }
+   
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void *DefAlloc(CHOTHIADATA *data, size_t size)
+   -----------------------------------------------
+   I/O:     CHOTHIADATA *data      Canonical definitions being read
+   Input:   size_t      size       Bytes required
+   Returns: void        *          Storage (NULL if no memory)
+
+   Allocates storage for the definitions read from a data file from the
+   blocks of the CHOTHIADATA. Storage is aligned with COMPALIGN() and 
+   is only freed, all together, by FreeDefBlocks().
+
+   16.10.26 Original    By: ACRM
+*/
+void *DefAlloc(CHOTHIADATA *data, size_t size)
+{
+   DEFBLOCK *block = data->blocks;
+
+   size = COMPALIGN(size);
+   if((block == NULL) || (block->size - block->used < size))
+   {
+      if((block = (DEFBLOCK *)malloc(sizeof(DEFBLOCK)))==NULL)
+      {
+         fprintf(stderr,"Error (chothia): No memory for canonical \
+definitions\n");
+         return(NULL);
+      }
+      block->size = (size > DEFBLOCKSIZE) ? size : DEFBLOCKSIZE;
+      block->used = 0;
+      if((block->data = (char *)malloc(block->size))==NULL)
+      {
+         fprintf(stderr,"Error (chothia): No memory for canonical \
+definitions\n");
+         free(block);
+         return(NULL);
+      }
+      block->next  = data->blocks;
+      data->blocks = block;
+   }
+
+   block->used += size;
+   return(block->data + block->used - size);
+}
+
+
+/************************************************************************/
+/*>char *DefString(CHOTHIADATA *data, char *string)
+   ------------------------------------------------
+   I/O:     CHOTHIADATA *data      Canonical definitions being read
+   Input:   char        *string    String to store
+   Returns: char        *          Copy of the string (NULL if no 
+                                   memory)
+
+   Copies a string into the storage for the definitions
+
+   16.10.26 Original    By: ACRM
+*/
+char *DefString(CHOTHIADATA *data, char *string)
+{
+   char *copy;
+   
+   if((copy = (char *)DefAlloc(data, strlen(string)+1))!=NULL)
+      strcpy(copy, string);
+   return(copy);
+}
+
+
+/************************************************************************/
+/*>void FreeDefBlocks(CHOTHIADATA *data)
+   -------------------------------------
+   I/O:     CHOTHIADATA *data      Canonical definitions
+
+   Frees the storage of the definitions read from a data file and so
+   the linked list of classes
+
+   16.10.26 Original    By: ACRM
+*/
+void FreeDefBlocks(CHOTHIADATA *data)
+{
+   DEFBLOCK *block,
+            *next;
+
+   for(block=data->blocks; block!=NULL; block=next)
+   {
+      next = block->next;
+      free(block->data);
+      free(block);
+   }
+   data->blocks  = NULL;
+   data->chothia = NULL;
+}
+
+
+/************************************************************************/
+/*>BOOL CompileChothiaData(CHOTHIADATA *data)
+   ------------------------------------------
+   I/O:     CHOTHIADATA *data      Canonical definitions. On input 
+                                   contains the linked list read by
+                                   ReadChothiaData(). On output contains
+                                   the compiled table; the linked list
+                                   has been freed.
+   Returns: BOOL                   Success?
+
+   Compiles the linked list of canonical definitions into a CANONTABLE.
+   The classes are sorted by loop and length (retaining the order from 
+   the file within each loop and length), with classes covering a range
+   of lengths after those of a single length, and their key residues are
+   stored in parallel arrays as encoded residue IDs and bit masks of 
+   the allowed residue types. The PRIORITY and SUBORDINATE links become
+   offsets into the class array and the classes are placed in buckets
+   by BuildCandidateBuckets().
+
+   16.10.26 Original    By: ACRM
+            Classes may cover a range of lengths
+            Key residues are a linked list of each class. Frees the
+            DEFBLOCKs rather than the list
+*/
+BOOL CompileChothiaData(CHOTHIADATA *data)
+{
+   CANONTABLE *table = &(data->table);
+   CANONCLASS *c;
+   CHOTHIA    *p,
+              **order = NULL,
+              *tmp;
+   CHOTHIAKEY *pk;
+   int        nClass   = 0,
+              nKey     = 0,
+              nStrings = 0,
+              i, j, k,
+              key,
+              loopi,
+              loopj,
+              *loops   = NULL;
+   char       *chp;
+
+   table->classes    = NULL;
+   table->keyResid   = table->keyLabel = table->keyTypes = NULL;
+   table->keyAllowed = NULL;
+   table->keyWeight  = NULL;
+   table->strings    = NULL;
+   table->candidates = NULL;
+   table->buckets    = NULL;
+   table->links      = NULL;
+   
+   /* Find the sizes needed                                             */
+   for(p=data->chothia; p!=NULL; NEXT(p))
+   {
+      nClass++;
+      nKey     += p->nKey;
+      nStrings += strlen(p->class) + strlen(p->source) + 2;
+      for(pk=p->keys; pk!=NULL; NEXT(pk))
+         nStrings += strlen(pk->resnum) + strlen(pk->restype) + 2;
+   }
+
+   /* Allocate the table                                                */
+   order = (CHOTHIA **)malloc((nClass+1) * sizeof(CHOTHIA *));
+   loops = (int *)malloc((nClass+1) * sizeof(int));
+   table->classes    = (CANONCLASS *)malloc((nClass+1) * 
+                                            sizeof(CANONCLASS));
+   table->keyResid   = (int *)malloc((nKey+1) * sizeof(int));
+   table->keyLabel   = (int *)malloc((nKey+1) * sizeof(int));
+   table->keyTypes   = (int *)malloc((nKey+1) * sizeof(int));
+   table->keyAllowed = (unsigned int *)malloc((nKey+1) * 
+                                              sizeof(unsigned int));
+   table->keyWeight  = (float *)malloc((nKey+1) * sizeof(float));
+   table->strings    = (char *)malloc(nStrings+1);
+   if((order == NULL) || (loops == NULL) ||
+      (table->classes == NULL) || (table->keyResid == NULL) || 
+      (table->keyLabel == NULL) || (table->keyTypes == NULL) ||
+      (table->keyAllowed == NULL) || (table->keyWeight == NULL) ||
+      (table->strings == NULL))
+   {
+      fprintf(stderr,"Error (chothia): No memory for compiled \
+canonical definitions\n");
+      if(order != NULL) free(order);
+      if(loops != NULL) free(loops);
+      return(FALSE);
+   }
+
+   /* Sort the classes by loop and length. This is an insertion sort
+      so classes retain their order from the file within each loop and
+      length. Unknown loops go at the end and, within a loop, ranges of
+      lengths go after single lengths (the sort key is twice the loop 
+      number, plus one for a range).
+   */
+   for(i=0, p=data->chothia; p!=NULL; NEXT(p), i++)
+   {
+      order[i] = p;
+      loops[i] = LoopIndex(p->LoopID);
+      if(loops[i] < 0)
+         loops[i] = NLOOPDEF;
+      loops[i] *= 2;
+      if(p->maxLength != p->length)
+         loops[i]++;
+   }
+   for(i=1; i<nClass; i++)
+   {
+      tmp   = order[i];
+      loopi = loops[i];
+      for(j=i; j>0; j--)
+      {
+         loopj = loops[j-1];
+         if((loopj < loopi) || 
+            ((loopj == loopi) && (order[j-1]->length <= tmp->length)))
+            break;
+         order[j] = order[j-1];
+         loops[j] = loops[j-1];
+      }
+      order[j] = tmp;
+      loops[j] = loopi;
+   }
+   
+   /* Copy in the classes and key residues                              */
+   chp = table->strings;
+   key = 0;
+   for(i=0; i<nClass; i++)
+   {
+      p = order[i];
+      c = &(table->classes[i]);
+      
+      c->loop          = ((loops[i]/2) == NLOOPDEF)?(-1):(loops[i]/2);
+      c->length        = p->length;
+      c->maxLength     = p->maxLength;
+      c->firstKey      = key;
+      c->priorityOver  = c->subordinateTo = (-1);
+      
+      c->name = chp - table->strings;
+      strcpy(chp, p->class);
+      chp += strlen(chp) + 1;
+      c->source = chp - table->strings;
+      strcpy(chp, p->source);
+      chp += strlen(chp) + 1;
+      
+      for(pk=p->keys; pk!=NULL; NEXT(pk), key++)
+      {
+         table->keyResid[key] = EncodeResID(pk->resnum);
+         table->keyLabel[key] = chp - table->strings;
+         strcpy(chp, pk->resnum);
+         chp += strlen(chp) + 1;
+         table->keyTypes[key] = chp - table->strings;
+         strcpy(chp, pk->restype);
+         chp += strlen(chp) + 1;
+         
+         table->keyAllowed[key] = 0;
+         for(k=0; pk->restype[k]; k++)
+            table->keyAllowed[key] |= RESBIT(pk->restype[k]);
+         table->keyWeight[key] = pk->weight;
+      }
+      c->nKey = key - c->firstKey;
+
+      /* Convert the PRIORITY and SUBORDINATE links to offsets          */
+      for(j=0; j<nClass; j++)
+      {
+         if(p->priority_over == order[j])
+            c->priorityOver = j;
+         if(p->subordinate_to == order[j])
+            c->subordinateTo = j;
+      }
+   }
+   table->nClass   = nClass;
+   table->nKey     = nKey;
+   table->nStrings = nStrings;
+
+   free(order);
+   free(loops);
+
+   /* Check there are no loops in the priority chains, which would 
+      stop ClassifyLoop() from ever finding the end of a chain
+   */
+   for(i=0; i<nClass; i++)
+   {
+      for(j=i, k=0; 
+          (table->classes[j].subordinateTo >= 0) && (k <= nClass); 
+          j=table->classes[j].subordinateTo, k++);
+      if(k > nClass)
+      {
+         fprintf(stderr,"Chothia: Error 7, Loop %s is in a circular \
+chain of SUBORDINATE classes\n", 
+                 table->strings + table->classes[i].name);
+         return(FALSE);
+      }
+      for(j=i, k=0; 
+          (table->classes[j].priorityOver >= 0) && (k <= nClass); 
+          j=table->classes[j].priorityOver, k++);
+      if(k > nClass)
+      {
+         fprintf(stderr,"Chothia: Error 8, Loop %s is in a circular \
+chain of PRIORITY classes\n", 
+                 table->strings + table->classes[i].name);
+         return(FALSE);
+      }
+   }
+   
+   /* The linked list is no longer needed                               */
+   FreeDefBlocks(data);
+   
+   return(BuildCandidateBuckets(table));
+}
+
+
+/************************************************************************/
+/*>BOOL BuildCandidateBuckets(CANONTABLE *table)
+   ---------------------------------------------
+   I/O:     CANONTABLE *table      Compiled canonical definitions
+   Returns: BOOL                   Success?
+
+   Builds the list of candidates to be tested for each loop and length.
+   A class that is not subordinate to anything is a candidate on its 
+   own. A class that is subordinate to another, but does not take 
+   priority over anything, is the lowest priority class of a chain;
+   the candidate is then the whole chain, highest priority first, and 
+   it is reported as the lowest priority class if nothing in the chain
+   matches. Other classes in a chain are not candidates themselves.
+   This matches the order in which ReportACanonical() used to test the
+   classes while walking the full list. A class covering a range of 
+   lengths is a candidate in the bucket for each length in the range.
+
+   16.10.26 Original    By: ACRM
+            Classes may cover a range of lengths
+*/
+BOOL BuildCandidateBuckets(CANONTABLE *table)
+{
+   CANONCLASS *classes = table->classes;
+   CANDIDATE  *cand    = NULL;
+   BUCKET     *bucket;
+   int        i,
+              q,
+              b,
+              length,
+              pass,
+              nBucket;
+
+   table->maxLength = 0;
+   for(i=0; i<table->nClass; i++)
+   {
+      if(classes[i].maxLength > table->maxLength)
+         table->maxLength = classes[i].maxLength;
+   }
+   nBucket = NLOOPDEF * (table->maxLength + 1);
+
+   /* The first pass counts the candidates and links; the second fills
+      them in. The candidates for each bucket are contiguous and in the
+      order of the sorted classes
+   */
+   for(pass=0; pass<2; pass++)
+   {
+      table->nCandidate = table->nLink = 0;
+      
+      for(b=0; b<nBucket; b++)
+      {
+         length = b % (table->maxLength+1);
+         
+         for(i=0; i<table->nClass; i++)
+         {
+            if((classes[i].loop   != b / (table->maxLength+1)) || 
+               (classes[i].length >  length)                    ||
+               (classes[i].maxLength < length))
+               continue;
+            if((classes[i].subordinateTo >= 0) && 
+               (classes[i].priorityOver >= 0))
+               continue;
+
+            if(pass)
+            {
+               cand = &(table->candidates[table->nCandidate]);
+               cand->firstLink = table->nLink;
+               cand->nLink     = 0;
+               cand->reportAs  = i;
+
+               bucket = &(table->buckets[b]);
+               if(bucket->n == 0)
+                  bucket->first = table->nCandidate;
+               bucket->n++;
+            }
+            
+            /* Walk to the highest priority class                       */
+            for(q=i; classes[q].subordinateTo >= 0; 
+                q=classes[q].subordinateTo);
+      
+            /* and back down the chain                                  */
+            for(; q >= 0; q = classes[q].priorityOver)
+            {
+               if(pass)
+               {
+                  table->links[table->nLink] = q;
+                  cand->nLink++;
+               }
+               table->nLink++;
+            }
+         
+            table->nCandidate++;
+         }
+      }
+
+      if(!pass)
+      {
+         table->buckets    = (BUCKET *)calloc(nBucket, sizeof(BUCKET));
+         table->candidates = (CANDIDATE *)malloc((table->nCandidate+1) *
+                                                 sizeof(CANDIDATE));
+         table->links      = (int *)malloc((table->nLink+1) * 
+                                           sizeof(int));
+         if((table->buckets == NULL) || (table->candidates == NULL) ||
+            (table->links == NULL))
+         {
+            fprintf(stderr,"Error (chothia): No memory for canonical \
+buckets\n");
+            return(FALSE);
+         }
+      }
+   }
+   
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL LoadChothiaData(char *filename, CHOTHIADATA *data)
+   -------------------------------------------------------
+   Input:   char        *filename  The Chothia data filename
+   Output:  CHOTHIADATA *data      The compiled Chothia data
+   Returns: BOOL                   Success?
+
+   Obtains the compiled canonical definitions for a data file. If there
+   is a compiled data file (written by WriteCompiledData()) for the 
+   current version of the data file, this is mapped into memory, 
+   including the MATCHKERNEL and the translation of the key residues
+   between Kabat and Chothia numbering. Otherwise the data file is read
+   and compiled and these are built. CDR-H3 is only classified if the
+   data file defines H3 classes.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 The MATCHKERNEL and Kabat/Chothia KEYTRANS are only built if
+            not mapped. Records the version of the data file
+*/
+BOOL LoadChothiaData(char *filename, CHOTHIADATA *data)
+{
+   char        path[MAXBUFF+MAXWORD];
+   struct stat srcInfo;
+   NUMTRANS    *kabcho;
+   BOOL        found,
+               mapped = FALSE;
+   int         i;
+
+   if((found = FindDataFile(filename, path, &srcInfo)))
+   {
+      strcat(path, COMP_EXT);
+      mapped = MapCompiledData(path, &srcInfo, data);
+   }
+
+   if(!mapped &&
+      !(ReadChothiaData(filename, data) && CompileChothiaData(data)))
+      return(FALSE);
+
+   if(found)
+   {
+      data->srcMtime     = (long)srcInfo.st_mtim.tv_sec;
+      data->srcMtimeNsec = (long)srcInfo.st_mtim.tv_nsec;
+      data->srcSize      = (long)srcInfo.st_size;
+   }
+
+   data->nCDR = NCDR - 1;
+   for(i=0; i<data->table.nClass; i++)
+   {
+      if(data->table.classes[i].loop == NCDR - 1)
+         data->nCDR = NCDR;
+   }
+
+   if(mapped)
+      return(TRUE);
+
+   if((kabcho = BuiltinNumTrans()) == NULL)
+   {
+      fprintf(stderr,"Error (chothia): No memory for numbering \
+translation\n");
+      return(FALSE);
+   }
+   data->kabchoKeys = CompileKeyTrans(data, kabcho);
+   FreeNumTrans(kabcho);
+   if(data->kabchoKeys == NULL)
+      return(FALSE);
+
+   if((data->kernel = BuildMatchKernel(&(data->table))) == NULL)
+   {
+      fprintf(stderr,"Error (chothia): No memory for matching \
+kernel\n");
+      return(FALSE);
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL BuildChothiaTree(CHOTHIADATA *data)
+   ----------------------------------------
+   I/O:     CHOTHIADATA *data      Chothia data from LoadChothiaData()
+   Returns: BOOL                   Success?
+
+   Builds the CLASSTREE used by ClassifyLoop() when the engine is
+   ENGINE_TREE. This is only needed with that engine, so is not done
+   by LoadChothiaData(). Without it, loops are classified as with
+   ENGINE_SCAN. It must be called before the data are shared between
+   threads.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL BuildChothiaTree(CHOTHIADATA *data)
+{
+   if(data->tree != NULL)
+      return(TRUE);
+
+   if((data->tree = BuildClassTree(&(data->table), data->kernel))
+      == NULL)
+   {
+      fprintf(stderr,"Error (chothia): No memory for decision \
+trees\n");
+      return(FALSE);
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void FreeChothiaData(CHOTHIADATA *data)
+   ---------------------------------------
+   I/O:     CHOTHIADATA *data      The Chothia data to free
+
+   Frees the canonical definitions obtained by LoadChothiaData() or
+   ReadChothiaData(), including those left by a partial read. A mapped
+   compiled data file is unmapped.
+
+   16.10.26 Original    By: ACRM
+*/
+void FreeChothiaData(CHOTHIADATA *data)
+{
+   CANONTABLE *table = &(data->table);
+   
+   FreeDefBlocks(data);
+
+   if(data->map != NULL)
+   {
+      munmap(data->map, data->mapSize);
+      data->map = NULL;
+   }
+   else
+   {
+      if(table->classes    != NULL) free(table->classes);
+      if(table->candidates != NULL) free(table->candidates);
+      if(table->buckets    != NULL) free(table->buckets);
+      if(table->keyResid   != NULL) free(table->keyResid);
+      if(table->keyLabel   != NULL) free(table->keyLabel);
+      if(table->keyTypes   != NULL) free(table->keyTypes);
+      if(table->keyAllowed != NULL) free(table->keyAllowed);
+      if(table->keyWeight  != NULL) free(table->keyWeight);
+      if(table->links      != NULL) free(table->links);
+      if(table->strings    != NULL) free(table->strings);
+   }
+   memset(table, 0, sizeof(CANONTABLE));
+
+   FreeKeyTrans(data->kabchoKeys);
+   FreeMatchKernel(data->kernel);
+   FreeClassTree(data->tree);
+   data->kabchoKeys = NULL;
+   data->kernel     = NULL;
+   data->tree       = NULL;
+}
+
+
+/************************************************************************/
+/*>int ReadCanonMethods(char *filename, CANONMETHOD *methods,
+                        int maxMethods)
+   -------------------------------------------------------------
+   Input:   char        *filename   The method file
+            int         maxMethods  Size of methods array
+   Output:  CANONMETHOD *methods    The methods in display order
+   Returns: int                     Number of methods (0 if error)
+
+   Reads a file listing the sets of canonical definitions (methods)
+   available, such as canonical_method.txt. Each line gives the name
+   of a method, the name under which its results are displayed and
+   its position in the display order, separated by | characters:
+
+   abm|AbM|2
+
+   Lines starting with # are comments. The datafile for a method is
+   chothia.dat.name in the directory in which the method file was
+   found (which is looked for as for a datafile). The methods are
+   returned sorted by display order; those with the same order stay
+   in the order of the file.
+
+   16.10.26 Original    By: ACRM
+*/
+int ReadCanonMethods(char *filename, CANONMETHOD *methods,
+                     int maxMethods)
+{
+   FILE        *fp;
+   char        buffer[MAXBUFF],
+               path[MAXBUFF],
+               order[MAXWORD],
+               *buffp,
+               *display,
+               *chp;
+   struct stat info;
+   CANONMETHOD method;
+   int         nMethods = 0,
+               dirLen   = 0,
+               i;
+
+   if(!FindDataFile(filename, path, &info) ||
+      ((fp = fopen(path, "r")) == NULL))
+   {
+      fprintf(stderr,"Error (chothia): Unable to open method file %s\n",
+              filename);
+      return(0);
+   }
+   if((chp = strrchr(path, '/')) != NULL)
+      dirLen = (int)(chp - path) + 1;
+
+   while(fgets(buffer, MAXBUFF, fp))
+   {
+      TERMINATE(buffer);
+      buffp = buffer;
+      while(isspace(*buffp))
+         buffp++;
+      if((buffp[0] == '\0') || (buffp[0] == '#') || (buffp[0] == '!'))
+         continue;
+
+      /* Split into name, display name and order                        */
+      if(((display = strchr(buffp, '|')) == NULL) ||
+         ((chp = strchr(display + 1, '|')) == NULL))
+      {
+         fprintf(stderr,"Error (chothia): Invalid method definition: \
+%s\n", buffp);
+         fclose(fp);
+         return(0);
+      }
+      *(display++) = *(chp++) = '\0';
+      blGetWord(chp, order, MAXWORD);
+      if(!buffp[0] || !display[0] ||
+         (sscanf(order, "%d", &(method.order)) != 1))
+      {
+         fprintf(stderr,"Error (chothia): Invalid method definition: \
+%s\n", buffp);
+         fclose(fp);
+         return(0);
+      }
+      if((nMethods == maxMethods) ||
+         (dirLen + strlen(METHODPREFIX) + strlen(buffp) >= MAXBUFF))
+      {
+         fprintf(stderr,"Error (chothia): Too many methods, or method \
+name too long, in %s\n", filename);
+         fclose(fp);
+         return(0);
+      }
+      strncpy(method.name,    buffp,   MAXBUFF);
+      strncpy(method.display, display, MAXBUFF);
+      method.name[MAXBUFF-1] = method.display[MAXBUFF-1] = '\0';
+      strncpy(method.datafile, path, dirLen);
+      method.datafile[dirLen] = '\0';
+      strcat(method.datafile, METHODPREFIX);
+      strcat(method.datafile, method.name);
+
+      /* Insert in display order                                        */
+      for(i=nMethods; (i>0) && (methods[i-1].order > method.order); i--)
+         methods[i] = methods[i-1];
+      methods[i] = method;
+      nMethods++;
+   }
+   fclose(fp);
+
+   if(nMethods == 0)
+      fprintf(stderr,"Error (chothia): No methods in %s\n", filename);
+   return(nMethods);
+}
+
+
+/************************************************************************/
+/*>BOOL FindDataFile(char *filename, char *path, struct stat *info)
+   ----------------------------------------------------------------
+   Input:   char        *filename  The Chothia data filename
+   Output:  char        *path      The path at which it was found
+            struct stat *info      File information
+   Returns: BOOL                   Found?
+
+   Finds a data file in the same way as blOpenFile(): first in the 
+   current directory, then in the directory given by the KABATDIR
+   environment variable.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL FindDataFile(char *filename, char *path, struct stat *info)
+{
+   char *dir;
+
+   strncpy(path, filename, MAXBUFF);
+   if(!stat(path, info))
+      return(TRUE);
+   
+   if(((dir = getenv(ENV_KABATDIR)) != NULL) && 
+      (strlen(dir) + strlen(filename) + 2 <= MAXBUFF))
+   {
+      sprintf(path, "%s/%s", dir, filename);
+      if(!stat(path, info))
+         return(TRUE);
+   }
+
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>BOOL CompiledDataPath(char *filename, char *compfile)
+   -----------------------------------------------------
+   Input:   char  *filename     The Chothia data filename
+   Output:  char  *compfile     The compiled data filename 
+                                (MAXBUFF+MAXWORD)
+   Returns: BOOL                Data file found?
+
+   Gives the name of the compiled data file for a data file, which is
+   alongside the data file (found as by FindDataFile()) with the
+   extension COMP_EXT.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL CompiledDataPath(char *filename, char *compfile)
+{
+   struct stat srcInfo;
+
+   if(!FindDataFile(filename, compfile, &srcInfo))
+      return(FALSE);
+   strcat(compfile, COMP_EXT);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL WriteCompiledData(CHOTHIADATA *data, char *compfile)
+   ---------------------------------------------------------
+   Input:   CHOTHIADATA *data      Chothia data from LoadChothiaData()
+            char        *compfile  The compiled data filename (see
+                                   CompiledDataPath())
+   Returns: BOOL                   Success?
+
+   Writes the compiled CANONTABLE, MATCHKERNEL and Kabat/Chothia 
+   KEYTRANS of a set of Chothia data to a binary file. The file records
+   the modification time and size of the data file so that it can be
+   checked to be current when it is used. The file is written under a
+   temporary name and renamed into place so that it may be replaced
+   while a server has the old version mapped.
+
+   16.10.26 Original    By: ACRM
+            Written via a temporary file
+   16.10.26 Writes loaded data rather than reading the data file. Also
+            writes the MATCHKERNEL and KEYTRANS
+*/
+BOOL WriteCompiledData(CHOTHIADATA *data, char *compfile)
+{
+   CANONTABLE    *table    = &(data->table);
+   KEYTRANS      *keyTrans = data->kabchoKeys;
+   COMPHEADER    *header;
+   char          tmppath[MAXBUFF+MAXWORD+SMALLWORD];
+   size_t        offset[NCOMPSECTION],
+                 size[NCOMPSECTION],
+                 total,
+                 headerSize = COMPALIGN(sizeof(COMPHEADER));
+   unsigned char *buffer;
+   void          *sections[NCOMPSECTION];
+   FILE          *fp;
+   int           t = NTABLESECTION + NKERNELARRAY,
+                 i;
+   BOOL          ok;
+
+   if((data->kernel == NULL) || (keyTrans == NULL) ||
+      (strlen(compfile) >= MAXBUFF+MAXWORD))
+      return(FALSE);
+
+   if((buffer = (unsigned char *)calloc(1, headerSize)) == NULL)
+      return(FALSE);
+   header = (COMPHEADER *)buffer;
+   memcpy(header->magic, COMP_MAGIC, 8);
+   header->version       = COMP_VERSION;
+   header->byteOrder     = COMP_BYTEORDER;
+   header->maxResNum     = MAXRESNUM;
+   header->nInsert       = NINSERT;
+   header->nLoopDef      = NLOOPDEF;
+   header->canonChothNum = data->canonChothNum;
+   header->nClass        = table->nClass;
+   header->nKey          = table->nKey;
+   header->nStrings      = table->nStrings;
+   header->nCandidate    = table->nCandidate;
+   header->nLink         = table->nLink;
+   header->maxLength     = table->maxLength;
+   header->kernelMaxKeys = MatchKernelMaxKeys(data->kernel);
+   header->kabcho        = keyTrans->info;
+   header->srcMtime      = data->srcMtime;
+   header->srcMtimeNsec  = data->srcMtimeNsec;
+   header->srcSize       = data->srcSize;
+
+   MatchKernelArrays(data->kernel, NLOOPDEF * (table->maxLength + 1),
+                     sections + NTABLESECTION, size + NTABLESECTION);
+   for(i=0; i<NKERNELARRAY; i++)
+      header->kernelSize[i] = (long)size[NTABLESECTION + i];
+
+   total = CompiledLayout(header, offset, size);
+   if((header = (COMPHEADER *)realloc(buffer, total)) == NULL)
+   {
+      free(buffer);
+      return(FALSE);
+   }
+   buffer = (unsigned char *)header;
+   memset(buffer+headerSize, 0, total-headerSize);
+
+   sections[0]   = table->classes;
+   sections[1]   = table->candidates;
+   sections[2]   = table->buckets;
+   sections[3]   = table->keyResid;
+   sections[4]   = table->keyLabel;
+   sections[5]   = table->keyTypes;
+   sections[6]   = table->keyAllowed;
+   sections[7]   = table->links;
+   sections[8]   = table->strings;
+   sections[9]   = table->keyWeight;
+   sections[t]   = keyTrans->region;
+   sections[t+1] = keyTrans->first;
+   sections[t+2] = keyTrans->resid;
+   sections[t+3] = keyTrans->label;
+   sections[t+4] = keyTrans->digit;
+   sections[t+5] = keyTrans->strings;
+   for(i=0; i<NCOMPSECTION; i++)
+   {
+      if(size[i])
+         memcpy(buffer+offset[i], sections[i], size[i]);
+   }
+   header->checksum = Checksum(buffer+headerSize, total-headerSize);
+
+   sprintf(tmppath, "%s.%ld", compfile, (long)getpid());
+   if((fp=fopen(tmppath, "wb"))==NULL)
+   {
+      free(buffer);
+      return(FALSE);
+   }
+   ok = (fwrite(buffer, 1, total, fp) == total);
+   if(fclose(fp))
+      ok = FALSE;
+   free(buffer);
+
+   if(ok && rename(tmppath, compfile))
+      ok = FALSE;
+   if(!ok)
+      unlink(tmppath);
+   
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL MapCompiledData(char *compfile, struct stat *srcInfo, 
+                        CHOTHIADATA *data)
+   ---------------------------------------------------------
+   Input:   char        *compfile  Compiled data filename
+            struct stat *srcInfo   Information on the original data file
+   Output:  CHOTHIADATA *data      The compiled Chothia data
+   Returns: BOOL                   Success?
+
+   Maps a compiled data file into memory and points the CANONTABLE 
+   arrays, the MATCHKERNEL and the Kabat/Chothia KEYTRANS into it. 
+   Fails (without a message) if the file does not exist, was written
+   by a different version or on a different type of machine, fails its
+   checksum, or was not compiled from the current version of the data
+   file.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Also maps the MATCHKERNEL and KEYTRANS
+*/
+BOOL MapCompiledData(char *compfile, struct stat *srcInfo, 
+                     CHOTHIADATA *data)
+{
+   CANONTABLE    *table = &(data->table);
+   COMPHEADER    *header;
+   struct stat   info;
+   size_t        offset[NCOMPSECTION],
+                 size[NCOMPSECTION],
+                 headerSize = COMPALIGN(sizeof(COMPHEADER));
+   unsigned char *map;
+   void          *arrays[NKERNELARRAY];
+   int           fd,
+                 i;
+
+   if((fd = open(compfile, O_RDONLY)) < 0)
+      return(FALSE);
+   if(fstat(fd, &info) || (info.st_size < (off_t)headerSize))
+   {
+      close(fd);
+      return(FALSE);
+   }
+   map = (unsigned char *)mmap(NULL, (size_t)info.st_size, PROT_READ, 
+                               MAP_SHARED, fd, 0);
+   close(fd);
+   if(map == (unsigned char *)MAP_FAILED)
+      return(FALSE);
+
+   header = (COMPHEADER *)map;
+   if(memcmp(header->magic, COMP_MAGIC, 8)               ||
+      (header->version   != COMP_VERSION)                 ||
+      (header->byteOrder != COMP_BYTEORDER)               ||
+      (header->maxResNum != MAXRESNUM)                    ||
+      (header->nInsert   != NINSERT)                      ||
+      (header->nLoopDef  != NLOOPDEF)                     ||
+      (header->srcMtime  != (long)srcInfo->st_mtim.tv_sec) ||
+      (header->srcMtimeNsec != (long)srcInfo->st_mtim.tv_nsec) ||
+      (header->srcSize   != (long)srcInfo->st_size)       ||
+      (CompiledLayout(header, offset, size) != (size_t)info.st_size) ||
+      (header->checksum  != Checksum(map+headerSize, 
+                                     info.st_size-headerSize)))
+   {
+      munmap(map, (size_t)info.st_size);
+      return(FALSE);
+   }
+
+   data->chothia        = NULL;
+   data->blocks         = NULL;
+   data->canonChothNum  = header->canonChothNum;
+   data->map            = map;
+   data->mapSize        = (size_t)info.st_size;
+   data->kabchoKeys     = NULL;
+   data->kernel         = NULL;
+   data->tree           = NULL;
+   
+   table->nClass        = header->nClass;
+   table->nKey          = header->nKey;
+   table->nStrings      = header->nStrings;
+   table->nCandidate    = header->nCandidate;
+   table->nLink         = header->nLink;
+   table->maxLength     = header->maxLength;
+   table->classes       = (CANONCLASS *)(map + offset[0]);
+   table->candidates    = (CANDIDATE *)(map + offset[1]);
+   table->buckets       = (BUCKET *)(map + offset[2]);
+   table->keyResid      = (int *)(map + offset[3]);
+   table->keyLabel      = (int *)(map + offset[4]);
+   table->keyTypes      = (int *)(map + offset[5]);
+   table->keyAllowed    = (unsigned int *)(map + offset[6]);
+   table->links         = (int *)(map + offset[7]);
+   table->strings       = (char *)(map + offset[8]);
+   table->keyWeight     = (float *)(map + offset[9]);
+
+   for(i=0; i<NKERNELARRAY; i++)
+      arrays[i] = map + offset[NTABLESECTION + i];
+   if(((data->kernel = MapMatchKernel(arrays, header->kernelMaxKeys))
+       == NULL) ||
+      ((data->kabchoKeys = MapKeyTrans(&(header->kabcho), map, 
+                                       offset + NTABLESECTION + 
+                                       NKERNELARRAY)) == NULL))
+   {
+      FreeMatchKernel(data->kernel);
+      data->kernel = NULL;
+      data->map    = NULL;
+      munmap(map, (size_t)info.st_size);
+      return(FALSE);
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>KEYTRANS *MapKeyTrans(KEYTRANSINFO *info, unsigned char *map,
+                         size_t *offset)
+   -------------------------------------------------------------
+   Input:   KEYTRANSINFO  *info    Sizes and fields of the KEYTRANS
+            unsigned char *map     Mapped compiled data file
+            size_t        *offset  Offsets of the arrays of the KEYTRANS
+   Returns: KEYTRANS      *        The KEYTRANS (NULL if no memory)
+
+   Makes a KEYTRANS whose arrays are in a mapped compiled data file, in
+   the order region, first, resid, label, digit, strings.
+
+   16.10.26 Original    By: ACRM
+*/
+KEYTRANS *MapKeyTrans(KEYTRANSINFO *info, unsigned char *map,
+                      size_t *offset)
+{
+   KEYTRANS *keyTrans;
+
+   if((keyTrans = (KEYTRANS *)calloc(1, sizeof(KEYTRANS)))==NULL)
+      return(NULL);
+
+   keyTrans->info    = *info;
+   keyTrans->region  = (int *)(map + offset[0]);
+   keyTrans->first   = (int *)(map + offset[1]);
+   keyTrans->resid   = (int *)(map + offset[2]);
+   keyTrans->label   = (int *)(map + offset[3]);
+   keyTrans->digit   = (int *)(map + offset[4]);
+   keyTrans->strings = (char *)(map + offset[5]);
+   keyTrans->mapped  = TRUE;
+
+   return(keyTrans);
+}
+
+
+/************************************************************************/
+/*>size_t CompiledLayout(COMPHEADER *header, size_t *offset, size_t *size)
+   ----------------------------------------------------------------------
+   Input:   COMPHEADER  *header    Header of compiled data file
+   Output:  size_t      *offset    Offset of each array in the file
+            size_t      *size      Size of each array
+   Returns: size_t                 Total size of the file
+
+   Works out where each array is placed in a compiled data file. The
+   arrays of the CANONTABLE are in the order classes, candidates, 
+   buckets, keyResid, keyLabel, keyTypes, keyAllowed, links, strings,
+   keyWeight. These are followed by the arrays of the MATCHKERNEL (see
+   MatchKernelArrays()) and of the Kabat/Chothia KEYTRANS (see
+   MapKeyTrans()).
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Adds the MATCHKERNEL and KEYTRANS
+*/
+size_t CompiledLayout(COMPHEADER *header, size_t *offset, size_t *size)
+{
+   KEYTRANSINFO *kabcho = &(header->kabcho);
+   size_t       pos;
+   int          t = NTABLESECTION + NKERNELARRAY,
+                i;
+
+   if((header->nClass < 0) || (header->nKey < 0) || 
+      (header->nStrings < 0) || (header->nCandidate < 0) ||
+      (header->nLink < 0) || (header->maxLength < 0) ||
+      (kabcho->nKey != header->nKey) || (kabcho->nEntries < 0) || 
+      (kabcho->nDigits < 0) || (kabcho->nStrings < 0))
+      return(0);
+   for(i=0; i<NKERNELARRAY; i++)
+   {
+      if(header->kernelSize[i] < 0)
+         return(0);
+      size[NTABLESECTION + i] = (size_t)header->kernelSize[i];
+   }
+   
+   size[0] = header->nClass     * sizeof(CANONCLASS);
+   size[1] = header->nCandidate * sizeof(CANDIDATE);
+   size[2] = NLOOPDEF * (header->maxLength + 1) * sizeof(BUCKET);
+   size[3] = header->nKey       * sizeof(int);
+   size[4] = header->nKey       * sizeof(int);
+   size[5] = header->nKey       * sizeof(int);
+   size[6] = header->nKey       * sizeof(unsigned int);
+   size[7] = header->nLink      * sizeof(int);
+   size[8] = header->nStrings;
+   size[9] = header->nKey       * sizeof(float);
+
+   size[t]   = kabcho->nKey     * sizeof(int);
+   size[t+1] = kabcho->nKey     * sizeof(int);
+   size[t+2] = kabcho->nEntries * sizeof(int);
+   size[t+3] = kabcho->nEntries * sizeof(int);
+   size[t+4] = kabcho->nDigits  * sizeof(int);
+   size[t+5] = kabcho->nStrings;
+
+   pos = COMPALIGN(sizeof(COMPHEADER));
+   for(i=0; i<NCOMPSECTION; i++)
+   {
+      offset[i] = pos;
+      pos = COMPALIGN(pos + size[i]);
+   }
+   return(pos);
+}
+
+
+/************************************************************************/
+/*>unsigned int Checksum(unsigned char *buffer, size_t length)
+   ----------------------------------------------------------
+   Input:   unsigned char *buffer  Data
+            size_t        length   Length of data
+   Returns: unsigned int           Checksum (32-bit FNV-1a hash)
+
+   16.10.26 Original    By: ACRM
+*/
+unsigned int Checksum(unsigned char *buffer, size_t length)
+{
+   unsigned int hash = 2166136261U;
+   size_t       i;
+
+   for(i=0; i<length; i++)
+   {
+      hash ^= buffer[i];
+      hash *= 16777619U;
+   }
+   return(hash);
+}
+
+
+/************************************************************************/
+/*>int LoopIndex(char *LoopID)
+   ---------------------------
+   Input:   char  *LoopID     Loop name (e.g. L1)
+   Returns: int               Offset into sLoopDef[] (-1 if not found)
+
+   16.10.26 Original    By: ACRM
+*/
+int LoopIndex(char *LoopID)
+{
+   int i;
+   
+   for(i=0; i<NLOOPDEF; i++)
+   {
+      if(!strcmp(LoopID, sLoopDef[i].name))
+         return(i);
+   }
+   return(-1);
+}
+
+
+/************************************************************************/
+/*>BOOL ParseLoopLength(char *word, int *length, int *maxLength)
+   -------------------------------------------------------------
+   Input:   char  *word       Loop length from a LOOP line
+   Output:  int   *length     Shortest loop length
+            int   *maxLength  Longest loop length
+   Returns: BOOL              Valid length?
+
+   Parses the length of a class. This is a single length (e.g. 10), a 
+   range (e.g. 9-14), a range with no upper limit (e.g. 15-) or * for 
+   any length. Ranges with no upper limit extend to MAXLOOPLEN.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL ParseLoopLength(char *word, int *length, int *maxLength)
+{
+   char *chp,
+        *start;
+   
+   if(!strcmp(word, "*"))
+   {
+      *length    = 0;
+      *maxLength = MAXLOOPLEN;
+      return(TRUE);
+   }
+   
+   *length = *maxLength = (int)strtol(word, &chp, 10);
+   if((chp == word) || (*length < 0))
+      return(FALSE);
+
+   if(*chp == '-')
+   {
+      start = ++chp;
+      if(*chp == '\0')
+      {
+         *maxLength = MAXLOOPLEN;
+      }
+      else
+      {
+         *maxLength = (int)strtol(start, &chp, 10);
+         if(chp == start)
+            return(FALSE);
+      }
+   }
+   
+   return((*chp == '\0') && (*maxLength >= *length));
+}
+
+
+/************************************************************************/
+/*>BOOL GrowSequence(SEQUENCE **Sequence, int *maxRes, int NRes)
+   -------------------------------------------------------------
+   I/O:     SEQUENCE **Sequence   Sequence array (may be NULL)
+            int      *maxRes      Allocated size of sequence array
+   Input:   int      NRes         Number of residues it must hold
+   Returns: BOOL                  Success?
+
+   Makes sure a sequence array allocated with malloc() can hold NRes
+   residues. It is at least doubled when grown, so an array reused for
+   many sequences is soon large enough for all of them.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL GrowSequence(SEQUENCE **Sequence, int *maxRes, int NRes)
+{
+   SEQUENCE *grown;
+   int      newMax;
+
+   if(NRes <= *maxRes)
+      return(TRUE);
+   
+   newMax = (*maxRes < MAXEXPSEQ) ? MAXEXPSEQ : 2 * (*maxRes);
+   if(newMax < NRes)
+      newMax = NRes;
+   
+   if((grown = (SEQUENCE *)realloc(*Sequence, newMax * sizeof(SEQUENCE)))
+      ==NULL)
+   {
+      fprintf(stderr,"Error (chothia): No memory for sequence of %d \
+residues\n", NRes);
+      return(FALSE);
+   }
+
+   *Sequence = grown;
+   *maxRes   = newMax;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int ReadInputData(FILE *in, SEQUENCE **Sequence, int *maxRes)
+   -------------------------------------------------------------
+   Input:   FILE     *in          Input data file pointer
+   I/O:     SEQUENCE **Sequence   Sequence array, grown as needed by 
+                                  GrowSequence() (may be NULL)
+            int      *maxRes      Allocated size of sequence array
+   Returns: int                   Length of sequence
+
+   Reads a numbered sequence. If the file contains several records as
+   read by ReadInputRecord(), only the first is read: an ID line or a
+   // line after the first residue ends the sequence.
+
+   16.05.95 Original    By: ACRM
+   19.12.08 Changed strcpy() to strncpy()
+            Changed word[16] to word[MAXWORD]
+            New GetWord()
+            Checks number of residues in file
+            Added check on residue names of '-'
+   14.12.16 Changed to blGetWord()
+   16.10.26 Line parsing moved out to ParseResidueLine()
+            The sequence array is grown rather than limited to MAXSEQ
+   16.10.26 Stops at the end of the first record
+*/
+int ReadInputData(FILE *in, SEQUENCE **Sequence, int *maxRes)
+{
+   char buffer[MAXBUFF];
+   int  count = 0,
+        ok;
+   
+   while(fgets(buffer, MAXBUFF, in))
+   {
+      TERMINATE(buffer);  /* 13.02.14 Added this                        */
+      TERMINATECR(buffer);/* 14.12.16 Added this                        */
+
+      if((count > 0) && 
+         ((buffer[0] == '>') || !strncmp(buffer, "//", 2)))
+         break;
+
+      if(!GrowSequence(Sequence, maxRes, count+1))
+         return(0);
+      if((ok = ParseResidueLine(buffer, *Sequence, count)) < 0)
+         return(0);
+      count += ok;
+   }
+
+   if(count > MAXEXPSEQ)
+   {
+      fprintf(stderr,"Warning (chothia): %d residues in input file. \
+Expect <%d. Maybe two antibodies?\n", count, MAXEXPSEQ);
+   }
+   
+   return(count);
+}
+
+
+/************************************************************************/
+/*>int ReadInputRecord(FILE *in, SEQUENCE **Sequence, int *maxRes,
+                       char *id, char *nextID)
+   ---------------------------------------------------------------
+   Input:   FILE     *in          Input data file pointer
+   I/O:     SEQUENCE **Sequence   Sequence array, grown as needed by 
+                                  GrowSequence() (may be NULL)
+            int      *maxRes      Allocated size of sequence array
+   Output:  char     *id          Record ID (blank if none given)
+   I/O:     char     *nextID      ID line read ahead from the following
+                                  record (blank if none)
+   Returns: int                   Length of sequence
+                                  0 if the record was empty or in error
+                                  -1 if there are no more records
+
+   Reads one record from a batch input file. Records are of the same
+   form as the input to ReadInputData(), but may be preceeded by an
+   ID line of the form
+      >id
+   and/or terminated by a line containing //. Reading the ID line of 
+   the following record also terminates a record; that ID is returned
+   in nextID and must be passed back in on the next call. An error in
+   a record causes the rest of that record to be skipped. The same
+   sequence array should be passed for each record, so it is only
+   grown for a record longer than any before.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 The sequence array is grown rather than limited to MAXSEQ
+*/
+int ReadInputRecord(FILE *in, SEQUENCE **Sequence, int *maxRes, 
+                    char *id, char *nextID)
+{
+   char buffer[MAXBUFF],
+        word[MAXBUFF];
+   int  count     = 0,
+        ok;
+   BOOL gotRecord = FALSE,
+        inError   = FALSE;
+
+   id[0] = '\0';
+   if(nextID[0])
+   {
+      strncpy(id, nextID, MAXBUFF);
+      nextID[0] = '\0';
+      gotRecord = TRUE;
+   }
+   
+   while(fgets(buffer, MAXBUFF, in))
+   {
+      TERMINATE(buffer);
+      TERMINATECR(buffer);
+
+      if(buffer[0] == '>')
+      {
+         /* Start of the next record                                    */
+         blGetWord(buffer+1, word, MAXBUFF);
+         if(gotRecord)
+         {
+            strncpy(nextID, word, MAXBUFF);
+            break;
+         }
+         strncpy(id, word, MAXBUFF);
+         gotRecord = TRUE;
+      }
+      else if(!strncmp(buffer, "//", 2))
+      {
+         /* End of this record; ignore empty records                    */
+         if(gotRecord)
+            break;
+      }
+      else if(!inError)
+      {
+         if(!GrowSequence(Sequence, maxRes, count+1) ||
+            ((ok = ParseResidueLine(buffer, *Sequence, count)) < 0))
+         {
+            inError = TRUE;
+         }
+         else if(ok)
+         {
+            gotRecord = TRUE;
+            count++;
+         }
+      }
+   }
+
+   if(!gotRecord)
+      return(-1);
+
+   if(inError)
+      return(0);
+   
+   if(count > MAXEXPSEQ)
+   {
+      fprintf(stderr,"Warning (chothia): %d residues in record %s. \
+Expect <%d. Maybe two antibodies?\n", count, id, MAXEXPSEQ);
+   }
+
+   return(count);
+}
+
+
+/************************************************************************/
+/*>int ParseResidueLine(char *buffer, SEQUENCE *Sequence, int count)
+   -----------------------------------------------------------------
+   Input:   char     *buffer      Line from the input file
+            int      count        Offset at which to store the residue
+   Output:  SEQUENCE *Sequence    Sequence array
+   Returns: int                   1 if a residue was stored
+                                  0 if the line was ignored
+                                  -1 if the line was in error
+
+   Parses a residue line of the form `L24 A' or `L24 ALA'. Lines which
+   do not start with a chain label and residue number are ignored as
+   are deleted residues (`-').
+
+   16.10.26 Extracted from ReadInputData()   By: ACRM
+*/
+int ParseResidueLine(char *buffer, SEQUENCE *Sequence, int count)
+{
+   char word[MAXWORD],
+        *chp;
+
+   if((buffer[0] == 'L' || buffer[0] == 'H') &&
+      isdigit(buffer[1]))
+   {
+      chp = blGetWord(buffer, word, MAXWORD);
+      strncpy(Sequence[count].resnum, word, SMALLWORD);
+      
+      chp = blGetWord(chp, word, MAXWORD);
+      if(strlen(word) == 0)
+         return(-1);
+      
+      if(word[0] != '-')
+      {
+         if(strlen(word) == 3)
+         {
+            Sequence[count].seq = blThrone(word);
+         }
+         else if(strlen(word) == 1)
+         {
+            Sequence[count].seq = word[0];
+         }
+         else
+         {
+            fprintf(stderr,"Warning (chothia): illegal residue name: \
+%s\n", word);
+            fprintf(stderr,"                   residue ignored.\n");
+            return(0);
+         }
+         return(1);
+      }
+   }
+   return(0);
+}
+
+
+/************************************************************************/
+/*>void ClassifySequence(CANONCONTEXT *ctx, SEQUENCE *Sequence, 
+                         int NRes, RESINDEX *index, 
+                         CANONRESULTS *results)
+   ---------------------------------------------------------------
+   Input:   CANONCONTEXT *ctx      Canonical definitions and options
+                                   (including chain to handle; both
+                                   if eq ' ')
+            SEQUENCE     *Sequence Sequence array
+            int          NRes      Length of sequence
+            RESINDEX     *index    Index of the sequence array
+   Output:  CANONRESULTS *results  Canonical classes assigned
+
+   Assigns the canonical classes for the loops of the chain(s) being
+   handled. Calls ClassifyLoop() to do the work.
+
+   16.05.95 Original    By: ACRM
+   18.08.95 No longer fails if unable to find a residue; just reports the
+            fact. Now returns void.
+   08.05.96 Modified to determine length of CDR1 in each chain and pass
+            it to the ReportACanonical() routine
+   19.12.08 Changed strcpy() to strncpy()
+   09.08.15 Added chain handling
+   16.10.26 Options now passed in a CANONCONTEXT
+            Takes the sequence index
+            Loop definitions moved out to sLoopDef[]
+            Renamed from ReportCanonicals() and fills in a CANONRESULTS
+            rather than printing. CDR1 is blank until it has been found
+            Finds the ends of all the CDRs before classifying them so
+            that key residues are translated using the length of the
+            CDR in whose region they lie
+            Handles CDR-H3 if the data file has H3 classes
+            Finding the CDRs split out to FindCDRs()
+            Counts the results if there is a CANONSTATS
+*/
+void ClassifySequence(CANONCONTEXT *ctx, SEQUENCE *Sequence, int NRes,
+                      RESINDEX *index, CANONRESULTS *results)
+{
+   int         loop,
+               start[NLOOPDEF],
+               stop[NLOOPDEF];
+   SEQTRANS    seqTrans;
+
+   FindCDRs(ctx, Sequence, NRes, index, &seqTrans, start, stop, results);
+
+   for(loop=results->firstCDR; loop<results->lastCDR; loop++)
+   {
+      if((start[loop] != (-1)) && (stop[loop] != (-1)))
+         ClassifyLoop(ctx, loop, seqTrans.loopLen[loop], Sequence, NRes,
+                      index, &seqTrans, &(results->cdr[loop]));
+   }
+
+   if(ctx->stats != NULL)
+      CountResults(ctx, results);
+}
+
+
+/************************************************************************/
+/*>void FindCDRs(CANONCONTEXT *ctx, SEQUENCE *Sequence, int NRes,
+                 RESINDEX *index, SEQTRANS *seqTrans, int *start,
+                 int *stop, CANONRESULTS *results)
+   --------------------------------------------------------------
+   Input:   CANONCONTEXT *ctx      Canonical definitions and options
+            SEQUENCE     *Sequence Sequence array
+            int          NRes      Length of sequence
+            RESINDEX     *index    Index of the sequence array
+   Output:  SEQTRANS     *seqTrans Translation to the numbering of the
+                                   sequence with the CDR lengths
+            int          *start    Offset of the start and stop of 
+            int          *stop     each CDR (NLOOPDEF; -1 if not found)
+            CANONRESULTS *results  The CDRs to be processed, with those
+                                   whose ends were not found marked as
+                                   CANON_MISSING
+
+   Finds the ends and lengths of the CDRs of the chain(s) being handled
+   and labels the results with the method of the context
+
+   16.10.26 Split from ClassifySequence()   By: ACRM
+   16.10.26 Sets the method
+   16.10.26 The translation context is found with KeyTransContext()
+*/
+void FindCDRs(CANONCONTEXT *ctx, SEQUENCE *Sequence, int NRes,
+              RESINDEX *index, SEQTRANS *seqTrans, int *start,
+              int *stop, CANONRESULTS *results)
+{
+   int         loop;
+   CANONRESULT *result;
+   LOOP        *LoopDef = sLoopDef;
+
+   results->chothiaNumbering = ctx->data->canonChothNum;
+   results->method           = ctx->method;
+   
+   /* Default to all CDRs (H3 only if there are H3 classes)            */
+   results->firstCDR = 0;
+   results->lastCDR  = ctx->data->nCDR;
+   
+   /* Update it we have specified to do only one chain                  */
+   if(ctx->chain == 'L')
+   {
+      results->firstCDR = 0;
+      results->lastCDR  = 3;
+   }
+   else if(ctx->chain == 'H')
+   {
+      results->firstCDR = 3;
+      results->lastCDR  = ctx->data->nCDR;
+   }
+
+   /* Find the ends and lengths of the CDRs                           */
+   SetSeqTrans(ctx, seqTrans);
+   for(loop=0; loop<NLOOPDEF; loop++)
+   {
+      start[loop] = stop[loop] = (-1);
+      seqTrans->loopLen[loop]  = 0;
+   }
+   for(loop=results->firstCDR; loop<results->lastCDR; loop++)
+   {
+      if(((start[loop] = FindLoopEnd(Sequence, NRes, index, seqTrans,
+                                     loop, 0)) != (-1)) &&
+         ((stop[loop]  = FindLoopEnd(Sequence, NRes, index, seqTrans,
+                                     loop, 1)) != (-1)))
+      {
+         seqTrans->loopLen[loop] = 1 + stop[loop] - start[loop];
+      }
+   }
+
+   /* Key residues are translated using the CDR lengths, so the cached
+      result for a loop also depends on these
+   */
+   seqTrans->context = 0;
+   if((seqTrans->trans != NULL) &&
+      ((seqTrans->context = KeyTransContext(seqTrans->trans,
+                                            seqTrans->loopLen)) >= 0))
+      seqTrans->context++;
+
+   for(loop=results->firstCDR; loop<results->lastCDR; loop++)
+   {
+      result = &(results->cdr[loop]);
+      
+      if((start[loop] == (-1)) || (stop[loop] == (-1)))
+      {
+         result->loop    = LoopDef[loop].name;
+         result->status  = CANON_MISSING;
+         result->missing = ((start[loop] == (-1)) ? LoopDef[loop].start :
+                            LoopDef[loop].stop);
+         result->nRanked = (-1);
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>void ClassifyBlock(CANONCONTEXT *ctx, SEQUENCE **Sequences, int *NRes,
+                      RESINDEX *index, int nSeq, CANONRESULTS *results)
+   ----------------------------------------------------------------------
+   Input:   CANONCONTEXT *ctx        Canonical definitions and options
+            SEQUENCE     **Sequences Sequence arrays
+            int          *NRes       Length of each sequence
+            RESINDEX     *index      Index of each sequence (array)
+            int          nSeq        Number of sequences (up to 
+                                     BLOCKSEQS)
+   Output:  CANONRESULTS *results    Canonical classes assigned to each
+                                     sequence (array)
+
+   Assigns the canonical classes for a block of sequences, giving 
+   exactly the results of ClassifySequence() for each. For each CDR, 
+   the sequences with loops of the same length are tested against the
+   classes of that length together with CountBlockMismatches(). Loops
+   which cannot be tested in this way, and all loops if classes are
+   to be ranked or the engine is ENGINE_TREE, are classified one 
+   sequence at a time.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Counts the results if there is a CANONSTATS
+            Classifies one sequence at a time with ENGINE_TREE
+*/
+void ClassifyBlock(CANONCONTEXT *ctx, SEQUENCE **Sequences, int *NRes,
+                   RESINDEX *index, int nSeq, CANONRESULTS *results)
+{
+   CANONTABLE    *table = &(ctx->data->table);
+   SEQTRANS      seqTrans[BLOCKSEQS];
+   unsigned long pending,
+                 group;
+   int           start[BLOCKSEQS][NLOOPDEF],
+                 stop[BLOCKSEQS][NLOOPDEF],
+                 bucket[BLOCKSEQS],
+                 loop,
+                 len,
+                 s, t;
+
+   if((ctx->topK > 0) || (ctx->engine == ENGINE_TREE) ||
+      (ctx->data->kernel == NULL))
+   {
+      for(s=0; s<nSeq; s++)
+         ClassifySequence(ctx, Sequences[s], NRes[s], &(index[s]),
+                          &(results[s]));
+      return;
+   }
+
+   for(s=0; s<nSeq; s++)
+      FindCDRs(ctx, Sequences[s], NRes[s], &(index[s]), &(seqTrans[s]),
+               start[s], stop[s], &(results[s]));
+
+   /* The CDRs processed only depend on the chain so are the same for
+      all the sequences
+   */
+   for(loop=results[0].firstCDR; 
+       (nSeq > 0) && (loop < results[0].lastCDR); 
+       loop++)
+   {
+      /* Find the bucket of candidates for each sequence. Those which
+         cannot be tested with the others are classified alone
+      */
+      pending = 0UL;
+      for(s=0; s<nSeq; s++)
+      {
+         if((start[s][loop] == (-1)) || (stop[s][loop] == (-1)))
+            continue;
+         
+         len       = seqTrans[s].loopLen[loop];
+         bucket[s] = (loop * (table->maxLength+1)) + len;
+         if((len >= 0) && (len <= table->maxLength) &&
+            MatchKernelUsable(ctx->data->kernel, bucket[s]))
+            pending |= (1UL << s);
+         else
+            ClassifyLoop(ctx, loop, len, Sequences[s], NRes[s],
+                         &(index[s]), &(seqTrans[s]),
+                         &(results[s].cdr[loop]));
+      }
+
+      /* Test the sequences of each bucket together                     */
+      for(s=0; pending; s++)
+      {
+         if(!(pending & (1UL << s)))
+            continue;
+         
+         group = 0UL;
+         for(t=s; t<nSeq; t++)
+         {
+            if((pending & (1UL << t)) && (bucket[t] == bucket[s]))
+               group |= (1UL << t);
+         }
+         pending &= ~group;
+
+         ClassifyLoopBlock(ctx, loop, bucket[s], group, Sequences, NRes,
+                           index, seqTrans, results);
+      }
+   }
+
+   for(s=0; (ctx->stats != NULL) && (s < nSeq); s++)
+      CountResults(ctx, &(results[s]));
+}
+
+
+/************************************************************************/
+/*>void ClassifyLoopBlock(CANONCONTEXT *ctx, int loop, int b,
+                          unsigned long group, SEQUENCE **Sequences,
+                          int *NRes, RESINDEX *index, 
+                          SEQTRANS *seqTrans, CANONRESULTS *results)
+   -----------------------------------------------------------------
+   Input:   CANONCONTEXT  *ctx        Canonical definitions and options
+            int           loop        The loop (offset into sLoopDef[])
+            int           b           Bucket of candidates for the loop
+                                      and its length
+            unsigned long group       Bit set for each sequence of the
+                                      block with a loop of this length
+            SEQUENCE      **Sequences Sequence arrays
+            int           *NRes       Length of each sequence
+            RESINDEX      *index      Index of each sequence
+            SEQTRANS      *seqTrans   Translation to the numbering of
+                                      each sequence
+   I/O:     CANONRESULTS  *results    Results of each sequence, with 
+                                      this loop filled in for the group
+
+   Assigns the canonical class for a loop of a group of sequences with
+   the same loop length. Loops whose residues at the key positions are
+   in the cache are given the cached result. The mismatches of every
+   other sequence against every class of the candidates are counted 
+   together. The candidates are
+   then resolved as in ClassifyLoop(), but a class at a time for all 
+   the sequences: in candidate and priority order, each class is 
+   assigned to the sequences not yet assigned which match it exactly.
+   Any sequence left is given the candidate with fewest mismatches 
+   against the lowest priority class of its chain. The results of the
+   loops classified are added to the cache.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Counts the classes tested if there is a CANONSTATS
+   16.10.26 Uses the CANONCACHE
+*/
+void ClassifyLoopBlock(CANONCONTEXT *ctx, int loop, int b,
+                       unsigned long group, SEQUENCE **Sequences,
+                       int *NRes, RESINDEX *index, SEQTRANS *seqTrans,
+                       CANONRESULTS *results)
+{
+   CANONTABLE    *table   = &(ctx->data->table);
+   CANONCLASS    *classes = table->classes,
+                 *best;
+   BUCKET        *bucket  = &(table->buckets[b]);
+   CANDIDATE     *cand;
+   unsigned int  observed[MAXMATCHKEYS * BLOCKSEQS];
+   unsigned long planes[MAXMATCHLANES * MATCHPLANES],
+                 unmatched,
+                 matched,
+                 found;
+   char          prints[BLOCKSEQS][MAXMATCHKEYS],
+                 *fingerprint = NULL;
+   int           member[BLOCKSEQS],
+                 classNum[BLOCKSEQS],
+                 *keys,
+                 nKeys,
+                 nMember   = 0,
+                 nGroup,
+                 status,
+                 firstLink = table->candidates[bucket->first].firstLink,
+                 lastLink,
+                 link,
+                 count,
+                 MinMismatch,
+                 res,
+                 pos,
+                 i, s;
+
+   for(s=0; s<BLOCKSEQS; s++)
+   {
+      if(group & (1UL << s))
+      {
+         member[nMember++] = s;
+         InitLoopResult(ctx, loop, seqTrans[s].loopLen[loop],
+                        &(results[s].cdr[loop]));
+      }
+   }
+
+   /* Find the residue at each key position of each sequence. Those
+      found in the cache are assigned and removed from the members
+   */
+   keys   = MatchKernelKeys(ctx->data->kernel, b, &nKeys);
+   if(ctx->cache != NULL)
+      CanonCacheKeys(ctx->cache, b, &nKeys, &fingerprint);
+   nGroup  = nMember;
+   nMember = 0;
+   for(i=0; i<nGroup; i++)
+   {
+      s = member[i];
+      for(pos=0; pos<nKeys; pos++)
+      {
+         res = FindKeyRes(ctx, keys[pos], Sequences[s], NRes[s],
+                          &(index[s]), &(seqTrans[s]));
+         prints[nMember][pos] = ((res == (-1)) ? '\0' : 
+                                 Sequences[s][res].seq);
+         observed[pos*BLOCKSEQS + nMember] = 
+            ((res == (-1)) ? MATCH_MISSING : 
+             RESBIT(Sequences[s][res].seq));
+      }
+
+      if((fingerprint != NULL) && (seqTrans[s].context >= 0))
+      {
+         memcpy(fingerprint, prints[nMember], nKeys);
+         if(LookupCanonCache(ctx->cache, b, seqTrans[s].context, 
+                             &status, &(classNum[nMember])))
+         {
+            SetLoopResult(ctx, (classNum[nMember] < 0) ? NULL :
+                          &(classes[classNum[nMember]]),
+                          (status == CANON_MATCH), Sequences[s], 
+                          NRes[s], &(index[s]), &(seqTrans[s]),
+                          &(results[s].cdr[loop]));
+            continue;
+         }
+      }
+      member[nMember++] = s;
+   }
+   if(nMember == 0)
+      return;
+
+   CountBlockMismatches(ctx->data->kernel, b, observed, nMember, planes);
+   if(ctx->stats != NULL)
+   {
+      cand = &(table->candidates[bucket->first + bucket->n - 1]);
+      ctx->stats->kernelLoops[loop]   += nMember;
+      ctx->stats->classesTested[loop] += (unsigned long)nMember *
+         (cand->firstLink + cand->nLink - firstLink);
+   }
+
+   /* Assign each class to the sequences it is the first to match       */
+   unmatched = (nMember >= BLOCKSEQS) ? ~0UL : ((1UL << nMember) - 1UL);
+   for(i=0; unmatched && (i < bucket->n); i++)
+   {
+      cand     = &(table->candidates[bucket->first + i]);
+      lastLink = cand->firstLink + cand->nLink;
+      for(link=cand->firstLink; link<lastLink; link++)
+      {
+         found      = unmatched & 
+                      BlockMatches(planes, link - firstLink, nMember);
+         unmatched &= ~found;
+         for(s=0; found; s++, found >>= 1)
+         {
+            if(found & 1UL)
+            {
+               classNum[s] = table->links[link];
+               SetLoopResult(ctx, &(classes[classNum[s]]), TRUE,
+                             Sequences[member[s]], NRes[member[s]],
+                             &(index[member[s]]), 
+                             &(seqTrans[member[s]]),
+                             &(results[member[s]].cdr[loop]));
+            }
+         }
+      }
+   }
+
+   /* The rest are given the nearest candidate. As in ClassifyLoop(),
+      mismatches are only counted against the lowest priority class of
+      a chain
+   */
+   matched = ~unmatched;
+   for(s=0; unmatched; s++, unmatched >>= 1)
+   {
+      if(!(unmatched & 1UL))
+         continue;
+
+      best        = NULL;
+      MinMismatch = 10000;
+      for(i=0; i<bucket->n; i++)
+      {
+         cand  = &(table->candidates[bucket->first + i]);
+         count = BlockMismatches(planes, 
+                                 cand->firstLink + cand->nLink - 1 -
+                                 firstLink, s);
+         if(count < MinMismatch)
+         {
+            MinMismatch = count;
+            best        = &(classes[cand->reportAs]);
+         }
+      }
+      classNum[s] = (best == NULL) ? (-1) : (int)(best - classes);
+      SetLoopResult(ctx, best, FALSE, Sequences[member[s]], 
+                    NRes[member[s]], &(index[member[s]]), 
+                    &(seqTrans[member[s]]), 
+                    &(results[member[s]].cdr[loop]));
+   }
+
+   for(s=0; (fingerprint != NULL) && (s < nMember); s++)
+   {
+      if(seqTrans[member[s]].context >= 0)
+         StoreCanonCacheKey(ctx->cache, b, seqTrans[member[s]].context,
+                            prints[s], 
+                            ((matched >> s) & 1UL) ? CANON_MATCH : 
+                            CANON_NOMATCH,
+                            classNum[s]);
+   }
+}
+
+
+/************************************************************************/
+/*>void CountResults(CANONCONTEXT *ctx, CANONRESULTS *results)
+   -----------------------------------------------------------
+   Input:   CANONCONTEXT *ctx      Canonical definitions and options,
+                                   with a CANONSTATS
+            CANONRESULTS *results  Canonical classes assigned
+
+   Counts the loops of a sequence which were missing, classified and
+   assigned a class
+
+   16.10.26 Original    By: ACRM
+*/
+void CountResults(CANONCONTEXT *ctx, CANONRESULTS *results)
+{
+   int loop;
+
+   for(loop=results->firstCDR; loop<results->lastCDR; loop++)
+   {
+      if(results->cdr[loop].status == CANON_MISSING)
+      {
+         ctx->stats->missing[loop]++;
+      }
+      else
+      {
+         ctx->stats->loops[loop]++;
+         if(results->cdr[loop].status == CANON_MATCH)
+            ctx->stats->matched[loop]++;
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>void PrintCanonResults(FILE *out, CANONRESULTS *results, BOOL verbose)
+   ----------------------------------------------------------------------
+   Input:   FILE         *out      Output file pointer
+            CANONRESULTS *results  Canonical classes assigned
+            BOOL         verbose   Show source of classes and reasons
+                                   for mismatches
+
+   Prints the canonical classes assigned by ClassifySequence(). A 
+   warning is given on stderr for each loop with missing residues.
+
+   16.05.95 Original    By: ACRM
+   17.05.95 Only prints source data if verbose
+   30.05.96 Mismatches report numbering scheme in data file
+            Reports deleted residues
+   16.10.26 Separated from assigning the classes in ReportCanonicals()
+            and ReportACanonical()
+            Prints the ranked classes
+*/
+void PrintCanonResults(FILE *out, CANONRESULTS *results, BOOL verbose)
+{
+   CANONRESULT   *result;
+   CANONMISMATCH *mismatch;
+   char          *numbering = (results->chothiaNumbering ? 
+                               "Chothia" : "Kabat");
+   int           loop,
+                 i;
+
+   for(loop=results->firstCDR; loop<results->lastCDR; loop++)
+   {
+      result = &(results->cdr[loop]);
+
+      if(result->status == CANON_MISSING)
+      {
+         fprintf(stderr,"Warning (chothia): Unable to find residue %s \
+in input\n", result->missing);
+         fprintf(out,"CDR %s  Missing Residues\n", result->loop);
+      }
+      else if(result->status == CANON_MATCH)
+      {
+         fprintf(out,"CDR %s  Class %-3s", result->loop, 
+                 result->className);
+         if(verbose && strlen(result->source))
+            fprintf(out," %s", result->source);
+         fprintf(out,"\n");
+      }
+      else
+      {
+         fprintf(out,"CDR %s  Class ?  \n", result->loop); 
+   
+         if(verbose)
+         {
+            if(result->similar == NULL)
+            {
+               fprintf(out, "! No canonical of the same loop length\n");
+            }
+            else
+            {
+               fprintf(out, "! Similar to class %s, but:\n", 
+                       result->similar);
+
+               /* Display each mismatch for this canonical definition   */
+               for(i=0; i<result->nMismatch; i++)
+               {
+                  mismatch = &(result->mismatch[i]);
+                  if(mismatch->found == '\0')
+                  {
+                     fprintf(out, "!    %s (%s Numbering) is deleted.\n",
+                             mismatch->label, numbering);
+                  }
+                  else
+                  {
+                     fprintf(out, "!    %s (%s Numbering) = %c \
+(allows: %s)\n", 
+                             mismatch->label, numbering, mismatch->found,
+                             mismatch->allowed);
+                  }
+               }
+            }
+         }
+      }
+
+      if(result->nRanked > 0)
+      {
+         fprintf(out, "! Scores:");
+         for(i=0; i<result->nRanked; i++)
+            fprintf(out, " %s %.3f", result->rank[i].className,
+                    result->rank[i].score);
+         fprintf(out, "\n");
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>void ReportCanonicals(FILE *out, CANONCONTEXT *ctx, 
+                         SEQUENCE *Sequence, int NRes, RESINDEX *index)
+   ---------------------------------------------------------------------
+   Input:   FILE         *out      Output file pointer
+            CANONCONTEXT *ctx      Canonical definitions and options
+            SEQUENCE     *Sequence Sequence array
+            int          NRes      Length of sequence
+            RESINDEX     *index    Index of the sequence array
+
+   Assigns and prints the canonical classes for a sequence.
+
+   16.10.26 Original - replaces the previous ReportCanonicals() which is
+            now ClassifySequence()   By: ACRM
+*/
+void ReportCanonicals(FILE *out, CANONCONTEXT *ctx, SEQUENCE *Sequence, 
+                      int NRes, RESINDEX *index)
+{
+   CANONRESULTS results;
+
+   ClassifySequence(ctx, Sequence, NRes, index, &results);
+   PrintCanonResults(out, &results, ctx->verbose);
+}
+
+
+/************************************************************************/
+/*>void ReportCanonicalRecord(FILE *out, CANONCONTEXT *ctx, char *id,
+                              SEQUENCE *Sequence, int NRes, 
+                              RESINDEX *index)
+   ------------------------------------------------------------------
+   Input:   FILE         *out      Output file pointer
+            CANONCONTEXT *ctx      Canonical definitions and options
+            char         *id       ID of the record (or NULL)
+            SEQUENCE     *Sequence Sequence array
+            int          NRes      Length of sequence
+            RESINDEX     *index    Index of the sequence array
+
+   Assigns and prints the canonical classes for one record of a batch
+   in the output format given in the CANONCONTEXT. In text format, the
+   output is started with a >id line and terminated with a // line 
+   unless the id is NULL. In JSON and TSV formats, each record is a 
+   single line.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Printing split out to PrintCanonRecord()
+*/
+void ReportCanonicalRecord(FILE *out, CANONCONTEXT *ctx, char *id,
+                           SEQUENCE *Sequence, int NRes, RESINDEX *index)
+{
+   CANONRESULTS results;
+
+   ClassifySequence(ctx, Sequence, NRes, index, &results);
+   PrintCanonRecord(out, ctx, id, 0, &results);
+}
+
+
+/************************************************************************/
+/*>void PrintCanonRecord(FILE *out, CANONCONTEXT *ctx, char *id, 
+                         int count, CANONRESULTS *results)
+   -----------------------------------------------------------
+   Input:   FILE         *out      Output file pointer
+            CANONCONTEXT *ctx      Canonical definitions and options
+            char         *id       ID of the record (or NULL)
+            int          count     Number of records with this sequence
+                                   (0 if not to be given)
+            CANONRESULTS *results  Canonical classes assigned
+
+   Prints the canonical classes assigned to one record of a batch as
+   for ReportCanonicalRecord(). If a count is given, it follows the
+   >id line in text format as a line of the form Count n, and is also
+   given in JSON and TSV formats. If the results are labelled with a
+   method (because several sets of definitions are being used), a line
+   of the form Method name then follows in text format.
+
+   16.10.26 Original - split from ReportCanonicalRecord()   By: ACRM
+   16.10.26 Gives the method of the results in text format
+*/
+void PrintCanonRecord(FILE *out, CANONCONTEXT *ctx, char *id, int count,
+                      CANONRESULTS *results)
+{
+   switch(ctx->format)
+   {
+   case FORMAT_JSON:
+      PrintCanonResultsJSON(out, id, count, results);
+      break;
+   case FORMAT_TSV:
+      PrintCanonResultsTSV(out, id, count, results);
+      break;
+   default:
+      if(id != NULL)
+         fprintf(out, ">%s\n", id);
+      if(count > 0)
+         fprintf(out, "Count %d\n", count);
+      if(results->method != NULL)
+         fprintf(out, "Method %s\n", results->method);
+      PrintCanonResults(out, results, ctx->verbose);
+      if(id != NULL)
+         fprintf(out, "//\n");
+      break;
+   }
+}
+
+
+/************************************************************************/
+/*>void PrintCanonResultsJSON(FILE *out, char *id, int count,
+                               CANONRESULTS *results)
+   ------------------------------------------------------------
+   Input:   FILE         *out      Output file pointer
+            char         *id       ID of the record (or NULL)
+            int          count     Number of records with this sequence
+                                   (0 if not to be given)
+            CANONRESULTS *results  Canonical classes assigned
+
+   Prints the canonical classes assigned by ClassifySequence() as a 
+   single line JSON object (JSON Lines). For example:
+
+   {"id":"4fab","numbering":"Kabat","cdrs":[
+    {"cdr":"L1","status":"nomatch","length":16,"class":null,
+     "source":null,"similar":"4/16A","mismatches":[
+      {"position":"L27D","observed":"Q","allowed":"NDS"}]},
+    {"cdr":"H1","status":"missing","missing":"H26"},...]}
+
+   status is "match", "nomatch" or "missing". observed is null for a
+   deleted residue. The mismatches are against the similar class so 
+   are only given for "nomatch". If a count is given, it follows the
+   id as "count":n. If classes were ranked, the CDR also has 
+   "ranking":[{"class":"4/16A","score":0.917},...] for all but
+   "missing". If the results are labelled with a method, this follows
+   the id (and count) as "method":"name".
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Added count
+   16.10.26 Added ranking
+   16.10.26 Added method
+*/
+void PrintCanonResultsJSON(FILE *out, char *id, int count,
+                           CANONRESULTS *results)
+{
+   CANONRESULT   *result;
+   CANONMISMATCH *mismatch;
+   int           loop,
+                 i;
+
+   fputs("{\"id\":", out);
+   PrintJSONString(out, ((id != NULL) && id[0]) ? id : NULL);
+   if(count > 0)
+      fprintf(out, ",\"count\":%d", count);
+   if(results->method != NULL)
+   {
+      fputs(",\"method\":", out);
+      PrintJSONString(out, results->method);
+   }
+   fprintf(out, ",\"numbering\":\"%s\",\"cdrs\":[",
+           results->chothiaNumbering ? "Chothia" : "Kabat");
+   
+   for(loop=results->firstCDR; loop<results->lastCDR; loop++)
+   {
+      result = &(results->cdr[loop]);
+
+      if(loop != results->firstCDR)
+         putc(',', out);
+      fputs("{\"cdr\":", out);
+      PrintJSONString(out, result->loop);
+
+      if(result->status == CANON_MISSING)
+      {
+         fputs(",\"status\":\"missing\",\"missing\":", out);
+         PrintJSONString(out, result->missing);
+         putc('}', out);
+         continue;
+      }
+
+      fprintf(out, ",\"status\":\"%s\",\"length\":%d,\"class\":",
+              (result->status == CANON_MATCH) ? "match" : "nomatch",
+              result->length);
+      PrintJSONString(out, result->className);
+      fputs(",\"source\":", out);
+      PrintJSONString(out, result->source);
+      fputs(",\"similar\":", out);
+      PrintJSONString(out, result->similar);
+      fputs(",\"mismatches\":[", out);
+
+      if(result->status == CANON_NOMATCH)
+      {
+         for(i=0; i<result->nMismatch; i++)
+         {
+            mismatch = &(result->mismatch[i]);
+            if(i)
+               putc(',', out);
+            fputs("{\"position\":", out);
+            PrintJSONString(out, mismatch->label);
+            if(mismatch->found == '\0')
+               fputs(",\"observed\":null", out);
+            else
+               fprintf(out, ",\"observed\":\"%c\"", mismatch->found);
+            fputs(",\"allowed\":", out);
+            PrintJSONString(out, mismatch->allowed);
+            putc('}', out);
+         }
+      }
+      putc(']', out);
+
+      if(result->nRanked >= 0)
+      {
+         fputs(",\"ranking\":[", out);
+         for(i=0; i<result->nRanked; i++)
+         {
+            if(i)
+               putc(',', out);
+            fputs("{\"class\":", out);
+            PrintJSONString(out, result->rank[i].className);
+            fprintf(out, ",\"score\":%.3f}", result->rank[i].score);
+         }
+         putc(']', out);
+      }
+      putc('}', out);
+   }
+
+   fputs("]}\n", out);
+}
+
+
+/************************************************************************/
+/*>void PrintJSONString(FILE *out, char *string)
+   ---------------------------------------------
+   Input:   FILE   *out      Output file pointer
+            char   *string   String to print (or NULL)
+
+   Prints a string as a quoted and escaped JSON string, or null.
+
+   16.10.26 Original    By: ACRM
+*/
+void PrintJSONString(FILE *out, char *string)
+{
+   if(string == NULL)
+   {
+      fputs("null", out);
+      return;
+   }
+
+   putc('"', out);
+   for(; *string; string++)
+   {
+      if((*string == '"') || (*string == '\\'))
+      {
+         putc('\\', out);
+         putc(*string, out);
+      }
+      else if((unsigned char)*string < ' ')
+      {
+         fprintf(out, "\\u%04x", (unsigned char)*string);
+      }
+      else
+      {
+         putc(*string, out);
+      }
+   }
+   putc('"', out);
+}
+
+
+/************************************************************************/
+/*>void PrintCanonHeaderTSV(FILE *out, BOOL count, BOOL method)
+   ------------------------------------------------------------
+   Input:   FILE   *out      Output file pointer
+            BOOL   count     Include the count column
+            BOOL   method    Include the method column
+
+   Prints the column headings for PrintCanonResultsTSV() 
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Added count
+   16.10.26 Added method
+*/
+void PrintCanonHeaderTSV(FILE *out, BOOL count, BOOL method)
+{
+   int loop;
+
+   fputs(count ? "id\tcount" : "id", out);
+   if(method)
+      fputs("\tmethod", out);
+   for(loop=0; loop<NCDR; loop++)
+   {
+      fprintf(out, "\t%s_class\t%s_length\t%s_similar\t%s_mismatches",
+              sLoopDef[loop].name, sLoopDef[loop].name, 
+              sLoopDef[loop].name, sLoopDef[loop].name);
+   }
+   putc('\n', out);
+}
+
+
+/************************************************************************/
+/*>void PrintCanonResultsTSV(FILE *out, char *id, int count,
+                              CANONRESULTS *results)
+   -----------------------------------------------------------
+   Input:   FILE         *out      Output file pointer
+            char         *id       ID of the record (or NULL)
+            int          count     Number of records with this sequence
+                                   (0 if not to be given)
+            CANONRESULTS *results  Canonical classes assigned
+
+   Prints the canonical classes assigned by ClassifySequence() as a 
+   single tab-separated line with the columns given by 
+   PrintCanonHeaderTSV(). If a count is given, it is in the column 
+   after the ID, followed by the method if the results are labelled 
+   with one. Each CDR has four columns:
+   class       The class assigned, ? if none matches or blank if the
+               loop was not found (or its chain was not processed)
+   length      The loop length
+   similar     The nearest class if none matches
+   mismatches  Comma-separated mismatches to the nearest class, each
+               given as position:observed:allowed with observed as - 
+               for a deleted residue
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Added count
+   16.10.26 Added method
+*/
+void PrintCanonResultsTSV(FILE *out, char *id, int count,
+                          CANONRESULTS *results)
+{
+   CANONRESULT   *result;
+   CANONMISMATCH *mismatch;
+   int           loop,
+                 i;
+
+   if(id != NULL)
+      fputs(id, out);
+   if(count > 0)
+      fprintf(out, "\t%d", count);
+   if(results->method != NULL)
+      fprintf(out, "\t%s", results->method);
+
+   for(loop=0; loop<NCDR; loop++)
+   {
+      result = &(results->cdr[loop]);
+
+      if((loop < results->firstCDR) || (loop >= results->lastCDR) ||
+         (result->status == CANON_MISSING))
+      {
+         fputs("\t\t\t\t", out);
+      }
+      else if(result->status == CANON_MATCH)
+      {
+         fprintf(out, "\t%s\t%d\t\t", result->className, result->length);
+      }
+      else
+      {
+         fprintf(out, "\t?\t%d\t%s\t", result->length,
+                 (result->similar == NULL) ? "" : result->similar);
+         for(i=0; i<result->nMismatch; i++)
+         {
+            mismatch = &(result->mismatch[i]);
+            fprintf(out, "%s%s:%c:%s", (i ? "," : ""), mismatch->label,
+                    (mismatch->found ? mismatch->found : '-'),
+                    mismatch->allowed);
+         }
+      }
+   }
+   putc('\n', out);
+}
+
+
+/************************************************************************/
+/*>int ParseResID(char *resnum, int *chain, int *num, int *ins)
+   -----------------------------------------------------------
+   Input:   char  *resnum     Residue label (e.g. L27A)
+   Output:  int   *chain      Chain (0=L, 1=H)
+            int   *num        Residue number
+            int   *ins        Insert code (0=none, 1=A, etc.)
+   Returns: int               RESID_OK   Fully parsed
+                              RESID_STEM Chain and number parsed, but
+                                         followed by something other 
+                                         than a single insert code,
+                                         starting with a letter
+                              RESID_BAD  Not parsed
+
+   Splits a residue label into its parts. Residue numbers above 
+   MAXRESNUM, or with leading zeros, are not parsed as they cannot be 
+   represented in a RESINDEX
+
+   16.10.26 Original    By: ACRM
+*/
+int ParseResID(char *resnum, int *chain, int *num, int *ins)
+{
+   char *chp;
+   
+   if(resnum[0] == 'L')
+      *chain = 0;
+   else if(resnum[0] == 'H')
+      *chain = 1;
+   else
+      return(RESID_BAD);
+
+   if(!isdigit(resnum[1]) || (resnum[1] == '0'))
+      return(RESID_BAD);
+
+   *num = 0;
+   for(chp=resnum+1; isdigit(*chp); chp++)
+   {
+      *num = (*num * 10) + (*chp - '0');
+      if(*num > MAXRESNUM)
+         return(RESID_BAD);
+   }
+
+   *ins = 0;
+   if(*chp == '\0')
+      return(RESID_OK);
+   if(!isalpha(*chp))
+      return(RESID_BAD);
+   if(isupper(*chp) && (chp[1] == '\0'))
+   {
+      *ins = *chp - 'A' + 1;
+      return(RESID_OK);
+   }
+   return(RESID_STEM);
+}
+
+
+/************************************************************************/
+/*>int EncodeResID(char *resnum)
+   -----------------------------
+   Input:   char  *resnum     Residue label (e.g. L27A)
+   Returns: int               Encoded residue ID (-1 if the label could
+                              not be encoded)
+
+   16.10.26 Original    By: ACRM
+*/
+int EncodeResID(char *resnum)
+{
+   int chain, num, ins;
+   
+   if(ParseResID(resnum, &chain, &num, &ins) != RESID_OK)
+      return(-1);
+   return(ENCODERESID(chain, num, ins));
+}
+
+
+/************************************************************************/
+/*>void InitResIndex(RESINDEX *index)
+   ----------------------------------
+   Output:  RESINDEX   *index         The index
+
+   Empties an index. This must be done once before the index is first
+   passed to IndexSequence(), which then only resets the entries it set
+   for the previous sequence.
+
+   16.10.26 Original    By: ACRM
+*/
+void InitResIndex(RESINDEX *index)
+{
+   int i;
+
+   for(i=0; i<NRESID; i++)
+      index->offset[i] = (-1);
+   for(i=0; i<2*(MAXRESNUM+1); i++)
+      index->first[i] = (-1);
+   index->nSetID  = 0;
+   index->nSetNum = 0;
+}
+
+
+/************************************************************************/
+/*>void IndexSequence(SEQUENCE *Sequence, int NRes, RESINDEX *index)
+   -----------------------------------------------------------------
+   Input:   SEQUENCE   *Sequence      The sequence array
+            int        NRes           Length of sequence array
+   I/O:     RESINDEX   *index         The index (emptied by 
+                                      InitResIndex() or indexing a
+                                      previous sequence)
+
+   Builds the index used by FindRes(). For each residue ID, the index
+   gives the first exact match in the sequence and, for each residue
+   number, the first residue with that number and any insert code.
+   From these, IndexedRes() gives the offset that FindRes() would have
+   found by scanning the sequence. Only the entries set for the 
+   previous sequence are reset, so the cost depends on the length of 
+   the sequence rather than the size of the index.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Only resets the entries set for the previous sequence. The
+            insert code fallbacks are left to IndexedRes()
+*/
+void IndexSequence(SEQUENCE *Sequence, int NRes, RESINDEX *index)
+{
+   int i,
+       chain,
+       num,
+       ins,
+       status,
+       resid;
+
+   for(i=0; i<index->nSetID; i++)
+      index->offset[index->setID[i]] = (-1);
+   for(i=0; i<index->nSetNum; i++)
+      index->first[index->setNum[i]] = (-1);
+   index->nSetID  = 0;
+   index->nSetNum = 0;
+
+   /* Record the first exact match for each residue ID and the first 
+      residue with each residue number
+   */
+   for(i=0; i<NRes; i++)
+   {
+      status = ParseResID(Sequence[i].resnum, &chain, &num, &ins);
+      if(status == RESID_BAD)
+         continue;
+      
+      resid = (chain * (MAXRESNUM+1)) + num;
+      if(index->first[resid] == (-1))
+      {
+         index->first[resid] = i;
+         index->setNum[index->nSetNum++] = resid;
+      }
+      
+      if(status == RESID_OK)
+      {
+         resid = ENCODERESID(chain, num, ins);
+         if(index->offset[resid] == (-1))
+         {
+            index->offset[resid] = i;
+            index->setID[index->nSetID++] = resid;
+         }
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>int IndexedRes(RESINDEX *index, int resid)
+   ------------------------------------------
+   Input:   RESINDEX   *index         Index of the sequence array
+            int        resid          Encoded residue ID
+   Returns: int                       Offset into Sequence array
+                                      -1 if not found
+
+   Looks up a residue ID in the index, with the fallbacks of 
+   FindResByScan(): a residue without an insert code only matches 
+   exactly, while one with an insert code matches the same residue 
+   with that or an earlier insert code, then the first residue with the
+   same number and any insert code.
+
+   16.10.26 Original    By: ACRM
+*/
+int IndexedRes(RESINDEX *index, int resid)
+{
+   int ins = resid % (NINSERT+1);
+
+   if(ins == 0)
+      return(index->offset[resid]);
+
+   for(; ins>0; ins--, resid--)
+   {
+      if(index->offset[resid] >= 0)
+         return(index->offset[resid]);
+   }
+   return(index->first[resid / (NINSERT+1)]);
+}
+
+
+/************************************************************************/
+/*>int FindRes(SEQUENCE *Sequence, int NRes, RESINDEX *index, 
+               char *InRes)
+   ----------------------------------------------------------
+   Input:   SEQUENCE   *Sequence      The sequence array
+            int        NRes           Length of sequence array
+            RESINDEX   *index         Index of the sequence array
+            char       *InRes         The res number to find
+   Returns: int                       Offset into Sequence array
+                                      -1 if not found
+
+   Finds a residue label in the sequence array using the index built
+   by IndexSequence(). Labels which can't be held in the index are 
+   handled by FindResByScan().
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Uses IndexedRes()
+*/
+int FindRes(SEQUENCE *Sequence, int NRes, RESINDEX *index, char *InRes)
+{
+   int resid;
+   
+   if(!strncmp(InRes,"---",3))
+      return(-1);
+
+   if((resid = EncodeResID(InRes)) < 0)
+      return(FindResByScan(Sequence, NRes, InRes));
+
+   return(IndexedRes(index, resid));
+}
+
+
+/************************************************************************/
+/*>int FindResByScan(SEQUENCE *Sequence, int NRes, char *InRes)
+   ------------------------------------------------------------
+   Input:   SEQUENCE   *Sequence      The sequence array
+            int        NRes           Length of sequence array
+            char       *InRes         The res number to find
+   Returns: int                       Offset into Sequence array
+                                      -1 if not found
+
+   Finds a residue label in the sequence array. If no exact match is found
+   it runs through again checking without any insert codes. This assumes
+   that residues which we search for can be substituted by an earlier 
+   residue in the sequence.
+
+   16.05.95 Original    By: ACRM
+   17.05.95 Added no-insert checking
+   18.08.95 Fixed failure when 35B specified and had 35A in sequence
+            (Used to find 35 instead of 35A).
+   30.05.96 Checks for InRes being --- and returns -1
+   19.12.08 Changed strcpy() to strncpy()
+            Changed res[16] and buff[16] to use MAXWORD
+   16.10.26 Renamed from FindRes(); now only used for labels which 
+            can't be indexed
+*/
+int FindResByScan(SEQUENCE *Sequence, int NRes, char *InRes)
+{
+   int  i,
+        InsPos = (-1);
+   char res[MAXWORD];
+
+   if(!strncmp(InRes,"---",3))
+      return(-1);
+
+   strncpy(res,InRes,MAXWORD);
+   
+   /* Check full residue names                                          */
+   for(i=0; i<NRes; i++)
+   {
+      if(!strcmp(Sequence[i].resnum, res))
+         return(i);
+   }
+
+   /* Exact match failed, see if there is an insert code. Counts from 1
+      not zero as 0 is the chain name
+   */
+   for(i=1; i<strlen(res); i++)
+   {
+      if(isalpha(res[i]))
+      {
+         InsPos = i;
+         break;
+      }
+   }
+
+   /* If there wasn't an insert code, then we've definitely failed      */
+   if(InsPos < 0)
+      return(-1);
+
+   /* Step the insert code down                                         */
+   res[InsPos]--;
+   
+   while(res[InsPos] >= 'A')
+   {
+      for(i=0; i<NRes; i++)
+      {
+         if(!strcmp(Sequence[i].resnum, res))
+            return(i);
+      }
+   
+      /* Step the insert code down                                      */
+      res[InsPos]--;
+   }
+
+   /* Finally try without the insert code                               */
+   res[InsPos] = '\0';
+   for(i=0; i<NRes; i++)
+   {
+      char buff[MAXWORD];
+
+      strncpy(buff, Sequence[i].resnum, MAXWORD);
+      TERMALPHA(buff+1);
+
+      if(!strcmp(buff, res))
+         return(i);
+   }
+   
+   /* Tried everything!                                                 */
+   return(-1);
+}
+
+
+/************************************************************************/
+/*>int FindKeyRes(CANONCONTEXT *ctx, int key, SEQUENCE *Sequence, 
+                  int NRes, RESINDEX *index, SEQTRANS *seqTrans)
+   -----------------------------------------------------------------
+   Input:   CANONCONTEXT *ctx      Canonical definitions and options
+            int          key       Offset of the key residue in the 
+                                   compiled table
+            SEQUENCE     *Sequence Sequence array
+            int          NRes      Length of sequence
+            RESINDEX     *index    Index of the sequence array
+            SEQTRANS     *seqTrans Translation to the numbering of the
+                                   sequence
+   Returns: int                    Offset into Sequence array
+                                   -1 if not found
+
+   Finds a key residue of a canonical class in the sequence. If the
+   residue is labelled the same in the data file and the sequence, 
+   this is a direct lookup of the compiled residue ID. Otherwise the 
+   residue ID translated for the length of the CDR in whose region it
+   lies, or translated with its chain, is looked up.
+
+   16.10.26 Extracted from TestThisCanonical() and ReportACanonical()
+            By: ACRM
+   16.10.26 Translates through a NUMTRANS rather than with KabCho() and
+            ChoKab()
+   16.10.26 Uses the translations compiled in a KEYTRANS
+   16.10.26 Counts the lookups if there is a CANONSTATS
+   16.10.26 Labels are taken from the string pool of the KEYTRANS
+   16.10.26 Key residues may be translated without a CDR region
+*/
+int FindKeyRes(CANONCONTEXT *ctx, int key, SEQUENCE *Sequence, int NRes,
+               RESINDEX *index, SEQTRANS *seqTrans)
+{
+   CANONTABLE *table    = &(ctx->data->table);
+   KEYTRANS   *keyTrans = seqTrans->trans;
+   char       *label;
+   int        region,
+              len,
+              entry,
+              resid,
+              res;
+   
+   if((keyTrans != NULL) && ((entry = keyTrans->first[key]) >= 0))
+   {
+      if((region = keyTrans->region[key]) >= 0)
+      {
+         len    = seqTrans->loopLen[region];
+         entry += ((len >= 0) && (len <= keyTrans->info.regionMax[region]))
+                  ? len : (keyTrans->info.regionMax[region] + 1);
+      }
+      resid = keyTrans->resid[entry];
+      label = KEYTRANSLABEL(keyTrans, keyTrans->label[entry]);
+   }
+   else
+   {
+      /* An untranslated residue ID is -1 (KEY_SCAN) if not encodable   */
+      resid = table->keyResid[key];
+      label = table->strings + table->keyLabel[key];
+   }
+
+   res = FindTransRes(Sequence, NRes, index, resid, label);
+
+   /* A residue found with a different label was found by falling back
+      to an earlier insert code
+   */
+   if(ctx->stats != NULL)
+   {
+      ctx->stats->lookups++;
+      if(resid == KEY_SCAN)
+         ctx->stats->scans++;
+      if((res != (-1)) && strcmp(Sequence[res].resnum, label))
+         ctx->stats->fallbacks++;
+   }
+   
+   return(res);
+}
+
+
+/************************************************************************/
+/*>int FindLoopEnd(SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                   SEQTRANS *seqTrans, int loop, int end)
+   --------------------------------------------------------------
+   Input:   SEQUENCE     *Sequence Sequence array
+            int          NRes      Length of sequence
+            RESINDEX     *index    Index of the sequence array
+            SEQTRANS     *seqTrans Translation to the numbering of the
+                                   sequence
+            int          loop      The loop (offset into sLoopDef[])
+            int          end       0 for the start, 1 for the stop
+   Returns: int                    Offset into Sequence array
+                                   -1 if not found
+
+   Finds the end of a CDR in the sequence. Since the CDR lengths are 
+   not yet known, the label is translated as for a CDR of a length 
+   with no translation of its own.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Uses the translations compiled in a KEYTRANS
+   16.10.26 Labels are taken from the string pool of the KEYTRANS
+*/
+int FindLoopEnd(SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                SEQTRANS *seqTrans, int loop, int end)
+{
+   KEYTRANS *keyTrans = seqTrans->trans;
+
+   if(keyTrans != NULL)
+      return(FindTransRes(Sequence, NRes, index, 
+                          keyTrans->info.endResid[loop][end],
+                          KEYTRANSLABEL(keyTrans, 
+                                        keyTrans->info.endLabel[loop][end])));
+
+   return(FindRes(Sequence, NRes, index, 
+                  end ? sLoopDef[loop].stop : sLoopDef[loop].start));
+}
+
+
+/************************************************************************/
+/*>int FindTransRes(SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                    int resid, char *label)
+   ---------------------------------------------------------------
+   Input:   SEQUENCE     *Sequence Sequence array
+            int          NRes      Length of sequence
+            RESINDEX     *index    Index of the sequence array
+            int          resid     Translated residue ID (or KEY_SCAN
+                                   or KEY_DELETED)
+            char         *label    Translated residue label
+   Returns: int                    Offset into Sequence array
+                                   -1 if not found
+
+   Finds a residue translated by a KEYTRANS in the sequence
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Uses IndexedRes()
+*/
+int FindTransRes(SEQUENCE *Sequence, int NRes, RESINDEX *index, 
+                 int resid, char *label)
+{
+   if(resid >= 0)
+      return(IndexedRes(index, resid));
+   if(resid == KEY_DELETED)
+      return(-1);
+   return(FindResByScan(Sequence, NRes, label));
+}
+
+
+/************************************************************************/
+/*>int TestThisCanonical(CANONCONTEXT *ctx, CANONCLASS *p, int loop,
+                         int LoopLen, SEQUENCE *Sequence, int NRes,
+                         RESINDEX *index, SEQTRANS *seqTrans)
+   ----------------------------------------------------------------------
+   16.02.11 Extracted from ReportACanonical()
+   16.10.26 Numbering schemes now taken from CANONCONTEXT
+            Takes the sequence index
+            Works with a compiled CANONCLASS. Residue types are checked
+            with the bit mask of allowed types
+            The class may cover a range of lengths
+*/
+int TestThisCanonical(CANONCONTEXT *ctx, CANONCLASS *p, int loop, 
+                      int LoopLen, SEQUENCE *Sequence, int NRes, 
+                      RESINDEX *index, SEQTRANS *seqTrans)
+{
+   unsigned int *allowed = ctx->data->table.keyAllowed;
+   int          NMismatch = 10000, /* Return this if loop length/name 
+                                      wrong                             */
+                res,
+                key,
+                lastKey;
+   
+   /* If the Loop name and length match                                 */
+   if((p->loop == loop) && (LoopLen >= p->length) && 
+      (LoopLen <= p->maxLength))
+   {
+      NMismatch = 0;  /* Assume we are OK                               */
+         
+      /* Check each residue specified by this canonical definition      */
+      lastKey = p->firstKey + p->nKey;
+      for(key=p->firstKey; key<lastKey; key++)
+      {
+         res = FindKeyRes(ctx, key, Sequence, NRes, index, seqTrans);
+
+         /* This is a disallowed residue type, so increment the mismatch 
+            counter
+            30.05.96 Added check on -1
+         */
+         if((res==(-1)) || !(allowed[key] & RESBIT(Sequence[res].seq)))
+         {
+            NMismatch++;
+         }
+      }
+   }
+
+   return(NMismatch);
+}
+
+
+/************************************************************************/
+/*>void ClassifyLoop(CANONCONTEXT *ctx, int loop, int LoopLen, 
+                     SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                     SEQTRANS *seqTrans, CANONRESULT *result)
+   ---------------------------------------------------------------
+   Input:   CANONCONTEXT *ctx      Canonical definitions and options
+            int          loop      The loop (offset into sLoopDef[])
+            int          LoopLen   Length of the loop
+            SEQUENCE     *Sequence Sequence array
+            int          NRes      Length of sequence
+            RESINDEX     *index    Index of the sequence array
+            SEQTRANS     *seqTrans Translation to the numbering of the
+                                   sequence
+   Output:  CANONRESULT  *result   The class assigned, or the nearest
+                                   class and the mismatches against it
+
+   Assigns the canonical class for an individual loop
+
+   16.05.95 Original    By: ACRM
+   17.05.95 Only prints source data if verbose
+   08.05.96 Converts between Chothia and Kabat numbering if required
+   09.05.96 Fixed bug in reporting mismatches with numbering conversion
+   30.05.96 Mismatches report numbering scheme in data file
+            Added check for -1 return from FindRes(); reports deleted
+            residues
+   16.02.11 Moved actual canonical finding code out into 
+            TestThisCanonical()
+   17.02.11 Re-written to deal with priority chains
+   16.10.26 Canonical definitions and options passed in a CANONCONTEXT
+            Takes the sequence index
+            Works through the compiled CANONTABLE. Priority chains are 
+            walked using the subordinateTo links rather than assuming 
+            that the classes are adjacent in the file
+            Only tests the candidates for this loop and length, with 
+            priority chains already resolved
+            Renamed from ReportACanonical() and fills in a CANONRESULT
+            rather than printing
+            Uses the classification cache if there is one
+            Takes a SEQTRANS rather than the name and length of CDR1
+            Calls ScoreLoop() if classes are to be ranked
+            Counts the mismatches against all the candidates with
+            CountMismatches() where possible
+            Result initialised by InitLoopResult()
+            Counts the classes tested and how the loop was resolved if
+            there is a CANONSTATS
+            Follows the CLASSTREE if the engine is ENGINE_TREE
+*/
+void ClassifyLoop(CANONCONTEXT *ctx, int loop, int LoopLen, 
+                  SEQUENCE *Sequence, int NRes, RESINDEX *index, 
+                  SEQTRANS *seqTrans, CANONRESULT *result)
+{
+   CANONTABLE    *table   = &(ctx->data->table);
+   CANONCLASS    *classes = table->classes,
+                 *theMatch = NULL,
+                 *best     = NULL;
+   CANDIDATE     *cand;
+   BUCKET        *bucket;
+   char          *fingerprint = NULL;
+   unsigned int  observed[MAXMATCHKEYS];
+   int           i,
+                 b = 0,
+                 link,
+                 lastLink,
+                 res,
+                 *keys,
+                 nKeys,
+                 status,
+                 classNum,
+                 counts[MAXMATCHLANES],
+                 node,
+                 steps,
+                 firstLink   = 0,
+                 NMismatch   = 10000,
+                 MinMismatch = 10000;
+   BOOL          kernel      = FALSE,
+                 walked      = FALSE;
+
+   InitLoopResult(ctx, loop, LoopLen, result);
+   
+   /* Find the candidates for this loop and length                      */
+   if((LoopLen < 0) || (LoopLen > table->maxLength))
+   {
+      bucket = NULL;
+   }
+   else
+   {
+      b      = (loop * (table->maxLength+1)) + LoopLen;
+      bucket = &(table->buckets[b]);
+   }
+
+   /* Ranking the classes needs all of them to be scored, so the cache
+      is not used
+   */
+   if((ctx->topK > 0) && (bucket != NULL))
+   {
+      ScoreLoop(ctx, loop, bucket, Sequence, NRes, index, seqTrans, 
+                result);
+      return;
+   }
+
+   /* If the residues at all the key positions of these candidates have
+      been seen before, use the cached result
+   */
+   if((ctx->cache != NULL) && (bucket != NULL) && 
+      (seqTrans->context >= 0))
+   {
+      keys = CanonCacheKeys(ctx->cache, b, &nKeys, &fingerprint);
+      for(i=0; i<nKeys; i++)
+      {
+         res = FindKeyRes(ctx, keys[i], Sequence, NRes, index, 
+                          seqTrans);
+         fingerprint[i] = ((res==(-1)) ? '\0' : Sequence[res].seq);
+      }
+      if(LookupCanonCache(ctx->cache, b, seqTrans->context, &status,
+                          &classNum))
+      {
+         SetLoopResult(ctx, (classNum < 0) ? NULL : &(classes[classNum]),
+                       (status == CANON_MATCH), Sequence, NRes, index, 
+                       seqTrans, result);
+         return;
+      }
+   }
+
+   /* With the decision tree engine, follow the tree of the bucket,
+      looking up only the key residues tested on the way (or taking 
+      them from the fingerprint). This gives the class that the 
+      candidates below would match; if none matches, the mismatches
+      must still be counted to find the nearest class, and the 
+      residues found are kept for this
+   */
+   if((ctx->engine == ENGINE_TREE) && (bucket != NULL) && 
+      (bucket->n > 0) && ClassTreeUsable(ctx->data->tree, b))
+   {
+      walked = TRUE;
+      keys   = MatchKernelKeys(ctx->data->kernel, b, &nKeys);
+      for(i=0; i<nKeys; i++)
+         observed[i] = 0U;
+      for(node = ClassTreeRoot(ctx->data->tree, b), steps = 0; 
+          node >= 0; 
+          steps++)
+      {
+         i = ClassTreeKey(ctx->data->tree, node);
+         if(fingerprint == NULL)
+         {
+            res = FindKeyRes(ctx, keys[i], Sequence, NRes, index, 
+                             seqTrans);
+            node = ClassTreeNext(ctx->data->tree, node,
+                                 (res == (-1)) ? '\0' : Sequence[res].seq);
+            observed[i] = ((res == (-1)) ? MATCH_MISSING :
+                           RESBIT(Sequence[res].seq));
+         }
+         else
+         {
+            node = ClassTreeNext(ctx->data->tree, node, fingerprint[i]);
+         }
+      }
+
+      if(TREELANE(node) >= 0)
+      {
+         firstLink = table->candidates[bucket->first].firstLink;
+         theMatch  = &(classes[table->links[firstLink + TREELANE(node)]]);
+         if(ctx->stats != NULL)
+         {
+            ctx->stats->treeLoops[loop]++;
+            ctx->stats->treeSteps[loop] += steps;
+         }
+         SetLoopResult(ctx, theMatch, TRUE, Sequence, NRes, index, 
+                       seqTrans, result);
+         if((ctx->cache != NULL) && (seqTrans->context >= 0))
+            StoreCanonCache(ctx->cache, CANON_MATCH, 
+                            (int)(theMatch - classes));
+         return;
+      }
+   }
+
+   /* Count the mismatches against all the candidates at once. The 
+      residues at the key positions are the fingerprint if it has 
+      been found, or those found while walking the tree
+   */
+   if((bucket != NULL) && (bucket->n > 0) &&
+      MatchKernelUsable(ctx->data->kernel, b))
+   {
+      kernel    = TRUE;
+      firstLink = table->candidates[bucket->first].firstLink;
+      keys      = MatchKernelKeys(ctx->data->kernel, b, &nKeys);
+      for(i=0; i<nKeys; i++)
+      {
+         if(fingerprint != NULL)
+         {
+            observed[i] = ((fingerprint[i] == '\0') ? MATCH_MISSING :
+                           RESBIT(fingerprint[i]));
+         }
+         else if(!walked || (observed[i] == 0U))
+         {
+            res = FindKeyRes(ctx, keys[i], Sequence, NRes, index, 
+                             seqTrans);
+            observed[i] = ((res == (-1)) ? MATCH_MISSING :
+                           RESBIT(Sequence[res].seq));
+         }
+      }
+      CountMismatches(ctx->data->kernel, b, observed, counts);
+
+      if(ctx->stats != NULL)
+      {
+         cand = &(table->candidates[bucket->first + bucket->n - 1]);
+         ctx->stats->kernelLoops[loop]++;
+         ctx->stats->classesTested[loop] += cand->firstLink + 
+                                            cand->nLink - firstLink;
+      }
+   }
+   
+   /* Run through the candidates. Each is a single class or a priority
+      chain; for a chain, we walk from the highest priority class to the
+      lowest testing for a perfect match
+   */
+   for(i=0; (bucket != NULL) && (i < bucket->n); i++)
+   {
+      cand     = &(table->candidates[bucket->first + i]);
+      lastLink = cand->firstLink + cand->nLink;
+      for(link=cand->firstLink; link<lastLink; link++)
+      {
+         theMatch  = &(classes[table->links[link]]);
+         if(kernel)
+         {
+            NMismatch = counts[link - firstLink];
+         }
+         else
+         {
+            NMismatch = TestThisCanonical(ctx, theMatch, loop, LoopLen, 
+                                          Sequence, NRes, index, 
+                                          seqTrans);
+            if(ctx->stats != NULL)
+               ctx->stats->classesTested[loop]++;
+         }
+         if(NMismatch == 0)
+            break;
+      }
+
+      if((ctx->stats != NULL) && (cand->nLink > 1))
+      {
+         ctx->stats->chainWalks[loop]++;
+         ctx->stats->chainLinks[loop] += 
+            ((link < lastLink) ? (link + 1) : link) - cand->firstLink;
+      }
+
+      /* If we found a match then use that, otherwise, use the class
+         the candidate is reported as. In other words we only accept 
+         mismatches against the lowest priority class of a chain.
+      */
+      if(NMismatch != 0)
+         theMatch = &(classes[cand->reportAs]);
+
+      if(NMismatch == 0)  /* We've found the canonical                  */
+      {
+         if((ctx->stats != NULL) && (i < bucket->n - 1))
+            ctx->stats->earlyExits[loop]++;
+         break;
+      }
+      else
+      {
+         if(NMismatch < MinMismatch)
+         {
+            MinMismatch = NMismatch;
+            best = theMatch;
+         }
+      }
+   }
+
+   if(NMismatch != 0)
+      theMatch = best;
+   SetLoopResult(ctx, theMatch, (NMismatch == 0), Sequence, NRes, index,
+                 seqTrans, result);
+
+   if((ctx->cache != NULL) && (bucket != NULL) && 
+      (seqTrans->context >= 0))
+   {
+      StoreCanonCache(ctx->cache, 
+                      (NMismatch == 0) ? CANON_MATCH : CANON_NOMATCH,
+                      (theMatch == NULL) ? -1 : (int)(theMatch - classes));
+   }
+}
+
+
+/************************************************************************/
+/*>void ScoreLoop(CANONCONTEXT *ctx, int loop, BUCKET *bucket,
+                  SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                  SEQTRANS *seqTrans, CANONRESULT *result)
+   -------------------------------------------------------------
+   Input:   CANONCONTEXT *ctx      Canonical definitions and options
+            int          loop      The loop (offset into sLoopDef[])
+            BUCKET       *bucket   Candidates for the loop and length
+            SEQUENCE     *Sequence Sequence array
+            int          NRes      Length of sequence
+            RESINDEX     *index    Index of the sequence array
+            SEQTRANS     *seqTrans Translation to the numbering of the
+                                   sequence
+   I/O:     CANONRESULT  *result   The class assigned, or the nearest
+                                   class and the mismatches against it,
+                                   and the ctx->topK highest scoring
+                                   classes
+
+   Scores every class of the candidates for a loop in a single pass 
+   over their key residues, ranking them by score. The class is 
+   assigned from the same pass exactly as ClassifyLoop() would: the 
+   first class found with no mismatches in candidate and priority 
+   order, otherwise the candidate with fewest mismatches.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Counts the classes scored if there is a CANONSTATS
+*/
+void ScoreLoop(CANONCONTEXT *ctx, int loop, BUCKET *bucket,
+               SEQUENCE *Sequence, int NRes, RESINDEX *index,
+               SEQTRANS *seqTrans, CANONRESULT *result)
+{
+   CANONTABLE *table   = &(ctx->data->table);
+   CANONCLASS *classes = table->classes,
+              *theMatch = NULL,
+              *best     = NULL,
+              *p;
+   CANDIDATE  *cand;
+   double     score;
+   int        i,
+              link,
+              lastLink,
+              NMismatch   = 10000,
+              MinMismatch = 10000;
+
+   for(i=0; i<bucket->n; i++)
+   {
+      cand     = &(table->candidates[bucket->first + i]);
+      lastLink = cand->firstLink + cand->nLink;
+      for(link=cand->firstLink; link<lastLink; link++)
+      {
+         p         = &(classes[table->links[link]]);
+         NMismatch = ScoreThisCanonical(ctx, p, Sequence, NRes, index, 
+                                        seqTrans, &score);
+         if(ctx->stats != NULL)
+            ctx->stats->classesTested[loop]++;
+         RankClass(result, ctx->topK, table->strings + p->name, score);
+
+         if((NMismatch == 0) && (theMatch == NULL))
+            theMatch = p;
+      }
+
+      /* As in ClassifyLoop(), mismatches are only accepted against the
+         lowest priority class of a chain
+      */
+      if((theMatch == NULL) && (NMismatch < MinMismatch))
+      {
+         MinMismatch = NMismatch;
+         best        = &(classes[cand->reportAs]);
+      }
+   }
+
+   SetLoopResult(ctx, (theMatch != NULL) ? theMatch : best, 
+                 (theMatch != NULL), Sequence, NRes, index, seqTrans, 
+                 result);
+}
+
+
+/************************************************************************/
+/*>int ScoreThisCanonical(CANONCONTEXT *ctx, CANONCLASS *p, 
+                          SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                          SEQTRANS *seqTrans, double *score)
+   ----------------------------------------------------------------------
+   Input:   CANONCONTEXT *ctx      Canonical definitions and options
+            CANONCLASS   *p        The class
+            SEQUENCE     *Sequence Sequence array
+            int          NRes      Length of sequence
+            RESINDEX     *index    Index of the sequence array
+            SEQTRANS     *seqTrans Translation to the numbering of the
+                                   sequence
+   Output:  double       *score    Weighted fraction of key residues 
+                                   matching (1 if there are none)
+   Returns: int                    Number of key residues not matching
+
+   As TestThisCanonical(), but also gives a score using the weights of
+   the key residues. The loop and length must already be known to match
+
+   16.10.26 Original    By: ACRM
+*/
+int ScoreThisCanonical(CANONCONTEXT *ctx, CANONCLASS *p, 
+                       SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                       SEQTRANS *seqTrans, double *score)
+{
+   unsigned int *allowed = ctx->data->table.keyAllowed;
+   float        *weight  = ctx->data->table.keyWeight;
+   double       total    = 0.0,
+                matched  = 0.0;
+   int          NMismatch = 0,
+                res,
+                key,
+                lastKey;
+   
+   lastKey = p->firstKey + p->nKey;
+   for(key=p->firstKey; key<lastKey; key++)
+   {
+      res    = FindKeyRes(ctx, key, Sequence, NRes, index, seqTrans);
+      total += weight[key];
+      if((res==(-1)) || !(allowed[key] & RESBIT(Sequence[res].seq)))
+         NMismatch++;
+      else
+         matched += weight[key];
+   }
+
+   *score = (total > 0.0) ? (matched / total) : 1.0;
+   return(NMismatch);
+}
+
+
+/************************************************************************/
+/*>void RankClass(CANONRESULT *result, int topK, char *className, 
+                  double score)
+   --------------------------------------------------------------
+   I/O:     CANONRESULT  *result    Result with the classes ranked so 
+                                    far
+   Input:   int          topK       Number of classes to keep
+            char         *className Class scored
+            double       score      Its score
+
+   Inserts a class into the ranked classes if its score is among the
+   topK highest. Classes with equal scores keep the order in which they
+   were scored.
+
+   16.10.26 Original    By: ACRM
+*/
+void RankClass(CANONRESULT *result, int topK, char *className, 
+               double score)
+{
+   int i;
+
+   if(topK > MAXRANK)
+      topK = MAXRANK;
+   
+   for(i=result->nRanked; (i > 0) && (result->rank[i-1].score < score);
+       i--)
+   {
+      if(i < topK)
+         result->rank[i] = result->rank[i-1];
+   }
+   
+   if(i < topK)
+   {
+      result->rank[i].className = className;
+      result->rank[i].score     = score;
+      if(result->nRanked < topK)
+         result->nRanked++;
+   }
+}
+
+
+/************************************************************************/
+/*>void InitLoopResult(CANONCONTEXT *ctx, int loop, int LoopLen,
+                       CANONRESULT *result)
+   ---------------------------------------------------------------
+   Input:   CANONCONTEXT *ctx      Canonical definitions and options
+            int          loop      The loop (offset into sLoopDef[])
+            int          LoopLen   Length of the loop
+   Output:  CANONRESULT  *result   Result for the loop with no class
+
+   16.10.26 Extracted from ClassifyLoop()   By: ACRM
+*/
+void InitLoopResult(CANONCONTEXT *ctx, int loop, int LoopLen,
+                    CANONRESULT *result)
+{
+   result->loop      = sLoopDef[loop].name;
+   result->length    = LoopLen;
+   result->missing   = NULL;
+   result->className = NULL;
+   result->source    = NULL;
+   result->similar   = NULL;
+   result->nMismatch = 0;
+   result->nRanked   = (ctx->topK > 0) ? 0 : (-1);
+}
+
+
+/************************************************************************/
+/*>void SetLoopResult(CANONCONTEXT *ctx, CANONCLASS *p, BOOL match,
+                      SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                      SEQTRANS *seqTrans, CANONRESULT *result)
+   ----------------------------------------------------------------
+   Input:   CANONCONTEXT *ctx      Canonical definitions and options
+            CANONCLASS   *p        Class assigned or nearest class
+                                   (NULL if none)
+            BOOL         match     Was the class assigned?
+            SEQUENCE     *Sequence Sequence array
+            int          NRes      Length of sequence
+            RESINDEX     *index    Index of the sequence array
+            SEQTRANS     *seqTrans Translation to the numbering of the
+                                   sequence
+   I/O:     CANONRESULT  *result   Result for the loop
+
+   Fills in the class assigned to a loop or, if none, the nearest class
+   and the key residues which do not match it (up to MAXMISMATCH).
+
+   16.10.26 Extracted from ClassifyLoop()   By: ACRM
+*/
+void SetLoopResult(CANONCONTEXT *ctx, CANONCLASS *p, BOOL match,
+                   SEQUENCE *Sequence, int NRes, RESINDEX *index,
+                   SEQTRANS *seqTrans, CANONRESULT *result)
+{
+   CANONTABLE    *table = &(ctx->data->table);
+   CANONMISMATCH *mismatch;
+   int           key,
+                 res;
+
+   if(match)
+   {
+      result->status    = CANON_MATCH;
+      result->className = table->strings + p->name;
+      result->source    = table->strings + p->source;
+   }
+   else
+   {
+      result->status = CANON_NOMATCH;
+   
+      if(p != NULL)
+      {
+         result->similar = table->strings + p->name;
+
+         /* Record each mismatch for this canonical definition          */
+         for(key=p->firstKey; key<p->firstKey+p->nKey; key++)
+         {
+            res = FindKeyRes(ctx, key, Sequence, NRes, index, 
+                             seqTrans);
+
+            /* 30.05.96 Added check on -1                               */
+            if(((res==(-1)) || 
+                !(table->keyAllowed[key] & RESBIT(Sequence[res].seq))) &&
+               (result->nMismatch < MAXMISMATCH))
+            {
+               mismatch = &(result->mismatch[result->nMismatch++]);
+               mismatch->label   = table->strings + table->keyLabel[key];
+               mismatch->allowed = table->strings + table->keyTypes[key];
+               mismatch->found   = ((res==(-1)) ? '\0' : 
+                                    Sequence[res].seq);
+            }
+         }
+      }
+   }   
+}
+
+
+/************************************************************************/
+/*>void SetSeqTrans(CANONCONTEXT *ctx, SEQTRANS *seqTrans)
+   -------------------------------------------------------
+   Input:   CANONCONTEXT *ctx      Canonical definitions and options
+   Output:  SEQTRANS     *seqTrans Translation to the numbering of the
+                                   sequence (CDR lengths not set)
+
+   Chooses the translation of key residues from the numbering of the
+   data file to that of the sequence. This is the translation given in
+   the CANONCONTEXT if there is one, otherwise the built-in translation
+   between Kabat and Chothia numbering if the two differ.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Chooses a KEYTRANS
+*/
+void SetSeqTrans(CANONCONTEXT *ctx, SEQTRANS *seqTrans)
+{
+   seqTrans->trans   = ctx->trans;
+   seqTrans->context = 0;
+   if((seqTrans->trans == NULL) && 
+      (ctx->data->canonChothNum != ctx->chothiaNumbered))
+      seqTrans->trans = ctx->data->kabchoKeys;
+}
+
+
+/************************************************************************/
+/*>KEYTRANS *CompileKeyTrans(CHOTHIADATA *data, NUMTRANS *trans)
+   -------------------------------------------------------------
+   Input:   CHOTHIADATA *data      Compiled canonical definitions
+            NUMTRANS    *trans     Translation from the numbering of 
+                                   the data file (which must be one of
+                                   its schemes; see NumTransDirection())
+   Returns: KEYTRANS    *          Translated key residues (NULL if no
+                                   memory or the translation does not
+                                   include the numbering of the data
+                                   file)
+
+   Works out the translation of every key residue for every length of
+   the CDR in whose region it lies (or once if it is translated with 
+   its chain), and of the loop ends, so that no
+   labels need be translated while assigning canonicals. The labels and
+   the context digits of the NUMTRANS are copied, so the NUMTRANS may 
+   be freed once the KEYTRANS is compiled.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Copies the labels and context digits rather than referring
+            to the NUMTRANS
+   16.10.26 Translates key residues in the framework of a chain
+*/
+KEYTRANS *CompileKeyTrans(CHOTHIADATA *data, NUMTRANS *trans)
+{
+   CANONTABLE *table = &(data->table);
+   KEYTRANS   *keyTrans;
+   char       *label;
+   int        loopLen[NLOOPDEF],
+              *digit,
+              nRows,
+              nEntries = 0,
+              nDigits  = 0,
+              key,
+              loop,
+              row,
+              region,
+              maxLength;
+   BOOL       reverse,
+              ok = TRUE;
+
+   if(!NumTransDirection(trans, (data->canonChothNum ? "Chothia" : 
+                                 "Kabat"), &reverse))
+      return(NULL);
+
+   if((keyTrans = (KEYTRANS *)calloc(1, sizeof(KEYTRANS)))==NULL)
+   {
+      fprintf(stderr,"Error (chothia): No memory for key residue \
+translation\n");
+      return(NULL);
+   }
+   keyTrans->info.nKey      = table->nKey;
+   keyTrans->info.nContexts = NumTransContexts(trans);
+   for(loop=0; loop<NLOOPDEF; loop++)
+   {
+      keyTrans->info.regionMax[loop] = (-1);
+      if(NumTransDigits(trans, loop, &maxLength) != NULL)
+      {
+         keyTrans->info.regionMax[loop] = maxLength;
+         nDigits += maxLength + 2;
+      }
+   }
+
+   /* Find the region of each key residue                              */
+   if(((keyTrans->region = (int *)malloc((table->nKey+1) * sizeof(int)))
+       ==NULL) ||
+      ((keyTrans->first  = (int *)malloc((table->nKey+1) * sizeof(int)))
+       ==NULL) ||
+      ((keyTrans->digit  = (int *)malloc((nDigits+1) * sizeof(int)))
+       ==NULL))
+   {
+      fprintf(stderr,"Error (chothia): No memory for key residue \
+translation\n");
+      FreeKeyTrans(keyTrans);
+      return(NULL);
+   }
+   for(loop=0; loop<NLOOPDEF; loop++)
+      loopLen[loop] = (-1);
+   for(key=0; key<table->nKey; key++)
+   {
+      label = table->strings + table->keyLabel[key];
+      keyTrans->first[key]  = (-1);
+      keyTrans->region[key] = NumTransRegion(trans, reverse, label,
+                                             &maxLength);
+      if(keyTrans->region[key] >= 0)
+      {
+         keyTrans->first[key] = nEntries;
+         nEntries += maxLength + 2;
+      }
+      else if(TranslateResLabel(trans, reverse, loopLen, label) != label)
+      {
+         keyTrans->first[key] = nEntries++;
+      }
+   }
+
+   /* Copy the context digits of the translated CDRs                   */
+   nDigits = 0;
+   for(loop=0; loop<NLOOPDEF; loop++)
+   {
+      if((digit = NumTransDigits(trans, loop, &maxLength)) != NULL)
+      {
+         memcpy(keyTrans->digit + nDigits, digit, 
+                (maxLength + 2) * sizeof(int));
+         nDigits += maxLength + 2;
+      }
+   }
+   keyTrans->info.nDigits = nDigits;
+
+   /* Translate each key residue for each length of its region         */
+   if(((keyTrans->resid = (int *)malloc((nEntries+1) * sizeof(int)))
+       ==NULL) ||
+      ((keyTrans->label = (int *)malloc((nEntries+1) * sizeof(int)))
+       ==NULL))
+   {
+      fprintf(stderr,"Error (chothia): No memory for key residue \
+translation\n");
+      FreeKeyTrans(keyTrans);
+      return(NULL);
+   }
+   keyTrans->info.nEntries = nEntries;
+   for(key=0; ok && (key<table->nKey); key++)
+   {
+      if(keyTrans->first[key] < 0)
+         continue;
+
+      /* A key residue with no region has the one entry                 */
+      region = keyTrans->region[key];
+      nRows  = (region < 0) ? 1 : (keyTrans->info.regionMax[region] + 2);
+      for(row=0; ok && (row<nRows); row++)
+      {
+         if(region >= 0)
+            loopLen[region] = (row <= keyTrans->info.regionMax[region]) ? 
+                              row : (-1);
+         ok = SetTransEntry(keyTrans,
+                            TranslateResLabel(trans, reverse, loopLen,
+                                              table->strings + 
+                                              table->keyLabel[key]),
+                            &(keyTrans->resid[keyTrans->first[key]+row]),
+                            &(keyTrans->label[keyTrans->first[key]+row]));
+      }
+      if(region >= 0)
+         loopLen[region] = (-1);
+   }
+
+   /* The loop ends are translated as for CDRs of unknown length       */
+   for(loop=0; ok && (loop<NLOOPDEF); loop++)
+   {
+      ok = SetTransEntry(keyTrans,
+                         TranslateResLabel(trans, reverse, loopLen,
+                                           sLoopDef[loop].start),
+                         &(keyTrans->info.endResid[loop][0]),
+                         &(keyTrans->info.endLabel[loop][0])) &&
+           SetTransEntry(keyTrans,
+                         TranslateResLabel(trans, reverse, loopLen,
+                                           sLoopDef[loop].stop),
+                         &(keyTrans->info.endResid[loop][1]),
+                         &(keyTrans->info.endLabel[loop][1]));
+   }
+
+   if(!ok)
+   {
+      fprintf(stderr,"Error (chothia): No memory for key residue \
+translation\n");
+      FreeKeyTrans(keyTrans);
+      return(NULL);
+   }
+
+   return(keyTrans);
+}
+
+
+/************************************************************************/
+/*>BOOL SetTransEntry(KEYTRANS *keyTrans, char *label, int *resid,
+                      int *transLabel)
+   ---------------------------------------------------------------
+   I/O:     KEYTRANS  *keyTrans    Translated key residues
+   Input:   char      *label       Translated label (NULL if the 
+                                   position is not occupied)
+   Output:  int       *resid       Residue ID, KEY_SCAN if the label
+                                   cannot be encoded or KEY_DELETED
+            int       *transLabel  The label (offset into the string
+                                   pool or -1)
+   Returns: BOOL                   Success?
+
+   Stores a translated residue label in a KEYTRANS to be found with 
+   FindTransRes() as FindRes() would find it.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 The label is copied to the string pool of the KEYTRANS
+*/
+BOOL SetTransEntry(KEYTRANS *keyTrans, char *label, int *resid,
+                   int *transLabel)
+{
+   char *strings;
+   int  length;
+   
+   *transLabel = (-1);
+   if((label == NULL) || !strncmp(label, "---", 3))
+   {
+      *resid = KEY_DELETED;
+      return(TRUE);
+   }
+   if((*resid = EncodeResID(label)) < 0)
+      *resid = KEY_SCAN;
+
+   length = strlen(label) + 1;
+   if(keyTrans->info.nStrings + length > keyTrans->maxStrings)
+   {
+      if((strings = (char *)realloc(keyTrans->strings, 
+                                    keyTrans->maxStrings + 
+                                    length + MAXBUFF)) == NULL)
+         return(FALSE);
+      keyTrans->strings     = strings;
+      keyTrans->maxStrings += length + MAXBUFF;
+   }
+   strcpy(keyTrans->strings + keyTrans->info.nStrings, label);
+   *transLabel = keyTrans->info.nStrings;
+   keyTrans->info.nStrings += length;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int KeyTransContext(KEYTRANS *keyTrans, int *loopLen)
+   -----------------------------------------------------
+   Input:   KEYTRANS  *keyTrans  Translated key residues
+            int       *loopLen   Length of each CDR
+   Returns: int                  Translation context (-1 if there are
+                                 too many to number)
+
+   Gives the context of NumTransContext() from the digits copied from
+   the NUMTRANS.
+
+   16.10.26 Original    By: ACRM
+*/
+int KeyTransContext(KEYTRANS *keyTrans, int *loopLen)
+{
+   int *digit  = keyTrans->digit,
+       context = 0,
+       radix   = 1,
+       maxLength,
+       loop;
+
+   if(keyTrans->info.nContexts < 0)
+      return(-1);
+
+   for(loop=0; loop<NLOOPDEF; loop++)
+   {
+      if((maxLength = keyTrans->info.regionMax[loop]) < 0)
+         continue;
+
+      context += radix * 
+         digit[((loopLen[loop] >= 0) && (loopLen[loop] <= maxLength)) ?
+               loopLen[loop] : (maxLength + 1)];
+      radix   *= maxLength + 2;
+      digit   += maxLength + 2;
+   }
+
+   return(context);
+}
+
+
+/************************************************************************/
+/*>void FreeKeyTrans(KEYTRANS *keyTrans)
+   -------------------------------------
+   Input:   KEYTRANS  *keyTrans  Translated key residues (may be NULL)
+
+   Frees the translated key residues. The arrays of a KEYTRANS mapped
+   from a compiled data file are not freed.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Frees the digits and string pool unless mapped
+*/
+void FreeKeyTrans(KEYTRANS *keyTrans)
+{
+   if(keyTrans == NULL)
+      return;
+
+   if(!keyTrans->mapped)
+   {
+      if(keyTrans->region != NULL)  free(keyTrans->region);
+      if(keyTrans->first != NULL)   free(keyTrans->first);
+      if(keyTrans->resid != NULL)   free(keyTrans->resid);
+      if(keyTrans->label != NULL)   free(keyTrans->label);
+      if(keyTrans->digit != NULL)   free(keyTrans->digit);
+      if(keyTrans->strings != NULL) free(keyTrans->strings);
+   }
+   free(keyTrans);
+}
@@ -0,0 +1,738 @@
+/*************************************************************************
+
+   Program:    Chothia
+   File:       match.c
+
+   Version:    V2.30
+   Date:       16.10.26
+   Function:   Vectorized test of the key residues of a loop against all
+               the classes of the same length
+
+   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2026
+   Author:     Prof. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Part of libchothia. For each bucket of candidates (loop and length)
+   a MATCHKERNEL holds the distinct key positions of all its classes
+   and, for each of these positions, the bit mask of residue types
+   allowed by each class in the bucket. Classes are in the order of the
+   links of the candidates, which is the order in which ClassifyLoop()
+   tests them. A class with no key residue at a position allows
+   anything there.
+
+   Once the residue at each position has been found, the mismatches
+   against every class in the bucket are counted at once: the residue
+   is broadcast and ANDed with the masks of 8 (AVX2) or 4 (SSE2)
+   classes at a time. The vector code is used when the compiler is
+   targeting those instruction sets (e.g. with -mavx2); otherwise a
+   plain C loop is used, which compilers will often vectorize
+   themselves. A residue which is missing or deleted is given the bit
+   MATCH_MISSING, which no class allows.
+
+   For a block of sequences with loops of the same length, the test is
+   transposed: each bit of an unsigned long is a sequence, so each
+   class is tested against 64 sequences (32 where a long is 32 bits) 
+   at a time with bitwise operations. At each position, the sequences
+   are grouped by the residue found, and the sequences matching a class
+   are the OR of the groups of the types it allows. The mismatches of 
+   each sequence are counted in bit planes, so that bit s of plane p is
+   bit p of the count for sequence s.
+
+   Buckets with more than MAXMATCHKEYS positions or MAXMATCHLANES
+   classes, or with a class having two key residues with the same
+   label, have no masks and are tested by TestThisCanonical() instead.
+
+   The kernel is not modified once built, so may be shared between
+   threads. Its arrays may be stored in a compiled data file and used
+   from there with MapMatchKernel().
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.22 16.10.26 Original. The distinct key positions of each bucket
+                  were previously found by the CANONCACHE
+   V2.23 16.10.26 Added CountBlockMismatches() to test a block of
+                  sequences against the classes of a bucket
+   V2.27 16.10.26 Added MatchKernelMasks() for building a CLASSTREE
+   V2.30 16.10.26 Added MatchKernelArrays() and MapMatchKernel() so that
+                  the kernel may be stored in a compiled data file
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "chothia.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#if defined(__AVX2__)
+#define MATCHWIDTH   8           /* Classes tested by each instruction  */
+#elif defined(__SSE2__)
+#define MATCHWIDTH   4
+#else
+#define MATCHWIDTH   1
+#endif
+
+#define MATCHPAD     8           /* Classes in each bucket padded to a
+                                    multiple of this                    */
+
+struct _matchkernel
+{
+   int          *keyFirst,          /* Offset of first key position     */
+                *keyCount,          /*    and number of positions for
+                                       each bucket                      */
+                *keys,              /* Key residue (offset into the
+                                       table) at each position          */
+                *maskFirst,         /* Offset of first mask and number  */
+                *nLane,             /*    of classes (padded; 0 if no
+                                       masks) for each bucket           */
+                maxKeys,            /* Most positions in one bucket     */
+                nKey,               /* Entries of keys[]                */
+                nMask;              /*    and of masks[]                */
+   unsigned int *masks;             /* Allowed residue types for each
+                                       position and class               */
+   BOOL         mapped;             /* Arrays owned by the caller?      */
+};
+
+/************************************************************************/
+/* Prototypes
+*/
+BOOL FindMatchKeys(MATCHKERNEL *kernel, CANONTABLE *table);
+BOOL BuildMatchMasks(MATCHKERNEL *kernel, CANONTABLE *table);
+int  FindMatchKey(MATCHKERNEL *kernel, CANONTABLE *table, int bucket,
+                  int key);
+
+
+/************************************************************************/
+/*>MATCHKERNEL *BuildMatchKernel(CANONTABLE *table)
+   ------------------------------------------------
+   Input:   CANONTABLE  *table    Compiled canonical definitions
+   Returns: MATCHKERNEL *         The kernel (NULL if no memory)
+
+   Builds the key positions and masks for each bucket of candidates
+
+   16.10.26 Original    By: ACRM
+*/
+MATCHKERNEL *BuildMatchKernel(CANONTABLE *table)
+{
+   MATCHKERNEL *kernel;
+
+   if((kernel = (MATCHKERNEL *)calloc(1, sizeof(MATCHKERNEL)))==NULL)
+      return(NULL);
+
+   if(!FindMatchKeys(kernel, table) || !BuildMatchMasks(kernel, table))
+   {
+      FreeMatchKernel(kernel);
+      return(NULL);
+   }
+
+   return(kernel);
+}
+
+
+/************************************************************************/
+/*>void FreeMatchKernel(MATCHKERNEL *kernel)
+   -----------------------------------------
+   Input:   MATCHKERNEL *kernel   Matching kernel (may be NULL)
+
+   The arrays of a kernel from MapMatchKernel() are not freed.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Does not free the arrays of a mapped kernel
+*/
+void FreeMatchKernel(MATCHKERNEL *kernel)
+{
+   if(kernel == NULL)
+      return;
+
+   if(kernel->mapped)
+   {
+      free(kernel);
+      return;
+   }
+
+   if(kernel->keyFirst != NULL)  free(kernel->keyFirst);
+   if(kernel->keyCount != NULL)  free(kernel->keyCount);
+   if(kernel->keys != NULL)      free(kernel->keys);
+   if(kernel->maskFirst != NULL) free(kernel->maskFirst);
+   if(kernel->nLane != NULL)     free(kernel->nLane);
+   if(kernel->masks != NULL)     free(kernel->masks);
+   free(kernel);
+}
+
+
+/************************************************************************/
+/*>void MatchKernelArrays(MATCHKERNEL *kernel, int nBucket, 
+                          void **arrays, size_t *sizes)
+   -------------------------------------------------------------
+   Input:   MATCHKERNEL *kernel   Matching kernel
+            int         nBucket   Number of buckets of candidates
+   Output:  void        **arrays  The NKERNELARRAY arrays of the kernel
+            size_t      *sizes    Size of each in bytes
+
+   Gives the arrays of a kernel so that they may be stored in a 
+   compiled data file, in the order expected by MapMatchKernel().
+
+   16.10.26 Original    By: ACRM
+*/
+void MatchKernelArrays(MATCHKERNEL *kernel, int nBucket, void **arrays,
+                       size_t *sizes)
+{
+   arrays[0] = kernel->keyFirst;
+   arrays[1] = kernel->keyCount;
+   arrays[2] = kernel->keys;
+   arrays[3] = kernel->maskFirst;
+   arrays[4] = kernel->nLane;
+   arrays[5] = kernel->masks;
+   sizes[0]  = nBucket * sizeof(int);
+   sizes[1]  = nBucket * sizeof(int);
+   sizes[2]  = kernel->nKey * sizeof(int);
+   sizes[3]  = nBucket * sizeof(int);
+   sizes[4]  = nBucket * sizeof(int);
+   sizes[5]  = kernel->nMask * sizeof(unsigned int);
+}
+
+
+/************************************************************************/
+/*>MATCHKERNEL *MapMatchKernel(void **arrays, int maxKeys)
+   -------------------------------------------------------
+   Input:   void        **arrays  The arrays from MatchKernelArrays()
+            int         maxKeys   From MatchKernelMaxKeys()
+   Returns: MATCHKERNEL *         The kernel (NULL if no memory)
+
+   Makes a kernel which uses arrays stored in a compiled data file. 
+   These are not copied and must not be freed before the kernel.
+
+   16.10.26 Original    By: ACRM
+*/
+MATCHKERNEL *MapMatchKernel(void **arrays, int maxKeys)
+{
+   MATCHKERNEL *kernel;
+
+   if((kernel = (MATCHKERNEL *)calloc(1, sizeof(MATCHKERNEL)))==NULL)
+      return(NULL);
+
+   kernel->keyFirst  = (int *)arrays[0];
+   kernel->keyCount  = (int *)arrays[1];
+   kernel->keys      = (int *)arrays[2];
+   kernel->maskFirst = (int *)arrays[3];
+   kernel->nLane     = (int *)arrays[4];
+   kernel->masks     = (unsigned int *)arrays[5];
+   kernel->maxKeys   = maxKeys;
+   kernel->mapped    = TRUE;
+
+   return(kernel);
+}
+
+
+/************************************************************************/
+/*>int *MatchKernelKeys(MATCHKERNEL *kernel, int bucket, int *nKeys)
+   -----------------------------------------------------------------
+   Input:   MATCHKERNEL *kernel   Matching kernel
+            int         bucket    Bucket of candidates
+   Output:  int         *nKeys    Number of key positions
+   Returns: int         *         Key residue (offset into the table)
+                                  at each position
+
+   16.10.26 Original    By: ACRM
+*/
+int *MatchKernelKeys(MATCHKERNEL *kernel, int bucket, int *nKeys)
+{
+   *nKeys = kernel->keyCount[bucket];
+   return(kernel->keys + kernel->keyFirst[bucket]);
+}
+
+
+/************************************************************************/
+/*>int MatchKernelMaxKeys(MATCHKERNEL *kernel)
+   -------------------------------------------
+   Input:   MATCHKERNEL *kernel   Matching kernel
+   Returns: int                   Most key positions in one bucket
+
+   16.10.26 Original    By: ACRM
+*/
+int MatchKernelMaxKeys(MATCHKERNEL *kernel)
+{
+   return(kernel->maxKeys);
+}
+
+
+/************************************************************************/
+/*>BOOL MatchKernelUsable(MATCHKERNEL *kernel, int bucket)
+   -------------------------------------------------------
+   Input:   MATCHKERNEL *kernel   Matching kernel (may be NULL)
+            int         bucket    Bucket of candidates
+   Returns: BOOL                  Can CountMismatches() be used for the
+                                  bucket?
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL MatchKernelUsable(MATCHKERNEL *kernel, int bucket)
+{
+   return((kernel != NULL) && (kernel->nLane[bucket] > 0));
+}
+
+
+/************************************************************************/
+/*>unsigned int *MatchKernelMasks(MATCHKERNEL *kernel, int bucket,
+                                  int *nLane)
+   ----------------------------------------------------------------
+   Input:   MATCHKERNEL  *kernel   Matching kernel
+            int          bucket    Bucket of candidates (must be usable)
+   Output:  int          *nLane    Classes of each position (padded)
+   Returns: unsigned int *         Allowed residue types of class c at
+                                   position p, at p*nLane + c
+
+   16.10.26 Original    By: ACRM
+*/
+unsigned int *MatchKernelMasks(MATCHKERNEL *kernel, int bucket,
+                               int *nLane)
+{
+   *nLane = kernel->nLane[bucket];
+   return(kernel->masks + kernel->maskFirst[bucket]);
+}
+
+
+/************************************************************************/
+/*>void CountMismatches(MATCHKERNEL *kernel, int bucket,
+                        unsigned int *observed, int *counts)
+   ----------------------------------------------------------
+   Input:   MATCHKERNEL  *kernel    Matching kernel
+            int          bucket     Bucket of candidates
+            unsigned int *observed  Bit of the residue type found at
+                                    each key position (MATCH_MISSING if
+                                    none)
+   Output:  int          *counts    Mismatches against each class, in
+                                    the order of the links of the
+                                    candidates (MAXMATCHLANES)
+
+   Counts the key residues which mismatch each class in a bucket. The
+   bucket must be usable (see MatchKernelUsable()).
+
+   16.10.26 Original    By: ACRM
+*/
+void CountMismatches(MATCHKERNEL *kernel, int bucket,
+                     unsigned int *observed, int *counts)
+{
+   unsigned int *masks = kernel->masks + kernel->maskFirst[bucket];
+   int          nKeys  = kernel->keyCount[bucket],
+                nLane  = kernel->nLane[bucket],
+                lane,
+                pos;
+#if defined(__AVX2__)
+   __m256i      zero   = _mm256_setzero_si256(),
+                count,
+                seen;
+
+   for(lane=0; lane<nLane; lane+=MATCHWIDTH)
+   {
+      count = zero;
+      for(pos=0; pos<nKeys; pos++)
+      {
+         seen  = _mm256_and_si256(
+                    _mm256_set1_epi32((int)observed[pos]),
+                    _mm256_loadu_si256((__m256i *)(masks + pos*nLane +
+                                                   lane)));
+         /* A mismatch gives -1 in its lane                             */
+         count = _mm256_sub_epi32(count,
+                                  _mm256_cmpeq_epi32(seen, zero));
+      }
+      _mm256_storeu_si256((__m256i *)(counts + lane), count);
+   }
+#elif defined(__SSE2__)
+   __m128i      zero   = _mm_setzero_si128(),
+                count,
+                seen;
+
+   for(lane=0; lane<nLane; lane+=MATCHWIDTH)
+   {
+      count = zero;
+      for(pos=0; pos<nKeys; pos++)
+      {
+         seen  = _mm_and_si128(
+                    _mm_set1_epi32((int)observed[pos]),
+                    _mm_loadu_si128((__m128i *)(masks + pos*nLane +
+                                                lane)));
+         /* A mismatch gives -1 in its lane                             */
+         count = _mm_sub_epi32(count, _mm_cmpeq_epi32(seen, zero));
+      }
+      _mm_storeu_si128((__m128i *)(counts + lane), count);
+   }
+#else
+   unsigned int seen;
+
+   for(lane=0; lane<nLane; lane++)
+      counts[lane] = 0;
+   for(pos=0; pos<nKeys; pos++)
+   {
+      seen = observed[pos];
+      for(lane=0; lane<nLane; lane++)
+         counts[lane] += ((masks[pos*nLane + lane] & seen) == 0);
+   }
+#endif
+}
+
+
+/************************************************************************/
+/*>void CountBlockMismatches(MATCHKERNEL *kernel, int bucket,
+                             unsigned int *observed, int nSeq,
+                             unsigned long *planes)
+   ---------------------------------------------------------------
+   Input:   MATCHKERNEL   *kernel   Matching kernel
+            int           bucket    Bucket of candidates
+            unsigned int  *observed Bit of the residue type found at
+                                    each key position of each sequence
+                                    (MATCH_MISSING if none). Position
+                                    p of sequence s is at 
+                                    p*BLOCKSEQS + s
+            int           nSeq      Number of sequences (up to 
+                                    BLOCKSEQS)
+   Output:  unsigned long *planes   Bit planes of the mismatches of 
+                                    each sequence against each class
+                                    (MAXMATCHLANES * MATCHPLANES)
+
+   Counts the key residues of a block of sequences which mismatch each
+   class in a bucket. The counts are read with BlockMatches() and
+   BlockMismatches(). The bucket must be usable (see 
+   MatchKernelUsable()).
+
+   16.10.26 Original    By: ACRM
+*/
+void CountBlockMismatches(MATCHKERNEL *kernel, int bucket,
+                          unsigned int *observed, int nSeq,
+                          unsigned long *planes)
+{
+   unsigned int  *masks = kernel->masks + kernel->maskFirst[bucket],
+                 type[BLOCKSEQS],
+                 allowed;
+   unsigned long seqs[BLOCKSEQS],
+                 live,
+                 carry,
+                 *count;
+   int           nKeys  = kernel->keyCount[bucket],
+                 nLane  = kernel->nLane[bucket],
+                 nType,
+                 lane,
+                 pos,
+                 s, t, p;
+
+   live = (nSeq >= BLOCKSEQS) ? ~0UL : ((1UL << nSeq) - 1UL);
+   for(p=0; p<nLane*MATCHPLANES; p++)
+      planes[p] = 0UL;
+
+   for(pos=0; pos<nKeys; pos++)
+   {
+      /* Group the sequences by the residue found at this position      */
+      nType = 0;
+      for(s=0; s<nSeq; s++)
+      {
+         for(t=0; (t<nType) && (type[t] != observed[pos*BLOCKSEQS+s]);
+             t++);
+         if(t == nType)
+         {
+            type[nType]   = observed[pos*BLOCKSEQS+s];
+            seqs[nType++] = 0UL;
+         }
+         seqs[t] |= (1UL << s);
+      }
+
+      for(lane=0; lane<nLane; lane++)
+      {
+         /* Find the sequences which mismatch this class here           */
+         allowed = masks[pos*nLane + lane];
+         carry   = live;
+         for(t=0; t<nType; t++)
+         {
+            if(allowed & type[t])
+               carry &= ~seqs[t];
+         }
+
+         /* Add one to their counts, propagating the carry up through
+            the planes
+         */
+         count = planes + (lane * MATCHPLANES);
+         for(p=0; carry && (p<MATCHPLANES); p++)
+         {
+            count[p] ^= carry;
+            carry    &= ~count[p];
+         }
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>unsigned long BlockMatches(unsigned long *planes, int lane, int nSeq)
+   ---------------------------------------------------------------------
+   Input:   unsigned long *planes   Bit planes from 
+                                    CountBlockMismatches()
+            int           lane      Class (in the order of the links of
+                                    the candidates)
+            int           nSeq      Number of sequences in the block
+   Returns: unsigned long           Bit set for each sequence with no
+                                    mismatches against the class
+
+   16.10.26 Original    By: ACRM
+*/
+unsigned long BlockMatches(unsigned long *planes, int lane, int nSeq)
+{
+   unsigned long any = 0UL;
+   int           p;
+
+   planes += lane * MATCHPLANES;
+   for(p=0; p<MATCHPLANES; p++)
+      any |= planes[p];
+
+   return(~any & ((nSeq >= BLOCKSEQS) ? ~0UL : ((1UL << nSeq) - 1UL)));
+}
+
+
+/************************************************************************/
+/*>int BlockMismatches(unsigned long *planes, int lane, int seq)
+   -------------------------------------------------------------
+   Input:   unsigned long *planes   Bit planes from 
+                                    CountBlockMismatches()
+            int           lane      Class (in the order of the links of
+                                    the candidates)
+            int           seq       Sequence in the block
+   Returns: int                     Mismatches of the sequence against
+                                    the class
+
+   16.10.26 Original    By: ACRM
+*/
+int BlockMismatches(unsigned long *planes, int lane, int seq)
+{
+   int count = 0,
+       p;
+
+   planes += lane * MATCHPLANES;
+   for(p=MATCHPLANES-1; p>=0; p--)
+      count = (count << 1) | (int)((planes[p] >> seq) & 1UL);
+
+   return(count);
+}
+
+
+/************************************************************************/
+/*>BOOL FindMatchKeys(MATCHKERNEL *kernel, CANONTABLE *table)
+   ----------------------------------------------------------
+   I/O:     MATCHKERNEL *kernel   Matching kernel
+   Input:   CANONTABLE  *table    Compiled canonical definitions
+   Returns: BOOL                  Success?
+
+   Finds the distinct key residues of the classes in each bucket of
+   candidates. Key residues with the same label are always found at
+   the same position in a sequence, so only the first is used.
+
+   16.10.26 Original    By: ACRM (moved from BuildFingerprintKeys() in
+            cache.c)
+   16.10.26 Records the number of positions
+*/
+BOOL FindMatchKeys(MATCHKERNEL *kernel, CANONTABLE *table)
+{
+   CANONCLASS *canon;
+   CANDIDATE  *cand;
+   int        nBucket = NLOOPDEF * (table->maxLength + 1),
+              nKeys   = 0,
+              b, i, link, key;
+
+   /* A class may be in the priority chains of more than one bucket, so
+      the keys are counted through the links
+   */
+   for(link=0; link<table->nLink; link++)
+      nKeys += table->classes[table->links[link]].nKey;
+
+   kernel->keyFirst = (int *)malloc(nBucket * sizeof(int));
+   kernel->keyCount = (int *)calloc(nBucket, sizeof(int));
+   kernel->keys     = (int *)malloc((nKeys + 1) * sizeof(int));
+   if((kernel->keyFirst == NULL) || (kernel->keyCount == NULL) ||
+      (kernel->keys == NULL))
+      return(FALSE);
+
+   nKeys = 0;
+   for(b=0; b<nBucket; b++)
+   {
+      kernel->keyFirst[b] = nKeys;
+      for(i=0; i<table->buckets[b].n; i++)
+      {
+         cand = &(table->candidates[table->buckets[b].first + i]);
+         for(link=cand->firstLink; link<cand->firstLink+cand->nLink;
+             link++)
+         {
+            canon = &(table->classes[table->links[link]]);
+            for(key=canon->firstKey; key<canon->firstKey+canon->nKey;
+                key++)
+            {
+               /* Search the positions found so far                     */
+               kernel->keyCount[b] = nKeys - kernel->keyFirst[b];
+               if(FindMatchKey(kernel, table, b, key) < 0)
+                  kernel->keys[nKeys++] = key;
+            }
+         }
+      }
+      kernel->keyCount[b] = nKeys - kernel->keyFirst[b];
+      if(kernel->keyCount[b] > kernel->maxKeys)
+         kernel->maxKeys = kernel->keyCount[b];
+   }
+   kernel->nKey = nKeys;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL BuildMatchMasks(MATCHKERNEL *kernel, CANONTABLE *table)
+   ------------------------------------------------------------
+   I/O:     MATCHKERNEL *kernel   Matching kernel with its key positions
+   Input:   CANONTABLE  *table    Compiled canonical definitions
+   Returns: BOOL                  Success?
+
+   Builds the mask of allowed residue types for each key position and
+   class of each bucket. Masks are held by position, with the classes
+   of a position contiguous.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Records the number of masks
+*/
+BOOL BuildMatchMasks(MATCHKERNEL *kernel, CANONTABLE *table)
+{
+   CANONCLASS   *canon;
+   CANDIDATE    *first;
+   unsigned int *masks;
+   int          nBucket = NLOOPDEF * (table->maxLength + 1),
+                nMask   = 0,
+                b, pos, lane, nClass, key;
+
+   kernel->maskFirst = (int *)calloc(nBucket, sizeof(int));
+   kernel->nLane     = (int *)calloc(nBucket, sizeof(int));
+   if((kernel->maskFirst == NULL) || (kernel->nLane == NULL))
+      return(FALSE);
+
+   /* The links of the candidates in a bucket are contiguous           */
+   for(b=0; b<nBucket; b++)
+   {
+      if(table->buckets[b].n == 0)
+         continue;
+      first  = &(table->candidates[table->buckets[b].first]);
+      nClass = first[table->buckets[b].n - 1].firstLink +
+               first[table->buckets[b].n - 1].nLink - first->firstLink;
+      if((nClass <= MAXMATCHLANES) &&
+         (kernel->keyCount[b] <= MAXMATCHKEYS))
+      {
+         kernel->maskFirst[b] = nMask;
+         kernel->nLane[b]     = MATCHPAD *
+                                ((nClass + MATCHPAD - 1) / MATCHPAD);
+         nMask += kernel->nLane[b] * kernel->keyCount[b];
+      }
+   }
+
+   if((kernel->masks = (unsigned int *)malloc((nMask + 1) *
+                                              sizeof(unsigned int)))
+      == NULL)
+      return(FALSE);
+   kernel->nMask = nMask;
+
+   for(b=0; b<nBucket; b++)
+   {
+      if(kernel->nLane[b] == 0)
+         continue;
+
+      /* Padding classes allow anything                                 */
+      masks = kernel->masks + kernel->maskFirst[b];
+      for(pos=0; pos < kernel->nLane[b] * kernel->keyCount[b]; pos++)
+         masks[pos] = ~0U;
+
+      first = &(table->candidates[table->buckets[b].first]);
+      for(lane=0;
+          lane < first[table->buckets[b].n - 1].firstLink +
+                 first[table->buckets[b].n - 1].nLink - first->firstLink;
+          lane++)
+      {
+         canon = &(table->classes[table->links[first->firstLink+lane]]);
+         for(key=canon->firstKey; key<canon->firstKey+canon->nKey; key++)
+         {
+            pos = FindMatchKey(kernel, table, b, key);
+
+            /* Each key residue must be counted, so a class with two at
+               the same position cannot use the kernel
+            */
+            if(masks[pos*kernel->nLane[b] + lane] != ~0U)
+            {
+               kernel->nLane[b] = 0;
+               break;
+            }
+            masks[pos*kernel->nLane[b] + lane] = table->keyAllowed[key];
+         }
+         if(kernel->nLane[b] == 0)
+            break;
+      }
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int FindMatchKey(MATCHKERNEL *kernel, CANONTABLE *table, int bucket,
+                    int key)
+   ---------------------------------------------------------------------
+   Input:   MATCHKERNEL *kernel   Matching kernel
+            CANONTABLE  *table    Compiled canonical definitions
+            int         bucket    Bucket of candidates
+            int         key       Key residue (offset into the table)
+   Returns: int                   Position of the key residue label in
+                                  the bucket (-1 if not there)
+
+   16.10.26 Original    By: ACRM
+*/
+int FindMatchKey(MATCHKERNEL *kernel, CANONTABLE *table, int bucket,
+                 int key)
+{
+   char *label = table->strings + table->keyLabel[key];
+   int  *keys  = kernel->keys + kernel->keyFirst[bucket],
+        pos;
+
+   for(pos=0; pos<kernel->keyCount[bucket]; pos++)
+   {
+      if(!strcmp(table->strings + table->keyLabel[keys[pos]], label))
+         return(pos);
+   }
+   return(-1);
+}
@@ -0,0 +1,996 @@
+/*************************************************************************
+
+   Program:    Chothia
+   File:       numbering.c
+
+   Version:    V2.32
+   Date:       16.10.26
+   Function:   Read raw antibody sequences and apply Kabat (or Chothia)
+               numbering
+
+   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2026
+   Author:     Prof. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Part of libchothia. Reads sequences in FASTA or PIR format and
+   numbers the variable domains found in memory, so that the SEQUENCE
+   array can be used directly rather than running KabatSeq first.
+
+   Files are read in chunks of SEQREADBUFF bytes which are parsed in 
+   place, so only the residues of the current record are held. The
+   buffer for these is grown for long records and reused. If 
+   compiled with USE_ZLIB, files (including stdin) are read through 
+   zlib, so may be gzipped.
+
+   The numbering is based on the conserved residues of the framework
+   regions rather than a full alignment:
+
+   Light chain:  Cys L23, Trp L35, Cys L88 and Phe-Gly-X-Gly at L98-L101
+                 CDR-L1 (L24-L34) is 10-17 residues with insertions at
+                 L27A-F (L28 is deleted for 10 residues). CDR-L2 is
+                 always L50-L56. CDR-L3 (L89-L97) is 7-11 residues
+                 with insertions at L95A-B (or L95 and L96 deleted).
+   Heavy chain:  Cys H22, Trp H36, Cys H92 and Trp-Gly-X-Gly at
+                 H103-H106. CDR-H1 (H26-H35B) is 10-12 residues with
+                 insertions at H35A-B. CDR-H2 (H50-H65) is 16-19
+                 residues with insertions at H52A-C. FR3 always has
+                 H82A-C. CDR-H3 (H95-H102) is 2-30 residues with
+                 insertions at H100A onwards (or deletions from H100
+                 down).
+
+   Residues before the start of FR1 are not numbered and numbering
+   stops at the end of FR4 (L109, H113). If the C-terminal motif is
+   not found (e.g. a truncated sequence), numbering stops at L88 or
+   H94. A sequence may contain a light and a heavy chain domain (in
+   either order, e.g. an scFv, or separate chains in a PIR entry).
+
+   Must be linked with KabCho.c from KabatMan
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.12 16.10.26 Original
+   V2.13 16.10.26 Sequences are read through a SEQREADER which parses
+                  large chunks of the file in place (optionally through
+                  zlib) so files of any size and line length are read
+                  in constant memory
+   V2.26 16.10.26 The residues of a record and the numbered sequence
+                  array are grown as needed rather than limited to
+                  MAXSEQ
+   V2.32 16.10.26 Light chains are numbered to L109 (rather than L107)
+                  unless the heavy chain domain follows at once
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L  /* For fileno() and dup()              */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef USE_ZLIB
+#  include <unistd.h>
+#  include <zlib.h>
+#endif
+
+#include "chothia.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MINLEN_L1    10          /* Range of CDR-L1 lengths (L24-L34)   */
+#define MAXLEN_L1    17
+#define MINLEN_L3    7           /* Range of CDR-L3 lengths (L89-L97)   */
+#define MAXLEN_L3    11
+#define MINLEN_H1    10          /* Range of CDR-H1 lengths (H26-H35B)  */
+#define MAXLEN_H1    12
+#define MINLEN_H2    16          /* Range of CDR-H2 lengths (H50-H65)   */
+#define MAXLEN_H2    19
+#define MINLEN_H3    2           /* Range of CDR-H3 lengths (H95-H102)  */
+#define MAXLEN_H3    30
+
+/* Light chain framework spacings. From Trp L35 to the start of CDR-L2
+   (L50) and from the start of CDR-L2 to Cys L88
+*/
+#define LIGHT_W35_L50 15
+#define LIGHT_L50_C88 38
+/* Heavy chain framework spacings. From Cys H22 to the start of CDR-H1
+   (H26), from Trp H36 to the start of CDR-H2 (H50), from the end of
+   CDR-H2 to Cys H92 and from Cys H92 to the start of CDR-H3 (H95)
+*/
+#define HEAVY_C22_H26 4
+#define HEAVY_W36_H50 14
+#define HEAVY_H66_C92 29
+#define HEAVY_C92_H95 3
+
+#define SEQREADBUFF  (1 << 20)   /* Size of chunks read from input      */
+#define SEQRESBUFF   1024        /* Initial size of record residues     */
+
+#define READ_SEQUENCE 0          /* Sequence reader states: reading the */
+#define READ_HEADER   1          /*    sequence, a >header line or the  */
+#define READ_TITLE    2          /*    PIR title line after it          */
+
+/* Tests for Phe/Trp-Gly-X-Gly at offset i of a sequence of length n  */
+#define FGXG(s, n, i) (((i)+3 < (n)) && ((s)[(i)] == 'F') &&          \
+                       ((s)[(i)+1] == 'G') && ((s)[(i)+3] == 'G'))
+#define WGXG(s, n, i) (((i)+3 < (n)) && ((s)[(i)] == 'W') &&          \
+                       ((s)[(i)+1] == 'G') && ((s)[(i)+3] == 'G'))
+
+/* A variable domain found in a sequence. The offsets are into the raw
+   sequence and the lengths are of the CDRs                             */
+typedef struct
+{
+   int   cys1,                      /* Offset of Cys L23 or H22         */
+         cys2,                      /* Offset of Cys L88 or H92         */
+         cdr1len,                   /* Length of CDR-L1 or H1           */
+         cdr2len,                   /* Length of CDR-H2                 */
+         cdr3len,                   /* Length of CDR-L3 or H3 (0 if the
+                                       end of the domain was not found) */
+         first,                     /* Offset of first residue numbered */
+         last,                      /* Offset of last residue numbered  */
+         tail,                      /* Residues after last which may be
+                                       numbered if not in another 
+                                       domain (L108-L109)               */
+         score;                     /* Number of conserved residues
+                                       found (0 if no domain)           */
+}  DOMAIN;
+
+/* State of a sequence reader                                          */
+struct _seqreader
+{
+   FILE   *fp;                      /* Input file (if not using zlib)   */
+#ifdef USE_ZLIB
+   gzFile gz;                       /* Input file (if using zlib)       */
+#endif
+   char   *buffer,                  /* Chunk of input                   */
+          *seq,                     /* Residues of current record       */
+          header[MAXBUFF];          /* Header line of current record    */
+   size_t length,                   /* Bytes in buffer                  */
+          offset;                   /* Next byte to parse               */
+   int    maxSeq;                   /* Allocated size of seq            */
+   BOOL   lineStart,                /* Next byte starts a line?         */
+          eof;                      /* End of input reached?            */
+};
+
+/************************************************************************/
+/* Globals
+*/
+/* Residues deleted (in this order) when a loop is shorter than the
+   standard Kabat numbering for it                                      */
+static int sDeleteL1[] = {28, 0};
+static int sDeleteL3[] = {95, 96, 0};
+static int sDeleteH3[] = {100, 99, 98, 97, 96, 0};
+static int sDeleteNone[] = {0};
+
+/************************************************************************/
+/* Prototypes
+*/
+BOOL ParseSequenceHeader(char *header, char *id);
+BOOL FillSequenceBuffer(SEQREADER *reader);
+BOOL GrowRecordBuffer(SEQREADER *reader);
+BOOL FindLightDomain(char *seq, int length, DOMAIN *domain);
+BOOL FindHeavyDomain(char *seq, int length, DOMAIN *domain);
+int  NumberLightDomain(char *seq, DOMAIN *domain, BOOL chothia,
+                       SEQUENCE *Sequence, int NRes);
+int  NumberHeavyDomain(char *seq, DOMAIN *domain, BOOL chothia,
+                       SEQUENCE *Sequence, int NRes);
+int  NumberRange(char *seq, int offset, char chain, int first, int last,
+                 SEQUENCE *Sequence, int NRes);
+int  NumberLoop(char *seq, int offset, int length, char chain,
+                int first, int last, int insertAfter, int *deletions,
+                SEQUENCE *Sequence, int NRes);
+void ConvertToChothia(char *cdr, int length, SEQUENCE *Sequence,
+                      int first, int last);
+
+
+/************************************************************************/
+/*>SEQREADER *OpenSequenceReader(FILE *fp)
+   ---------------------------------------
+   Input:   FILE       *fp     Input file pointer
+   Returns: SEQREADER  *       Sequence reader (NULL if no memory)
+
+   Creates a reader for FASTA or PIR sequences from a file. The reader 
+   buffers the input itself, so nothing else should read from the file
+   while it is in use. If compiled with USE_ZLIB and the file is a real 
+   file (or pipe), it is read through zlib and so may be gzipped. 
+
+   16.10.26 Original    By: ACRM
+*/
+SEQREADER *OpenSequenceReader(FILE *fp)
+{
+   SEQREADER *reader;
+#ifdef USE_ZLIB
+   int       fd;
+#endif
+
+   if((reader = (SEQREADER *)malloc(sizeof(SEQREADER)))==NULL)
+      return(NULL);
+   if((reader->buffer = (char *)malloc(SEQREADBUFF))==NULL)
+   {
+      free(reader);
+      return(NULL);
+   }
+   if((reader->seq = (char *)malloc(SEQRESBUFF))==NULL)
+   {
+      free(reader->buffer);
+      free(reader);
+      return(NULL);
+   }
+   reader->maxSeq = SEQRESBUFF;
+
+   reader->fp        = fp;
+   reader->length    = 0;
+   reader->offset    = 0;
+   reader->lineStart = TRUE;
+   reader->eof       = FALSE;
+   
+#ifdef USE_ZLIB
+   /* zlib reads from a descriptor of its own so the file may still be
+      closed by the caller. Memory streams have no descriptor so are
+      read directly
+   */
+   reader->gz = NULL;
+   if((fd = fileno(fp)) >= 0)
+   {
+      if(((fd = dup(fd)) < 0) || 
+         ((reader->gz = gzdopen(fd, "rb")) == NULL))
+      {
+         if(fd >= 0)
+            close(fd);
+         CloseSequenceReader(reader);
+         return(NULL);
+      }
+      gzbuffer(reader->gz, SEQREADBUFF);
+   }
+#endif
+
+   return(reader);
+}
+
+
+/************************************************************************/
+/*>void CloseSequenceReader(SEQREADER *reader)
+   -------------------------------------------
+   I/O:     SEQREADER  *reader   Sequence reader
+
+   Frees a sequence reader. The file from which it was reading is not
+   closed.
+
+   16.10.26 Original    By: ACRM
+*/
+void CloseSequenceReader(SEQREADER *reader)
+{
+   if(reader != NULL)
+   {
+#ifdef USE_ZLIB
+      if(reader->gz != NULL)
+         gzclose(reader->gz);
+#endif
+      free(reader->buffer);
+      free(reader->seq);
+      free(reader);
+   }
+}
+
+
+/************************************************************************/
+/*>BOOL FillSequenceBuffer(SEQREADER *reader)
+   ------------------------------------------
+   I/O:     SEQREADER  *reader   Sequence reader
+   Returns: BOOL                 Was more data read?
+
+   Reads the next chunk of input into the reader's buffer once the
+   previous chunk has been parsed.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL FillSequenceBuffer(SEQREADER *reader)
+{
+   int nread;
+   
+   if(reader->eof)
+      return(FALSE);
+
+#ifdef USE_ZLIB
+   if(reader->gz != NULL)
+      nread = gzread(reader->gz, reader->buffer, SEQREADBUFF);
+   else
+#endif
+      nread = fread(reader->buffer, 1, SEQREADBUFF, reader->fp);
+
+   if(nread <= 0)
+   {
+      reader->eof = TRUE;
+      return(FALSE);
+   }
+   
+   reader->length = nread;
+   reader->offset = 0;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL GrowRecordBuffer(SEQREADER *reader)
+   ----------------------------------------
+   I/O:     SEQREADER  *reader   Sequence reader
+   Returns: BOOL                 Success?
+
+   Doubles the size of the buffer for the residues of a record
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL GrowRecordBuffer(SEQREADER *reader)
+{
+   char *seq;
+
+   if((seq = (char *)realloc(reader->seq, 2 * reader->maxSeq))==NULL)
+      return(FALSE);
+   reader->seq     = seq;
+   reader->maxSeq *= 2;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int ReadSequenceRecord(SEQREADER *reader, SEQUENCE **Sequence, 
+                          int *maxRes, char *id, char chain, 
+                          BOOL chothia)
+   ---------------------------------------------------------------
+   Input:   SEQREADER *reader     Sequence reader
+            char      chain       Chain to number (both if ' ')
+            BOOL      chothia     Apply Chothia (rather than Kabat)
+                                  numbering
+   I/O:     SEQUENCE  **Sequence  Numbered sequence array, grown as 
+                                  needed by GrowSequence() (may be 
+                                  NULL)
+            int       *maxRes     Allocated size of sequence array
+   Output:  char      *id         ID of the record (blank if none)
+   Returns: int                   Number of residues numbered
+                                  0 if the record could not be read or
+                                    numbered
+                                  -1 if there are no more records
+
+   Reads one entry from a FASTA or PIR file and numbers it. Each entry
+   starts with a >id line; for PIR (>P1;id) the following title line
+   is skipped. The sequence may span any number of lines of any length
+   and anything other than letters (spaces, digits, the PIR * 
+   terminator, gaps and / chain separators) is ignored.
+
+   The input is parsed in place in the reader's buffer. The record ends
+   at a line starting with > which is left to start the next record.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Reads through a SEQREADER rather than lines of a file
+   16.10.26 The residues and sequence array are grown rather than 
+            limited to MAXSEQ
+*/
+int ReadSequenceRecord(SEQREADER *reader, SEQUENCE **Sequence, 
+                       int *maxRes, char *id, char chain, BOOL chothia)
+{
+   char *buffp,
+        *endp,
+        *eol;
+   int  length    = 0,
+        nheader   = 0,
+        state     = READ_SEQUENCE,
+        NRes;
+   BOOL gotRecord = FALSE,
+        noMemory  = FALSE;
+
+   id[0] = '\0';
+
+   while((reader->offset < reader->length) || FillSequenceBuffer(reader))
+   {
+      buffp = reader->buffer + reader->offset;
+      endp  = reader->buffer + reader->length;
+
+      if(reader->lineStart && (*buffp == '>'))
+      {
+         /* Start of the next record                                    */
+         if(gotRecord)
+            break;
+         
+         gotRecord = TRUE;
+         state     = READ_HEADER;
+         buffp++;
+      }
+
+      /* Deal with the rest of this line (or what is in the buffer)     */
+      if((eol = memchr(buffp, '\n', endp - buffp)) == NULL)
+         eol = endp;
+      reader->lineStart = (eol < endp);
+      reader->offset    = (eol - reader->buffer) + reader->lineStart;
+
+      switch(state)
+      {
+      case READ_SEQUENCE:
+         for(; buffp < eol; buffp++)
+         {
+            if(isalpha(*buffp))
+            {
+               gotRecord = TRUE;
+               if((length < reader->maxSeq) || GrowRecordBuffer(reader))
+                  reader->seq[length++] = toupper(*buffp);
+               else
+                  noMemory = TRUE;
+            }
+         }
+         break;
+      case READ_HEADER:
+         for(; (buffp < eol) && (nheader < MAXBUFF-1); buffp++)
+            reader->header[nheader++] = *buffp;
+         if(reader->lineStart)
+         {
+            reader->header[nheader] = '\0';
+            state = ParseSequenceHeader(reader->header, id) ? 
+                    READ_TITLE : READ_SEQUENCE;
+         }
+         break;
+      case READ_TITLE:
+         if(reader->lineStart)
+            state = READ_SEQUENCE;
+         break;
+      }
+   }
+
+   if(!gotRecord)
+      return(-1);
+   
+   /* Header with no end of line                                        */
+   if(state == READ_HEADER)
+   {
+      reader->header[nheader] = '\0';
+      ParseSequenceHeader(reader->header, id);
+   }
+
+   if(noMemory)
+   {
+      fprintf(stderr,"Error (chothia): No memory for sequence %s\n",
+              id);
+      return(0);
+   }
+
+   /* Numbering may repeat a residue in a CDR shorter than its 
+      deletions allow, so there is room for one extra in each
+   */
+   if(!GrowSequence(Sequence, maxRes, length + NCDR))
+      return(0);
+
+   if((NRes = NumberSequence(reader->seq, length, chain, chothia, 
+                             *Sequence)) == 0)
+   {
+      fprintf(stderr,"Warning (chothia): No antibody variable domain \
+found in sequence %s\n", id);
+   }
+
+   return(NRes);
+}
+
+
+/************************************************************************/
+/*>BOOL ParseSequenceHeader(char *header, char *id)
+   ------------------------------------------------
+   Input:   char  *header     Header line without the >
+   Output:  char  *id         ID from the header
+   Returns: BOOL              Is it a PIR header? (followed by a title
+                              line)
+
+   Extracts the ID from a FASTA (>id ...) or PIR (>P1;id) header line.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL ParseSequenceHeader(char *header, char *id)
+{
+   BOOL pir = FALSE;
+   int  i;
+
+   if((strlen(header) > 3) && (header[2] == ';'))
+   {
+      header += 3;
+      pir = TRUE;
+   }
+
+   for(i=0; (i < MAXBUFF-1) && header[i] && !isspace(header[i]); i++)
+      id[i] = header[i];
+   id[i] = '\0';
+
+   return(pir);
+}
+
+
+/************************************************************************/
+/*>int NumberSequence(char *seq, int length, char chain, BOOL chothia,
+                      SEQUENCE *Sequence)
+   -------------------------------------------------------------------
+   Input:   char      *seq        Sequence (upper case 1-letter code)
+            int       length      Length of sequence
+            char      chain       Chain to number (both if ' ')
+            BOOL      chothia     Apply Chothia (rather than Kabat)
+                                  numbering
+   Output:  SEQUENCE  *Sequence   Numbered sequence array (must have
+                                  room for length+NCDR residues)
+   Returns: int                   Number of residues numbered (0 if no
+                                  variable domain found)
+
+   Finds and numbers the light and/or heavy chain variable domains in a
+   sequence. The light chain is placed first in the SEQUENCE array. If
+   both are found but they overlap, the one with more conserved
+   residues is used. The light chain is numbered to L109 unless the 
+   heavy chain domain follows at once.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Numbers the tail of the light chain domain
+*/
+int NumberSequence(char *seq, int length, char chain, BOOL chothia,
+                   SEQUENCE *Sequence)
+{
+   DOMAIN light,
+          heavy;
+   int    NRes = 0;
+
+   if((chain == 'H') || !FindLightDomain(seq, length, &light))
+      light.score = 0;
+   if((chain == 'L') || !FindHeavyDomain(seq, length, &heavy))
+      heavy.score = 0;
+
+   /* If the domains overlap, keep the better one                       */
+   if(light.score && heavy.score &&
+      (light.first <= heavy.last) && (heavy.first <= light.last))
+   {
+      if(light.score >= heavy.score)
+         heavy.score = 0;
+      else
+         light.score = 0;
+   }
+
+   /* The tail stops before the next domain or the end of the sequence */
+   if(light.score)
+   {
+      light.last += light.tail;
+      if(light.last >= length)
+         light.last = length - 1;
+      if(heavy.score && (heavy.first > light.first) &&
+         (light.last >= heavy.first))
+         light.last = heavy.first - 1;
+   }
+
+   if(light.score)
+      NRes = NumberLightDomain(seq, &light, chothia, Sequence, NRes);
+   if(heavy.score)
+      NRes = NumberHeavyDomain(seq, &heavy, chothia, Sequence, NRes);
+
+   return(NRes);
+}
+
+
+/************************************************************************/
+/*>BOOL FindLightDomain(char *seq, int length, DOMAIN *domain)
+   -----------------------------------------------------------
+   Input:   char    *seq       Sequence
+            int     length     Length of sequence
+   Output:  DOMAIN  *domain    The light chain domain found
+   Returns: BOOL               Was a domain found?
+
+   Finds a light chain variable domain from Cys L23, Trp L35 and Cys L88
+   which must be present with the spacing allowed by CDR-L1, and the
+   Phe-Gly-X-Gly after CDR-L3. Where there is a choice, the one with
+   most conserved residues (also counting Gln L37) is taken. The 
+   domain ends at L107 with L108-L109 as its tail.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Gives L108-L109 as the tail of the domain
+*/
+BOOL FindLightDomain(char *seq, int length, DOMAIN *domain)
+{
+   int cys1,
+       cys2,
+       w35,
+       len1,
+       len3,
+       score;
+
+   domain->score = 0;
+
+   for(cys1=0; cys1<length; cys1++)
+   {
+      if(seq[cys1] != 'C')
+         continue;
+
+      for(len1=MINLEN_L1; len1<=MAXLEN_L1; len1++)
+      {
+         w35  = cys1 + 1 + len1;
+         cys2 = w35 + LIGHT_W35_L50 + LIGHT_L50_C88;
+         if(cys2 >= length)
+            break;
+         if((seq[w35] != 'W') || (seq[cys2] != 'C'))
+            continue;
+
+         score = 3;
+         if(seq[w35+2] == 'Q')
+            score++;
+
+         for(len3=MINLEN_L3; len3<=MAXLEN_L3; len3++)
+         {
+            if(FGXG(seq, length, cys2+1+len3))
+            {
+               score += 2;
+               break;
+            }
+         }
+         if(len3 > MAXLEN_L3)
+            len3 = 0;
+
+         if(score > domain->score)
+         {
+            domain->score   = score;
+            domain->cys1    = cys1;
+            domain->cys2    = cys2;
+            domain->cdr1len = len1;
+            domain->cdr2len = 7;
+            domain->cdr3len = len3;
+            domain->first   = ((cys1 >= 22) ? cys1 - 22 : 0);
+            domain->last    = (len3 ? cys2 + len3 + 10 : cys2);
+            domain->tail    = (len3 ? 2 : 0);
+            if(domain->last >= length)
+               domain->last = length - 1;
+         }
+      }
+   }
+
+   return(domain->score != 0);
+}
+
+
+/************************************************************************/
+/*>BOOL FindHeavyDomain(char *seq, int length, DOMAIN *domain)
+   -----------------------------------------------------------
+   Input:   char    *seq       Sequence
+            int     length     Length of sequence
+   Output:  DOMAIN  *domain    The heavy chain domain found
+   Returns: BOOL               Was a domain found?
+
+   Finds a heavy chain variable domain from Cys H22, Trp H36 and Cys H92
+   which must be present with the spacing allowed by CDR-H1 and H2, and
+   the Trp-Gly-X-Gly after CDR-H3. Where there is a choice, the one with
+   most conserved residues (also counting Arg H38) is taken.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL FindHeavyDomain(char *seq, int length, DOMAIN *domain)
+{
+   int cys1,
+       cys2,
+       w36,
+       len1,
+       len2,
+       len3,
+       score;
+
+   domain->score = 0;
+
+   for(cys1=0; cys1<length; cys1++)
+   {
+      if(seq[cys1] != 'C')
+         continue;
+
+      for(len1=MINLEN_H1; len1<=MAXLEN_H1; len1++)
+      {
+         w36 = cys1 + HEAVY_C22_H26 + len1;
+         if(w36 >= length)
+            break;
+         if(seq[w36] != 'W')
+            continue;
+
+         for(len2=MINLEN_H2; len2<=MAXLEN_H2; len2++)
+         {
+            cys2 = w36 + HEAVY_W36_H50 + len2 + HEAVY_H66_C92;
+            if(cys2 >= length)
+               break;
+            if(seq[cys2] != 'C')
+               continue;
+
+            score = 3;
+            if(seq[w36+2] == 'R')
+               score++;
+
+            for(len3=MINLEN_H3; len3<=MAXLEN_H3; len3++)
+            {
+               if(WGXG(seq, length, cys2+HEAVY_C92_H95+len3))
+               {
+                  score += 2;
+                  break;
+               }
+            }
+            if(len3 > MAXLEN_H3)
+               len3 = 0;
+
+            if(score > domain->score)
+            {
+               domain->score   = score;
+               domain->cys1    = cys1;
+               domain->cys2    = cys2;
+               domain->cdr1len = len1;
+               domain->cdr2len = len2;
+               domain->cdr3len = len3;
+               domain->first   = ((cys1 >= 21) ? cys1 - 21 : 0);
+               domain->last    = (len3 ?
+                                  cys2 + HEAVY_C92_H95 + len3 + 10 :
+                                  cys2 + HEAVY_C92_H95 - 1);
+               domain->tail    = 0;
+               if(domain->last >= length)
+                  domain->last = length - 1;
+            }
+         }
+      }
+   }
+
+   return(domain->score != 0);
+}
+
+
+/************************************************************************/
+/*>int NumberLightDomain(char *seq, DOMAIN *domain, BOOL chothia,
+                         SEQUENCE *Sequence, int NRes)
+   --------------------------------------------------------------
+   Input:   char      *seq        Sequence
+            DOMAIN    *domain     Light chain domain found
+            BOOL      chothia     Apply Chothia numbering
+   I/O:     SEQUENCE  *Sequence   Numbered sequence array
+   Input:   int       NRes        Residues already in Sequence
+   Returns: int                   Updated number of residues
+
+   Adds the numbered light chain domain to the SEQUENCE array.
+
+   16.10.26 Original    By: ACRM
+*/
+int NumberLightDomain(char *seq, DOMAIN *domain, BOOL chothia,
+                      SEQUENCE *Sequence, int NRes)
+{
+   int pos,
+       cdr1;
+
+   /* FR1 counting back from Cys L23                                    */
+   pos  = domain->first;
+   NRes = NumberRange(seq, pos, 'L', 23-(domain->cys1-pos), 23,
+                      Sequence, NRes);
+   pos  = domain->cys1 + 1;
+
+   cdr1 = NRes;
+   NRes = NumberLoop(seq, pos, domain->cdr1len, 'L', 24, 34, 27,
+                     sDeleteL1, Sequence, NRes);
+   if(chothia)
+      ConvertToChothia("L1", domain->cdr1len, Sequence, cdr1, NRes);
+   pos += domain->cdr1len;
+
+   NRes = NumberRange(seq, pos, 'L', 35, 88, Sequence, NRes);
+   pos += 54;
+
+   if(domain->cdr3len)
+   {
+      NRes = NumberLoop(seq, pos, domain->cdr3len, 'L', 89, 97, 95,
+                        sDeleteL3, Sequence, NRes);
+      pos += domain->cdr3len;
+
+      NRes = NumberRange(seq, pos, 'L', 98,
+                         98 + (domain->last - pos), Sequence, NRes);
+   }
+
+   return(NRes);
+}
+
+
+/************************************************************************/
+/*>int NumberHeavyDomain(char *seq, DOMAIN *domain, BOOL chothia,
+                         SEQUENCE *Sequence, int NRes)
+   --------------------------------------------------------------
+   Input:   char      *seq        Sequence
+            DOMAIN    *domain     Heavy chain domain found
+            BOOL      chothia     Apply Chothia numbering
+   I/O:     SEQUENCE  *Sequence   Numbered sequence array
+   Input:   int       NRes        Residues already in Sequence
+   Returns: int                   Updated number of residues
+
+   Adds the numbered heavy chain domain to the SEQUENCE array.
+
+   16.10.26 Original    By: ACRM
+*/
+int NumberHeavyDomain(char *seq, DOMAIN *domain, BOOL chothia,
+                      SEQUENCE *Sequence, int NRes)
+{
+   int pos,
+       cdr1;
+
+   /* FR1 counting back from Cys H22                                    */
+   pos  = domain->first;
+   NRes = NumberRange(seq, pos, 'H', 22-(domain->cys1-pos), 25,
+                      Sequence, NRes);
+   pos  = domain->cys1 + HEAVY_C22_H26;
+
+   cdr1 = NRes;
+   NRes = NumberLoop(seq, pos, domain->cdr1len, 'H', 26, 35, 35,
+                     sDeleteNone, Sequence, NRes);
+   if(chothia)
+      ConvertToChothia("H1", domain->cdr1len, Sequence, cdr1, NRes);
+   pos += domain->cdr1len;
+
+   NRes = NumberRange(seq, pos, 'H', 36, 49, Sequence, NRes);
+   pos += 14;
+
+   NRes = NumberLoop(seq, pos, domain->cdr2len, 'H', 50, 65, 52,
+                     sDeleteNone, Sequence, NRes);
+   pos += domain->cdr2len;
+
+   NRes = NumberLoop(seq, pos, 32, 'H', 66, 94, 82, sDeleteNone,
+                     Sequence, NRes);
+   pos += 32;
+
+   if(domain->cdr3len)
+   {
+      NRes = NumberLoop(seq, pos, domain->cdr3len, 'H', 95, 102, 100,
+                        sDeleteH3, Sequence, NRes);
+      pos += domain->cdr3len;
+
+      NRes = NumberRange(seq, pos, 'H', 103,
+                         103 + (domain->last - pos), Sequence, NRes);
+   }
+
+   return(NRes);
+}
+
+
+/************************************************************************/
+/*>int NumberRange(char *seq, int offset, char chain, int first,
+                   int last, SEQUENCE *Sequence, int NRes)
+   -------------------------------------------------------------
+   Input:   char      *seq        Sequence
+            int       offset      Offset of first residue in seq
+            char      chain       Chain label (L or H)
+            int       first       First residue number
+            int       last        Last residue number
+   I/O:     SEQUENCE  *Sequence   Numbered sequence array
+   Input:   int       NRes        Residues already in Sequence
+   Returns: int                   Updated number of residues
+
+   Numbers a run of residues with no insertions.
+
+   16.10.26 Original    By: ACRM
+*/
+int NumberRange(char *seq, int offset, char chain, int first, int last,
+                SEQUENCE *Sequence, int NRes)
+{
+   int num;
+
+   for(num=first; (num<=last) && (num<=MAXRESNUM); num++)
+   {
+      sprintf(Sequence[NRes].resnum, "%c%d", chain, num);
+      Sequence[NRes].seq = seq[offset++];
+      NRes++;
+   }
+
+   return(NRes);
+}
+
+
+/************************************************************************/
+/*>int NumberLoop(char *seq, int offset, int length, char chain,
+                  int first, int last, int insertAfter, int *deletions,
+                  SEQUENCE *Sequence, int NRes)
+   ---------------------------------------------------------------------
+   Input:   char      *seq         Sequence
+            int       offset       Offset of first residue in seq
+            int       length       Number of residues
+            char      chain        Chain label (L or H)
+            int       first        First residue number
+            int       last         Last residue number
+            int       insertAfter  Residue number after which insertion
+                                   codes are used if the region is long
+            int       *deletions   Residue numbers removed if the region
+                                   is short (0 terminated)
+   I/O:     SEQUENCE  *Sequence    Numbered sequence array
+   Input:   int       NRes         Residues already in Sequence
+   Returns: int                    Updated number of residues
+
+   Numbers a region (normally a CDR) of variable length from first to
+   last, using insertion codes after insertAfter if there are too many
+   residues and leaving out residue numbers if there are too few.
+
+   16.10.26 Original    By: ACRM
+*/
+int NumberLoop(char *seq, int offset, int length, char chain, int first,
+               int last, int insertAfter, int *deletions,
+               SEQUENCE *Sequence, int NRes)
+{
+   int  num,
+        i,
+        nInsert = length - (1 + last - first),
+        nDelete = -nInsert;
+   BOOL deleted;
+
+   for(num=first; num<=last; num++)
+   {
+      /* Skip this number if it is one of those to delete               */
+      deleted = FALSE;
+      for(i=0; (i<nDelete) && deletions[i]; i++)
+      {
+         if(deletions[i] == num)
+            deleted = TRUE;
+      }
+      if(deleted)
+         continue;
+
+      sprintf(Sequence[NRes].resnum, "%c%d", chain, num);
+      Sequence[NRes].seq = seq[offset++];
+      NRes++;
+
+      if(num == insertAfter)
+      {
+         for(i=0; (i<nInsert) && (i<NINSERT); i++)
+         {
+            sprintf(Sequence[NRes].resnum, "%c%d%c", chain, num, 'A'+i);
+            Sequence[NRes].seq = seq[offset++];
+            NRes++;
+         }
+      }
+   }
+
+   return(NRes);
+}
+
+
+/************************************************************************/
+/*>void ConvertToChothia(char *cdr, int length, SEQUENCE *Sequence,
+                         int first, int last)
+   ----------------------------------------------------------------
+   Input:   char      *cdr        CDR (L1 or H1)
+            int       length      Length of the CDR
+   I/O:     SEQUENCE  *Sequence   Numbered sequence array
+   Input:   int       first       Offset of first residue of the CDR
+            int       last        Offset after last residue of the CDR
+
+   Converts the Kabat residue numbers of CDR-L1 or H1 to Chothia
+   numbering. The other CDRs are numbered the same in both schemes.
+
+   16.10.26 Original    By: ACRM
+*/
+void ConvertToChothia(char *cdr, int length, SEQUENCE *Sequence,
+                      int first, int last)
+{
+   int i;
+
+   for(i=first; i<last; i++)
+   {
+      strncpy(Sequence[i].resnum,
+              KabCho(cdr, length, Sequence[i].resnum), SMALLWORD);
+   }
+}
@@ -0,0 +1,1061 @@
+/*************************************************************************
+
+   Program:    Chothia
+   File:       numtrans.c
+
+   Version:    V2.31
+   Date:       16.10.26
+   Function:   Translate residue labels between antibody numbering
+               schemes
+
+   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2026
+   Author:     Prof. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Part of libchothia. A NUMTRANS translates residue labels between two
+   numbering schemes (the FROM and TO schemes) in either direction. The
+   translation of a residue depends on the length of the CDR in whose
+   region it lies. Residues outside the regions of the CDRs may be given
+   a translation for their chain which does not depend on the CDR 
+   lengths. Other residues are numbered the same in both schemes.
+
+   A translation file has the format:
+
+   FROM scheme
+   TO   scheme
+   LOOP loopid
+   =      label label label ...
+   length label label label ...
+   ...
+   *      label label label ...
+   LOOP loopid
+   ...
+   CHAIN chain
+   =      label label label ...
+   *      label label label ...
+
+   The = line gives the labels in the TO scheme of the positions in the
+   region of the CDR. Each following line gives, for a CDR of the given
+   length, the labels in the FROM scheme of these positions, with - for
+   a position which is not occupied. A line starting with * applies to
+   CDRs of any length without their own line. If there is no such line,
+   residues in the region of a CDR of any other length are numbered the
+   same in both schemes. A CHAIN block (chain L or H) gives the
+   translation of the framework of the chain, so has only the = line and
+   a * line. Positions which are also in the region of a CDR are 
+   translated for the length of the CDR. Lines starting with # or ! are
+   comments. The translation between Kabat and Chothia numbering of 
+   KabCho() and ChoKab() is built in.
+
+   For each direction, each region has a direct-index array for every
+   length, indexed by the encoded residue ID (see EncodeResID()) in the
+   window of IDs in the region, so a translation is a lookup. A
+   direction may only be used if all the labels translated from are in
+   the standard form (chain, number and insert code).
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.18 16.10.26 Original
+   V2.19 16.10.26 Added NumTransRegion(). Translation contexts are 
+                  looked up rather than found by searching the lines
+   V2.26 16.10.26 Loop lengths are limited by NRESID rather than MAXSEQ
+   V2.30 16.10.26 Added NumTransDigits()
+   V2.31 16.10.26 Added CHAIN blocks to translate the framework
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+#include "bioplib/macros.h"
+#include "bioplib/general.h"
+
+#include "chothia.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define TRANS_PASS    (-1)       /* Map entry: label not translated     */
+#define TRANS_DELETED (-2)       /*    or position not occupied         */
+#define TRANS_DEFAULT (-1)       /* Length of the * line                */
+#define MAXTRANSLINE  4096       /* Max length of translation file line */
+#define NTRANSREGION  (NLOOPDEF+2) /* Regions of the CDRs then the L
+                                      and H chains                      */
+
+/* The translation of the region of one CDR or chain                    */
+typedef struct
+{
+   int      nCols,                  /* Positions in the region (0 if the
+                                       CDR is not translated)           */
+            nRows,                  /* Lines: = line then each length   */
+            *rowLength,             /* Length of each line (TRANS_DEFAULT
+                                       for *)                           */
+            *cells,                 /* Label (string pool offset or -1
+                                       if unoccupied) of each position
+                                       on each line                     */
+            maxLength,              /* Longest length given             */
+            *digit,                 /* Context digit of each length
+                                       0..maxLength then others         */
+            lo[2],                  /* First residue ID of the window   */
+            size[2],                /*    and its size in each direction*/
+            *map[2];                /* Translation (string pool offset,
+                                       TRANS_PASS or TRANS_DELETED) of
+                                       each ID in the window for each
+                                       length 0..maxLength then others  */
+}  TRANSREGION;
+
+struct _numtrans
+{
+   char          scheme[2][MAXWORD];/* FROM and TO schemes              */
+   TRANSREGION   region[NTRANSREGION];
+                                    /* Regions of each CDR and chain    */
+   signed char   *regionOf[2];      /* Region of each residue ID in each
+                                       direction (-1 if none)           */
+   BOOL          indexed[2];        /* May each direction be used?      */
+   char          *strings;          /* String pool                      */
+   int           nStrings,
+                 maxStrings,
+                 nContexts;         /* Distinct translation contexts
+                                       (-1 if too many)                 */
+};
+
+
+/************************************************************************/
+/* Prototypes
+*/
+NUMTRANS *NewNumTrans(char *from, char *to);
+int  NumTransString(NUMTRANS *trans, char *string);
+BOOL AddTransRegion(NUMTRANS *trans, int loop, int nCols, int nRows,
+                    int *rowLength, int *cells);
+BOOL CompileNumTrans(NUMTRANS *trans);
+int  CompileTransRegion(NUMTRANS *trans, int loop, int dir);
+BOOL ExplicitTransRow(TRANSREGION *region, int length);
+int  LoopIndex(char *LoopID);
+int  ChainRegion(char *chain);
+int  EncodeResID(char *resnum);
+
+
+/************************************************************************/
+/*>NUMTRANS *BuiltinNumTrans(void)
+   -------------------------------
+   Returns: NUMTRANS *     Translation from Kabat to Chothia numbering
+                           (NULL if no memory)
+
+   Builds the translation between Kabat and Chothia numbering from the
+   tables used by KabCho() and ChoKab(). For CDR-L1 and CDR-H1, these
+   give the Chothia labels followed by the Kabat labels for each loop
+   length.
+
+   16.10.26 Original    By: ACRM
+*/
+NUMTRANS *BuiltinNumTrans(void)
+{
+   static char *cdrs[] = {"L1", "H1", NULL};
+   NUMTRANS    *trans;
+   char        **table;
+   int         *rowLength = NULL,
+               *cells     = NULL,
+               maxLength,
+               rowSize,
+               i,
+               j,
+               c;
+   BOOL        ok = TRUE;
+
+   if((trans = NewNumTrans("Kabat", "Chothia")) == NULL)
+      return(NULL);
+
+   for(c=0; ok && (cdrs[c] != NULL); c++)
+   {
+      table = KabChoTable(cdrs[c], &maxLength, &rowSize);
+
+      /* Row 0 (the Chothia labels) is the = line and the others are 
+         the lines for each length. Each row ends with a NULL which is
+         not a position
+      */
+      if(((rowLength = (int *)malloc((maxLength+1) * sizeof(int)))
+          ==NULL) ||
+         ((cells = (int *)malloc((maxLength+1) * (rowSize-1) *
+                                 sizeof(int)))==NULL))
+      {
+         ok = FALSE;
+      }
+
+      for(i=0; ok && (i<=maxLength); i++)
+      {
+         rowLength[i] = i;
+         for(j=0; ok && (j<rowSize-1); j++)
+         {
+            cells[i*(rowSize-1) + j] = (-1);
+            if((table[i*rowSize + j][0] != '-') &&
+               ((cells[i*(rowSize-1) + j] = 
+                 NumTransString(trans, table[i*rowSize + j])) < 0))
+               ok = FALSE;
+         }
+      }
+
+      if(ok)
+         ok = AddTransRegion(trans, LoopIndex(cdrs[c]), rowSize-1,
+                             maxLength+1, rowLength, cells);
+      if(rowLength != NULL) free(rowLength);
+      if(cells != NULL)     free(cells);
+      rowLength = cells = NULL;
+   }
+
+   if(!ok || !CompileNumTrans(trans))
+   {
+      FreeNumTrans(trans);
+      return(NULL);
+   }
+
+   return(trans);
+}
+
+
+/************************************************************************/
+/*>NUMTRANS *ReadNumTrans(char *filename)
+   --------------------------------------
+   Input:   char      *filename   Translation file
+   Returns: NUMTRANS  *           The translation (NULL on error)
+
+   Reads a translation between numbering schemes from a file with the
+   format given above. As with the Chothia datafile, the file is looked
+   for in the current directory and then in the directory given by the
+   KABATDIR environment variable.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Lengths are limited by NRESID as MAXSEQ was removed
+   16.10.26 Reads CHAIN blocks
+*/
+NUMTRANS *ReadNumTrans(char *filename)
+{
+   FILE     *fp;
+   NUMTRANS *trans     = NULL;
+   char     buffer[MAXTRANSLINE],
+            from[MAXWORD],
+            to[MAXWORD],
+            loopName[MAXWORD],
+            regionName[MAXWORD+8],
+            word[MAXWORD],
+            *chp;
+   int      *rowLength = NULL,
+            *cells     = NULL,
+            loop       = (-1),           /* Region being read           */
+            nCols      = 0,
+            nRows      = 0,
+            maxRows    = 0,
+            maxCells   = 0,
+            nCells     = 0,
+            length;
+   BOOL     NoEnv,
+            ok         = TRUE;
+
+   if((fp=blOpenFile(filename,ENV_KABATDIR,"r",&NoEnv))==NULL)
+   {
+      fprintf(stderr,"Error (chothia): Unable to open translation file \
+%s\n", filename);
+      return(NULL);
+   }
+
+   from[0] = to[0] = '\0';
+
+   while(ok)
+   {
+      chp = fgets(buffer, MAXTRANSLINE, fp);
+
+      /* Store the region just read                                     */
+      if((loop >= 0) &&
+         ((chp == NULL) || !blUpstrncmp(buffer, "LOOP", 4) ||
+          !blUpstrncmp(buffer, "CHAIN", 5)))
+      {
+         ok   = AddTransRegion(trans, loop, nCols, nRows, rowLength,
+                               cells);
+         loop = (-1);
+      }
+      if(!ok || (chp == NULL))
+         break;
+
+      TERMINATE(buffer);
+      for(chp=buffer; isspace(*chp); chp++);
+      if((*chp == '\0') || (*chp == '#') || (*chp == '!'))
+         continue;
+
+      if(!blUpstrncmp(chp, "FROM", 4) && (trans == NULL))
+      {
+         blGetWord(chp+4, from, MAXWORD);
+      }
+      else if(!blUpstrncmp(chp, "TO", 2) && (trans == NULL))
+      {
+         blGetWord(chp+2, to, MAXWORD);
+      }
+      else if(!blUpstrncmp(chp, "LOOP", 4) || 
+              !blUpstrncmp(chp, "CHAIN", 5))
+      {
+         if(!blUpstrncmp(chp, "LOOP", 4))
+         {
+            blGetWord(chp+4, loopName, MAXWORD);
+            sprintf(regionName, "loop %s", loopName);
+         }
+         else
+         {
+            blGetWord(chp+5, loopName, MAXWORD);
+            sprintf(regionName, "chain %s", loopName);
+         }
+
+         if((trans == NULL) && from[0] && to[0] &&
+            ((trans = NewNumTrans(from, to)) == NULL))
+         {
+            ok = FALSE;
+         }
+         else if(trans == NULL)
+         {
+            fprintf(stderr,"Error (chothia): FROM and TO must precede \
+LOOP and CHAIN in %s\n", filename);
+            ok = FALSE;
+         }
+         else if(((loop = ((regionName[0] == 'l') ? 
+                           LoopIndex(loopName) : ChainRegion(loopName)))
+                  < 0) || 
+                 trans->region[loop].nCols)
+         {
+            fprintf(stderr,"Error (chothia): Unknown or repeated %s in \
+%s\n", regionName, filename);
+            ok = FALSE;
+         }
+         nCols = nRows = nCells = 0;
+      }
+      else if(loop < 0)
+      {
+         fprintf(stderr,"Error (chothia): Unexpected line in %s: %s\n",
+                 filename, chp);
+         ok = FALSE;
+      }
+      else
+      {
+         /* A line of labels, starting with = or the length             */
+         chp = blGetWord(chp, word, MAXWORD);
+         if((nRows == 0) != !strcmp(word, "="))
+         {
+            fprintf(stderr,"Error (chothia): The = line must be the \
+first line for %s in %s\n", regionName, filename);
+            ok = FALSE;
+            break;
+         }
+
+         if(nRows == 0)
+            length = 0;
+         else if(!strcmp(word, "*"))
+            length = TRANS_DEFAULT;
+         else if((sscanf(word, "%d", &length) != 1) || (length < 1) ||
+                 (length > NRESID))
+         {
+            fprintf(stderr,"Error (chothia): Bad length for %s in %s: \
+%s\n", regionName, filename, word);
+            ok = FALSE;
+            break;
+         }
+
+         /* A chain is translated the same for all CDR lengths          */
+         if((loop >= NLOOPDEF) && (nRows > 0) && 
+            ((length != TRANS_DEFAULT) || (nRows > 1)))
+         {
+            fprintf(stderr,"Error (chothia): Only a * line may follow the \
+= line for %s in %s\n", regionName, filename);
+            ok = FALSE;
+            break;
+         }
+
+         if(nRows == maxRows)
+         {
+            maxRows += 32;
+            if((rowLength = (int *)realloc(rowLength, 
+                                           maxRows * sizeof(int)))
+               ==NULL)
+            {
+               ok = FALSE;
+               break;
+            }
+         }
+         rowLength[nRows] = length;
+
+         /* Each label in the line                                      */
+         while((chp != NULL) && ok)
+         {
+            chp = blGetWord(chp, word, MAXWORD);
+            if(!word[0])
+               break;
+            
+            if(nCells == maxCells)
+            {
+               maxCells += 1024;
+               if((cells = (int *)realloc(cells, maxCells * sizeof(int)))
+                  ==NULL)
+               {
+                  ok = FALSE;
+                  break;
+               }
+            }
+            cells[nCells] = (-1);
+            if((word[0] != '-') &&
+               ((cells[nCells] = NumTransString(trans, word)) < 0))
+               ok = FALSE;
+            nCells++;
+         }
+
+         if(nRows == 0)
+            nCols = nCells;
+         nRows++;
+         
+         if(ok && ((nCols == 0) || (nCells != nRows * nCols)))
+         {
+            fprintf(stderr,"Error (chothia): Wrong number of positions \
+for %s in %s\n", regionName, filename);
+            ok = FALSE;
+         }
+      }
+   }
+
+   fclose(fp);
+   if(rowLength != NULL) free(rowLength);
+   if(cells != NULL)     free(cells);
+
+   if(ok && ((trans == NULL) || !CompileNumTrans(trans)))
+   {
+      fprintf(stderr,"Error (chothia): No usable translations in %s\n",
+              filename);
+      ok = FALSE;
+   }
+   if(!ok)
+   {
+      FreeNumTrans(trans);
+      return(NULL);
+   }
+
+   return(trans);
+}
+
+
+/************************************************************************/
+/*>void FreeNumTrans(NUMTRANS *trans)
+   ----------------------------------
+   Input:   NUMTRANS  *trans     Translation (may be NULL)
+
+   Frees a translation between numbering schemes
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Frees the regions of the chains
+*/
+void FreeNumTrans(NUMTRANS *trans)
+{
+   TRANSREGION *region;
+   int         loop,
+               dir;
+
+   if(trans == NULL)
+      return;
+
+   for(loop=0; loop<NTRANSREGION; loop++)
+   {
+      region = &(trans->region[loop]);
+      if(region->rowLength != NULL) free(region->rowLength);
+      if(region->cells != NULL)     free(region->cells);
+      if(region->digit != NULL)     free(region->digit);
+      for(dir=0; dir<2; dir++)
+      {
+         if(region->map[dir] != NULL)
+            free(region->map[dir]);
+      }
+   }
+   for(dir=0; dir<2; dir++)
+   {
+      if(trans->regionOf[dir] != NULL)
+         free(trans->regionOf[dir]);
+   }
+   if(trans->strings != NULL)
+      free(trans->strings);
+   free(trans);
+}
+
+
+/************************************************************************/
+/*>BOOL NumTransDirection(NUMTRANS *trans, char *scheme, BOOL *reverse)
+   --------------------------------------------------------------------
+   Input:   NUMTRANS  *trans     Translation
+            char      *scheme    Numbering scheme of the labels to be
+                                 translated (case is ignored)
+   Output:  BOOL      *reverse   Translate from the TO scheme to the
+                                 FROM scheme?
+   Returns: BOOL                 Can labels be translated from this
+                                 scheme?
+
+   Finds the direction in which to use a translation for labels in
+   the given scheme.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL NumTransDirection(NUMTRANS *trans, char *scheme, BOOL *reverse)
+{
+   int dir;
+
+   for(dir=1; dir>=0; dir--)
+   {
+      if(trans->indexed[dir] &&
+         (strlen(scheme) == strlen(trans->scheme[dir])) &&
+         !blUpstrncmp(scheme, trans->scheme[dir], strlen(scheme)))
+      {
+         *reverse = (BOOL)dir;
+         return(TRUE);
+      }
+   }
+
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>char *NumTransScheme(NUMTRANS *trans, BOOL to)
+   ----------------------------------------------
+   Input:   NUMTRANS  *trans     Translation
+            BOOL      to         Give the TO (rather than FROM) scheme
+   Returns: char      *          Name of the scheme
+
+   16.10.26 Original    By: ACRM
+*/
+char *NumTransScheme(NUMTRANS *trans, BOOL to)
+{
+   return(trans->scheme[to ? 1 : 0]);
+}
+
+
+/************************************************************************/
+/*>char *TranslateResLabel(NUMTRANS *trans, BOOL reverse, int *loopLen,
+                           char *label)
+   --------------------------------------------------------------------
+   Input:   NUMTRANS  *trans     Translation
+            BOOL      reverse    Translate from the TO scheme to the
+                                 FROM scheme (see NumTransDirection())
+            int       *loopLen   Length of each CDR (indexed as the
+                                 loop definitions; 0 if not found)
+            char      *label     Residue label
+   Returns: char      *          The equivalent label (label itself if
+                                 numbered the same in both schemes, 
+                                 NULL if the position is not occupied
+                                 for these CDR lengths)
+
+   Translates a residue label using the length of the CDR in whose
+   region it lies, or the translation of its chain.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Translates the framework of a chain
+*/
+char *TranslateResLabel(NUMTRANS *trans, BOOL reverse, int *loopLen,
+                        char *label)
+{
+   TRANSREGION *region;
+   int         dir = (reverse ? 1 : 0),
+               id,
+               loop,
+               row,
+               result;
+
+   if(((id = EncodeResID(label)) < 0) ||
+      ((loop = trans->regionOf[dir][id]) < 0))
+      return(label);
+
+   region = &(trans->region[loop]);
+   row    = ((loop < NLOOPDEF) && (loopLen[loop] >= 0) && 
+             (loopLen[loop] <= region->maxLength))
+            ? loopLen[loop] : region->maxLength + 1;
+   result = region->map[dir][row * region->size[dir] + 
+                             id - region->lo[dir]];
+
+   if(result == TRANS_PASS)
+      return(label);
+   if(result == TRANS_DELETED)
+      return(NULL);
+   return(trans->strings + result);
+}
+
+
+/************************************************************************/
+/*>int NumTransContext(NUMTRANS *trans, int *loopLen)
+   --------------------------------------------------
+   Input:   NUMTRANS  *trans     Translation
+            int       *loopLen   Length of each CDR
+   Returns: int                  Translation context (-1 if there are
+                                 too many to number)
+
+   Gives a number which is the same for two sets of CDR lengths if and
+   only if every label is translated in the same way for both. It is 
+   less than the number of contexts given by NumTransContexts().
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Uses the context digit of each length rather than looking
+            for its line
+*/
+int NumTransContext(NUMTRANS *trans, int *loopLen)
+{
+   TRANSREGION *region;
+   int         loop,
+               context = 0,
+               radix   = 1;
+
+   if(trans->nContexts < 0)
+      return(-1);
+
+   for(loop=0; loop<NLOOPDEF; loop++)
+   {
+      region = &(trans->region[loop]);
+      if(region->nCols == 0)
+         continue;
+
+      context += radix * 
+         region->digit[((loopLen[loop] >= 0) && 
+                        (loopLen[loop] <= region->maxLength)) ?
+                       loopLen[loop] : (region->maxLength + 1)];
+      radix   *= region->maxLength + 2;
+   }
+
+   return(context);
+}
+
+
+/************************************************************************/
+/*>int NumTransRegion(NUMTRANS *trans, BOOL reverse, char *label,
+                      int *maxLength)
+   --------------------------------------------------------------
+   Input:   NUMTRANS  *trans     Translation
+            BOOL      reverse    Translate from the TO scheme
+            char      *label     Residue label
+   Output:  int       *maxLength Longest CDR length with its own
+                                 translation (unset if no region)
+   Returns: int                  CDR in whose region the residue lies
+                                 (-1 if the translation of the label
+                                 does not depend on a CDR length)
+
+   Finds the CDR whose length determines the translation of a label, 
+   so that the translations for every length may be worked out in 
+   advance with TranslateResLabel(). Lengths above maxLength are all
+   translated as for maxLength+1.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Gives -1 for the framework of a chain
+*/
+int NumTransRegion(NUMTRANS *trans, BOOL reverse, char *label,
+                   int *maxLength)
+{
+   int id,
+       loop;
+
+   if(((id = EncodeResID(label)) < 0) ||
+      ((loop = trans->regionOf[reverse ? 1 : 0][id]) < 0) ||
+      (loop >= NLOOPDEF))
+      return(-1);
+
+   *maxLength = trans->region[loop].maxLength;
+   return(loop);
+}
+
+
+/************************************************************************/
+/*>int NumTransContexts(NUMTRANS *trans)
+   -------------------------------------
+   Input:   NUMTRANS  *trans     Translation
+   Returns: int                  Number of translation contexts (-1 if
+                                 too many to number)
+
+   16.10.26 Original    By: ACRM
+*/
+int NumTransContexts(NUMTRANS *trans)
+{
+   return(trans->nContexts);
+}
+
+
+/************************************************************************/
+/*>int *NumTransDigits(NUMTRANS *trans, int loop, int *maxLength)
+   --------------------------------------------------------------
+   Input:   NUMTRANS  *trans     Translation
+            int       loop       The CDR
+   Output:  int       *maxLength Longest CDR length with its own
+                                 translation (unset if no region)
+   Returns: int       *          Context digit of each length 
+                                 0..maxLength then others (NULL if the
+                                 CDR has no region)
+
+   Gives the digits from which NumTransContext() makes the translation
+   context, so that it may be worked out without the NUMTRANS.
+
+   16.10.26 Original    By: ACRM
+*/
+int *NumTransDigits(NUMTRANS *trans, int loop, int *maxLength)
+{
+   if(trans->region[loop].nCols == 0)
+      return(NULL);
+
+   *maxLength = trans->region[loop].maxLength;
+   return(trans->region[loop].digit);
+}
+
+
+/************************************************************************/
+/*>NUMTRANS *NewNumTrans(char *from, char *to)
+   -------------------------------------------
+   Input:   char      *from      FROM scheme
+            char      *to        TO scheme
+   Returns: NUMTRANS  *          Empty translation (NULL if no memory)
+
+   16.10.26 Original    By: ACRM
+*/
+NUMTRANS *NewNumTrans(char *from, char *to)
+{
+   NUMTRANS *trans;
+
+   if((trans = (NUMTRANS *)calloc(1, sizeof(NUMTRANS)))==NULL)
+      return(NULL);
+
+   strncpy(trans->scheme[0], from, MAXWORD-1);
+   strncpy(trans->scheme[1], to, MAXWORD-1);
+
+   return(trans);
+}
+
+
+/************************************************************************/
+/*>int NumTransString(NUMTRANS *trans, char *string)
+   -------------------------------------------------
+   Input:   NUMTRANS  *trans     Translation
+            char      *string    String to store
+   Returns: int                  Offset in the string pool (-1 if no
+                                 memory)
+
+   Adds a label to the string pool of a translation
+
+   16.10.26 Original    By: ACRM
+*/
+int NumTransString(NUMTRANS *trans, char *string)
+{
+   int  len = strlen(string) + 1,
+        offset;
+   char *strings;
+
+   if(trans->nStrings + len > trans->maxStrings)
+   {
+      if((strings = (char *)realloc(trans->strings, 
+                                    2 * trans->maxStrings + len + 256))
+         ==NULL)
+         return(-1);
+      trans->strings    = strings;
+      trans->maxStrings = 2 * trans->maxStrings + len + 256;
+   }
+
+   offset = trans->nStrings;
+   strcpy(trans->strings + offset, string);
+   trans->nStrings += len;
+
+   return(offset);
+}
+
+
+/************************************************************************/
+/*>BOOL AddTransRegion(NUMTRANS *trans, int loop, int nCols, int nRows,
+                       int *rowLength, int *cells)
+   --------------------------------------------------------------------
+   Input:   NUMTRANS  *trans     Translation
+            int       loop       CDR (index in the loop definitions)
+                                 or chain (see ChainRegion())
+            int       nCols      Number of positions
+            int       nRows      Number of lines (= line then lengths)
+            int       *rowLength Length of each line (TRANS_DEFAULT for
+                                 the * line)
+            int       *cells     Label of each position on each line
+                                 (string pool offset, -1 if unoccupied)
+   Returns: BOOL                 Success?
+
+   Adds the region of a CDR or chain to a translation. The arrays are
+   copied.
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL AddTransRegion(NUMTRANS *trans, int loop, int nCols, int nRows,
+                    int *rowLength, int *cells)
+{
+   TRANSREGION *region = &(trans->region[loop]);
+   int         i;
+
+   if(((region->rowLength = (int *)malloc(nRows * sizeof(int)))==NULL) ||
+      ((region->cells = (int *)malloc(nRows * nCols * sizeof(int)))
+       ==NULL))
+      return(FALSE);
+
+   memcpy(region->rowLength, rowLength, nRows * sizeof(int));
+   memcpy(region->cells, cells, nRows * nCols * sizeof(int));
+   region->nCols     = nCols;
+   region->nRows     = nRows;
+   region->maxLength = 0;
+   for(i=1; i<nRows; i++)
+   {
+      if(rowLength[i] > region->maxLength)
+         region->maxLength = rowLength[i];
+   }
+
+   /* Lengths without their own line share the context of the * line  */
+   if((region->digit = (int *)malloc((region->maxLength + 2) * 
+                                     sizeof(int)))==NULL)
+      return(FALSE);
+   for(i=0; i<=region->maxLength + 1; i++)
+   {
+      region->digit[i] = ExplicitTransRow(region, i) ? 
+                         i : (region->maxLength + 1);
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL CompileNumTrans(NUMTRANS *trans)
+   -------------------------------------
+   I/O:     NUMTRANS  *trans     Translation
+   Returns: BOOL                 Success? (FALSE if no memory or 
+                                 neither direction may be used)
+
+   Builds the direct-index arrays for each region and direction once
+   all regions have been added, and counts the translation contexts.
+   The regions of the chains are compiled after those of the CDRs, 
+   which take precedence over them.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Compiles the regions of the chains
+*/
+BOOL CompileNumTrans(NUMTRANS *trans)
+{
+   int  loop,
+        dir,
+        status;
+   BOOL found = FALSE;
+
+   for(dir=0; dir<2; dir++)
+   {
+      if((trans->regionOf[dir] = (signed char *)malloc(NRESID))==NULL)
+         return(FALSE);
+      memset(trans->regionOf[dir], -1, NRESID);
+      trans->indexed[dir] = TRUE;
+   }
+
+   trans->nContexts = 1;
+   for(loop=0; loop<NTRANSREGION; loop++)
+   {
+      if(trans->region[loop].nCols == 0)
+         continue;
+      found = TRUE;
+
+      for(dir=0; dir<2; dir++)
+      {
+         if((status = CompileTransRegion(trans, loop, dir)) < 0)
+            return(FALSE);
+         if(status == 0)
+            trans->indexed[dir] = FALSE;
+      }
+
+      /* A chain does not add to the contexts                          */
+      if(loop >= NLOOPDEF)
+         continue;
+      if((trans->nContexts < 0) ||
+         (trans->nContexts > INT_MAX / (trans->region[loop].maxLength+2)))
+         trans->nContexts = (-1);
+      else
+         trans->nContexts *= trans->region[loop].maxLength + 2;
+   }
+
+   return(found && (trans->indexed[0] || trans->indexed[1]));
+}
+
+
+/************************************************************************/
+/*>int CompileTransRegion(NUMTRANS *trans, int loop, int dir)
+   ----------------------------------------------------------
+   I/O:     NUMTRANS  *trans     Translation
+   Input:   int       loop       CDR or chain
+            int       dir        0 to translate from the FROM scheme,
+                                 1 from the TO scheme
+   Returns: int                  1 Success
+                                 0 Direction may not be used
+                                 -1 No memory
+
+   Builds the direct-index array of a region for one direction. When 
+   translating from the FROM scheme, the labels on each length line 
+   are translated to those on the = line. When translating from the 
+   TO scheme, the labels on the = line are translated to those on the
+   line for each length. In each case the first match is used, as by
+   KabCho() and ChoKab(). Lengths without their own line are given the
+   * line. Labels of a chain which are in the region of a CDR are left
+   to the CDR.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Compiles the regions of the chains
+*/
+int CompileTransRegion(NUMTRANS *trans, int loop, int dir)
+{
+   TRANSREGION *region = &(trans->region[loop]);
+   int         *cells  = region->cells,
+               nCols   = region->nCols,
+               lo      = NRESID,
+               hi      = (-1),
+               size,
+               row,
+               mapRow,
+               from,
+               to,
+               col,
+               id,
+               i,
+               *entry;
+
+   /* Find the window of IDs translated from                            */
+   for(row=((dir == 0) ? 1 : 0); row<((dir == 0) ? region->nRows : 1);
+       row++)
+   {
+      for(col=0; col<nCols; col++)
+      {
+         if(cells[row*nCols + col] < 0)
+            continue;
+         if((id = EncodeResID(trans->strings + cells[row*nCols + col]))
+            < 0)
+            return(0);
+         if((trans->regionOf[dir][id] >= 0) &&
+            (trans->regionOf[dir][id] != loop))
+         {
+            if((loop >= NLOOPDEF) && (trans->regionOf[dir][id] < NLOOPDEF))
+               continue;
+            return(0);
+         }
+         trans->regionOf[dir][id] = (signed char)loop;
+         if(id < lo) lo = id;
+         if(id > hi) hi = id;
+      }
+   }
+   if(hi < 0)
+      return(0);
+
+   size = hi - lo + 1;
+   region->lo[dir]   = lo;
+   region->size[dir] = size;
+   if((region->map[dir] = (int *)malloc((region->maxLength + 2) * size *
+                                        sizeof(int)))==NULL)
+      return(-1);
+   for(i=0; i<(region->maxLength + 2) * size; i++)
+      region->map[dir][i] = TRANS_PASS;
+
+   for(row=1; row<region->nRows; row++)
+   {
+      mapRow = (region->rowLength[row] == TRANS_DEFAULT) ? 
+               (region->maxLength + 1) : region->rowLength[row];
+
+      for(col=0; col<nCols; col++)
+      {
+         from = (dir == 0) ? cells[row*nCols + col] : cells[col];
+         to   = (dir == 0) ? cells[col] : cells[row*nCols + col];
+         if(from < 0)
+            continue;
+
+         /* Labels of a chain left to a CDR                            */
+         id = EncodeResID(trans->strings + from);
+         if(trans->regionOf[dir][id] != loop)
+            continue;
+
+         entry = &(region->map[dir][mapRow * size + id - lo]);
+         if(*entry == TRANS_PASS)
+            *entry = (to < 0) ? TRANS_DELETED : to;
+      }
+   }
+
+   /* Lengths without their own line are translated by the * line       */
+   for(row=0; row<=region->maxLength; row++)
+   {
+      if(!ExplicitTransRow(region, row))
+      {
+         memcpy(region->map[dir] + row * size,
+                region->map[dir] + (region->maxLength + 1) * size,
+                size * sizeof(int));
+      }
+   }
+
+   return(1);
+}
+
+
+/************************************************************************/
+/*>BOOL ExplicitTransRow(TRANSREGION *region, int length)
+   ------------------------------------------------------
+   Input:   TRANSREGION *region   Region of a CDR
+            int         length    Length of the CDR
+   Returns: BOOL                  Is there a line for this length?
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL ExplicitTransRow(TRANSREGION *region, int length)
+{
+   int row;
+
+   for(row=1; row<region->nRows; row++)
+   {
+      if(region->rowLength[row] == length)
+         return(TRUE);
+   }
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>int ChainRegion(char *chain)
+   ----------------------------
+   Input:   char  *chain      Chain name (L or H)
+   Returns: int               Region of the chain in a NUMTRANS (-1 if
+                              not known)
+
+   16.10.26 Original    By: ACRM
+*/
+int ChainRegion(char *chain)
+{
+   if(!strcmp(chain, "L"))
+      return(NLOOPDEF);
+   if(!strcmp(chain, "H"))
+      return(NLOOPDEF+1);
+   return(-1);
+}
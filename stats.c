@@ -0,0 +1,291 @@
+/*************************************************************************
+
+   Program:    Chothia
+   File:       stats.c
+
+   Version:    V2.27
+   Date:       16.10.26
+   Function:   Counts of the work done in assigning canonicals
+
+   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2026
+   Author:     Prof. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Part of libchothia. If a CANONCONTEXT has a CANONSTATS, the
+   assignment code counts the key residues it looks up, the classes it
+   tests for each CDR and how the candidates were resolved. As with a
+   CANONCACHE, each thread has its own so the counters are not locked;
+   the counts of the threads are added together with MergeCanonStats()
+   once they have finished. The times are filled in by the caller.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.24 16.10.26 Original
+   V2.27 16.10.26 Counts the loops matched with the CLASSTREE and the
+                  key positions tested for them
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L  /* For clock_gettime()                 */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "chothia.h"
+
+/************************************************************************/
+/* Globals
+*/
+static char *sCDRName[NCDR] = {"L1", "L2", "L3", "H1", "H2", "H3"};
+
+/************************************************************************/
+/* Prototypes
+*/
+double Ratio(unsigned long count, unsigned long total);
+
+
+/************************************************************************/
+/*>void InitCanonStats(CANONSTATS *stats)
+   --------------------------------------
+   Output:  CANONSTATS  *stats     Counts, all zero
+
+   16.10.26 Original    By: ACRM
+*/
+void InitCanonStats(CANONSTATS *stats)
+{
+   memset(stats, 0, sizeof(CANONSTATS));
+}
+
+
+/************************************************************************/
+/*>void MergeCanonStats(CANONSTATS *total, CANONSTATS *stats)
+   ----------------------------------------------------------
+   I/O:     CANONSTATS  *total     Counts of all threads so far
+   Input:   CANONSTATS  *stats     Counts of one thread
+
+   Adds the counts of a thread to the total. The classification times
+   are summed; the other times are those of the total.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Adds the CLASSTREE counts
+*/
+void MergeCanonStats(CANONSTATS *total, CANONSTATS *stats)
+{
+   int cdr;
+
+   total->classifyTime   += stats->classifyTime;
+   total->records        += stats->records;
+   total->errors         += stats->errors;
+   total->duplicates     += stats->duplicates;
+   total->lookups        += stats->lookups;
+   total->fallbacks      += stats->fallbacks;
+   total->scans          += stats->scans;
+   total->cacheHits      += stats->cacheHits;
+   total->cacheMisses    += stats->cacheMisses;
+   total->cacheEvictions += stats->cacheEvictions;
+   total->threads++;
+
+   for(cdr=0; cdr<NCDR; cdr++)
+   {
+      total->missing[cdr]       += stats->missing[cdr];
+      total->loops[cdr]         += stats->loops[cdr];
+      total->matched[cdr]       += stats->matched[cdr];
+      total->classesTested[cdr] += stats->classesTested[cdr];
+      total->kernelLoops[cdr]   += stats->kernelLoops[cdr];
+      total->earlyExits[cdr]    += stats->earlyExits[cdr];
+      total->chainWalks[cdr]    += stats->chainWalks[cdr];
+      total->chainLinks[cdr]    += stats->chainLinks[cdr];
+      total->treeLoops[cdr]     += stats->treeLoops[cdr];
+      total->treeSteps[cdr]     += stats->treeSteps[cdr];
+   }
+}
+
+
+/************************************************************************/
+/*>void AddCacheStats(CANONSTATS *stats, CANONCACHE *cache)
+   --------------------------------------------------------
+   I/O:     CANONSTATS  *stats     Counts
+   Input:   CANONCACHE  *cache     Classification cache (or NULL)
+
+   Adds the counters kept by a classification cache. Call once, before
+   the cache is freed.
+
+   16.10.26 Original    By: ACRM
+*/
+void AddCacheStats(CANONSTATS *stats, CANONCACHE *cache)
+{
+   unsigned long hits,
+                 misses,
+                 evictions;
+
+   if(cache == NULL)
+      return;
+
+   CanonCacheStats(cache, &hits, &misses, &evictions);
+   stats->cacheHits      += hits;
+   stats->cacheMisses    += misses;
+   stats->cacheEvictions += evictions;
+}
+
+
+/************************************************************************/
+/*>double StatsClock(void)
+   -----------------------
+   Returns: double      Monotonic time in seconds
+
+   16.10.26 Original    By: ACRM
+*/
+double StatsClock(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return((double)ts.tv_sec + ((double)ts.tv_nsec * 1.0e-9));
+}
+
+
+/************************************************************************/
+/*>double Ratio(unsigned long count, unsigned long total)
+   ------------------------------------------------------
+   Returns: double      count / total (0 if total is 0)
+
+   16.10.26 Original    By: ACRM
+*/
+double Ratio(unsigned long count, unsigned long total)
+{
+   return(total ? ((double)count / (double)total) : 0.0);
+}
+
+
+/************************************************************************/
+/*>void PrintCanonStats(FILE *out, CANONSTATS *stats, BOOL json)
+   -------------------------------------------------------------
+   Input:   FILE        *out       Output file pointer
+            CANONSTATS  *stats     Counts
+            BOOL        json       Print as a JSON object rather than a
+                                   summary table
+
+   Prints the counts with the rates derived from them. The counts for
+   each CDR are only given for CDRs which were processed.
+
+   16.10.26 Original    By: ACRM
+   16.10.26 Prints the CLASSTREE counts
+*/
+void PrintCanonStats(FILE *out, CANONSTATS *stats, BOOL json)
+{
+   unsigned long seen;
+   int           cdr;
+   BOOL          first = TRUE;
+
+   if(json)
+   {
+      fprintf(out, "{\"threads\":%d,\"loadTime\":%.6f,\"readTime\":%.6f,\
+\"classifyTime\":%.6f,\"totalTime\":%.6f,\"records\":%lu,\"errors\":%lu,\
+\"duplicates\":%lu,\"lookups\":%lu,\"fallbacks\":%lu,\"scans\":%lu,\
+\"cacheHits\":%lu,\"cacheMisses\":%lu,\"cacheEvictions\":%lu,\
+\"cdrs\":[",
+              stats->threads, stats->loadTime, stats->readTime,
+              stats->classifyTime, stats->totalTime, stats->records,
+              stats->errors, stats->duplicates, stats->lookups,
+              stats->fallbacks, stats->scans, stats->cacheHits,
+              stats->cacheMisses, stats->cacheEvictions);
+      for(cdr=0; cdr<NCDR; cdr++)
+      {
+         if((stats->loops[cdr] == 0) && (stats->missing[cdr] == 0))
+            continue;
+         fprintf(out, "%s{\"cdr\":\"%s\",\"loops\":%lu,\"missing\":%lu,\
+\"matched\":%lu,\"classesTested\":%lu,\"kernelLoops\":%lu,\
+\"earlyExits\":%lu,\"chainWalks\":%lu,\"chainLinks\":%lu,\
+\"treeLoops\":%lu,\"treeSteps\":%lu}",
+                 (first ? "" : ","), sCDRName[cdr], stats->loops[cdr],
+                 stats->missing[cdr], stats->matched[cdr],
+                 stats->classesTested[cdr], stats->kernelLoops[cdr],
+                 stats->earlyExits[cdr], stats->chainWalks[cdr],
+                 stats->chainLinks[cdr], stats->treeLoops[cdr],
+                 stats->treeSteps[cdr]);
+         first = FALSE;
+      }
+      fprintf(out, "]}\n");
+      return;
+   }
+
+   seen = stats->cacheHits + stats->cacheMisses;
+   fprintf(out, "Statistics (chothia):\n");
+   fprintf(out, "   Threads                    %d\n", stats->threads);
+   fprintf(out, "   Load time (s)              %.6f\n", stats->loadTime);
+   fprintf(out, "   Read time (s)              %.6f\n", stats->readTime);
+   fprintf(out, "   Classify time (s)          %.6f\n",
+           stats->classifyTime);
+   fprintf(out, "   Total time (s)             %.6f\n",
+           stats->totalTime);
+   fprintf(out, "   Records read               %lu", stats->records);
+   if(stats->totalTime > 0.0)
+      fprintf(out, " (%.1f per second)",
+              stats->records / stats->totalTime);
+   fprintf(out, "\n");
+   fprintf(out, "   Records in error           %lu\n", stats->errors);
+   fprintf(out, "   Duplicate records          %lu\n",
+           stats->duplicates);
+   fprintf(out, "   Key residue lookups        %lu\n", stats->lookups);
+   fprintf(out, "      Insert code fallbacks   %lu (%.2f%%)\n",
+           stats->fallbacks, 100.0 * Ratio(stats->fallbacks,
+                                           stats->lookups));
+   fprintf(out, "      Scanned                 %lu (%.2f%%)\n",
+           stats->scans, 100.0 * Ratio(stats->scans, stats->lookups));
+   fprintf(out, "   Cache hits                 %lu (%.2f%%)\n",
+           stats->cacheHits, 100.0 * Ratio(stats->cacheHits, seen));
+   fprintf(out, "   Cache misses               %lu\n",
+           stats->cacheMisses);
+   fprintf(out, "   Cache evictions            %lu\n",
+           stats->cacheEvictions);
+
+   fprintf(out, "   CDR      Loops  Missing  Matched  Classes/loop  \
+Kernel  Early exits  Chains  Links/chain     Tree  Steps/tree\n");
+   for(cdr=0; cdr<NCDR; cdr++)
+   {
+      if((stats->loops[cdr] == 0) && (stats->missing[cdr] == 0))
+         continue;
+      fprintf(out, "   %-3s %10lu %8lu %8lu %13.2f %7lu %12lu %7lu \
+%12.2f %8lu %11.2f\n",
+              sCDRName[cdr], stats->loops[cdr], stats->missing[cdr],
+              stats->matched[cdr],
+              Ratio(stats->classesTested[cdr], stats->loops[cdr]),
+              stats->kernelLoops[cdr], stats->earlyExits[cdr],
+              stats->chainWalks[cdr],
+              Ratio(stats->chainLinks[cdr], stats->chainWalks[cdr]),
+              stats->treeLoops[cdr],
+              Ratio(stats->treeSteps[cdr], stats->treeLoops[cdr]));
+   }
+}
@@ -8,12 +8,40 @@ set -o pipefail
 # -c Specify Chothia datafile (Default: chothia.dat)
 # -v Verbose; give explanations when no canonical found
 # -n The sequence file has Chothia (rather than Kabat) numbering
+# -b Batch mode; the sequence file contains many records
+# -j Number of threads to use in batch mode
+# -r The sequence file contains raw (FASTA or PIR) sequences
+# -f Output format (text, json, tsv or arrow)
+# -m Size of the classification cache in batch mode
+# -u Output each distinct sequence once with a count of records
+# -t Translate the numbering of the sequence file using a file
+# -H Input only contains heavy chain
+# -k Give the highest scoring classes for each CDR
+# -g Classify batch records in blocks
+# -M Classify against each method listed in a file
+# -e Matching engine (scan or tree)
     
-rm -f ./test?.out
+rm -f ./test*.out
 
 ../chothia -c ./chothia.dat.ex1 -v ./numbered.kabat.dat > test1.out 2>&1 
 ../chothia -c ./chothia.dat.ex2 -v ./numbered.kabat.dat > test2.out 2>&1 
 ../chothia -c ./chothia.dat.ex3 -v ./numbered.kabat.dat > test3.out 2>&1 
+../chothia -c ./chothia.dat.ex1 -v -b ./numbered.batch.dat > test4.out 2>&1 
+../chothia -c ./chothia.dat.ex1 -v -j 2 ./numbered.batch.dat > test5.out 2>&1 
+../chothia -c ./chothia.dat.ex1 -v -r -b ./raw.fasta > test6.out 2>&1 
+../chothia -c ./chothia.dat.ex1 -f json -b ./numbered.batch.dat > test7.out 2>&1 
+../chothia -c ./chothia.dat.ex1 -v -m 1 -b ./numbered.batch.dat > test8.out 2>&1 
+../chothia -c ./chothia.dat.ex1 -v -u ./numbered.batch.dat > test9.out 2>&1 
+../chothia -c ./chothia.dat.ex1 -v -t ../data/numbering.kabat_chothia ./numbered.kabat.dat > test10.out 2>&1 
+../chothia -c ./chothia.dat.ex4 -v -H -b ./numbered.heavy.dat > test11.out 2>&1 
+../chothia -c ./chothia.dat.ex4 -H -k 3 -b ./numbered.heavy.dat > test12.out 2>&1 
+../chothia -c ./chothia.dat.ex1 -v -g -d ./numbered.batch.dat > test13.out 2>&1 
+../chothia -M ../data/canonical_method.txt -v -b ./numbered.batch.dat > test14.out 2>&1 
+../chothia -c ./chothia.dat.ex5 -v ./numbered.kabat.dat > test15.out 2>&1 
+../chothia -c ./chothia.dat.ex4 -v -e tree -H -b ./numbered.heavy.dat > test16.out 2>&1 
+../chothia -c ../data/chothia.dat.auto -v ./numbered.kabat.dat > test17.out 2>&1 
+../chothia -c ../data/chothia.dat.auto -v -n ./numbered.chothia.dat > test18.out 2>&1 
+../chothia -c ../data/chothia.dat.auto -v -t ../data/numbering.imgt_chothia ./numbered.imgt.dat > test19.out 2>&1 
 
 echo "chothia tests passed"
 
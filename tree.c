@@ -0,0 +1,533 @@
+/*************************************************************************
+
+   Program:    Chothia
+   File:       tree.c
+
+   Version:    V2.27
+   Date:       16.10.26
+   Function:   Decision trees over the key positions of the classes of
+               each bucket
+
+   Copyright:  (c) Prof. Andrew C. R. Martin, UCL 1995-2026
+   Author:     Prof. Andrew C. R. Martin
+   Address:    Biomolecular Structure & Modelling Unit,
+               Department of Biochemistry & Molecular Biology,
+               University College,
+               Gower Street,
+               London.
+               WC1E 6BT.
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Part of libchothia. For each bucket of candidates (loop and length)
+   which has masks in the MATCHKERNEL, a CLASSTREE holds a decision
+   tree which finds the first class, in the order of the links of the
+   candidates, matched exactly by a loop. This is the class that
+   ClassifyLoop() assigns.
+
+   Each node tests the residue at one key position and has a branch
+   for each residue type (A-Z, anything else, or missing) leading to
+   another node or a leaf. A leaf gives the class matched, or says that
+   no class matches. The classes still possible at a node are those
+   allowing all the residues tested on the way to it. Once the first
+   of these has had all its key positions tested, it is the match, so
+   a loop only has the positions on its path looked up. The position
+   tested at each node is the one which leaves the fewest classes
+   possible on its largest branch, so the most discriminating
+   positions are tested first. Residue types leading to the same
+   classes share a branch, and leaves are shared between nodes.
+
+   A tree says nothing about the mismatches of a loop that matches no
+   class, so the nearest class must then be found by counting them as
+   before. Buckets whose tree would need more than MAXTREENODES nodes
+   have no tree.
+
+   The trees are not modified once built, so may be shared between
+   threads.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.27 16.10.26 Original
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chothia.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define TREEBRANCHES 28          /* Residue types: A-Z, any other, and
+                                    missing                             */
+#define TREEOTHER    26          /* Branches for any other residue and  */
+#define TREEMISSING  27          /*    for a missing one                */
+#define MAXTREENODES 4096        /* Max nodes in the tree of a bucket   */
+#define LANEWORDS    ((MAXMATCHLANES + 31) / 32)
+                                 /* Words of a set of classes, one bit
+                                    each                                */
+
+/* Residue type bit (as in the masks of the MATCHKERNEL) of a branch    */
+#define BRANCHBIT(t) (((t) == TREEMISSING) ? MATCH_MISSING : (1U << (t)))
+#define ALLBRANCHES  (((1U << (TREEOTHER + 1)) - 1U) | MATCH_MISSING)
+
+struct _classtree
+{
+   int           *root,             /* Root of the tree of each bucket  */
+                 *nodeKey,          /* Key position tested at each node */
+                 *next,             /* Node or leaf reached by each
+                                       branch of each node              */
+                 nNode,             /* Nodes used                       */
+                 maxNode;           /*    and allocated                 */
+   unsigned char *built;            /* Does each bucket have a tree?    */
+   BOOL          noMemory;          /* Allocation failed while building */
+};
+
+/************************************************************************/
+/* Prototypes
+*/
+BOOL BuildTreeNode(CLASSTREE *tree, unsigned int *masks, int nLane,
+                   int nKeys, int *live, int nLive, char *tested,
+                   int firstNode, int *node);
+int  ChooseTreeKey(unsigned int *masks, int nLane, int nKeys, int *live,
+                   int nLive, char *tested);
+int  GroupBranches(unsigned int *masks, int nLane, int pos, int *live,
+                   int nLive, unsigned int *types, int *size);
+
+
+/************************************************************************/
+/*>CLASSTREE *BuildClassTree(CANONTABLE *table, MATCHKERNEL *kernel)
+   -----------------------------------------------------------------
+   Input:   CANONTABLE  *table    Compiled canonical definitions
+            MATCHKERNEL *kernel   Matching kernel built from them
+   Returns: CLASSTREE   *         The trees (NULL if no memory)
+
+   Builds the decision tree of each bucket which has masks
+
+   16.10.26 Original    By: ACRM
+*/
+CLASSTREE *BuildClassTree(CANONTABLE *table, MATCHKERNEL *kernel)
+{
+   CLASSTREE    *tree;
+   CANDIDATE    *first;
+   unsigned int *masks;
+   char         tested[MAXMATCHKEYS];
+   int          live[MAXMATCHLANES],
+                nBucket = NLOOPDEF * (table->maxLength + 1),
+                nLane,
+                nKeys,
+                nClass,
+                start,
+                b, lane;
+
+   if((tree = (CLASSTREE *)calloc(1, sizeof(CLASSTREE)))==NULL)
+      return(NULL);
+
+   tree->maxNode = 256;
+   tree->root    = (int *)calloc(nBucket, sizeof(int));
+   tree->built   = (unsigned char *)calloc(nBucket,
+                                           sizeof(unsigned char));
+   tree->nodeKey = (int *)malloc(tree->maxNode * sizeof(int));
+   tree->next    = (int *)malloc(tree->maxNode * TREEBRANCHES *
+                                 sizeof(int));
+   if((tree->root == NULL) || (tree->built == NULL) ||
+      (tree->nodeKey == NULL) || (tree->next == NULL))
+   {
+      FreeClassTree(tree);
+      return(NULL);
+   }
+
+   for(b=0; b<nBucket; b++)
+   {
+      if(!MatchKernelUsable(kernel, b))
+         continue;
+
+      /* Padding classes are left out                                   */
+      first  = &(table->candidates[table->buckets[b].first]);
+      nClass = first[table->buckets[b].n - 1].firstLink +
+               first[table->buckets[b].n - 1].nLink - first->firstLink;
+      masks  = MatchKernelMasks(kernel, b, &nLane);
+      MatchKernelKeys(kernel, b, &nKeys);
+      for(lane=0; lane<nClass; lane++)
+         live[lane] = lane;
+      memset(tested, 0, nKeys);
+
+      start = tree->nNode;
+      if(BuildTreeNode(tree, masks, nLane, nKeys, live, nClass, tested,
+                       start, &(tree->root[b])))
+      {
+         tree->built[b] = 1;
+      }
+      else
+      {
+         /* Out of memory, or too many nodes for this bucket            */
+         tree->nNode = start;
+         if(tree->noMemory)
+         {
+            FreeClassTree(tree);
+            return(NULL);
+         }
+      }
+   }
+
+   return(tree);
+}
+
+
+/************************************************************************/
+/*>void FreeClassTree(CLASSTREE *tree)
+   -----------------------------------
+   Input:   CLASSTREE   *tree     Decision trees (may be NULL)
+
+   16.10.26 Original    By: ACRM
+*/
+void FreeClassTree(CLASSTREE *tree)
+{
+   if(tree == NULL)
+      return;
+
+   if(tree->root != NULL)    free(tree->root);
+   if(tree->built != NULL)   free(tree->built);
+   if(tree->nodeKey != NULL) free(tree->nodeKey);
+   if(tree->next != NULL)    free(tree->next);
+   free(tree);
+}
+
+
+/************************************************************************/
+/*>BOOL ClassTreeUsable(CLASSTREE *tree, int bucket)
+   -------------------------------------------------
+   Input:   CLASSTREE   *tree     Decision trees (may be NULL)
+            int         bucket    Bucket of candidates
+   Returns: BOOL                  Does the bucket have a tree?
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL ClassTreeUsable(CLASSTREE *tree, int bucket)
+{
+   return((tree != NULL) && tree->built[bucket]);
+}
+
+
+/************************************************************************/
+/*>int ClassTreeRoot(CLASSTREE *tree, int bucket)
+   ----------------------------------------------
+   Input:   CLASSTREE   *tree     Decision trees
+            int         bucket    Bucket of candidates (must have a tree)
+   Returns: int                   Root node, or a leaf (see TREELANE())
+
+   16.10.26 Original    By: ACRM
+*/
+int ClassTreeRoot(CLASSTREE *tree, int bucket)
+{
+   return(tree->root[bucket]);
+}
+
+
+/************************************************************************/
+/*>int ClassTreeKey(CLASSTREE *tree, int node)
+   -------------------------------------------
+   Input:   CLASSTREE   *tree     Decision trees
+            int         node      Node (not a leaf)
+   Returns: int                   Key position tested at the node (as
+                                  from MatchKernelKeys())
+
+   16.10.26 Original    By: ACRM
+*/
+int ClassTreeKey(CLASSTREE *tree, int node)
+{
+   return(tree->nodeKey[node]);
+}
+
+
+/************************************************************************/
+/*>int ClassTreeNext(CLASSTREE *tree, int node, char res)
+   ------------------------------------------------------
+   Input:   CLASSTREE   *tree     Decision trees
+            int         node      Node (not a leaf)
+            char        res       Residue found at the key position
+                                  tested ('\0' if missing or deleted)
+   Returns: int                   The next node, or a leaf (negative;
+                                  see TREELANE())
+
+   16.10.26 Original    By: ACRM
+*/
+int ClassTreeNext(CLASSTREE *tree, int node, char res)
+{
+   int type;
+
+   if(res == '\0')
+      type = TREEMISSING;
+   else if((res >= 'A') && (res <= 'Z'))
+      type = res - 'A';
+   else
+      type = TREEOTHER;
+
+   return(tree->next[node*TREEBRANCHES + type]);
+}
+
+
+/************************************************************************/
+/*>BOOL BuildTreeNode(CLASSTREE *tree, unsigned int *masks, int nLane,
+                      int nKeys, int *live, int nLive, char *tested,
+                      int firstNode, int *node)
+   -------------------------------------------------------------------
+   I/O:     CLASSTREE    *tree      Decision trees
+            char         *tested    Flag for each key position tested
+                                    on the way to this node (restored
+                                    on return)
+   Input:   unsigned int *masks     Masks of the bucket (MATCHKERNEL)
+            int          nLane      Classes (padded) in the masks
+            int          nKeys      Key positions of the bucket
+            int          *live      Classes still possible, in order
+            int          nLive      Number of classes still possible
+            int          firstNode  First node of the tree of this
+                                    bucket
+   Output:  int          *node      The node built, or a leaf
+   Returns: BOOL                    Success? (FALSE if the tree is
+                                    too big, or if out of memory when
+                                    tree->noMemory is set)
+
+   Builds the (sub)tree which resolves the classes still possible once
+   the positions flagged in tested have been tested
+
+   16.10.26 Original    By: ACRM
+*/
+BOOL BuildTreeNode(CLASSTREE *tree, unsigned int *masks, int nLane,
+                   int nKeys, int *live, int nLive, char *tested,
+                   int firstNode, int *node)
+{
+   unsigned int types[TREEBRANCHES];
+   int          size[TREEBRANCHES],
+                child[MAXMATCHLANES],
+                nChild,
+                nGroup,
+                pos,
+                sub,
+                g, t, i, n;
+   int          *nodeKey,
+                *next;
+   BOOL         ok = TRUE;
+
+   if(nLive == 0)
+   {
+      *node = TREELEAF(-1);
+      return(TRUE);
+   }
+
+   /* The first class still possible matches if all its key positions
+      have been tested
+   */
+   for(pos=0; pos<nKeys; pos++)
+   {
+      if(!tested[pos] &&
+         ((masks[pos*nLane + live[0]] & ALLBRANCHES) != ALLBRANCHES))
+         break;
+   }
+   if(pos == nKeys)
+   {
+      *node = TREELEAF(live[0]);
+      return(TRUE);
+   }
+
+   pos = ChooseTreeKey(masks, nLane, nKeys, live, nLive, tested);
+
+   /* Make the node                                                     */
+   if(tree->nNode - firstNode >= MAXTREENODES)
+      return(FALSE);
+   if(tree->nNode == tree->maxNode)
+   {
+      if((nodeKey = (int *)realloc(tree->nodeKey, 2 * tree->maxNode *
+                                   sizeof(int))) != NULL)
+         tree->nodeKey = nodeKey;
+      if((next = (int *)realloc(tree->next, 2 * tree->maxNode *
+                                TREEBRANCHES * sizeof(int))) != NULL)
+         tree->next = next;
+      if((nodeKey == NULL) || (next == NULL))
+      {
+         tree->noMemory = TRUE;
+         return(FALSE);
+      }
+      tree->maxNode *= 2;
+   }
+   n = tree->nNode++;
+   tree->nodeKey[n] = pos;
+   *node = n;
+
+   /* Build the child of each group of residue types. The arrays may
+      move as children are added, so are indexed afresh each time
+   */
+   nGroup = GroupBranches(masks, nLane, pos, live, nLive, types, size);
+   tested[pos] = 1;
+   for(g=0; ok && (g<nGroup); g++)
+   {
+      nChild = 0;
+      for(i=0; i<nLive; i++)
+      {
+         if(masks[pos*nLane + live[i]] & types[g])
+            child[nChild++] = live[i];
+      }
+      if((ok = BuildTreeNode(tree, masks, nLane, nKeys, child, nChild,
+                             tested, firstNode, &sub)))
+      {
+         for(t=0; t<TREEBRANCHES; t++)
+         {
+            if(types[g] & BRANCHBIT(t))
+               tree->next[n*TREEBRANCHES + t] = sub;
+         }
+      }
+   }
+   tested[pos] = 0;
+
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>int ChooseTreeKey(unsigned int *masks, int nLane, int nKeys,
+                     int *live, int nLive, char *tested)
+   ------------------------------------------------------------
+   Input:   unsigned int *masks     Masks of the bucket (MATCHKERNEL)
+            int          nLane      Classes (padded) in the masks
+            int          nKeys      Key positions of the bucket
+            int          *live      Classes still possible, in order
+            int          nLive      Number of classes still possible
+            char         *tested    Flag for each key position tested
+   Returns: int                     Key position to test next
+
+   Chooses the untested key position, constrained by one of the
+   classes still possible, which leaves the fewest classes on its
+   largest branch, then the fewest over all its branches. At least
+   one such position must remain.
+
+   16.10.26 Original    By: ACRM
+*/
+int ChooseTreeKey(unsigned int *masks, int nLane, int nKeys, int *live,
+                  int nLive, char *tested)
+{
+   unsigned int types[TREEBRANCHES];
+   int size[TREEBRANCHES],
+       best     = (-1),
+       bestMax  = 0,
+       bestSum  = 0,
+       nGroup,
+       largest,
+       sum,
+       pos,
+       g, i;
+
+   for(pos=0; pos<nKeys; pos++)
+   {
+      if(tested[pos])
+         continue;
+      for(i=0; i<nLive; i++)
+      {
+         if((masks[pos*nLane + live[i]] & ALLBRANCHES) != ALLBRANCHES)
+            break;
+      }
+      if(i == nLive)
+         continue;
+
+      nGroup  = GroupBranches(masks, nLane, pos, live, nLive, types,
+                              size);
+      largest = sum = 0;
+      for(g=0; g<nGroup; g++)
+      {
+         sum += size[g];
+         if(size[g] > largest)
+            largest = size[g];
+      }
+      if((best < 0) || (largest < bestMax) ||
+         ((largest == bestMax) && (sum < bestSum)))
+      {
+         best    = pos;
+         bestMax = largest;
+         bestSum = sum;
+      }
+   }
+
+   return(best);
+}
+
+
+/************************************************************************/
+/*>int GroupBranches(unsigned int *masks, int nLane, int pos, int *live,
+                     int nLive, unsigned int *types, int *size)
+   ---------------------------------------------------------------------
+   Input:   unsigned int *masks     Masks of the bucket (MATCHKERNEL)
+            int          nLane      Classes (padded) in the masks
+            int          pos        Key position
+            int          *live      Classes still possible, in order
+            int          nLive      Number of classes still possible
+   Output:  unsigned int *types     Residue type bits of each group
+                                    (up to TREEBRANCHES)
+            int          *size      Classes allowing the types of each
+                                    group
+   Returns: int                     Number of groups
+
+   Groups the residue types at a key position by the classes still
+   possible which allow them. Starting from one group of all the types,
+   each group is split by the types each class allows.
+
+   16.10.26 Original    By: ACRM
+*/
+int GroupBranches(unsigned int *masks, int nLane, int pos, int *live,
+                  int nLive, unsigned int *types, int *size)
+{
+   unsigned int allowed;
+   int          nGroup = 1,
+                g, i, n;
+
+   types[0] = ALLBRANCHES;
+   for(i=0; i<nLive; i++)
+   {
+      allowed = masks[pos*nLane + live[i]] & ALLBRANCHES;
+      for(g=0, n=nGroup; g<n; g++)
+      {
+         if((types[g] & allowed) && (types[g] & ~allowed))
+         {
+            types[nGroup++] = types[g] & ~allowed;
+            types[g]       &= allowed;
+         }
+      }
+   }
+
+   for(g=0; g<nGroup; g++)
+   {
+      size[g] = 0;
+      for(i=0; i<nLive; i++)
+      {
+         if(masks[pos*nLane + live[i]] & types[g])
+            size[g]++;
+      }
+   }
+
+   return(nGroup);
+}